@@ -1,10 +1,17 @@
 #include "obs_scene_tree_view/obs_scene_tree_view.h"
 
+#include "obs_scene_tree_view/stv_stats.h"
+#include "obs_scene_tree_view/stv_tree_commands.h"
+#include "obs_scene_tree_view/stv_tree_publisher.h"
 #include "obs_scene_tree_view/version.h"
 
+#include <QElapsedTimer>
+#include <QKeySequence>
 #include <QLineEdit>
+#include <QSet>
 #include <QAction>
 #include <QtWidgets/QComboBox>
+#include <QtWidgets/QListView>
 #include <QtWidgets/QListWidget>
 #include <QtWidgets/QMainWindow>
 #include <QtWidgets/QMenu>
@@ -14,6 +21,8 @@
 #include <obs-module.h>
 #include <util/platform.h>
 
+#include <algorithm>
+
 
 OBS_DECLARE_MODULE();
 OBS_MODULE_AUTHOR("DigitOtter");
@@ -31,36 +40,54 @@ MODULE_EXPORT const char *obs_module_name(void)
 
 bool obs_module_load()
 {
+	QElapsedTimer timer;
+	timer.start();
+
 	blog(LOG_INFO, "[%s] loaded version %s", obs_module_name(), PROJECT_VERSION);
 
 	BPtr<char> stv_config_path = obs_module_config_path("");
 	if(!os_mkdir(stv_config_path))
 		blog(LOG_WARNING, "[%s] failed to create config dir '%s'", obs_module_name(), stv_config_path.Get());
 
+	StvTreePublisher::Get().RegisterProcs(obs_get_proc_handler());
+	StvTreeCommands::Get().RegisterProcs(obs_get_proc_handler());
+
+	// All docks share the service's model, so it must exist before the first dock
 	QMainWindow *main_window = reinterpret_cast<QMainWindow*>(obs_frontend_get_main_window());
-	obs_frontend_push_ui_translation(obs_module_get_string);
-	obs_frontend_add_dock(new ObsSceneTreeView(main_window));
-	obs_frontend_pop_ui_translation();
+	StvTreeService::Create(main_window).CreateDocks();
+
+	StvStats::Get().RecordModuleLoad(timer.nsecsElapsed());
 
 	return true;
 }
 
 MODULE_EXPORT void obs_module_unload()
-{}
+{
+	StvStats::Get().Log();
+}
 
 #define QT_UTF8(str) QString::fromUtf8(str)
 #define QT_TO_UTF8(str) str.toUtf8().constData()
 
 
-ObsSceneTreeView::ObsSceneTreeView(QMainWindow *main_window)
+ObsSceneTreeView::ObsSceneTreeView(QMainWindow *main_window, int dock_id)
     : QDockWidget(dynamic_cast<QWidget*>(main_window)),
       _add_scene_act(main_window->findChild<QAction*>("actionAddScene")),
       _remove_scene_act(main_window->findChild<QAction*>("actionRemoveScene")),
-      _toggle_toolbars_scene_act(main_window->findChild<QAction*>("toggleListboxToolbars"))
+      _toggle_toolbars_scene_act(main_window->findChild<QAction*>("toggleListboxToolbars")),
+      _undo_act(new QAction(obs_module_text("SceneTreeView.Undo"), this)),
+      _redo_act(new QAction(obs_module_text("SceneTreeView.Redo"), this)),
+      _dock_id(dock_id),
+      _service(StvTreeService::Get()),
+      _scene_tree_items(_service.GetModel())
 {
 	config_t *const global_config = obs_frontend_get_global_config();
 	config_set_default_bool(global_config, "SceneTreeView", "ShowSceneIcons", false);
 	config_set_default_bool(global_config, "SceneTreeView", "ShowFolderIcons", false);
+	config_set_default_bool(global_config, "SceneTreeView", "CompactRendering", false);
+	config_set_default_bool(global_config, "SceneTreeView", "GridMode", false);
+	config_set_default_bool(global_config, "SceneTreeView", "ShowRecentScenes", true);
+	config_set_default_bool(global_config, "SceneTreeView", "RecentScenesExpanded", true);
 
 	assert(this->_add_scene_act);
 	assert(this->_remove_scene_act);
@@ -68,71 +95,268 @@ ObsSceneTreeView::ObsSceneTreeView(QMainWindow *main_window)
 	this->_stv_dock.setupUi(this);
 	this->hide();
 
-	this->_stv_dock.stvTree->SetItemModel(&this->_scene_tree_items);
+	// OBS restores dock positions by object name
+	if(this->_dock_id != StvTreeService::PRIMARY_DOCK_ID)
+	{
+		this->setObjectName(this->objectName() + QString::number(this->_dock_id));
+		this->setWindowTitle(QString("%1 %2").arg(obs_module_text("SceneTreeView.Title"), QString::number(this->_dock_id+1)));
+	}
+
+	this->_stv_dock.stvTree->SetItemModel(&this->_scene_tree_items, this->_dock_id == StvTreeService::PRIMARY_DOCK_ID);
 	this->_stv_dock.stvTree->setDefaultDropAction(Qt::DropAction::MoveAction);
+	this->_stv_dock.stvTree->SetCompactMode(config_get_bool(global_config, "SceneTreeView", "CompactRendering"));
+
+	// The grid shows the same model with the same selection, so switching modes doesn't copy any items
+	this->_stv_dock.stvGridView->SetItemModel(&this->_scene_tree_items, this->_stv_dock.stvTree);
+	this->_stv_dock.stvBreadcrumbs->SetFolder(&this->_scene_tree_items, QModelIndex());
+	this->SetGridMode(config_get_bool(global_config, "SceneTreeView", "GridMode"));
+
+	// Recent scenes are shown in a separate list, so the tree never contains the same scene twice
+	this->_stv_dock.stvRecentList->setModel(&this->_service.GetRecentModel());
+	this->_stv_dock.stvRecentHeader->setChecked(config_get_bool(global_config, "SceneTreeView", "RecentScenesExpanded"));
+	this->UpdateRecentScenes();
+
+	QObject::connect(this->_stv_dock.stvGridView, &StvGridView::FolderChanged, this, [this](const QModelIndex &folder) {
+		this->_stv_dock.stvBreadcrumbs->SetFolder(&this->_scene_tree_items, folder);
+	});
+	QObject::connect(this->_stv_dock.stvBreadcrumbs, &StvBreadcrumbBar::FolderSelected,
+	                 this->_stv_dock.stvGridView, &StvGridView::SetFolder);
 
 	const bool show_icons = config_get_bool(global_config, "BasicWindow", "ShowListboxToolbars");
 	this->on_toggleListboxToolbars(show_icons);
 
-	// Add callback to obs scene list change event
-	obs_frontend_add_event_callback(&ObsSceneTreeView::obs_frontend_event_cb, this);
-	obs_frontend_add_save_callback(&ObsSceneTreeView::obs_frontend_save_cb, this);
+	// Frontend events are handled once by the service, docks only update their views
+	QObject::connect(&this->_service, &StvTreeService::TreeLoaded, this, [this]() {
+		this->RestoreRootFolder();
+		this->RestoreExpandedFolders();
+		this->SelectCurrentScene();
+	});
+	QObject::connect(&this->_service, &StvTreeService::FinishedLoading, this, &ObsSceneTreeView::UpdateIcons);
+	QObject::connect(&this->_service, &StvTreeService::CurrentSceneChanged, this, &ObsSceneTreeView::SelectCurrentScene);
+	QObject::connect(&this->_service, &StvTreeService::RecentScenesChanged, this, &ObsSceneTreeView::UpdateRecentScenes);
+
+	// The context menu is cached. Transition entries and icons are rebuilt on the next open
+	QObject::connect(&this->_service, &StvTreeService::TransitionListChanged, this, [this]() {
+		this->_context_menu_outdated = true;
+	});
+	QObject::connect(&this->_service, &StvTreeService::ThemeChanged, this, [this]() {
+		this->_context_menu_outdated = true;
+		this->UpdateIcons();
+	});
+
+	// Moving the root folder takes it out of the tree and inserts it again
+	QObject::connect(&this->_scene_tree_items, &QAbstractItemModel::rowsInserted, this, [this]() {
+		if(this->_root_folder_id != 0)
+			this->ApplyRootFolder();
+	});
+
+	QObject::connect(this->_stv_dock.stvTree, &StvItemView::ExpandedFoldersChanged, this, &ObsSceneTreeView::SaveExpandedFolders);
+
+	// New scenes are added next to the current item of the dock used last
+	QObject::connect(this->_stv_dock.stvTree->selectionModel(), &QItemSelectionModel::currentChanged, this, [this](const QModelIndex &current) {
+		this->_service.SetInsertIndex(current);
+	});
+
+	// Docks added after loading missed the service's signals
+	if(this->_service.IsLoaded())
+	{
+		this->RestoreRootFolder();
+		this->RestoreExpandedFolders();
+		this->SelectCurrentScene();
+		this->UpdateIcons();
+	}
 
 	QObject::connect(this->_stv_dock.stvAdd, &QToolButton::released, this->_add_scene_act, &QAction::trigger);
 
 	QObject::connect(this->_stv_dock.stvTree->itemDelegate(), SIGNAL(closeEditor(QWidget*,QAbstractItemDelegate::EndEditHint)),
 	                 this, SLOT(on_SceneNameEdited(QWidget*)));
 	                //main_window, SLOT(SceneNameEdited(QWidget*,QAbstractItemDelegate::EndEditHint)));
+	QObject::connect(this->_stv_dock.stvGridView->itemDelegate(), SIGNAL(closeEditor(QWidget*,QAbstractItemDelegate::EndEditHint)),
+	                 this, SLOT(on_SceneNameEdited(QWidget*)));
 
 	QObject::connect(this->_toggle_toolbars_scene_act, &QAction::triggered, this, &ObsSceneTreeView::on_toggleListboxToolbars);
 
-	this->_stv_dock.stvTree->setModel(&(this->_scene_tree_items));
+	// Only active while the dock has focus, so OBS keeps its own undo shortcuts everywhere else
+	this->_undo_act->setShortcut(QKeySequence::Undo);
+	this->_undo_act->setShortcutContext(Qt::WidgetWithChildrenShortcut);
+	this->addAction(this->_undo_act);
+	QObject::connect(this->_undo_act, &QAction::triggered, this, [this]() {
+		this->_scene_tree_items.Undo();
+	});
+
+	this->_redo_act->setShortcut(QKeySequence::Redo);
+	this->_redo_act->setShortcutContext(Qt::WidgetWithChildrenShortcut);
+	this->addAction(this->_redo_act);
+	QObject::connect(this->_redo_act, &QAction::triggered, this, [this]() {
+		this->_scene_tree_items.Redo();
+	});
+
 }
 
 ObsSceneTreeView::~ObsSceneTreeView()
+{}
+
+int ObsSceneTreeView::GetDockId() const
 {
-	// Remove frontend cb
-	obs_frontend_remove_save_callback(&ObsSceneTreeView::obs_frontend_save_cb, this);
-	obs_frontend_remove_event_callback(&ObsSceneTreeView::obs_frontend_event_cb, this);
+	return this->_dock_id;
 }
 
-void ObsSceneTreeView::SaveSceneTree(const char *scene_collection)
+namespace
 {
-	if(!scene_collection)
-		return;
+	obs_data_t *create_folder_path_data(const std::vector<QString> &folder_path)
+	{
+		OBSDataArrayAutoRelease path_array = obs_data_array_create();
+		for(const QString &folder_name : folder_path)
+		{
+			OBSDataAutoRelease folder_data = obs_data_create();
+			obs_data_set_string(folder_data, ObsSceneTreeView::FOLDER_NAME_DATA.data(), QT_TO_UTF8(folder_name));
+			obs_data_array_push_back(path_array, folder_data);
+		}
+
+		obs_data_t *path_data = obs_data_create();
+		obs_data_set_array(path_data, ObsSceneTreeView::FOLDER_PATH_DATA.data(), path_array);
+		return path_data;
+	}
 
-	BPtr<char> stv_config_file_path = obs_module_config_path(SCENE_TREE_CONFIG_FILE.data());
+	std::vector<QString> read_folder_path_data(obs_data_t *path_data)
+	{
+		OBSDataArrayAutoRelease path_array = obs_data_get_array(path_data, ObsSceneTreeView::FOLDER_PATH_DATA.data());
 
-	OBSDataAutoRelease stv_data = obs_data_create_from_json_file(stv_config_file_path);
-	if(!stv_data)
-		stv_data = obs_data_create();
+		std::vector<QString> folder_path;
+		const size_t folder_count = obs_data_array_count(path_array);
+		for(size_t i=0; i < folder_count; ++i)
+		{
+			OBSDataAutoRelease folder_data = obs_data_array_item(path_array, i);
+			folder_path.push_back(QT_UTF8(obs_data_get_string(folder_data, ObsSceneTreeView::FOLDER_NAME_DATA.data())));
+		}
 
-	this->_scene_tree_items.SaveSceneTree(stv_data, scene_collection, this->_stv_dock.stvTree);
+		return folder_path;
+	}
 
-	if(!obs_data_save_json(stv_data, stv_config_file_path))
-		blog(LOG_WARNING, "[%s] Failed to save scene tree in '%s'", obs_module_name(), stv_config_file_path.Get());
+	std::vector<std::vector<QString>> read_expanded_folders_config(const QString &config_name)
+	{
+		std::vector<std::vector<QString>> folder_paths;
+		const char *folders_json = config_get_string(obs_frontend_get_global_config(), "SceneTreeView", QT_TO_UTF8(config_name));
+		if(!folders_json || !*folders_json)
+			return folder_paths;
+
+		OBSDataAutoRelease folders_data = obs_data_create_from_json(folders_json);
+		OBSDataArrayAutoRelease folders_array = obs_data_get_array(folders_data, ObsSceneTreeView::EXPANDED_FOLDERS_DATA.data());
+
+		const size_t folder_count = obs_data_array_count(folders_array);
+		for(size_t i=0; i < folder_count; ++i)
+		{
+			OBSDataAutoRelease path_data = obs_data_array_item(folders_array, i);
+			folder_paths.push_back(read_folder_path_data(path_data));
+		}
+
+		return folder_paths;
+	}
 }
 
-void ObsSceneTreeView::LoadSceneTree(const char *scene_collection)
+void ObsSceneTreeView::SetRootFolder(QStandardItem *folder)
 {
-	assert(scene_collection);
+	this->_root_folder_id = folder && folder->type() == StvItemModel::FOLDER ? static_cast<StvFolderItem*>(folder)->GetId() : 0;
+	this->ApplyRootFolder();
 
-	BPtr<char> stv_config_file_path = obs_module_config_path(SCENE_TREE_CONFIG_FILE.data());
+	// Folder ids aren't stored, so remember the folder by its path
+	OBSDataAutoRelease path_data = create_folder_path_data(this->_scene_tree_items.GetFolderPath(folder));
 
-	OBSDataAutoRelease stv_data = obs_data_create_from_json_file(stv_config_file_path);
-	this->_scene_tree_items.LoadSceneTree(stv_data, scene_collection, this->_stv_dock.stvTree);
+	const QString config_name = QString(ROOT_FOLDER_CONFIG.data()).arg(this->_dock_id);
+	config_set_string(obs_frontend_get_global_config(), "SceneTreeView", QT_TO_UTF8(config_name), folder ? obs_data_get_json(path_data) : "");
 }
 
-void ObsSceneTreeView::UpdateTreeView()
+void ObsSceneTreeView::RestoreRootFolder()
 {
-	obs_frontend_source_list scene_list = {};
-	obs_frontend_get_scenes(&scene_list);
+	const QString config_name = QString(ROOT_FOLDER_CONFIG.data()).arg(this->_dock_id);
+	const char *path_json = config_get_string(obs_frontend_get_global_config(), "SceneTreeView", QT_TO_UTF8(config_name));
+
+	QStandardItem *folder = nullptr;
+	if(path_json && *path_json)
+	{
+		OBSDataAutoRelease path_data = obs_data_create_from_json(path_json);
+		folder = this->_scene_tree_items.FindFolder(read_folder_path_data(path_data));
+	}
 
-	this->_scene_tree_items.UpdateTree(scene_list, this->_stv_dock.stvTree->currentIndex());
+	// Keep the stored path if this tree doesn't contain the folder, another scene collection might
+	this->_root_folder_id = folder && folder->type() == StvItemModel::FOLDER ? static_cast<StvFolderItem*>(folder)->GetId() : 0;
+	this->ApplyRootFolder();
+}
 
-	obs_frontend_source_list_free(&scene_list);
+void ObsSceneTreeView::ApplyRootFolder()
+{
+	StvFolderItem *folder = this->_scene_tree_items.GetFolderItem(this->_root_folder_id);
+	const QModelIndex root_index = folder ? folder->index() : QModelIndex();
+	if(root_index == this->_stv_dock.stvTree->rootIndex())
+		return;
 
-	this->SaveSceneTree(this->_scene_collection_name);
+	this->_stv_dock.stvTree->setRootIndex(root_index);
+	this->_stv_dock.stvGridView->SetFolder(root_index);
+}
+
+void ObsSceneTreeView::SaveExpandedFolders()
+{
+	if(this->_dock_id == StvTreeService::PRIMARY_DOCK_ID)
+		return;
+
+	const QString config_name = QString(EXPANDED_FOLDERS_CONFIG.data()).arg(this->_dock_id);
+
+	// Folders of this tree are stored again below if they are still expanded. Paths also change by renaming or moving
+	std::vector<std::vector<QString>> folder_paths = read_expanded_folders_config(config_name);
+	folder_paths.erase(std::remove_if(folder_paths.begin(), folder_paths.end(), [this](const std::vector<QString> &folder_path) {
+		return this->_scene_tree_items.FindFolder(folder_path) != nullptr;
+	}), folder_paths.end());
+
+	for(const uint64_t folder_id : this->_stv_dock.stvTree->GetExpandedFolders())
+	{
+		if(StvFolderItem *folder = this->_scene_tree_items.GetFolderItem(folder_id))
+			folder_paths.push_back(this->_scene_tree_items.GetFolderPath(folder));
+	}
+
+	OBSDataArrayAutoRelease folders_array = obs_data_array_create();
+	for(const std::vector<QString> &folder_path : folder_paths)
+	{
+		OBSDataAutoRelease path_data = create_folder_path_data(folder_path);
+		obs_data_array_push_back(folders_array, path_data);
+	}
+
+	OBSDataAutoRelease folders_data = obs_data_create();
+	obs_data_set_array(folders_data, EXPANDED_FOLDERS_DATA.data(), folders_array);
+
+	config_set_string(obs_frontend_get_global_config(), "SceneTreeView", QT_TO_UTF8(config_name),
+	                  folder_paths.empty() ? "" : obs_data_get_json(folders_data));
+}
+
+void ObsSceneTreeView::RestoreExpandedFolders()
+{
+	if(this->_dock_id == StvTreeService::PRIMARY_DOCK_ID)
+		return;
+
+	const QString config_name = QString(EXPANDED_FOLDERS_CONFIG.data()).arg(this->_dock_id);
+
+	QSet<uint64_t> folder_ids;
+	for(const std::vector<QString> &folder_path : read_expanded_folders_config(config_name))
+	{
+		QStandardItem *folder = this->_scene_tree_items.FindFolder(folder_path);
+		if(folder && folder->type() == StvItemModel::FOLDER)
+			folder_ids.insert(static_cast<StvFolderItem*>(folder)->GetId());
+	}
+
+	this->_stv_dock.stvTree->SetExpandedFolders(folder_ids);
+}
+
+void ObsSceneTreeView::UpdateIcons()
+{
+	// We're updating the icons after loading to allow the main_window to load themes first
+	// Set icons, force style sheet recalculation. Taken from obs source code, qt-wrappers.cpp, setThemeID()
+	QMainWindow *main_window = reinterpret_cast<QMainWindow*>(obs_frontend_get_main_window());
+	this->_stv_dock.stvAdd->setIcon(this->_add_scene_act->icon());
+	this->_stv_dock.stvRemove->setIcon(this->_remove_scene_act->icon());
+	this->_stv_dock.stvAddFolder->setIcon(main_window->property("groupIcon").value<QIcon>());
+
+	QString qss = this->styleSheet();
+	this->setStyleSheet("/* */");
+	this->setStyleSheet(qss);
 }
 
 void ObsSceneTreeView::on_toggleListboxToolbars(bool visible)
@@ -144,7 +368,13 @@ void ObsSceneTreeView::on_stvAddFolder_clicked()
 {
 	int row;
 	QStandardItem *selected = this->_scene_tree_items.itemFromIndex(this->_stv_dock.stvTree->currentIndex());
-	if(!selected)
+	if(this->IsGridMode() && (!selected || this->_scene_tree_items.GetParentOrRoot(selected->index()) != this->_stv_dock.stvGridView->GetFolderItem()))
+	{
+		// Add to the shown folder if the selected item isn't part of it
+		selected = this->_stv_dock.stvGridView->GetFolderItem();
+		row = selected->rowCount();
+	}
+	else if(!selected)
 	{
 		selected = this->_scene_tree_items.invisibleRootItem();
 		row = selected->rowCount();
@@ -171,10 +401,7 @@ void ObsSceneTreeView::on_stvAddFolder_clicked()
 		new_folder_name = format.arg(++i);
 	}
 
-	StvFolderItem *pItem = new StvFolderItem(new_folder_name);
-	selected->insertRow(row, pItem);
-
-	this->SaveSceneTree(this->_scene_collection_name);
+	this->_scene_tree_items.AddFolder(new_folder_name, selected, row);
 }
 
 void ObsSceneTreeView::on_stvRemove_released()
@@ -192,141 +419,318 @@ void ObsSceneTreeView::on_stvRemove_released()
 
 void ObsSceneTreeView::on_stvTree_customContextMenuRequested(const QPoint &pos)
 {
-	QStandardItem *item = this->_scene_tree_items.itemFromIndex(this->_stv_dock.stvTree->indexAt(pos));
+	this->ShowContextMenu(this->_scene_tree_items.itemFromIndex(this->_stv_dock.stvTree->indexAt(pos)));
+}
 
+void ObsSceneTreeView::on_stvGridView_customContextMenuRequested(const QPoint &pos)
+{
+	this->ShowContextMenu(this->_scene_tree_items.itemFromIndex(this->_stv_dock.stvGridView->indexAt(pos)));
+}
+
+void ObsSceneTreeView::ShowContextMenu(QStandardItem *item)
+{
+	if(!this->_context_menu || this->_context_menu_outdated)
+		this->CreateContextMenu();
+
+	this->_context_item = item ? item->index() : QModelIndex();
+	this->UpdateContextMenu(item);
+
+	this->_context_menu->exec(QCursor::pos());
+}
+
+void ObsSceneTreeView::CreateContextMenu()
+{
 	QMainWindow *main_window = reinterpret_cast<QMainWindow*>(obs_frontend_get_main_window());
 
-	QMenu popup(this);
+	this->_context_actions = CONTEXT_MENU_ACTIONS();
+	this->_context_menu = std::make_unique<QMenu>(this);
+	this->_context_menu_outdated = false;
+
+	CONTEXT_MENU_ACTIONS &actions = this->_context_actions;
+	QMenu &popup = *this->_context_menu;
 //	QMenu order(QTStr("Basic.MainMenu.Edit.Order"), this);
 
+	// Entries act on the item the menu was last opened on
+	const auto context_item = [this]() {
+		return this->_scene_tree_items.itemFromIndex(this->_context_item);
+	};
+
 	popup.addAction(obs_module_text("SceneTreeView.AddScene"),
 	                main_window, SLOT(on_actionAddScene_triggered()));
 
 	popup.addAction(obs_module_text("SceneTreeView.AddFolder"),
 	                this, SLOT(on_stvAddFolder_clicked()));
 
-	if(item)
-	{
-		if(item->type() == StvItemModel::SCENE)
-		{
-			QAction *copyFilters = new QAction(QTStr("Copy.Filters"), this);
-			copyFilters->setEnabled(false);
-			connect(copyFilters, SIGNAL(triggered()),
-			        main_window, SLOT(SceneCopyFilters()));
-			QAction *pasteFilters = new QAction(QTStr("Paste.Filters"), this);
-//			pasteFilters->setEnabled(
-//			    !obs_weak_source_expired(copyFiltersSource));			// Cannot use (we can't check copyFiltersSource, as it's a private member of OBSBasic)
-			connect(pasteFilters, SIGNAL(triggered()),
-			        main_window, SLOT(ScenePasteFilters()));
-
-			popup.addSeparator();
-			popup.addAction(QTStr("Duplicate"),
-			                main_window, SLOT(DuplicateSelectedScene()));
-			popup.addAction(copyFilters);
-			popup.addAction(pasteFilters);
-			popup.addSeparator();
-			QAction *rename = popup.addAction(QTStr("Rename"));
-			QObject::connect(rename, SIGNAL(triggered()), this->_stv_dock.stvTree, SLOT(EditSelectedItem()));
-			popup.addAction(QTStr("Remove"),
-			                main_window, SLOT(RemoveSelectedScene()));
-			popup.addSeparator();
-
-//			order.addAction(QTStr("Basic.MainMenu.Edit.Order.MoveUp"),
-//			                main_window, SLOT(on_actionSceneUp_triggered()));
-//			order.addAction(QTStr("Basic.MainMenu.Edit.Order.MoveDown"),
-//			        this, SLOT(on_actionSceneDown_triggered()));
-//			order.addSeparator();
-
-//			order.addAction(QTStr("Basic.MainMenu.Edit.Order.MoveToTop"),
-//			        this, SLOT(MoveSceneToTop()));
-//			order.addAction(QTStr("Basic.MainMenu.Edit.Order.MoveToBottom"),
-//				    this, SLOT(MoveSceneToBottom()));
-//			popup.addMenu(&order);
-
-//			popup.addSeparator();
-
-//			delete sceneProjectorMenu;
-//			sceneProjectorMenu = new QMenu(QTStr("SceneProjector"));
-//			AddProjectorMenuMonitors(sceneProjectorMenu, this,
-//				         SLOT(OpenSceneProjector()));
-//			popup.addMenu(sceneProjectorMenu);
-
-			QAction *sceneWindow = popup.addAction(QTStr("SceneWindow"),
-			                                       main_window, SLOT(OpenSceneWindow()));
-
-			popup.addAction(sceneWindow);
-			popup.addAction(QTStr("Screenshot.Scene"),
-			                main_window, SLOT(ScreenshotScene()));
-			popup.addSeparator();
-			popup.addAction(QTStr("Filters"),
-			                main_window, SLOT(OpenSceneFilters()));
-
-			popup.addSeparator();
-
-			this->_per_scene_transition_menu.reset(CreatePerSceneTransitionMenu(main_window));
-			popup.addMenu(this->_per_scene_transition_menu.get());
-
-			/* ---------------------- */
-
-			QAction *multiviewAction = popup.addAction(QTStr("ShowInMultiview"));
-
-			OBSSourceAutoRelease source = this->_scene_tree_items.GetCurrentScene();
-			OBSDataAutoRelease data = obs_source_get_private_settings(source);
-
-			obs_data_set_default_bool(data, "show_in_multiview", true);
-			bool show = obs_data_get_bool(data, "show_in_multiview");
-
-			multiviewAction->setCheckable(true);
-			multiviewAction->setChecked(show);
-
-			auto showInMultiview = [main_window](OBSData data) {
-				bool show =
-				    obs_data_get_bool(data, "show_in_multiview");
-				obs_data_set_bool(data, "show_in_multiview", !show);
-				// Workaround because OBSProjector::UpdateMultiviewProjectors() isn't available to modules
-				QMetaObject::invokeMethod(main_window, "ScenesReordered");
-			};
-
-			connect(multiviewAction, &QAction::triggered,
-			    std::bind(showInMultiview, data.Get()));
-
-			copyFilters->setEnabled(obs_source_filter_count(source) > 0);
-		}
+	popup.addSeparator();
 
-		popup.addSeparator();
+	// Separate actions, the dock's shortcut actions must stay enabled
+	actions.Undo = popup.addAction(this->_undo_act->text(), this->_undo_act, &QAction::trigger);
+	actions.Undo->setShortcut(this->_undo_act->shortcut());
 
-		// Enable/disable scene or folder icon
-		const auto toggleName = item->type() == StvItemModel::SCENE ? obs_module_text("SceneTreeView.ToggleSceneIcons") :
-		                                                              obs_module_text("SceneTreeView.ToggleFolderIcons");
+	actions.Redo = popup.addAction(this->_redo_act->text(), this->_redo_act, &QAction::trigger);
+	actions.Redo->setShortcut(this->_redo_act->shortcut());
 
-		QAction *toggleIconAction = popup.addAction(toggleName);
-		toggleIconAction->setCheckable(true);
+	const auto add_scene_action = [&actions](QAction *action) {
+		actions.SceneActions.push_back(action);
+		return action;
+	};
+
+	add_scene_action(popup.addSeparator());
+	add_scene_action(popup.addAction(QTStr("Duplicate"),
+	                                 main_window, SLOT(DuplicateSelectedScene())));
+	actions.CopyFilters = add_scene_action(popup.addAction(QTStr("Copy.Filters"),
+	                                                       main_window, SLOT(SceneCopyFilters())));
+	// Cannot check whether filters were copied, copyFiltersSource is a private member of OBSBasic
+	add_scene_action(popup.addAction(QTStr("Paste.Filters"),
+	                                 main_window, SLOT(ScenePasteFilters())));
+	add_scene_action(popup.addSeparator());
+	add_scene_action(popup.addAction(QTStr("Rename"), this, [this]() {
+		QMetaObject::invokeMethod(this->GetActiveView(), "EditSelectedItem");
+	}));
+	add_scene_action(popup.addAction(QTStr("Remove"),
+	                                 main_window, SLOT(RemoveSelectedScene())));
+	add_scene_action(popup.addSeparator());
+
+//	order.addAction(QTStr("Basic.MainMenu.Edit.Order.MoveUp"),
+//	                main_window, SLOT(on_actionSceneUp_triggered()));
+//	order.addAction(QTStr("Basic.MainMenu.Edit.Order.MoveDown"),
+//	        this, SLOT(on_actionSceneDown_triggered()));
+//	order.addSeparator();
+
+//	order.addAction(QTStr("Basic.MainMenu.Edit.Order.MoveToTop"),
+//	        this, SLOT(MoveSceneToTop()));
+//	order.addAction(QTStr("Basic.MainMenu.Edit.Order.MoveToBottom"),
+//		    this, SLOT(MoveSceneToBottom()));
+//	popup.addMenu(&order);
+
+//	popup.addSeparator();
+
+//	delete sceneProjectorMenu;
+//	sceneProjectorMenu = new QMenu(QTStr("SceneProjector"));
+//	AddProjectorMenuMonitors(sceneProjectorMenu, this,
+//		         SLOT(OpenSceneProjector()));
+//	popup.addMenu(sceneProjectorMenu);
+
+	add_scene_action(popup.addAction(QTStr("SceneWindow"),
+	                                 main_window, SLOT(OpenSceneWindow())));
+	add_scene_action(popup.addAction(QTStr("Screenshot.Scene"),
+	                                 main_window, SLOT(ScreenshotScene())));
+	add_scene_action(popup.addSeparator());
+	add_scene_action(popup.addAction(QTStr("Filters"),
+	                                 main_window, SLOT(OpenSceneFilters())));
+
+	add_scene_action(popup.addSeparator());
+
+	add_scene_action(popup.addAction(obs_module_text("SceneTreeView.ShowParentScenes"), [this, context_item]() {
+		if(QStandardItem *item = context_item())
+			this->HighlightSceneDependencies(item, StvItemModel::PARENT_SCENES);
+	}));
+	add_scene_action(popup.addAction(obs_module_text("SceneTreeView.ShowNestedScenes"), [this, context_item]() {
+		if(QStandardItem *item = context_item())
+			this->HighlightSceneDependencies(item, StvItemModel::NESTED_SCENES);
+	}));
+
+	popup.addSeparator();
+
+	actions.TransitionOverride = popup.addMenu(this->CreatePerSceneTransitionMenu(main_window, &popup));
+
+	/* ---------------------- */
+
+	actions.Multiview = add_scene_action(popup.addAction(QTStr("ShowInMultiview")));
+	actions.Multiview->setCheckable(true);
+
+	connect(actions.Multiview, &QAction::triggered, [this, main_window](bool show) {
+		OBSSourceAutoRelease source = this->_scene_tree_items.GetCurrentScene();
+		OBSDataAutoRelease data = obs_source_get_private_settings(source);
+
+		obs_data_set_bool(data, "show_in_multiview", show);
+		// Workaround because OBSProjector::UpdateMultiviewProjectors() isn't available to modules
+		QMetaObject::invokeMethod(main_window, "ScenesReordered");
+	});
+
+	popup.addSeparator();
+
+	// Enable/disable scene or folder icon
+	actions.ToggleIcons = popup.addAction(QString());
+	actions.ToggleIcons->setCheckable(true);
+
+	connect(actions.ToggleIcons, &QAction::triggered, [this, context_item](bool show) {
+		QStandardItem *item = context_item();
+		if(!item)
+			return;
 
 		const auto configName = item->type() == StvItemModel::SCENE ? "ShowSceneIcons" : "ShowFolderIcons";
-		const bool showIcon = config_get_bool(obs_frontend_get_global_config(), "SceneTreeView", configName);
+		config_set_bool(obs_frontend_get_global_config(), "SceneTreeView", configName, show);
+		this->_scene_tree_items.SetIconVisibility(show, (StvItemModel::QITEM_TYPE)item->type());
+	});
+
+	actions.SortFolder = popup.addAction(obs_module_text("SceneTreeView.SortFolder"));
+	actions.SortFolder->setCheckable(true);
+
+	connect(actions.SortFolder, &QAction::triggered, [this, context_item](bool sorted) {
+		this->_scene_tree_items.SetFolderSorted(context_item(), sorted);
+	});
+
+	actions.Playlist = this->CreatePlaylistMenu(&popup);
+	popup.addMenu(actions.Playlist);
+
+	actions.ClearHighlight = popup.addAction(obs_module_text("SceneTreeView.ClearHighlight"), [this]() {
+		this->_scene_tree_items.ClearHighlight();
+	});
+
+	popup.addSeparator();
+
+	actions.ShowOnlyFolder = popup.addAction(obs_module_text("SceneTreeView.ShowOnlyFolder"), [this, context_item]() {
+		if(QStandardItem *item = context_item())
+			this->SetRootFolder(item);
+	});
 
-		toggleIconAction->setChecked(showIcon);
+	actions.ShowAllFolders = popup.addAction(obs_module_text("SceneTreeView.ShowAllFolders"), [this]() {
+		this->SetRootFolder(nullptr);
+	});
 
-		auto toggleIcon = [this, showIcon, configName, item]() {
-			config_set_bool(obs_frontend_get_global_config(), "SceneTreeView", configName, !showIcon);
-			this->_scene_tree_items.SetIconVisibility(!showIcon, (StvItemModel::QITEM_TYPE)item->type());
-		};
+	// Filled by UpdateCanvasMenu(), canvases come and go with scene resizes
+	actions.Canvas = popup.addMenu(obs_module_text("SceneTreeView.Canvas"));
 
-		connect(toggleIconAction, &QAction::triggered, toggleIcon);
+	popup.addAction(obs_module_text("SceneTreeView.NewDock"), [this]() {
+		this->_service.AddDock();
+	});
+
+	if(this->_dock_id != StvTreeService::PRIMARY_DOCK_ID)
+	{
+		popup.addAction(obs_module_text("SceneTreeView.RemoveDock"), [this]() {
+			this->_service.RemoveDock(this);
+		});
 	}
 
-//	popup.addSeparator();
+	popup.addSeparator();
+
+	actions.Compact = popup.addAction(obs_module_text("SceneTreeView.CompactRendering"));
+	actions.Compact->setCheckable(true);
+
+	connect(actions.Compact, &QAction::triggered, [this](bool compact) {
+		config_set_bool(obs_frontend_get_global_config(), "SceneTreeView", "CompactRendering", compact);
+		this->_stv_dock.stvTree->SetCompactMode(compact);
+	});
+
+	popup.addAction(obs_module_text("SceneTreeView.LogStats"), [](){
+		StvStats::Get().Log();
+	});
+
+	popup.addSeparator();
 
-//	bool grid = ui->scenes->GetGridMode();
+	actions.RecentScenes = popup.addAction(obs_module_text("SceneTreeView.ShowRecentScenes"));
+	actions.RecentScenes->setCheckable(true);
 
-//	QAction *gridAction = new QAction(grid ? QTStr("Basic.Main.ListMode")
-//	                       : QTStr("Basic.Main.GridMode"),
-//	                  this);
-//	connect(gridAction, SIGNAL(triggered()), this,
-//	    SLOT(GridActionClicked()));
-//	popup.addAction(gridAction);
+	connect(actions.RecentScenes, &QAction::triggered, [this](bool show) {
+		config_set_bool(obs_frontend_get_global_config(), "SceneTreeView", "ShowRecentScenes", show);
+		this->_service.UpdateRecentScenes();
+	});
 
-	popup.exec(QCursor::pos());
+	actions.SyncSceneOrder = popup.addAction(obs_module_text("SceneTreeView.SyncSceneOrder"));
+	actions.SyncSceneOrder->setCheckable(true);
+
+	connect(actions.SyncSceneOrder, &QAction::triggered, [this](bool sync) {
+		this->_service.GetSceneOrderSync().SetEnabled(sync);
+	});
+
+	actions.GridMode = popup.addAction(QString());
+	connect(actions.GridMode, &QAction::triggered, [this]() {
+		const bool grid = this->IsGridMode();
+		config_set_bool(obs_frontend_get_global_config(), "SceneTreeView", "GridMode", !grid);
+		this->SetGridMode(!grid);
+	});
+}
+
+void ObsSceneTreeView::UpdateContextMenu(QStandardItem *item)
+{
+	CONTEXT_MENU_ACTIONS &actions = this->_context_actions;
+
+	actions.Undo->setEnabled(this->_scene_tree_items.CanUndo());
+	actions.Redo->setEnabled(this->_scene_tree_items.CanRedo());
+
+	// QMenu hides separators left without entries between them
+	const bool is_scene = item && item->type() == StvItemModel::SCENE;
+	for(QAction *action : actions.SceneActions)
+		action->setVisible(is_scene);
+
+	if(is_scene)
+	{
+		// Read the current scene's settings once for all entries that depend on them
+		OBSSourceAutoRelease source = this->_scene_tree_items.GetCurrentScene();
+		OBSDataAutoRelease data = obs_source_get_private_settings(source);
+
+		actions.CopyFilters->setEnabled(obs_source_filter_count(source) > 0);
+
+		obs_data_set_default_bool(data, "show_in_multiview", true);
+		actions.Multiview->setChecked(obs_data_get_bool(data, "show_in_multiview"));
+
+		this->UpdatePerSceneTransitionMenu(data);
+	}
+	else if(item && item->type() == StvItemModel::FOLDER)
+		this->UpdateFolderTransitionMenu(item);
+
+	actions.TransitionOverride->setVisible(item != nullptr);
+
+	actions.ToggleIcons->setVisible(item != nullptr);
+	if(item)
+	{
+		actions.ToggleIcons->setText(is_scene ? obs_module_text("SceneTreeView.ToggleSceneIcons") :
+		                                        obs_module_text("SceneTreeView.ToggleFolderIcons"));
+
+		const auto configName = is_scene ? "ShowSceneIcons" : "ShowFolderIcons";
+		actions.ToggleIcons->setChecked(config_get_bool(obs_frontend_get_global_config(), "SceneTreeView", configName));
+	}
+
+	actions.SortFolder->setVisible(item && item->type() == StvItemModel::FOLDER);
+	actions.SortFolder->setChecked(this->_scene_tree_items.IsFolderSorted(item));
+
+	this->UpdatePlaylistMenu(item);
+
+	actions.ClearHighlight->setVisible(this->_scene_tree_items.HasHighlight());
+
+	actions.ShowOnlyFolder->setVisible(item && item->type() == StvItemModel::FOLDER);
+	actions.ShowAllFolders->setVisible(this->_root_folder_id != 0);
+	this->UpdateCanvasMenu();
+
+	actions.Compact->setChecked(this->_stv_dock.stvTree->IsCompactMode());
+	actions.RecentScenes->setChecked(config_get_bool(obs_frontend_get_global_config(), "SceneTreeView", "ShowRecentScenes"));
+	actions.SyncSceneOrder->setChecked(this->_service.GetSceneOrderSync().IsEnabled());
+	actions.GridMode->setText(this->IsGridMode() ? QTStr("Basic.Main.ListMode") :
+	                                               QTStr("Basic.Main.GridMode"));
+}
+
+void ObsSceneTreeView::UpdateCanvasMenu()
+{
+	// Reading the canvases walks the whole canvas index, skip it while nothing changed
+	const uint64_t canvases_version = this->_scene_tree_items.GetCanvasesVersion();
+	if(canvases_version == this->_context_actions.CanvasVersion)
+		return;
+
+	this->_context_actions.CanvasVersion = canvases_version;
+
+	QMenu *menu = this->_context_actions.Canvas;
+	menu->clear();
+
+	const std::vector<StvItemModel::SCENE_SIZE_T> canvases = this->_scene_tree_items.GetCanvases();
+	menu->menuAction()->setVisible(canvases.size() > 1);
+
+	const StvItemModel::SCENE_SIZE_T current_canvas = this->_scene_tree_items.GetCanvas();
+	for(const StvItemModel::SCENE_SIZE_T &canvas : canvases)
+	{
+		const bool is_base = canvas == StvItemModel::BASE_CANVAS;
+		const StvItemModel::SCENE_SIZE_T size = is_base ? this->_scene_tree_items.GetSceneSize() : canvas;
+		const QString resolution = QString("%1x%2").arg(QString::number(size.cx), QString::number(size.cy));
+
+		const QString text = is_base ? QString(obs_module_text("SceneTreeView.BaseCanvas")).arg(resolution) : resolution;
+
+		QAction *action = menu->addAction(text, [this, canvas]() {
+			this->_service.SetCanvas(canvas);
+		});
+
+		action->setCheckable(true);
+		action->setChecked(canvas == current_canvas);
+	}
 }
 
 void ObsSceneTreeView::on_SceneNameEdited(QWidget *editor)
@@ -334,6 +738,10 @@ void ObsSceneTreeView::on_SceneNameEdited(QWidget *editor)
 	QStandardItem *selected = this->_scene_tree_items.itemFromIndex(this->_stv_dock.stvTree->currentIndex());
 	if(selected->type() == StvItemModel::SCENE)
 	{
+		// The editor already changed the item text. Record it, in case OBS rejects the name the next
+		// UpdateTree() reverts it
+		this->_scene_tree_items.RenameItem(selected, selected->text());
+
 		QMainWindow *main_window = reinterpret_cast<QMainWindow*>(obs_frontend_get_main_window());
 		QMetaObject::invokeMethod(main_window, "SceneNameEdited", Q_ARG(QWidget*, editor));
 	}
@@ -342,9 +750,75 @@ void ObsSceneTreeView::on_SceneNameEdited(QWidget *editor)
 		QLineEdit *edit = qobject_cast<QLineEdit *>(editor);
 		std::string text = QT_TO_UTF8(edit->text().trimmed());
 
-		selected->setText(this->_scene_tree_items.CreateUniqueFolderName(selected,
-		                                                                 this->_scene_tree_items.GetParentOrRoot(selected->index())));
+		this->_scene_tree_items.RenameItem(selected,
+		                                   this->_scene_tree_items.CreateUniqueFolderName(selected,
+		                                                                                  this->_scene_tree_items.GetParentOrRoot(selected->index())));
+	}
+}
+
+void ObsSceneTreeView::on_stvRecentHeader_toggled(bool expanded)
+{
+	config_set_bool(obs_frontend_get_global_config(), "SceneTreeView", "RecentScenesExpanded", expanded);
+
+	this->_stv_dock.stvRecentHeader->setArrowType(expanded ? Qt::DownArrow : Qt::RightArrow);
+	this->_stv_dock.stvRecentList->setVisible(expanded);
+}
+
+void ObsSceneTreeView::on_stvRecentList_clicked(const QModelIndex &index)
+{
+	if(!index.isValid())
+		return;
+
+	// Select the scene item of the tree, the recent list only refers to it by name
+	OBSSourceAutoRelease source = obs_get_source_by_name(QT_TO_UTF8(this->_service.GetRecentModel().GetSceneName(index.row())));
+	if(QStandardItem *item = this->_scene_tree_items.GetSceneItem(source))
+		this->_scene_tree_items.SetSelectedScene(item, obs_frontend_preview_program_mode_active());
+}
+
+void ObsSceneTreeView::SetGridMode(bool grid_mode)
+{
+	this->_stv_dock.stvTree->setVisible(!grid_mode);
+	this->_stv_dock.stvGrid->setVisible(grid_mode);
+}
+
+bool ObsSceneTreeView::IsGridMode() const
+{
+	return !this->_stv_dock.stvGrid->isHidden();
+}
+
+QAbstractItemView *ObsSceneTreeView::GetActiveView() const
+{
+	if(this->IsGridMode())
+		return this->_stv_dock.stvGridView;
+
+	return this->_stv_dock.stvTree;
+}
+
+void ObsSceneTreeView::HighlightSceneDependencies(QStandardItem *scene_item, StvItemModel::DEPENDENCY_DIRECTION direction)
+{
+	const std::vector<QStandardItem*> items = this->_scene_tree_items.HighlightSceneDependencies(scene_item, direction);
+
+	// Make all results visible
+	for(QStandardItem *item : items)
+	{
+		for(QModelIndex parent = item->index().parent(); parent.isValid(); parent = parent.parent())
+			this->_stv_dock.stvTree->expand(parent);
 	}
+
+	if(!items.empty())
+		this->GetActiveView()->scrollTo(items.front()->index());
+}
+
+void ObsSceneTreeView::UpdateRecentScenes()
+{
+	// The list itself is shared by all docks, only its layout is per dock
+	const int row_count = this->_service.GetRecentModel().rowCount();
+
+	QListView *recent_list = this->_stv_dock.stvRecentList;
+	recent_list->setFixedHeight(row_count * std::max(recent_list->sizeHintForRow(0), 1) + 2*recent_list->frameWidth());
+
+	this->_stv_dock.stvRecent->setVisible(row_count > 0);
+	this->on_stvRecentHeader_toggled(this->_stv_dock.stvRecentHeader->isChecked());
 }
 
 void ObsSceneTreeView::SelectCurrentScene()
@@ -384,7 +858,7 @@ void ObsSceneTreeView::RemoveFolder(QStandardItem *folder)
 
 	// Remove folder if empty
 	if(folder->rowCount() == 0)
-		this->_scene_tree_items.GetParentOrRoot(folder->index())->removeRow(folder->row());
+		this->_scene_tree_items.RemoveItem(folder);
 }
 
 Q_DECLARE_METATYPE(OBSSource);
@@ -394,51 +868,55 @@ static inline OBSSource GetTransitionComboItem(QComboBox *combo, int idx)
 	return combo->itemData(idx).value<OBSSource>();
 }
 
-QMenu *ObsSceneTreeView::CreatePerSceneTransitionMenu(QMainWindow *main_window)
+QMenu *ObsSceneTreeView::CreatePerSceneTransitionMenu(QMainWindow *main_window, QWidget *parent)
 {
-	OBSSourceAutoRelease scene = this->_scene_tree_items.GetCurrentScene();
-	QMenu *menu = new QMenu(QTStr("TransitionOverride"));
+	QMenu *menu = new QMenu(QTStr("TransitionOverride"), parent);
 	QAction *action;
 
-	OBSDataAutoRelease data = obs_source_get_private_settings(scene);
-
-	obs_data_set_default_int(data, "transition_duration", 300);
-
-	const char *curTransition = obs_data_get_string(data, "transition");
-	int curDuration = (int)obs_data_get_int(data, "transition_duration");
-
 	QSpinBox *duration = new QSpinBox(menu);
 	duration->setMinimum(50);
 	duration->setSuffix(" ms");
 	duration->setMaximum(20000);
 	duration->setSingleStep(50);
-	duration->setValue(curDuration);
+	this->_context_actions.TransitionDuration = duration;
 
 	// Workaround to get the transitions menu from the main menu
 	QComboBox *combo = main_window->findChild<QComboBox*>("transitions");
 	assert(combo);
 
-	auto setTransition = [this, combo](QAction *action) {
-		int idx = action->property("transition_index").toInt();
-		OBSSourceAutoRelease scene = this->_scene_tree_items.GetCurrentScene();
-		OBSDataAutoRelease data =
-		    obs_source_get_private_settings(scene);
+	// Folders store their override in the service, scenes in their private settings
+	const auto context_folder = [this]() -> QStandardItem* {
+		QStandardItem *item = this->_scene_tree_items.itemFromIndex(this->_context_item);
+		return item && item->type() == StvItemModel::FOLDER ? item : nullptr;
+	};
 
-		if (idx == -1) {
-			obs_data_set_string(data, "transition", "");
+	auto setTransition = [this, context_folder](QAction *action) {
+		if(QStandardItem *folder = context_folder())
+		{
+			StvTransitionOverrides &overrides = this->_service.GetTransitionOverrides();
+			StvTransitionOverrides::OVERRIDE folder_override = overrides.GetFolderOverride(folder);
+			folder_override.Transition = action->data().toString();
+			overrides.SetFolderOverride(folder, folder_override);
 			return;
 		}
 
-		OBSSource tr = GetTransitionComboItem(combo, idx);
+		OBSSourceAutoRelease scene = this->_scene_tree_items.GetCurrentScene();
+		OBSDataAutoRelease data =
+		    obs_source_get_private_settings(scene);
+
+		obs_data_set_string(data, "transition", QT_TO_UTF8(action->data().toString()));
+	};
 
-		if (tr)
+	auto setDuration = [this, context_folder](int duration) {
+		if(QStandardItem *folder = context_folder())
 		{
-			const char *name = obs_source_get_name(tr);
-			obs_data_set_string(data, "transition", name);
+			StvTransitionOverrides &overrides = this->_service.GetTransitionOverrides();
+			StvTransitionOverrides::OVERRIDE folder_override = overrides.GetFolderOverride(folder);
+			folder_override.DurationMs = duration;
+			overrides.SetFolderOverride(folder, folder_override);
+			return;
 		}
-	};
 
-	auto setDuration = [this](int duration) {
 		OBSSourceAutoRelease scene = this->_scene_tree_items.GetCurrentScene();
 		OBSDataAutoRelease data =
 		    obs_source_get_private_settings(scene);
@@ -462,15 +940,16 @@ QMenu *ObsSceneTreeView::CreatePerSceneTransitionMenu(QMainWindow *main_window)
 			name = obs_source_get_name(tr);
 		}
 
-		bool match = (name && strcmp(name, curTransition) == 0);
+		// Store the name, combo indices change with the transition list
+		const QString transition = QT_UTF8(name);
 
 		if (!name || !*name)
 			name = none.c_str();
 
 		action = menu->addAction(QT_UTF8(name));
-		action->setProperty("transition_index", i);
+		action->setData(transition);
 		action->setCheckable(true);
-		action->setChecked(match);
+		this->_context_actions.Transitions.push_back(action);
 
 		connect(action, &QAction::triggered,
 		    std::bind(setTransition, action));
@@ -484,60 +963,153 @@ QMenu *ObsSceneTreeView::CreatePerSceneTransitionMenu(QMainWindow *main_window)
 	return menu;
 }
 
-void ObsSceneTreeView::ObsFrontendEvent(enum obs_frontend_event event)
+void ObsSceneTreeView::UpdatePerSceneTransitionMenu(obs_data_t *scene_settings)
 {
-	// Update our tree view when scene list was changed
-	if(event == OBS_FRONTEND_EVENT_FINISHED_LOADING)
-	{
-		this->_scene_collection_name = obs_frontend_get_current_scene_collection();
+	obs_data_set_default_int(scene_settings, "transition_duration", 300);
 
-		// Load saved scene locations, then add any missing items that weren't saved
-		this->LoadSceneTree(this->_scene_collection_name);
-		this->UpdateTreeView();
+	const QString curTransition = QT_UTF8(obs_data_get_string(scene_settings, "transition"));
+	for(QAction *action : this->_context_actions.Transitions)
+		action->setChecked(action->data().toString() == curTransition);
 
-		this->SelectCurrentScene();
+	// Only user edits are written back to the scene
+	QSpinBox *duration = this->_context_actions.TransitionDuration;
+	duration->blockSignals(true);
+	duration->setValue((int)obs_data_get_int(scene_settings, "transition_duration"));
+	duration->blockSignals(false);
+}
 
-		// We're updating the icons here to allow the main_window to load themes first
-		// Set icons, force style sheet recalculation. Taken from obs source code, qt-wrappers.cpp, setThemeID()
-		QMainWindow *main_window = reinterpret_cast<QMainWindow*>(obs_frontend_get_main_window());
-		this->_stv_dock.stvAdd->setIcon(this->_add_scene_act->icon());
-		this->_stv_dock.stvRemove->setIcon(this->_remove_scene_act->icon());
-		this->_stv_dock.stvAddFolder->setIcon(main_window->property("groupIcon").value<QIcon>());
+void ObsSceneTreeView::UpdateFolderTransitionMenu(QStandardItem *folder)
+{
+	const StvTransitionOverrides::OVERRIDE folder_override = this->_service.GetTransitionOverrides().GetFolderOverride(folder);
 
-		QString qss = this->styleSheet();
-		this->setStyleSheet("/* */");
-		this->setStyleSheet(qss);
-	}
-	else if(event == OBS_FRONTEND_EVENT_SCENE_LIST_CHANGED)
-		this->UpdateTreeView();
-	else if(event == OBS_FRONTEND_EVENT_SCENE_CHANGED || event == OBS_FRONTEND_EVENT_PREVIEW_SCENE_CHANGED)
-		this->SelectCurrentScene();
-	else if(event == OBS_FRONTEND_EVENT_SCENE_COLLECTION_CLEANUP)
-	{
-		this->_scene_tree_items.CleanupSceneTree();
-		this->_scene_collection_name = nullptr;
-	}
-	else if(event == OBS_FRONTEND_EVENT_SCENE_COLLECTION_CHANGING)
-		this->SaveSceneTree(this->_scene_collection_name);
-	else if(event == OBS_FRONTEND_EVENT_SCENE_COLLECTION_CHANGED)
-	{
-		this->_scene_collection_name = obs_frontend_get_current_scene_collection();
-		this->LoadSceneTree(this->_scene_collection_name);
-		this->UpdateTreeView();
-	}
-	else if(event == OBS_FRONTEND_EVENT_SCENE_COLLECTION_RENAMED)
-	{
-		// TODO: Delete old scene tree from json file
+	// Same layout as the settings of a scene
+	OBSDataAutoRelease folder_settings = obs_data_create();
+	obs_data_set_string(folder_settings, "transition", folder_override.Transition.toUtf8().constData());
+	obs_data_set_int(folder_settings, "transition_duration", folder_override.DurationMs);
 
-		this->_scene_collection_name = obs_frontend_get_current_scene_collection();
-		this->SaveSceneTree(this->_scene_collection_name);
+	this->UpdatePerSceneTransitionMenu(folder_settings);
+}
 
-		this->UpdateTreeView();
-	}
+QMenu *ObsSceneTreeView::CreatePlaylistMenu(QWidget *parent)
+{
+	CONTEXT_MENU_ACTIONS &actions = this->_context_actions;
+	StvFolderPlaylist &playlist = this->_service.GetFolderPlaylist();
+
+	QMenu *menu = new QMenu(obs_module_text("SceneTreeView.Playlist"), parent);
+
+	const auto context_item = [this]() {
+		return this->_scene_tree_items.itemFromIndex(this->_context_item);
+	};
+
+	actions.PlayPlaylist = menu->addAction(QString(), [this, &playlist, context_item]() {
+		QStandardItem *folder = context_item();
+		if(playlist.IsPlaying(folder))
+			playlist.Stop();
+		else
+			playlist.Start(folder);
+	});
+
+	menu->addSeparator();
+
+	actions.PlaylistShuffle = menu->addAction(obs_module_text("SceneTreeView.PlaylistShuffle"));
+	actions.PlaylistShuffle->setCheckable(true);
+
+	connect(actions.PlaylistShuffle, &QAction::triggered, [&playlist, context_item](bool shuffle) {
+		StvFolderPlaylist::SETTINGS settings = playlist.GetSettings(context_item());
+		settings.Shuffle = shuffle;
+		playlist.SetSettings(context_item(), settings);
+	});
+
+	actions.PlaylistLoop = menu->addAction(obs_module_text("SceneTreeView.PlaylistLoop"));
+	actions.PlaylistLoop->setCheckable(true);
+
+	connect(actions.PlaylistLoop, &QAction::triggered, [&playlist, context_item](bool loop) {
+		StvFolderPlaylist::SETTINGS settings = playlist.GetSettings(context_item());
+		settings.Loop = loop;
+		playlist.SetSettings(context_item(), settings);
+	});
+
+	// Dwell times are edited in seconds, stored in ms
+	QSpinBox *folder_dwell_time = new QSpinBox(menu);
+	folder_dwell_time->setPrefix(obs_module_text("SceneTreeView.PlaylistDwellTime"));
+	folder_dwell_time->setSuffix(" s");
+	folder_dwell_time->setMinimum(1);
+	folder_dwell_time->setMaximum(86400);
+	actions.FolderDwellTime = folder_dwell_time;
+
+	connect(folder_dwell_time, (void (QSpinBox::*)(int)) & QSpinBox::valueChanged, [&playlist, context_item](int seconds) {
+		StvFolderPlaylist::SETTINGS settings = playlist.GetSettings(context_item());
+		settings.DwellTimeMs = (int64_t)seconds*1000;
+		playlist.SetSettings(context_item(), settings);
+	});
+
+	QWidgetAction *folder_dwell_action = new QWidgetAction(menu);
+	folder_dwell_action->setDefaultWidget(folder_dwell_time);
+	menu->addAction(folder_dwell_action);
+	actions.FolderDwellTimeAction = folder_dwell_action;
+
+	// 0 uses the dwell time of the folder the scene is played in
+	QSpinBox *scene_dwell_time = new QSpinBox(menu);
+	scene_dwell_time->setPrefix(obs_module_text("SceneTreeView.PlaylistDwellTime"));
+	scene_dwell_time->setSuffix(" s");
+	scene_dwell_time->setMinimum(0);
+	scene_dwell_time->setMaximum(86400);
+	scene_dwell_time->setSpecialValueText(obs_module_text("SceneTreeView.PlaylistFolderDwellTime"));
+	actions.SceneDwellTime = scene_dwell_time;
+
+	connect(scene_dwell_time, (void (QSpinBox::*)(int)) & QSpinBox::valueChanged, [context_item](int seconds) {
+		QStandardItem *item = context_item();
+		if(!item || item->type() != StvItemModel::SCENE)
+			return;
+
+		OBSSourceAutoRelease scene = OBSGetStrongRef(item->data(StvItemModel::OBS_SCENE).value<obs_weak_source_ptr>().ptr);
+		StvFolderPlaylist::SetSceneDwellTime(scene, (int64_t)seconds*1000);
+	});
+
+	QWidgetAction *scene_dwell_action = new QWidgetAction(menu);
+	scene_dwell_action->setDefaultWidget(scene_dwell_time);
+	menu->addAction(scene_dwell_action);
+	actions.SceneDwellTimeAction = scene_dwell_action;
+
+	return menu;
 }
 
-void ObsSceneTreeView::ObsFrontendSave(obs_data_t */*save_data*/, bool saving)
+void ObsSceneTreeView::UpdatePlaylistMenu(QStandardItem *item)
 {
-	if(saving)
-		this->SaveSceneTree(this->_scene_collection_name);
+	CONTEXT_MENU_ACTIONS &actions = this->_context_actions;
+	StvFolderPlaylist &playlist = this->_service.GetFolderPlaylist();
+
+	const bool is_folder = item && item->type() == StvItemModel::FOLDER;
+	const bool is_scene = item && item->type() == StvItemModel::SCENE;
+
+	actions.Playlist->menuAction()->setVisible(is_folder || is_scene);
+
+	actions.PlayPlaylist->setVisible(is_folder);
+	actions.PlaylistShuffle->setVisible(is_folder);
+	actions.PlaylistLoop->setVisible(is_folder);
+	actions.FolderDwellTimeAction->setVisible(is_folder);
+	actions.SceneDwellTimeAction->setVisible(is_scene);
+
+	// Only user edits are written back
+	if(is_folder)
+	{
+		const StvFolderPlaylist::SETTINGS settings = playlist.GetSettings(item);
+
+		actions.PlayPlaylist->setText(playlist.IsPlaying(item) ? obs_module_text("SceneTreeView.StopPlaylist") :
+		                                                         obs_module_text("SceneTreeView.PlayPlaylist"));
+		actions.PlaylistShuffle->setChecked(settings.Shuffle);
+		actions.PlaylistLoop->setChecked(settings.Loop);
+
+		actions.FolderDwellTime->blockSignals(true);
+		actions.FolderDwellTime->setValue((int)(settings.DwellTimeMs/1000));
+		actions.FolderDwellTime->blockSignals(false);
+	}
+	else if(is_scene)
+	{
+		OBSSourceAutoRelease scene = OBSGetStrongRef(item->data(StvItemModel::OBS_SCENE).value<obs_weak_source_ptr>().ptr);
+
+		actions.SceneDwellTime->blockSignals(true);
+		actions.SceneDwellTime->setValue((int)(StvFolderPlaylist::GetSceneDwellTime(scene)/1000));
+		actions.SceneDwellTime->blockSignals(false);
+	}
 }
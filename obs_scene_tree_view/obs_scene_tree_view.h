@@ -2,33 +2,52 @@
 #define OBS_SCENE_TREE_VIEW_H
 
 #include <map>
+#include <memory>
+#include <string_view>
+#include <vector>
 
 #include <QAbstractItemDelegate>
+#include <QPersistentModelIndex>
 #include <QtWidgets/QDockWidget>
 
 #include <util/util.hpp>
 
 #include "obs-data.h"
 #include "obs_scene_tree_view/stv_item_model.h"
+#include "obs_scene_tree_view/stv_tree_service.h"
 #include "ui_scene_tree_view.h"
 
+class QSpinBox;
+
 class ObsSceneTreeView
         : public QDockWidget
 {
 		Q_OBJECT
 
 	public:
-		static constexpr std::string_view SCENE_TREE_CONFIG_FILE = "scene_tree.json";
-
-		ObsSceneTreeView(QMainWindow *main_window);
+		/*!
+		 * \brief Settings of a dock in the "SceneTreeView" section of the global config. %1 is replaced by the dock id
+		 */
+		static constexpr std::string_view ROOT_FOLDER_CONFIG = "Dock%1Root";
+		static constexpr std::string_view EXPANDED_FOLDERS_CONFIG = "Dock%1Expanded";
+
+		/*!
+		 * \brief Folder paths are stored as JSON objects holding an array of folder names
+		 */
+		static constexpr std::string_view FOLDER_PATH_DATA = "path";
+		static constexpr std::string_view FOLDER_NAME_DATA = "name";
+		static constexpr std::string_view EXPANDED_FOLDERS_DATA = "folders";
+
+		/*!
+		 * \brief View of the tree shared through StvTreeService. Each dock has its own selection, expansion state and
+		 * root folder. Only the primary dock's expansion state is stored with the tree
+		 */
+		ObsSceneTreeView(QMainWindow *main_window, int dock_id = StvTreeService::PRIMARY_DOCK_ID);
 		virtual ~ObsSceneTreeView() override;
 
-		void SaveSceneTree(const char *scene_collection);
-		void LoadSceneTree(const char *scene_collection);
+		int GetDockId() const;
 
 	protected slots:
-		void UpdateTreeView();
-
 		void on_toggleListboxToolbars(bool visible);
 
 		void on_stvAddFolder_clicked();
@@ -36,35 +55,133 @@ class ObsSceneTreeView
 
 		// Copied from OBS, OBSBasic::on_scenes_customContextMenuRequested()
 		void on_stvTree_customContextMenuRequested(const QPoint &pos);
+		void on_stvGridView_customContextMenuRequested(const QPoint &pos);
 
 		void on_SceneNameEdited(QWidget *editor);
 
+		void on_stvRecentHeader_toggled(bool expanded);
+		void on_stvRecentList_clicked(const QModelIndex &index);
+
 	private:
 		QAction *_add_scene_act = nullptr;
 		QAction *_remove_scene_act = nullptr;
 		QAction *_toggle_toolbars_scene_act = nullptr;
-
-		std::unique_ptr<QMenu> _per_scene_transition_menu;
+		QAction *_undo_act = nullptr;
+		QAction *_redo_act = nullptr;
+
+		/*!
+		 * \brief Entries of the context menu whose state depends on the clicked item or the current scene
+		 */
+		struct CONTEXT_MENU_ACTIONS
+		{
+			QAction *Undo = nullptr;
+			QAction *Redo = nullptr;
+
+			// Only shown for scenes
+			std::vector<QAction*> SceneActions;
+			QAction *CopyFilters = nullptr;
+			QAction *Multiview = nullptr;
+
+			QAction *ToggleIcons = nullptr;
+			QAction *SortFolder = nullptr;
+			QAction *ClearHighlight = nullptr;
+			QAction *ShowOnlyFolder = nullptr;
+			QAction *ShowAllFolders = nullptr;
+
+			// Canvas submenu, rebuilt when StvItemModel::GetCanvasesVersion() changed. Only shown if scenes use more
+			// than one canvas
+			QMenu *Canvas = nullptr;
+			uint64_t CanvasVersion = UINT64_MAX;
+
+			QAction *Compact = nullptr;
+			QAction *RecentScenes = nullptr;
+			QAction *SyncSceneOrder = nullptr;
+			QAction *GridMode = nullptr;
+
+			// Transition override entries of scenes and folders. Action data holds the transition name, empty for none
+			QAction *TransitionOverride = nullptr;
+			std::vector<QAction*> Transitions;
+			QSpinBox *TransitionDuration = nullptr;
+
+			// Playlist submenu. Folders show the playlist entries, scenes only their dwell time
+			QMenu *Playlist = nullptr;
+			QAction *PlayPlaylist = nullptr;
+			QAction *PlaylistShuffle = nullptr;
+			QAction *PlaylistLoop = nullptr;
+			QAction *FolderDwellTimeAction = nullptr;
+			QSpinBox *FolderDwellTime = nullptr;
+			QAction *SceneDwellTimeAction = nullptr;
+			QSpinBox *SceneDwellTime = nullptr;
+		};
+
+		// Built once, rebuilt on the next open after the transition list or theme changed
+		std::unique_ptr<QMenu> _context_menu;
+		bool _context_menu_outdated = true;
+		CONTEXT_MENU_ACTIONS _context_actions;
+
+		// Item the context menu was opened on
+		QPersistentModelIndex _context_item;
 
 		Ui::STVDock _stv_dock;
 
-		StvItemModel _scene_tree_items;
-		BPtr<char> _scene_collection_name = nullptr;
+		const int _dock_id;
+
+		StvTreeService &_service;
+		StvItemModel &_scene_tree_items;
+
+		// Id of the folder shown as the top level. 0 if the whole tree is shown
+		uint64_t _root_folder_id = 0;
+
+		/*!
+		 * \brief Show only the items of folder. nullptr shows the whole tree. The folder's path is stored
+		 * in the global config, so the dock shows it again once a tree containing it is loaded
+		 */
+		void SetRootFolder(QStandardItem *folder);
+		void RestoreRootFolder();
+		void ApplyRootFolder();
+
+		/*!
+		 * \brief Store the paths of the folders expanded in a secondary dock. Paths of folders that aren't in the
+		 * current tree are kept, another scene collection or canvas might contain them
+		 */
+		void SaveExpandedFolders();
+
+		/*!
+		 * \brief Expand the stored folders of a secondary dock. Called after a tree was loaded, as folder ids change
+		 */
+		void RestoreExpandedFolders();
+
+		void UpdateIcons();
+
+		void SetGridMode(bool grid_mode);
+		bool IsGridMode() const;
+		QAbstractItemView *GetActiveView() const;
+
+		void ShowContextMenu(QStandardItem *item);
+		void CreateContextMenu();
+
+		/*!
+		 * \brief Bind the cached context menu to item and the current scene's settings
+		 */
+		void UpdateContextMenu(QStandardItem *item);
+
+		void HighlightSceneDependencies(QStandardItem *scene_item, StvItemModel::DEPENDENCY_DIRECTION direction);
+
+		void UpdateRecentScenes();
 
 		void SelectCurrentScene();
 		void RemoveFolder(QStandardItem *folder);
 
-		// Copied from OBS, OBSBasic::CreatePerSceneTransitionMenu()
-		QMenu *CreatePerSceneTransitionMenu(QMainWindow *main_window);
-
-		inline static void obs_frontend_event_cb(enum obs_frontend_event event, void *private_data)
-		{	((ObsSceneTreeView*)private_data)->ObsFrontendEvent(event);	}
+		// Copied from OBS, OBSBasic::CreatePerSceneTransitionMenu(). Edits the override of the current scene,
+		// or of the folder the menu was opened on
+		QMenu *CreatePerSceneTransitionMenu(QMainWindow *main_window, QWidget *parent);
+		void UpdatePerSceneTransitionMenu(obs_data_t *scene_settings);
+		void UpdateFolderTransitionMenu(QStandardItem *folder);
 
-		inline static void obs_frontend_save_cb(obs_data_t *save_data, bool saving, void *private_data)
-		{	((ObsSceneTreeView*)private_data)->ObsFrontendSave(save_data, saving);	}
+		QMenu *CreatePlaylistMenu(QWidget *parent);
+		void UpdatePlaylistMenu(QStandardItem *item);
 
-		void ObsFrontendEvent(enum obs_frontend_event event);
-		void ObsFrontendSave(obs_data_t *save_data, bool saving);
+		void UpdateCanvasMenu();
 };
 
 #endif //OBS_SCENE_TREE_VIEW_H
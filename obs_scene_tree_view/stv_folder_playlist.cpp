@@ -0,0 +1,402 @@
+#include "obs_scene_tree_view/stv_folder_playlist.h"
+
+#include "obs_scene_tree_view/stv_item_model.h"
+#include "obs_scene_tree_view/stv_transition_overrides.h"
+
+#include <obs-frontend-api.h>
+#include <obs-module.h>
+#include <util/platform.h>
+
+#include <algorithm>
+#include <limits>
+
+
+namespace
+{
+	constexpr int64_t NS_PER_MS = 1000000;
+
+	// Timer wakeups up to this much before the switch time count as on time
+	constexpr uint64_t EARLY_WAKEUP_TOLERANCE_NS = NS_PER_MS;
+}
+
+
+StvFolderPlaylist::StvFolderPlaylist(StvItemModel &model, StvTransitionOverrides &transition_overrides)
+    : _model(model),
+      _transition_overrides(transition_overrides)
+{
+	this->_timer.setSingleShot(true);
+	this->_timer.setTimerType(Qt::PreciseTimer);
+	QObject::connect(&this->_timer, &QTimer::timeout, this, &StvFolderPlaylist::OnTimer);
+}
+
+StvFolderPlaylist::~StvFolderPlaylist()
+{
+	this->Stop();
+}
+
+void StvFolderPlaylist::Start(QStandardItem *folder)
+{
+	if(!folder || folder->type() != StvItemModel::FOLDER)
+		return;
+
+	this->Stop();
+
+	this->_folder_id = static_cast<StvFolderItem*>(folder)->GetId();
+	this->_playing_settings = this->GetSettings(folder);
+	this->_stats = DRIFT_STATS();
+	this->_last_scene = nullptr;
+	this->BuildOrder(folder);
+
+	blog(LOG_INFO, "[%s] Starting playlist of folder '%s'", obs_module_name(), folder->text().toStdString().c_str());
+
+	this->SwitchToNext(true);
+}
+
+void StvFolderPlaylist::Stop()
+{
+	if(!this->IsRunning())
+		return;
+
+	this->_timer.stop();
+	this->LogStats("stopped");
+
+	this->_folder_id = 0;
+	this->_detached = false;
+	this->_detached_path.clear();
+	this->_detached_scenes.clear();
+	this->_order.clear();
+	this->_last_scene = nullptr;
+}
+
+bool StvFolderPlaylist::IsPlaying(QStandardItem *folder) const
+{
+	return this->_folder_id != 0 && folder && folder->type() == StvItemModel::FOLDER &&
+	        static_cast<StvFolderItem*>(folder)->GetId() == this->_folder_id;
+}
+
+bool StvFolderPlaylist::Detach()
+{
+	if(this->_folder_id == 0)
+		return false;
+
+	StvFolderItem *folder = this->_model.GetFolderItem(this->_folder_id);
+	if(!folder)
+	{
+		this->Stop();
+		return false;
+	}
+
+	this->_detached_path = this->_model.GetFolderPath(folder);
+	this->_detached_scenes.clear();
+	for(int row = 0; row < folder->rowCount(); ++row)
+	{
+		QStandardItem *item = folder->child(row);
+		if(item->type() == StvItemModel::SCENE)
+			this->_detached_scenes.emplace_back(item->data(StvItemModel::OBS_SCENE).value<obs_weak_source_ptr>().ptr);
+	}
+
+	this->_folder_id = 0;
+	this->_detached = true;
+
+	return true;
+}
+
+void StvFolderPlaylist::Attach()
+{
+	if(!this->_detached)
+		return;
+
+	QStandardItem *folder = this->_model.FindFolder(this->_detached_path);
+	if(!folder || folder->type() != StvItemModel::FOLDER)
+	{
+		blog(LOG_INFO, "[%s] Folder of playlist is gone", obs_module_name());
+		this->Stop();
+		return;
+	}
+
+	this->_folder_id = static_cast<StvFolderItem*>(folder)->GetId();
+	this->_detached = false;
+	this->_detached_path.clear();
+	this->_detached_scenes.clear();
+}
+
+bool StvFolderPlaylist::IsDetached() const
+{
+	return this->_detached;
+}
+
+StvFolderPlaylist::SETTINGS StvFolderPlaylist::GetSettings(QStandardItem *folder) const
+{
+	if(!folder || folder->type() != StvItemModel::FOLDER)
+		return SETTINGS();
+
+	const auto settings_it = this->_settings.find(static_cast<StvFolderItem*>(folder)->GetId());
+	return settings_it != this->_settings.end() ? settings_it->second : SETTINGS();
+}
+
+void StvFolderPlaylist::SetSettings(QStandardItem *folder, const SETTINGS &settings)
+{
+	if(!folder || folder->type() != StvItemModel::FOLDER)
+		return;
+
+	this->_settings[static_cast<StvFolderItem*>(folder)->GetId()] = settings;
+
+	// The next round of a playing folder uses the new settings
+	if(this->IsPlaying(folder))
+		this->_playing_settings = settings;
+}
+
+int64_t StvFolderPlaylist::GetSceneDwellTime(obs_source_t *scene_source)
+{
+	OBSDataAutoRelease data = obs_source_get_private_settings(scene_source);
+	return obs_data_get_int(data, SCENE_DWELL_TIME_DATA.data());
+}
+
+void StvFolderPlaylist::SetSceneDwellTime(obs_source_t *scene_source, int64_t dwell_time_ms)
+{
+	OBSDataAutoRelease data = obs_source_get_private_settings(scene_source);
+	obs_data_set_int(data, SCENE_DWELL_TIME_DATA.data(), std::max<int64_t>(dwell_time_ms, 0));
+}
+
+void StvFolderPlaylist::Save(obs_data_t *save_data) const
+{
+	OBSDataArrayAutoRelease playlists_data = obs_data_array_create();
+	for(const auto &[folder_id, settings] : this->_settings)
+	{
+		StvFolderItem *folder = this->_model.GetFolderItem(folder_id);
+		if(!folder)
+			continue;
+
+		OBSDataArrayAutoRelease path_array = obs_data_array_create();
+		for(const QString &folder_name : this->_model.GetFolderPath(folder))
+		{
+			OBSDataAutoRelease folder_data = obs_data_create();
+			obs_data_set_string(folder_data, StvTreeSnapshot::SCENE_TREE_CONFIG_ITEM_NAME_DATA.data(), folder_name.toUtf8().constData());
+			obs_data_array_push_back(path_array, folder_data);
+		}
+
+		OBSDataAutoRelease playlist_data = obs_data_create();
+		obs_data_set_array(playlist_data, PLAYLIST_PATH_DATA.data(), path_array);
+		obs_data_set_bool(playlist_data, PLAYLIST_SHUFFLE_DATA.data(), settings.Shuffle);
+		obs_data_set_bool(playlist_data, PLAYLIST_LOOP_DATA.data(), settings.Loop);
+		obs_data_set_int(playlist_data, PLAYLIST_DWELL_TIME_DATA.data(), settings.DwellTimeMs);
+
+		obs_data_array_push_back(playlists_data, playlist_data);
+	}
+
+	obs_data_set_array(save_data, PLAYLISTS_DATA.data(), playlists_data);
+}
+
+void StvFolderPlaylist::Load(obs_data_t *save_data)
+{
+	// Folders of the previous tree are gone. A detached playlist doesn't refer to them
+	if(!this->_detached)
+		this->Stop();
+
+	this->_settings.clear();
+
+	this->_loaded_settings = obs_data_get_array(save_data, PLAYLISTS_DATA.data());
+}
+
+void StvFolderPlaylist::ApplyLoadedSettings()
+{
+	const size_t playlist_count = obs_data_array_count(this->_loaded_settings);
+	for(size_t i=0; i < playlist_count; ++i)
+	{
+		OBSDataAutoRelease playlist_data = obs_data_array_item(this->_loaded_settings, i);
+		OBSDataArrayAutoRelease path_array = obs_data_get_array(playlist_data, PLAYLIST_PATH_DATA.data());
+
+		std::vector<QString> folder_path;
+		const size_t folder_count = obs_data_array_count(path_array);
+		for(size_t j=0; j < folder_count; ++j)
+		{
+			OBSDataAutoRelease folder_data = obs_data_array_item(path_array, j);
+			folder_path.push_back(QString::fromUtf8(obs_data_get_string(folder_data, StvTreeSnapshot::SCENE_TREE_CONFIG_ITEM_NAME_DATA.data())));
+		}
+
+		QStandardItem *folder = this->_model.FindFolder(folder_path);
+		if(!folder || folder->type() != StvItemModel::FOLDER)
+			continue;
+
+		SETTINGS settings;
+		settings.Shuffle = obs_data_get_bool(playlist_data, PLAYLIST_SHUFFLE_DATA.data());
+		settings.Loop = obs_data_get_bool(playlist_data, PLAYLIST_LOOP_DATA.data());
+		settings.DwellTimeMs = obs_data_get_int(playlist_data, PLAYLIST_DWELL_TIME_DATA.data());
+		if(settings.DwellTimeMs <= 0)
+			settings.DwellTimeMs = DEFAULT_DWELL_TIME_MS;
+
+		this->_settings[static_cast<StvFolderItem*>(folder)->GetId()] = settings;
+	}
+
+	this->_loaded_settings = nullptr;
+}
+
+bool StvFolderPlaylist::IsRunning() const
+{
+	return this->_folder_id != 0 || this->_detached;
+}
+
+void StvFolderPlaylist::SwitchToNext(bool first)
+{
+	StvFolderItem *folder = this->_detached ? nullptr : this->_model.GetFolderItem(this->_folder_id);
+	OBSSourceAutoRelease scene = folder || this->_detached ? this->PeekNextScene(folder) : nullptr;
+	if(!scene)
+	{
+		this->Stop();
+		return;
+	}
+
+	++this->_position;
+	this->_last_scene = OBSGetWeakRef(scene);
+
+	const uint64_t now = os_gettime_ns();
+	if(first)
+		this->_shown_ns = now + this->GetTransitionDurationNs(scene);
+	else
+	{
+		const int64_t lateness = (int64_t)(now - std::min(now, this->_switch_ns));
+		++this->_stats.SwitchCount;
+		this->_stats.TotalLatenessNs += lateness;
+		this->_stats.MaxLatenessNs = std::max(this->_stats.MaxLatenessNs, lateness);
+	}
+
+	if(QStandardItem *scene_item = this->_model.GetSceneItem(scene))
+		this->_model.SetSelectedScene(scene_item, obs_frontend_preview_program_mode_active());
+	else if(this->_detached)
+	{
+		// Scenes of another canvas aren't part of the loaded tree
+		if(obs_frontend_preview_program_mode_active())
+			obs_frontend_set_current_preview_scene(scene);
+		else
+			obs_frontend_set_current_scene(scene);
+	}
+
+	int64_t dwell_time_ms = StvFolderPlaylist::GetSceneDwellTime(scene);
+	if(dwell_time_ms <= 0)
+		dwell_time_ms = this->_playing_settings.DwellTimeMs;
+
+	// Advance from the scheduled time, not from now, so lateness of this switch isn't carried over
+	uint64_t next_shown_ns = this->_shown_ns + (uint64_t)dwell_time_ms*NS_PER_MS;
+
+	OBSSourceAutoRelease next_scene = this->PeekNextScene(folder);
+	const uint64_t next_transition_ns = next_scene ? this->GetTransitionDurationNs(next_scene) : 0;
+
+	// If a whole dwell time was missed, e.g. while the system was suspended, restart the schedule from now
+	if(next_shown_ns < now + next_transition_ns)
+	{
+		++this->_stats.ResyncCount;
+		next_shown_ns = now + next_transition_ns;
+	}
+
+	this->_shown_ns = next_shown_ns;
+	this->_switch_ns = next_shown_ns - next_transition_ns;
+
+	this->ArmTimer();
+}
+
+void StvFolderPlaylist::ArmTimer()
+{
+	const uint64_t now = os_gettime_ns();
+	const uint64_t wait_ns = this->_switch_ns > now ? this->_switch_ns - now : 0;
+
+	// Round up, the timer may not fire before the switch time
+	const int64_t wait_ms = std::min<int64_t>((int64_t)((wait_ns + NS_PER_MS - 1) / NS_PER_MS), std::numeric_limits<int>::max());
+	this->_timer.start((int)wait_ms);
+}
+
+void StvFolderPlaylist::OnTimer()
+{
+	if(!this->IsRunning())
+		return;
+
+	// Long waits may end early, wait for the rest
+	if(os_gettime_ns() + EARLY_WAKEUP_TOLERANCE_NS < this->_switch_ns)
+	{
+		this->ArmTimer();
+		return;
+	}
+
+	this->SwitchToNext(false);
+
+	// Log once per round, so unattended rotations leave a trace
+	if(this->IsRunning() && this->_position == 1 && this->_stats.SwitchCount > 0)
+		this->LogStats("round finished");
+}
+
+OBSSourceAutoRelease StvFolderPlaylist::PeekNextScene(QStandardItem *folder)
+{
+	bool new_round = false;
+	while(true)
+	{
+		if(this->_position >= this->_order.size())
+		{
+			// Start a new round at most once per call, so a folder without scenes ends the playlist
+			if(new_round || !this->_playing_settings.Loop)
+				return nullptr;
+
+			this->BuildOrder(folder);
+			new_round = true;
+
+			if(this->_order.empty())
+				return nullptr;
+		}
+
+		// Scenes may have been deleted or moved out of the folder since the round started. Moves aren't seen while
+		// detached
+		OBSSourceAutoRelease scene = OBSGetStrongRef(this->_order[this->_position]);
+		if(!folder && scene)
+			return scene;
+
+		QStandardItem *scene_item = folder ? this->_model.GetSceneItem(scene) : nullptr;
+		if(scene_item && this->_model.GetParentOrRoot(scene_item->index()) == folder)
+			return scene;
+
+		++this->_position;
+	}
+}
+
+void StvFolderPlaylist::BuildOrder(QStandardItem *folder)
+{
+	this->_order.clear();
+	this->_position = 0;
+
+	if(!folder)
+		this->_order = this->_detached_scenes;
+	else
+	{
+		for(int row = 0; row < folder->rowCount(); ++row)
+		{
+			QStandardItem *item = folder->child(row);
+			if(item->type() == StvItemModel::SCENE)
+				this->_order.emplace_back(item->data(StvItemModel::OBS_SCENE).value<obs_weak_source_ptr>().ptr);
+		}
+	}
+
+	if(this->_playing_settings.Shuffle && this->_order.size() > 1)
+	{
+		std::shuffle(this->_order.begin(), this->_order.end(), this->_random);
+
+		// Don't show the last scene of the previous round twice in a row
+		if(this->_order.front() == this->_last_scene)
+			std::swap(this->_order.front(), this->_order.back());
+	}
+}
+
+int64_t StvFolderPlaylist::GetTransitionDurationNs(obs_source_t *scene_source)
+{
+	return std::max<int64_t>(this->_transition_overrides.GetTransitionDuration(scene_source), 0)*NS_PER_MS;
+}
+
+void StvFolderPlaylist::LogStats(const char *reason) const
+{
+	StvFolderItem *folder = this->_model.GetFolderItem(this->_folder_id);
+	const double mean_lateness_ms = this->_stats.SwitchCount > 0 ?
+	            (double)this->_stats.TotalLatenessNs / (double)this->_stats.SwitchCount / NS_PER_MS :
+	            0.0;
+
+	blog(LOG_INFO, "[%s] Playlist of folder '%s' %s: %llu switches, mean lateness %.3f ms, max lateness %.3f ms, %llu resyncs",
+	     obs_module_name(), folder ? folder->text().toStdString().c_str() :
+	                        !this->_detached_path.empty() ? this->_detached_path.back().toStdString().c_str() : "", reason,
+	     (unsigned long long)this->_stats.SwitchCount, mean_lateness_ms, (double)this->_stats.MaxLatenessNs / NS_PER_MS,
+	     (unsigned long long)this->_stats.ResyncCount);
+}
@@ -0,0 +1,151 @@
+#ifndef STV_FOLDER_PLAYLIST_H
+#define STV_FOLDER_PLAYLIST_H
+
+#include <obs.hpp>
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+#include <cstdint>
+#include <random>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+class QStandardItem;
+class StvItemModel;
+class StvTransitionOverrides;
+
+/*!
+ * \brief Plays the scenes of a folder one after another, each for its dwell time. Only one folder plays at a time.
+ *
+ * Switch times are derived from the playlist start on the monotonic clock, never from the time the previous switch
+ * actually happened, so timer and event loop jitter don't add up over long rotations. Each switch is requested
+ * ahead by the scene's transition duration, including inherited folder overrides, so the dwell time counts from
+ * when the scene is fully shown.
+ * Scenes are switched the same way as clicking them in the dock
+ */
+class StvFolderPlaylist
+        : public QObject
+{
+		Q_OBJECT
+
+	public:
+		static constexpr int64_t DEFAULT_DWELL_TIME_MS = 10000;
+
+		static constexpr std::string_view PLAYLISTS_DATA = "scene_tree_view_playlists";
+		static constexpr std::string_view PLAYLIST_PATH_DATA = "path";
+		static constexpr std::string_view PLAYLIST_SHUFFLE_DATA = "shuffle";
+		static constexpr std::string_view PLAYLIST_LOOP_DATA = "loop";
+		static constexpr std::string_view PLAYLIST_DWELL_TIME_DATA = "dwell_ms";
+
+		// Stored in the private settings of a scene. 0 uses the dwell time of the folder
+		static constexpr std::string_view SCENE_DWELL_TIME_DATA = "scene_tree_view_dwell_ms";
+
+		struct SETTINGS
+		{
+			bool Shuffle = false;
+			bool Loop = true;
+			int64_t DwellTimeMs = DEFAULT_DWELL_TIME_MS;
+		};
+
+		StvFolderPlaylist(StvItemModel &model, StvTransitionOverrides &transition_overrides);
+		virtual ~StvFolderPlaylist() override;
+
+		void Start(QStandardItem *folder);
+		void Stop();
+		bool IsPlaying(QStandardItem *folder) const;
+
+		/*!
+		 * \brief Keep playing while the tree of another canvas is loaded. The scenes of the playing folder are
+		 * remembered, and Attach() matches the playlist to its folder again by path
+		 * \return Returns false if no attached playlist is running
+		 */
+		bool Detach();
+
+		/*!
+		 * \brief Continue a detached playlist with its folder in the loaded tree. Stops if the folder is gone
+		 */
+		void Attach();
+		bool IsDetached() const;
+
+		SETTINGS GetSettings(QStandardItem *folder) const;
+		void SetSettings(QStandardItem *folder, const SETTINGS &settings);
+
+		static int64_t GetSceneDwellTime(obs_source_t *scene_source);
+		static void SetSceneDwellTime(obs_source_t *scene_source, int64_t dwell_time_ms);
+
+		/*!
+		 * \brief Store folder settings with the scene collection. Folders are stored by path
+		 */
+		void Save(obs_data_t *save_data) const;
+
+		/*!
+		 * \brief Read folder settings of a scene collection. They are matched to folders by ApplyLoadedSettings(),
+		 * once the tree of the collection is loaded. Stops the playlist unless it's detached
+		 */
+		void Load(obs_data_t *save_data);
+		void ApplyLoadedSettings();
+
+	private:
+		struct DRIFT_STATS
+		{
+			uint64_t SwitchCount = 0;
+
+			// Time between the scheduled and the actual switch
+			int64_t TotalLatenessNs = 0;
+			int64_t MaxLatenessNs = 0;
+
+			// Switches after which the schedule had to be moved, e.g. after the system was suspended
+			uint64_t ResyncCount = 0;
+		};
+
+		StvItemModel &_model;
+		StvTransitionOverrides &_transition_overrides;
+
+		// Settings by folder id
+		std::unordered_map<uint64_t, SETTINGS> _settings;
+		OBSDataArrayAutoRelease _loaded_settings;
+
+		// Playing folder, 0 if stopped or detached
+		uint64_t _folder_id = 0;
+		SETTINGS _playing_settings;
+
+		// Path and scenes of the playing folder while its tree isn't loaded
+		bool _detached = false;
+		std::vector<QString> _detached_path;
+		std::vector<OBSWeakSource> _detached_scenes;
+
+		std::vector<OBSWeakSource> _order;
+		size_t _position = 0;
+		OBSWeakSource _last_scene;
+		std::mt19937 _random{std::random_device{}()};
+
+		// Monotonic times at which the next scene is requested and fully shown
+		uint64_t _switch_ns = 0;
+		uint64_t _shown_ns = 0;
+
+		QTimer _timer;
+		DRIFT_STATS _stats;
+
+		bool IsRunning() const;
+
+		void SwitchToNext(bool first);
+		void ArmTimer();
+		void OnTimer();
+
+		/*!
+		 * \brief Next scene that still is part of the folder. Starts a new round if the order is exhausted
+		 * and the playlist loops. folder is nullptr while detached
+		 */
+		OBSSourceAutoRelease PeekNextScene(QStandardItem *folder);
+		void BuildOrder(QStandardItem *folder);
+
+		int64_t GetTransitionDurationNs(obs_source_t *scene_source);
+
+		void LogStats(const char *reason) const;
+};
+
+#endif // STV_FOLDER_PLAYLIST_H
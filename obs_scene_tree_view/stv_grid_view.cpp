@@ -0,0 +1,194 @@
+#include "obs_scene_tree_view/stv_grid_view.h"
+
+#include "obs_scene_tree_view/stv_item_delegate.h"
+
+#include <QMouseEvent>
+#include <QtWidgets/QHBoxLayout>
+#include <QtWidgets/QLabel>
+#include <QtWidgets/QToolButton>
+#include <util/config-file.h>
+
+#include <algorithm>
+#include <vector>
+
+
+StvGridView::StvGridView(QWidget *parent)
+    : QListView(parent)
+{
+	// Folder tiles get the same live and preview badges as tree rows
+	this->setItemDelegate(new StvItemDelegate(this));
+
+	this->setViewMode(QListView::IconMode);
+	this->setFlow(QListView::LeftToRight);
+	this->setWrapping(true);
+	this->setMovement(QListView::Static);
+	this->setResizeMode(QListView::Adjust);
+	this->setUniformItemSizes(true);
+	this->setWordWrap(false);
+	this->setTextElideMode(Qt::ElideRight);
+
+	// Folders are opened by double click
+	this->setEditTriggers(QAbstractItemView::EditKeyPressed);
+	this->setDragDropMode(QAbstractItemView::NoDragDrop);
+
+	this->UpdateGridSize();
+}
+
+void StvGridView::SetItemModel(StvItemModel *model, QAbstractItemView *view)
+{
+	this->_model = model;
+	this->setModel(model);
+
+	QItemSelectionModel *own_selection_model = this->selectionModel();
+	this->setSelectionModel(view->selectionModel());
+	delete own_selection_model;
+
+	// Return to the top level if the shown folder was removed
+	QObject::connect(this->_model, &QAbstractItemModel::rowsRemoved, this, [this]() {
+		if(this->_in_sub_folder && !this->_folder.isValid())
+			this->SetFolder(QModelIndex());
+	});
+
+	// Batched edits only report a layout change. The shown folder may have been moved or renamed
+	QObject::connect(this->_model, &QAbstractItemModel::layoutChanged, this, [this]() {
+		if(this->_in_sub_folder && !this->_folder.isValid())
+			this->SetFolder(QModelIndex());
+		else
+			emit this->FolderChanged(this->_folder);
+	});
+	QObject::connect(this->_model, &QAbstractItemModel::modelReset, this, [this]() {
+		this->SetFolder(QModelIndex());
+	});
+
+	// Folder names are shown outside of the view. Only the names on the path to the shown folder matter
+	QObject::connect(this->_model, &QAbstractItemModel::dataChanged, this,
+	                 [this](const QModelIndex &top_left, const QModelIndex &bottom_right, const QList<int> &roles) {
+		if(!this->_folder.isValid() || !(roles.isEmpty() || roles.contains(Qt::DisplayRole)))
+			return;
+
+		const QModelIndex changed_parent = top_left.parent();
+		for(QModelIndex index = this->_folder; index.isValid(); index = index.parent())
+		{
+			if(index.parent() == changed_parent && index.row() >= top_left.row() && index.row() <= bottom_right.row())
+			{
+				emit this->FolderChanged(this->_folder);
+				return;
+			}
+		}
+	});
+}
+
+void StvGridView::SetFolder(const QModelIndex &folder)
+{
+	this->_folder = folder;
+	this->_in_sub_folder = folder.isValid();
+	this->setRootIndex(folder);
+	this->scrollToTop();
+
+	emit this->FolderChanged(folder);
+}
+
+QStandardItem *StvGridView::GetFolderItem() const
+{
+	QStandardItem *folder = this->_model->itemFromIndex(this->_folder);
+	return folder ? folder : this->_model->invisibleRootItem();
+}
+
+void StvGridView::EditSelectedItem()
+{
+	this->edit(this->currentIndex());
+}
+
+void StvGridView::resizeEvent(QResizeEvent *event)
+{
+	this->UpdateGridSize();
+	this->QListView::resizeEvent(event);
+}
+
+void StvGridView::mouseDoubleClickEvent(QMouseEvent *event)
+{
+	const QModelIndex index = this->indexAt(event->pos());
+	QStandardItem *item = this->_model->itemFromIndex(index);
+	if(item && item->type() == StvItemModel::FOLDER)
+	{
+		this->SetFolder(index);
+		return;
+	}
+
+	if(item && obs_frontend_preview_enabled() &&
+	        config_get_bool(obs_frontend_get_global_config(), "BasicWindow", "TransitionOnDoubleClick"))
+	{
+		this->_model->SetSelectedScene(item, false, true);
+		return;
+	}
+
+	return QListView::mouseDoubleClickEvent(event);
+}
+
+void StvGridView::currentChanged(const QModelIndex &current, const QModelIndex &previous)
+{
+	this->QListView::currentChanged(current, previous);
+
+	// Follow scene changes made elsewhere
+	if(current.isValid() && current.parent() != this->rootIndex())
+		this->SetFolder(current.parent());
+}
+
+void StvGridView::UpdateGridSize()
+{
+	// Stretch tiles to fill the full row
+	const int width = std::max(this->viewport()->width(), MIN_TILE_WIDTH);
+	const int column_count = std::max(width / MIN_TILE_WIDTH, 1);
+
+	this->setGridSize(QSize(width / column_count, this->fontMetrics().height() + 2*TILE_MARGIN));
+}
+
+
+StvBreadcrumbBar::StvBreadcrumbBar(QWidget *parent)
+    : QWidget(parent)
+{
+	QHBoxLayout *layout = new QHBoxLayout(this);
+	layout->setContentsMargins(4, 2, 4, 2);
+	layout->setSpacing(0);
+}
+
+void StvBreadcrumbBar::SetFolder(StvItemModel *model, const QModelIndex &folder)
+{
+	// Buttons may be deleted while handling their own click
+	while(QLayoutItem *entry = this->layout()->takeAt(0))
+	{
+		if(entry->widget())
+			entry->widget()->deleteLater();
+
+		delete entry;
+	}
+
+	std::vector<QModelIndex> path;
+	for(QModelIndex index = folder; index.isValid(); index = index.parent())
+		path.push_back(index);
+
+	this->AddEntry(QTStr("Basic.Main.Scenes"), QModelIndex(), path.empty());
+
+	for(auto index_it = path.rbegin(); index_it != path.rend(); ++index_it)
+	{
+		this->layout()->addWidget(new QLabel("/", this));
+		this->AddEntry(model->itemFromIndex(*index_it)->text(), *index_it, index_it+1 == path.rend());
+	}
+
+	static_cast<QHBoxLayout*>(this->layout())->addStretch();
+}
+
+void StvBreadcrumbBar::AddEntry(const QString &name, const QModelIndex &folder, bool is_current)
+{
+	QToolButton *button = new QToolButton(this);
+	button->setText(name);
+	button->setAutoRaise(true);
+	button->setCheckable(true);
+	button->setChecked(is_current);
+
+	QObject::connect(button, &QToolButton::clicked, this, [this, folder = QPersistentModelIndex(folder)]() {
+		emit this->FolderSelected(folder);
+	});
+
+	this->layout()->addWidget(button);
+}
@@ -0,0 +1,81 @@
+#ifndef STV_GRID_VIEW_H
+#define STV_GRID_VIEW_H
+
+#include <QPersistentModelIndex>
+#include <QtWidgets/QListView>
+#include <QtWidgets/QWidget>
+
+#include "obs_scene_tree_view/stv_item_model.h"
+
+
+/*!
+ * \brief Shows the items of a single folder as tiles. Based on QListView in icon mode with uniform item sizes,
+ * so only visible tiles are laid out and painted, regardless of the folder size
+ */
+class StvGridView
+        : public QListView
+{
+		Q_OBJECT
+
+	public:
+		static constexpr int MIN_TILE_WIDTH = 96;
+		static constexpr int TILE_MARGIN = 8;
+
+		StvGridView(QWidget *parent = nullptr);
+		~StvGridView() override = default;
+
+		/*!
+		 * \brief Set model. Shares the selection model of view, so both views have the same current item
+		 */
+		void SetItemModel(StvItemModel *model, QAbstractItemView *view);
+
+		/*!
+		 * \brief Show the items of folder. An invalid index shows the top level items
+		 */
+		void SetFolder(const QModelIndex &folder);
+		QStandardItem *GetFolderItem() const;
+
+	signals:
+		void FolderChanged(const QModelIndex &folder);
+
+	public slots:
+		void EditSelectedItem();
+
+	protected:
+		void resizeEvent(QResizeEvent *event) override;
+		void mouseDoubleClickEvent(QMouseEvent *event) override;
+
+	protected slots:
+		void currentChanged(const QModelIndex &current, const QModelIndex &previous) override;
+
+	private:
+		StvItemModel *_model = nullptr;
+		QPersistentModelIndex _folder;
+		bool _in_sub_folder = false;
+
+		void UpdateGridSize();
+};
+
+
+/*!
+ * \brief Path from the top level to the folder shown by StvGridView. Each path entry is a button
+ */
+class StvBreadcrumbBar
+        : public QWidget
+{
+		Q_OBJECT
+
+	public:
+		StvBreadcrumbBar(QWidget *parent = nullptr);
+		~StvBreadcrumbBar() override = default;
+
+		void SetFolder(StvItemModel *model, const QModelIndex &folder);
+
+	signals:
+		void FolderSelected(const QModelIndex &folder);
+
+	private:
+		void AddEntry(const QString &name, const QModelIndex &folder, bool is_current);
+};
+
+#endif // STV_GRID_VIEW_H
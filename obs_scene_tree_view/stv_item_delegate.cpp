@@ -0,0 +1,207 @@
+#include "obs_scene_tree_view/stv_item_delegate.h"
+
+#include "obs_scene_tree_view/stv_item_model.h"
+
+#include <QApplication>
+#include <QIcon>
+#include <QPainter>
+#include <QTreeView>
+
+#include <algorithm>
+
+
+namespace
+{
+	constexpr QRgb LIVE_BADGE_COLOR = qRgb(0xd2, 0x3a, 0x3a);
+	constexpr QRgb PREVIEW_BADGE_COLOR = qRgb(0x3a, 0xa8, 0x5c);
+
+	int get_badge_size(const QStyleOptionViewItem &option)
+	{
+		const int line_height = std::min(option.rect.height(), option.fontMetrics.height() + 2*StvItemDelegate::TEXT_MARGIN);
+		return std::max(line_height/3, 4);
+	}
+}
+
+StvItemDelegate::StvItemDelegate(QObject *parent)
+    : QStyledItemDelegate(parent)
+{}
+
+void StvItemDelegate::SetCompact(bool compact)
+{
+	this->_compact = compact;
+
+	this->_font_metrics.reset();
+	this->_elided_texts.clear();
+}
+
+bool StvItemDelegate::IsCompact() const
+{
+	return this->_compact;
+}
+
+void StvItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+	if(!this->_compact)
+	{
+		QRgb colors[2];
+		const int badges_width = this->GetBadgesWidth(option, this->GetBadges(option, index, colors));
+		if(badges_width == 0)
+			return this->QStyledItemDelegate::paint(painter, option, index);
+
+		QStyleOptionViewItem item_option = option;
+		this->initStyleOption(&item_option, index);
+
+		// Same as QStyledItemDelegate::paint(), with the text elided left of the badges
+		const QWidget *widget = option.widget;
+		QStyle *style = widget ? widget->style() : QApplication::style();
+		const QRect text_rect = style->subElementRect(QStyle::SE_ItemViewItemText, &item_option, widget);
+		const int text_width = std::min(text_rect.right(), option.rect.right() - badges_width) - text_rect.left() + 1;
+		item_option.text = item_option.fontMetrics.elidedText(item_option.text, item_option.textElideMode, std::max(text_width, 0));
+
+		style->drawControl(QStyle::CE_ItemViewItem, &item_option, painter, widget);
+		this->PaintBadges(painter, option, index);
+		return;
+	}
+
+	this->UpdateMetrics(option);
+
+	const QVariant background = index.data(Qt::BackgroundRole);
+	if(background.isValid())
+		painter->fillRect(option.rect, background.value<QBrush>());
+
+	// Only rows with a highlighted background need the style
+	if(option.state & (QStyle::State_Selected | QStyle::State_MouseOver))
+	{
+		const QWidget *widget = option.widget;
+		QStyle *style = widget ? widget->style() : QApplication::style();
+		style->drawPrimitive(QStyle::PE_PanelItemViewItem, &option, painter, widget);
+	}
+
+	QRect rect = option.rect.adjusted(TEXT_MARGIN, 0, -TEXT_MARGIN, 0);
+
+	const QVariant decoration = index.data(Qt::DecorationRole);
+	if(decoration.isValid())
+	{
+		const QIcon icon = decoration.value<QIcon>();
+		if(!icon.isNull())
+		{
+			const QRect icon_rect(rect.left(), rect.top() + (rect.height() - this->_icon_size)/2, this->_icon_size, this->_icon_size);
+			icon.paint(painter, icon_rect, Qt::AlignCenter,
+			           (option.state & QStyle::State_Enabled) ? QIcon::Normal : QIcon::Disabled);
+
+			rect.setLeft(icon_rect.right() + 1 + TEXT_MARGIN);
+		}
+	}
+
+	rect.adjust(0, 0, -this->PaintBadges(painter, option, index), 0);
+
+	const QPalette::ColorGroup color_group = !(option.state & QStyle::State_Enabled) ? QPalette::Disabled :
+	                                         (option.state & QStyle::State_Active) ? QPalette::Normal : QPalette::Inactive;
+	const QPalette::ColorRole color_role = (option.state & QStyle::State_Selected) ? QPalette::HighlightedText : QPalette::Text;
+
+	painter->setPen(option.palette.color(color_group, color_role));
+	painter->drawText(rect, Qt::AlignLeft | Qt::AlignVCenter | Qt::TextSingleLine,
+	                  this->GetElidedText(index.data(Qt::DisplayRole).toString(), rect.width()));
+}
+
+QSize StvItemDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+	// Reserve the badges, so they don't cover the text
+	QRgb colors[2];
+	const int badges_width = this->GetBadgesWidth(option, this->GetBadges(option, index, colors));
+
+	if(!this->_compact)
+		return this->QStyledItemDelegate::sizeHint(option, index) + QSize(badges_width, 0);
+
+	// With uniform row heights, this is only called for the first row
+	this->UpdateMetrics(option);
+
+	const int text_width = this->_font_metrics->horizontalAdvance(index.data(Qt::DisplayRole).toString());
+	return QSize(text_width + this->_icon_size + 3*TEXT_MARGIN + badges_width, this->_row_height);
+}
+
+void StvItemDelegate::UpdateMetrics(const QStyleOptionViewItem &option) const
+{
+	const int icon_size = option.decorationSize.height();
+	if(this->_font_metrics && this->_font == option.font && this->_icon_size == icon_size)
+		return;
+
+	this->_font = option.font;
+	this->_font_metrics.emplace(option.font);
+	this->_icon_size = icon_size;
+	this->_row_height = std::max(this->_font_metrics->height(), icon_size) + 2*TEXT_MARGIN;
+
+	// Elided texts depend on the font
+	this->_elided_texts.clear();
+}
+
+const QString &StvItemDelegate::GetElidedText(const QString &text, int width) const
+{
+	auto elided_it = this->_elided_texts.find(text);
+	if(elided_it == this->_elided_texts.end())
+	{
+		if(this->_elided_texts.size() >= MAX_CACHED_TEXTS)
+			this->_elided_texts.clear();
+
+		elided_it = this->_elided_texts.insert(text, ELIDED_TEXT{-1, QString()});
+	}
+
+	if(elided_it->Width != width)
+	{
+		elided_it->Width = width;
+		elided_it->Text = this->_font_metrics->elidedText(text, Qt::ElideRight, width);
+	}
+
+	return elided_it->Text;
+}
+
+int StvItemDelegate::GetBadges(const QStyleOptionViewItem &option, const QModelIndex &index, QRgb (&colors)[2]) const
+{
+	// Expanded folders show the scene itself
+	const bool is_expanded = qobject_cast<const QTreeView*>(option.widget) ? (option.state & QStyle::State_Open) :
+	                                                                         index.data(StvItemModel::FOLDER_EXPANDED).toBool();
+	if(is_expanded)
+		return 0;
+
+	int badge_count = 0;
+	if(index.data(StvItemModel::FOLDER_LIVE).toBool())
+		colors[badge_count++] = LIVE_BADGE_COLOR;
+	if(index.data(StvItemModel::FOLDER_PREVIEW).toBool())
+		colors[badge_count++] = PREVIEW_BADGE_COLOR;
+
+	return badge_count;
+}
+
+int StvItemDelegate::GetBadgesWidth(const QStyleOptionViewItem &option, int badge_count) const
+{
+	return badge_count*(get_badge_size(option) + TEXT_MARGIN) + (badge_count > 0 ? TEXT_MARGIN : 0);
+}
+
+int StvItemDelegate::PaintBadges(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+	QRgb colors[2];
+	const int badge_count = this->GetBadges(option, index, colors);
+	if(badge_count == 0)
+		return 0;
+
+	// Badges are centered on the first line, tiles of the grid view are taller than a row
+	const int size = get_badge_size(option);
+	const int line_height = std::min(option.rect.height(), option.fontMetrics.height() + 2*TEXT_MARGIN);
+	int right = option.rect.right() - TEXT_MARGIN;
+
+	painter->save();
+	painter->setRenderHint(QPainter::Antialiasing);
+	painter->setPen(Qt::NoPen);
+
+	// Live badge at the right edge, preview badge left of it
+	for(int badge = 0; badge < badge_count; ++badge)
+	{
+		painter->setBrush(QColor(colors[badge]));
+		painter->drawEllipse(QRect(right - size + 1, option.rect.top() + (line_height - size)/2, size, size));
+		right -= size + TEXT_MARGIN;
+	}
+
+	painter->restore();
+
+	return option.rect.right() - right;
+}
@@ -0,0 +1,78 @@
+#ifndef STV_ITEM_DELEGATE_H
+#define STV_ITEM_DELEGATE_H
+
+#include <QFont>
+#include <QFontMetrics>
+#include <QHash>
+#include <QStyledItemDelegate>
+
+#include <optional>
+
+
+/*!
+ * \brief Item delegate of the scene tree. In compact mode, rows are painted directly with cached font metrics
+ * and elided text. The style is only asked to draw the background of selected and hovered rows,
+ * so theme selection colors are kept. Otherwise, painting is left to QStyledItemDelegate.
+ * Collapsed folders containing the program or preview scene get a badge at the right edge in both modes. The text
+ * is elided before it reaches the badges
+ */
+class StvItemDelegate
+        : public QStyledItemDelegate
+{
+		Q_OBJECT
+
+	public:
+		static constexpr int TEXT_MARGIN = 3;
+
+		// Drop cached elided texts once this many are stored
+		static constexpr int MAX_CACHED_TEXTS = 16*1024;
+
+		StvItemDelegate(QObject *parent = nullptr);
+		~StvItemDelegate() override = default;
+
+		void SetCompact(bool compact);
+		bool IsCompact() const;
+
+		void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+		QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+
+	private:
+		struct ELIDED_TEXT
+		{
+			int Width;
+			QString Text;
+		};
+
+		bool _compact = false;
+
+		// Metrics of the last used font
+		mutable QFont _font;
+		mutable std::optional<QFontMetrics> _font_metrics;
+		mutable int _icon_size = 0;
+		mutable int _row_height = 0;
+
+		mutable QHash<QString, ELIDED_TEXT> _elided_texts;
+
+		void UpdateMetrics(const QStyleOptionViewItem &option) const;
+		const QString &GetElidedText(const QString &text, int width) const;
+
+		/*!
+		 * \brief Colors of the live and preview badges of a collapsed folder. Tree views report expanded folders
+		 * with State_Open, other views don't show folder contents below the folder and use the stored expansion
+		 * \return Number of badges
+		 */
+		int GetBadges(const QStyleOptionViewItem &option, const QModelIndex &index, QRgb (&colors)[2]) const;
+
+		/*!
+		 * \return Width taken by badge_count badges, including the margin to the text
+		 */
+		int GetBadgesWidth(const QStyleOptionViewItem &option, int badge_count) const;
+
+		/*!
+		 * \brief Paint the live and preview badges of a collapsed folder
+		 * \return Width taken by the badges, 0 if none were painted
+		 */
+		int PaintBadges(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const;
+};
+
+#endif // STV_ITEM_DELEGATE_H
@@ -1,17 +1,65 @@
 #include "obs_scene_tree_view/stv_item_model.h"
+#include "obs_scene_tree_view/stv_stats.h"
+#include "obs_scene_tree_view/stv_tree_publisher.h"
 
 #include <util/config-file.h>
 
+#include <QApplication>
 #include <QMessageBox>
 #include <QLineEdit>
 #include <QMimeData>
 #include <QRegularExpression>
 #include <QtWidgets/QMainWindow>
 
+#include <algorithm>
+#include <deque>
+#include <unordered_set>
+
+
+namespace
+{
+	// Only folders created on the UI thread get ids
+	uint64_t next_folder_id = 0;
+}
+
+#ifdef STV_ACCOUNTING
+namespace
+{
+	int64_t get_name_bytes(const QVariant &name)
+	{
+		return name.isValid() ? (int64_t)(name.toString().size()*sizeof(QChar)) : 0;
+	}
+
+	int64_t get_icon_refs(const QVariant &icon)
+	{
+		return icon.isValid() && !icon.value<QIcon>().isNull() ? 1 : 0;
+	}
+
+	// Must be called before value is stored
+	void account_item_data(const QStandardItem &item, const QVariant &value, int role)
+	{
+		if(role == Qt::DisplayRole || role == Qt::EditRole)
+			STV_ACCOUNT(NAME_BYTES, get_name_bytes(value) - get_name_bytes(item.data(Qt::DisplayRole)));
+		else if(role == Qt::DecorationRole)
+			STV_ACCOUNT(ICON_REFS, get_icon_refs(value) - get_icon_refs(item.data(Qt::DecorationRole)));
+	}
+
+	void account_item_removal(const QStandardItem &item)
+	{
+		STV_ACCOUNT(NAME_BYTES, -get_name_bytes(item.data(Qt::DisplayRole)));
+		STV_ACCOUNT(ICON_REFS, -get_icon_refs(item.data(Qt::DecorationRole)));
+	}
+}
+#endif
+
 
 StvFolderItem::StvFolderItem(const QString &text)
-    : QStandardItem(text)
+    : QStandardItem(text),
+      _id(++next_folder_id)
 {
+	STV_ACCOUNT(FOLDER_ITEMS, 1);
+	STV_ACCOUNT(NAME_BYTES, get_name_bytes(text));
+
 	this->setDropEnabled(true);
 
 	QMainWindow *main_window = reinterpret_cast<QMainWindow*>(obs_frontend_get_main_window());
@@ -21,13 +69,60 @@ StvFolderItem::StvFolderItem(const QString &text)
 	this->setIcon(icon);
 }
 
+StvFolderItem::~StvFolderItem()
+{
+	STV_ACCOUNT(FOLDER_ITEMS, -1);
+#ifdef STV_ACCOUNTING
+	account_item_removal(*this);
+#endif
+}
+
 int StvFolderItem::type() const
 {	return StvItemModel::FOLDER;	}
 
+void StvFolderItem::setData(const QVariant &value, int role)
+{
+#ifdef STV_ACCOUNTING
+	account_item_data(*this, value, role);
+#endif
+	if(role == Qt::DisplayRole || role == Qt::EditRole)
+		this->_sort_key.reset();
+
+	this->QStandardItem::setData(value, role);
+}
 
-StvSceneItem::StvSceneItem(const QString &text, obs_weak_source_t *weak)
-    : QStandardItem(text)
+uint64_t StvFolderItem::GetId() const
 {
+	return this->_id;
+}
+
+void StvFolderItem::SetId(uint64_t id)
+{
+	assert(id != 0);
+	this->_id = id;
+}
+
+const QCollatorSortKey &StvFolderItem::GetSortKey(const QCollator &collator) const
+{
+	if(!this->_sort_key)
+		this->_sort_key = collator.sortKey(this->text());
+
+	return *this->_sort_key;
+}
+
+bool StvFolderItem::operator<(const QStandardItem &other) const
+{
+	return static_cast<const StvItemModel*>(this->model())->LessThan(*this, other);
+}
+
+
+StvSceneItem::StvSceneItem(const QString &text, obs_weak_source_t *weak, const char *uuid)
+    : QStandardItem(text),
+      _uuid(QString::fromUtf8(uuid))
+{
+	STV_ACCOUNT(SCENE_ITEMS, 1);
+	STV_ACCOUNT(NAME_BYTES, get_name_bytes(text));
+
 	this->setDropEnabled(false);
 	this->setData(QVariant::fromValue(obs_weak_source_ptr({weak})), StvItemModel::OBS_SCENE);
 
@@ -38,19 +133,74 @@ StvSceneItem::StvSceneItem(const QString &text, obs_weak_source_t *weak)
 	this->setIcon(icon);
 }
 
+StvSceneItem::~StvSceneItem()
+{
+	STV_ACCOUNT(SCENE_ITEMS, -1);
+#ifdef STV_ACCOUNTING
+	account_item_removal(*this);
+#endif
+}
+
 int StvSceneItem::type() const
 {	return StvItemModel::SCENE;	}
 
+void StvSceneItem::setData(const QVariant &value, int role)
+{
+#ifdef STV_ACCOUNTING
+	account_item_data(*this, value, role);
+#endif
+	if(role == Qt::DisplayRole || role == Qt::EditRole)
+		this->_sort_key.reset();
+
+	this->QStandardItem::setData(value, role);
+}
+
+const QCollatorSortKey &StvSceneItem::GetSortKey(const QCollator &collator) const
+{
+	if(!this->_sort_key)
+		this->_sort_key = collator.sortKey(this->text());
+
+	return *this->_sort_key;
+}
+
+const QString &StvSceneItem::GetUuid() const
+{
+	return this->_uuid;
+}
+
+bool StvSceneItem::operator<(const QStandardItem &other) const
+{
+	return static_cast<const StvItemModel*>(this->model())->LessThan(*this, other);
+}
+
 
 StvItemModel::StvItemModel()
-{}
+    : _scene_dependencies(std::bind(&StvItemModel::OnSceneDependenciesChanged, this))
+{
+	// Natural order: "Scene 2" before "Scene 10"
+	this->_collator.setNumericMode(true);
+	this->_collator.setCaseSensitivity(Qt::CaseInsensitive);
+
+	QObject::connect(this, &QAbstractItemModel::rowsInserted, this, &StvItemModel::ScheduleActiveScenesUpdate);
+	QObject::connect(this, &QAbstractItemModel::rowsRemoved, this, &StvItemModel::ScheduleActiveScenesUpdate);
+	QObject::connect(this, &QAbstractItemModel::rowsMoved, this, &StvItemModel::ScheduleActiveScenesUpdate);
+	QObject::connect(this, &QAbstractItemModel::layoutChanged, this, &StvItemModel::ScheduleActiveScenesUpdate);
+	QObject::connect(this, &QAbstractItemModel::modelReset, this, &StvItemModel::ScheduleActiveScenesUpdate);
+
+	signal_handler_connect(obs_get_signal_handler(), "source_update", &StvItemModel::obs_source_update_cb, this);
+}
 
 StvItemModel::~StvItemModel()
 {
+	signal_handler_disconnect(obs_get_signal_handler(), "source_update", &StvItemModel::obs_source_update_cb, this);
+
+	this->_scene_dependencies.Clear();
+
 	// Remove scene refs
 	for(auto &scene : this->_scenes_in_tree)
 	{
 		obs_weak_source_release(scene.first);
+		STV_ACCOUNT(WEAK_SOURCE_REFS, -1);
 	}
 
 	this->_scenes_in_tree.clear();
@@ -117,12 +267,23 @@ bool StvItemModel::dropMimeData(const QMimeData *data, Qt::DropAction action, in
 		// Find item and move it
 		const mime_item_data_t *item_data = (const mime_item_data_t*)dat;
 		assert(item_data->Type == FOLDER || item_data->Type == SCENE);
+
+		QStandardItem *item = nullptr;
 		if(item_data->Type == SCENE)
-			this->MoveSceneItem((obs_weak_source_t*)item_data->Data, row, parent_item);
+		{
+			if(const auto scene_it = this->_scenes_in_tree.find((obs_weak_source_t*)item_data->Data); scene_it != this->_scenes_in_tree.end())
+				item = scene_it->second;
+			else
+				blog(LOG_WARNING, "[%s] Couldn't find item to move in Scene Tree View", obs_module_name());
+		}
 		else
-			this->MoveSceneFolder((QStandardItem*)item_data->Data, row, parent_item);
+			item = (QStandardItem*)item_data->Data;
+
+		// Keep order of multiple dropped items
+		if(item && this->MoveItem(item, row, parent_item))
+			row = item->row()+1;
 
-		dat += sizeof(obs_weak_source_ptr);
+		dat += sizeof(mime_item_data_t);
 	}
 
 	return true;
@@ -131,9 +292,17 @@ bool StvItemModel::dropMimeData(const QMimeData *data, Qt::DropAction action, in
 void StvItemModel::UpdateTree(obs_frontend_source_list &scene_list, const QModelIndex &selected_index)
 {
 	this->UpdateSceneSize();
+	this->IndexSceneCanvases(scene_list);
 
 	source_map_t new_scene_tree;
 
+	// New scenes are all added next to the selected item. Collect them and insert them as one range,
+	// so views lay out once instead of once per scene
+	QStandardItem *insert_parent = nullptr;
+	int insert_row = 0;
+	bool insert_in_front = true;
+	QList<QStandardItem*> new_scene_items;
+
 	for (size_t i = 0; i < scene_list.sources.num; i++)
 	{
 		obs_source_t *source = scene_list.sources.array[i];
@@ -161,49 +330,89 @@ void StvItemModel::UpdateTree(obs_frontend_source_list &scene_list, const QModel
 		{
 			// if not in tree, add it
 			scene_it = new_scene_tree.emplace(weak, nullptr).first;
+			STV_ACCOUNT(WEAK_SOURCE_REFS, 1);
 		}
 
 		weak = nullptr;
 
-		// Check that scene contains tree data
-		obs_data_t *scene_dat = obs_source_get_private_settings(OBSGetStrongRef(scene_it->first).Get());
-
 		if(!scene_it->second)
 		{
 			// Scene not yet in tree, add it at the correct position
-			QStandardItem *selected = this->itemFromIndex(selected_index);
-			QStandardItem *parent;
-			if(selected)
+			if(!insert_parent)
 			{
-				assert(selected->type() == QITEM_TYPE::SCENE || selected->type() == QITEM_TYPE::FOLDER);
-
-				if(selected->type() == QITEM_TYPE::FOLDER)
-					parent = selected;
+				QStandardItem *selected = this->itemFromIndex(selected_index);
+				if(selected)
+				{
+					assert(selected->type() == QITEM_TYPE::SCENE || selected->type() == QITEM_TYPE::FOLDER);
+
+					if(selected->type() == QITEM_TYPE::FOLDER)
+						insert_parent = selected;
+					else
+					{
+						insert_parent = this->GetParentOrRoot(selected->index());
+						insert_row = selected->row();
+						insert_in_front = false;
+					}
+				}
 				else
-					parent = this->GetParentOrRoot(selected->index());
+					insert_parent = this->invisibleRootItem();
 			}
-			else
-			{
-				selected = this->invisibleRootItem();
-				parent = selected;
-			}
-
-			// Add new item to scene
-			StvSceneItem *pItem = new StvSceneItem(obs_source_get_name(source), scene_it->first);
 
-			const auto row = parent == selected ? 0 : selected->row();
-			parent->insertRow(row, pItem);
+			// Add new item to scene. Keeps the order of inserting scenes one by one: each scene goes to the top of a
+			// selected folder, in front of the previous one, or directly in front of a selected scene, behind the
+			// previous one
+			StvSceneItem *pItem = new StvSceneItem(obs_source_get_name(source), scene_it->first, obs_source_get_uuid(source));
+			if(insert_in_front)
+				new_scene_items.prepend(pItem);
+			else
+				new_scene_items.append(pItem);
 
 			scene_it->second = pItem;
+			this->_scene_dependencies.AddScene(scene_it->first);
 		}
 		else
 		{
 			// Update scene name
-			scene_it->second->setText(obs_source_get_name(source));
+			const QString name = QString::fromUtf8(obs_source_get_name(source));
+			if(scene_it->second->text() != name)
+				this->RenameItem(scene_it->second, name);
+		}
+	}
+
+	if(!new_scene_items.empty())
+	{
+		std::vector<StvTreeOp> ops;
+		ops.reserve(new_scene_items.size());
+
+		const std::vector<int> parent_path = this->GetItemPath(insert_parent);
+		auto add_insert_op = [&ops, &parent_path](int row, QStandardItem *scene_item) {
+			StvTreeOp op;
+			op.Type = StvTreeOp::INSERT;
+			op.Path = parent_path;
+			op.Row = row;
+			op.Name = scene_item->text();
+			op.Uuid = static_cast<StvSceneItem*>(scene_item)->GetUuid();
+			ops.push_back(std::move(op));
+		};
+
+		if(this->IsFolderSorted(insert_parent))
+		{
+			// Each scene goes to its own row in a sorted folder
+			for(QStandardItem *scene_item : new_scene_items)
+			{
+				const int row = this->GetSortedRow(insert_parent, scene_item);
+				insert_parent->insertRow(row, scene_item);
+				add_insert_op(row, scene_item);
+			}
+		}
+		else
+		{
+			insert_parent->insertRows(insert_row, new_scene_items);
+			for(int i=0; i < new_scene_items.size(); ++i)
+				add_insert_op(insert_row + i, new_scene_items[i]);
 		}
 
-		obs_data_release(scene_dat);
-		scene_dat = nullptr;
+		this->EmitTreeEdits(ops);
 	}
 
 	// Erase all remaining elements in _scene_tree
@@ -211,11 +420,18 @@ void StvItemModel::UpdateTree(obs_frontend_source_list &scene_list, const QModel
 	{
 		assert(scene.second);
 
+		StvTreeOp op;
+		op.Type = StvTreeOp::REMOVE;
+		op.Path = this->GetItemPath(scene.second);
+		this->EmitTreeEdit(op);
+
 		const int row = scene.second->row();
 		this->removeRow(row, this->parent(scene.second->index()));
 
 		// Remove scene reference
+		this->_scene_dependencies.RemoveScene(scene.first);
 		obs_weak_source_release(scene.first);
+		STV_ACCOUNT(WEAK_SOURCE_REFS, -1);
 	}
 
 	this->_scenes_in_tree = std::move(new_scene_tree);
@@ -246,7 +462,10 @@ void StvItemModel::SetSelectedScene(QStandardItem *item, bool set_preview_scene,
 		if(!set_preview_scene)
 		{
 			if(force_set_scene || OBSSourceAutoRelease(obs_frontend_get_current_scene()).Get() != source)
+			{
+				emit this->SceneSwitching(source);
 				obs_frontend_set_current_scene(source);
+			}
 		}
 		else if(force_set_scene || OBSSourceAutoRelease(obs_frontend_get_current_preview_scene()).Get() != source)
 			obs_frontend_set_current_preview_scene(source);
@@ -268,18 +487,503 @@ QStandardItem *StvItemModel::GetCurrentSceneItem()
 	}
 }
 
+QStandardItem *StvItemModel::GetSceneItem(obs_source_t *scene_source)
+{
+	if(!scene_source)
+		return nullptr;
+
+	OBSWeakSourceAutoRelease weak = obs_source_get_weak_source(scene_source);
+	const auto scene_it = this->_scenes_in_tree.find(weak);
+	return scene_it != this->_scenes_in_tree.end() ? scene_it->second : nullptr;
+}
+
 OBSSourceAutoRelease StvItemModel::GetCurrentScene()
 {
 	return obs_frontend_preview_program_mode_active() ? obs_frontend_get_current_preview_scene() : obs_frontend_get_current_scene();
 }
 
-void StvItemModel::SaveSceneTree(obs_data_t *root_folder_data, const char *scene_collection, QTreeView *view)
+void StvItemModel::SetFolderExpanded(const QModelIndex &index, bool expanded)
+{
+	QStandardItem *item = this->itemFromIndex(index);
+	if(item && item->type() == FOLDER && item->data(QDATA_ROLE::FOLDER_EXPANDED).toBool() != expanded)
+	{
+		item->setData(expanded, QDATA_ROLE::FOLDER_EXPANDED);
+
+		StvUndoStack::DELTA delta;
+		delta.Type = StvUndoStack::DELTA::EXPAND;
+		delta.Item = this->GetHandle(item);
+		delta.IsExpanded = expanded;
+		this->RecordUndo(std::move(delta));
+
+		StvTreeOp op;
+		op.Type = StvTreeOp::EXPAND;
+		op.Path = this->GetItemPath(item);
+		op.IsExpanded = expanded;
+		this->EmitTreeEdit(op);
+	}
+}
+
+void StvItemModel::SetFolderSorted(QStandardItem *folder, bool sorted)
+{
+	if(!folder || folder->type() != FOLDER || this->IsFolderSorted(folder) == sorted)
+		return;
+
+	StvUndoStack::DELTA delta;
+	delta.Type = StvUndoStack::DELTA::SORT;
+	delta.Item = this->GetHandle(folder);
+	delta.IsSorted = sorted;
+	this->RecordUndo(std::move(delta));
+
+	const std::vector<int> folder_path = this->GetItemPath(folder);
+	std::vector<StvTreeOp> ops;
+
+	if(sorted)
+	{
+		std::vector<QStandardItem*> items;
+		items.reserve(folder->rowCount());
+		for(int row = 0; row < folder->rowCount(); ++row)
+			items.push_back(folder->child(row));
+
+		std::vector<QStandardItem*> sorted_items = items;
+		std::stable_sort(sorted_items.begin(), sorted_items.end(), [this](QStandardItem *item, QStandardItem *other) {
+			return this->IsSortedBefore(item, other);
+		});
+
+		// Each misplaced item becomes a single move, so the journal replays the exact order
+		std::vector<int> item_path = folder_path;
+		item_path.push_back(0);
+		for(size_t row = 0; row < sorted_items.size(); ++row)
+		{
+			const auto item_it = std::find(items.begin() + row, items.end(), sorted_items[row]);
+			if(item_it == items.begin() + row)
+				continue;
+
+			item_path.back() = (int)(item_it - items.begin());
+
+			StvTreeOp op;
+			op.Type = StvTreeOp::MOVE;
+			op.Path = item_path;
+			op.TargetPath = folder_path;
+			op.Row = (int)row;
+			ops.push_back(std::move(op));
+
+			std::rotate(items.begin() + row, item_it, item_it+1);
+		}
+	}
+
+	StvTreeOp op;
+	op.Type = StvTreeOp::SORT;
+	op.Path = folder_path;
+	op.IsSorted = sorted;
+	ops.push_back(std::move(op));
+
+	// Sorting is a permutation of the folder's rows. sortChildren() applies it as a single layout change and
+	// updates persistent indexes, so views keep selection and expansion. It recurses into subfolders, which
+	// LessThan() leaves untouched
+	if(sorted)
+	{
+		this->_sorting_folder = folder;
+		folder->sortChildren(0);
+		this->_sorting_folder = nullptr;
+	}
+
+	folder->setData(sorted, QDATA_ROLE::FOLDER_SORTED);
+
+	this->EmitTreeEdits(ops);
+}
+
+bool StvItemModel::IsFolderSorted(QStandardItem *folder) const
+{
+	return folder && folder->type() == FOLDER && folder->data(QDATA_ROLE::FOLDER_SORTED).toBool();
+}
+
+const QCollator &StvItemModel::GetCollator() const
+{
+	return this->_collator;
+}
+
+bool StvItemModel::LessThan(const QStandardItem &item, const QStandardItem &other) const
+{
+	if(!this->_sorting_folder || item.parent() != this->_sorting_folder)
+		return false;
+
+	return this->IsSortedBefore(&item, &other);
+}
+
+StvFolderItem *StvItemModel::AddFolder(const QString &name, QStandardItem *parent, int row)
+{
+	StvFolderItem *folder = new StvFolderItem(name);
+	if(this->IsFolderSorted(parent))
+		row = this->GetSortedRow(parent, folder);
+
+	parent->insertRow(row, folder);
+	this->RegisterFolder(folder);
+
+	StvUndoStack::DELTA delta;
+	delta.Type = StvUndoStack::DELTA::CREATE_FOLDER;
+	delta.Item = this->GetHandle(folder);
+	delta.Parent = this->GetHandle(parent);
+	delta.Row = row;
+	delta.Name = name;
+	this->RecordUndo(std::move(delta));
+
+	StvTreeOp op;
+	op.Type = StvTreeOp::INSERT;
+	op.Path = this->GetItemPath(parent);
+	op.Row = row;
+	op.IsFolder = true;
+	op.Name = name;
+	this->EmitTreeEdit(op);
+
+	return folder;
+}
+
+void StvItemModel::RenameItem(QStandardItem *item, const QString &name)
+{
+	StvTreeOp op;
+	op.Type = StvTreeOp::RENAME;
+	op.Path = this->GetItemPath(item);
+	op.Name = name;
+
+	// Scenes are renamed by OBS, which keeps its own undo history
+	if(item->type() == FOLDER)
+	{
+		// Editors change the item text before the rename is committed, so take the previous name from the
+		// published tree
+		const StvTreeNodePtr node = this->_published_tree && !this->_republish_queued ?
+		            StvTreeSnapshot::Find(this->_published_tree, op.Path) :
+		            nullptr;
+
+		StvUndoStack::DELTA delta;
+		delta.Type = StvUndoStack::DELTA::RENAME;
+		delta.Item = this->GetHandle(item);
+		delta.Name = node ? node->Name : item->text();
+		delta.NewName = name;
+		if(delta.Name != delta.NewName)
+			this->RecordUndo(std::move(delta));
+	}
+
+	item->setText(name);
+	this->EmitTreeEdit(op);
+
+	// Move the renamed item to its new row in a sorted folder
+	QStandardItem *parent = this->GetParentOrRoot(item->index());
+	if(this->IsFolderSorted(parent))
+		this->MoveItem(item, item->row(), parent);
+}
+
+void StvItemModel::RemoveItem(QStandardItem *item)
+{
+	QStandardItem *parent = this->GetParentOrRoot(item->index());
+
+	// Scenes are removed by OBS. Only empty folders can be restored
+	if(item->type() == FOLDER && item->rowCount() == 0)
+	{
+		StvUndoStack::DELTA delta;
+		delta.Type = StvUndoStack::DELTA::REMOVE_FOLDER;
+		delta.Item = this->GetHandle(item);
+		delta.Parent = this->GetHandle(parent);
+		delta.Row = item->row();
+		delta.Name = item->text();
+		delta.IsExpanded = item->data(QDATA_ROLE::FOLDER_EXPANDED).toBool();
+		this->RecordUndo(std::move(delta));
+	}
+
+	StvTreeOp op;
+	op.Type = StvTreeOp::REMOVE;
+	op.Path = this->GetItemPath(item);
+	this->EmitTreeEdit(op);
+
+	this->UnregisterFolders(item);
+	parent->removeRow(item->row());
+}
+
+bool StvItemModel::MoveItem(QStandardItem *item, int row, QStandardItem *parent_item)
+{
+	assert(item->type() == FOLDER || item->type() == SCENE);
+
+	// Folders can't be moved into themselves
+	for(QStandardItem *ancestor = parent_item; ancestor; ancestor = ancestor->parent())
+	{
+		if(ancestor == item)
+			return false;
+	}
+
+	QStandardItem *old_parent = this->GetParentOrRoot(item->index());
+	const int old_row = item->row();
+
+	// row refers to the position before the item was taken out. Sorted folders decide the row themselves,
+	// so items can be dropped into them, but not reordered within them
+	if(this->IsFolderSorted(parent_item))
+		row = this->GetSortedRow(parent_item, item);
+	else if(old_parent == parent_item && old_row < row)
+		--row;
+
+	if(old_parent == parent_item && old_row == row)
+		return true;
+
+	blog(LOG_DEBUG, "[%s] Moving %s", obs_module_name(), item->text().toStdString().c_str());
+
+	StvTreeOp op;
+	op.Type = StvTreeOp::MOVE;
+	op.Path = this->GetItemPath(item);
+
+	// Re-parent the item, its children stay attached
+	QList<QStandardItem*> row_items = old_parent->takeRow(old_row);
+	row = std::clamp(row, 0, parent_item->rowCount());
+	parent_item->insertRow(row, row_items);
+
+	op.TargetPath = this->GetItemPath(parent_item);
+	op.Row = row;
+	this->EmitTreeEdit(op);
+
+	StvUndoStack::DELTA delta;
+	delta.Type = StvUndoStack::DELTA::MOVE;
+	delta.Item = this->GetHandle(item);
+	delta.Parent = this->GetHandle(old_parent);
+	delta.Row = old_row;
+	delta.NewParent = this->GetHandle(parent_item);
+	delta.NewRow = row;
+	this->RecordUndo(std::move(delta));
+
+	// Check that name is unique
+	if(item->type() == FOLDER)
+	{
+		const QString new_name = this->CreateUniqueFolderName(item, parent_item);
+		if(new_name != item->text())
+			this->RenameItem(item, new_name);
+	}
+
+	return true;
+}
+
+std::vector<int> StvItemModel::GetItemPath(QStandardItem *item)
+{
+	std::vector<int> path;
+	for(; item && item != this->invisibleRootItem(); item = item->parent())
+		path.push_back(item->row());
+
+	std::reverse(path.begin(), path.end());
+	return path;
+}
+
+std::vector<QString> StvItemModel::GetFolderPath(QStandardItem *folder)
+{
+	std::vector<QString> folder_path;
+	for(; folder && folder != this->invisibleRootItem(); folder = folder->parent())
+		folder_path.push_back(folder->text());
+
+	std::reverse(folder_path.begin(), folder_path.end());
+	return folder_path;
+}
+
+QStandardItem *StvItemModel::FindFolder(const std::vector<QString> &folder_path)
+{
+	QStandardItem *folder = this->invisibleRootItem();
+	for(const QString &folder_name : folder_path)
+	{
+		// Folder names are unique within their parent
+		QStandardItem *child_folder = nullptr;
+		for(int i=0; i < folder->rowCount() && !child_folder; ++i)
+		{
+			QStandardItem *child = folder->child(i);
+			if(child->type() == FOLDER && child->text() == folder_name)
+				child_folder = child;
+		}
+
+		if(!child_folder)
+			return nullptr;
+
+		folder = child_folder;
+	}
+
+	return folder;
+}
+
+StvFolderItem *StvItemModel::GetFolderItem(uint64_t folder_id) const
+{
+	return this->_folders.value(folder_id, nullptr);
+}
+
+StvTreeNodePtr StvItemModel::CreateSnapshot()
+{
+	return this->CreateSnapshotNode(*this->invisibleRootItem());
+}
+
+StvTreeNodePtr StvItemModel::GetTree()
+{
+	return this->_published_tree && !this->_republish_queued ? this->_published_tree : this->CreateSnapshot();
+}
+
+void StvItemModel::ApplyTreeOps(const std::vector<StvTreeOp> &ops, StvTreeNodePtr tree)
+{
+	// Ops are applied with the regular row signals. A layout change must not insert or remove rows, and
+	// invalidates the persistent indexes of moved subtrees
+	for(const auto &op : ops)
+	{
+		StvUndoStack::DELTA delta;
+
+		switch(op.Type)
+		{
+			case StvTreeOp::INSERT:
+			{
+				QStandardItem *parent = this->GetItem(op.Path);
+				StvFolderItem *folder = new StvFolderItem(op.Name);
+				folder->setData(op.IsExpanded, QDATA_ROLE::FOLDER_EXPANDED);
+				parent->insertRow(op.Row, folder);
+				this->RegisterFolder(folder);
+
+				delta.Type = StvUndoStack::DELTA::CREATE_FOLDER;
+				delta.Item = this->GetHandle(folder);
+				delta.Parent = this->GetHandle(parent);
+				delta.Row = op.Row;
+				delta.Name = op.Name;
+				delta.IsExpanded = op.IsExpanded;
+				break;
+			}
+
+			case StvTreeOp::MOVE:
+			{
+				QStandardItem *item = this->GetItem(op.Path);
+				QStandardItem *old_parent = this->GetParentOrRoot(item->index());
+
+				delta.Type = StvUndoStack::DELTA::MOVE;
+				delta.Item = this->GetHandle(item);
+				delta.Parent = this->GetHandle(old_parent);
+				delta.Row = item->row();
+
+				// Re-parent the item, its children stay attached
+				QList<QStandardItem*> row_items = old_parent->takeRow(item->row());
+				QStandardItem *parent = this->GetItem(op.TargetPath);
+				parent->insertRow(op.Row, row_items);
+
+				delta.NewParent = this->GetHandle(parent);
+				delta.NewRow = op.Row;
+				break;
+			}
+
+			case StvTreeOp::RENAME:
+			{
+				QStandardItem *item = this->GetItem(op.Path);
+
+				delta.Type = StvUndoStack::DELTA::RENAME;
+				delta.Item = this->GetHandle(item);
+				delta.Name = item->text();
+				delta.NewName = op.Name;
+
+				item->setText(op.Name);
+				break;
+			}
+
+			case StvTreeOp::EXPAND:
+			{
+				QStandardItem *item = this->GetItem(op.Path);
+				item->setData(op.IsExpanded, QDATA_ROLE::FOLDER_EXPANDED);
+
+				delta.Type = StvUndoStack::DELTA::EXPAND;
+				delta.Item = this->GetHandle(item);
+				delta.IsExpanded = op.IsExpanded;
+				break;
+			}
+
+			case StvTreeOp::SORT:
+			{
+				QStandardItem *item = this->GetItem(op.Path);
+				item->setData(op.IsSorted, QDATA_ROLE::FOLDER_SORTED);
+
+				delta.Type = StvUndoStack::DELTA::SORT;
+				delta.Item = this->GetHandle(item);
+				delta.IsSorted = op.IsSorted;
+				break;
+			}
+
+			case StvTreeOp::REMOVE:
+				// StvTreeCommands::Resolve() rejects removals, items are only removed through OBS or the dock
+				assert(false);
+				continue;
+		}
+
+		// All deltas of the batch form one undo step
+		this->RecordUndo(std::move(delta));
+	}
+
+	this->_published_tree = std::move(tree);
+	StvTreePublisher::Get().Publish(this->_published_tree);
+
+	// All ops of the batch end up in a single journal write
+	if(this->_suppress_tree_edits == 0)
+	{
+		for(const auto &op : ops)
+			emit this->TreeEdited(op);
+	}
+}
+
+bool StvItemModel::Undo()
+{
+	StvUndoStack::step_t step = this->_undo_stack.TakeUndoStep();
+	if(step.empty())
+		return false;
+
+	++this->_applying_undo;
+
+	StvUndoStack::step_t reverted;
+	for(auto delta_it = step.rbegin(); delta_it != step.rend(); ++delta_it)
+	{
+		if(this->ApplyUndoDelta(*delta_it, true))
+			reverted.push_back(std::move(*delta_it));
+		else
+			blog(LOG_DEBUG, "[%s] Skipping undo of edit that no longer applies", obs_module_name());
+	}
+
+	--this->_applying_undo;
+
+	// Redo re-applies deltas in their original order
+	std::reverse(reverted.begin(), reverted.end());
+	this->_undo_stack.PushRedoStep(std::move(reverted));
+
+	return true;
+}
+
+bool StvItemModel::Redo()
+{
+	StvUndoStack::step_t step = this->_undo_stack.TakeRedoStep();
+	if(step.empty())
+		return false;
+
+	++this->_applying_undo;
+
+	StvUndoStack::step_t applied;
+	for(auto &delta : step)
+	{
+		if(this->ApplyUndoDelta(delta, false))
+			applied.push_back(std::move(delta));
+		else
+			blog(LOG_DEBUG, "[%s] Skipping redo of edit that no longer applies", obs_module_name());
+	}
+
+	--this->_applying_undo;
+
+	this->_undo_stack.PushUndoStep(std::move(applied));
+
+	return true;
+}
+
+bool StvItemModel::CanUndo() const
+{
+	return this->_undo_stack.CanUndo();
+}
+
+bool StvItemModel::CanRedo() const
 {
-	OBSDataArrayAutoRelease folder_data = this->CreateFolderArray(*this->invisibleRootItem(), view);
-	obs_data_set_array(root_folder_data, scene_collection, folder_data);
+	return this->_undo_stack.CanRedo();
 }
 
-void StvItemModel::LoadSceneTree(obs_data_t *root_folder_data, const char *scene_collection, QTreeView *view)
+void StvItemModel::SetUndoMemoryLimit(size_t memory_limit)
+{
+	this->_undo_stack.SetMemoryLimit(memory_limit);
+}
+
+void StvItemModel::LoadSceneTree(const StvTreeNodePtr &tree)
 {
 	this->UpdateSceneSize();
 
@@ -288,32 +992,89 @@ void StvItemModel::LoadSceneTree(obs_data_t *root_folder_data, const char *scene
 	// Erase previous data
 	this->CleanupSceneTree();
 
-	// Add loaded data
-	OBSDataArrayAutoRelease folder_array = obs_data_get_array(root_folder_data, scene_collection);
-	if(folder_array)
+	// Add loaded data. Views expand folders when they are inserted
+	if(tree)
 	{
-		std::list<StvFolderItem*> expandable_folders;
-		this->LoadFolderArray(folder_array, *root_item, expandable_folders);
+		this->_skipped_scene_count = 0;
+		this->_outdated_scene_count = 0;
+
+		// Stored scenes are matched against one index of the scene list, by UUID and by name for older trees
+		obs_frontend_source_list scene_list = {};
+		obs_frontend_get_scenes(&scene_list);
 
-		for(auto &item : expandable_folders)
+		SCENE_INDEX scene_index;
+		scene_index.ByUuid.reserve((qsizetype)scene_list.sources.num);
+		scene_index.ByName.reserve((qsizetype)scene_list.sources.num);
+		for(size_t i = 0; i < scene_list.sources.num; i++)
 		{
-			view->setExpanded(item->index(), true);
+			obs_source_t *source = scene_list.sources.array[i];
+			scene_index.ByUuid.insert(QString::fromUtf8(obs_source_get_uuid(source)), source);
+			scene_index.ByName.insert(QString::fromUtf8(obs_source_get_name(source)), source);
 		}
+
+		this->IndexSceneCanvases(scene_list);
+
+		++this->_suppress_tree_edits;
+		this->LoadFolderNode(*tree, *root_item, scene_index);
+		--this->_suppress_tree_edits;
+
+		obs_frontend_source_list_free(&scene_list);
+
+		// Scenes renamed since the tree was stored, or stored without UUID, need a new checkpoint as well
+		this->_loaded_tree_complete = this->_skipped_scene_count == 0 && this->_outdated_scene_count == 0;
 	}
+
+	// Scenes that no longer exist were skipped, so publish what was actually loaded
+	this->PublishTree();
+}
+
+bool StvItemModel::IsLoadedTreeComplete(obs_frontend_source_list &scene_list) const
+{
+	if(!this->_loaded_tree_complete)
+		return false;
+
+	size_t managed_scene_count = 0;
+	for(size_t i = 0; i < scene_list.sources.num; i++)
+	{
+		if(this->IsManagedScene(scene_list.sources.array[i]))
+			++managed_scene_count;
+	}
+
+	return managed_scene_count == this->_scenes_in_tree.size();
 }
 
 void StvItemModel::CleanupSceneTree()
 {
+	this->_loaded_tree_complete = false;
+
+	this->ClearHighlight();
+	this->_scene_dependencies.Clear();
+
 	// Remove scene refs
 	for(auto &scene : this->_scenes_in_tree)
 	{
 		obs_weak_source_release(scene.first);
+		STV_ACCOUNT(WEAK_SOURCE_REFS, -1);
 	}
 
 	this->_scenes_in_tree.clear();
 
+	// Undo deltas refer to items of this tree only
+	this->_undo_stack.Clear();
+	this->_folders.clear();
+	this->_live_folders.clear();
+	this->_preview_folders.clear();
+
 	QStandardItem *root_item = this->invisibleRootItem();
+
 	root_item->removeRows(0, root_item->rowCount());
+
+	// Everything the tree held must be released now
+#ifdef STV_ACCOUNTING
+	StvStats::Get().CheckAccountsReleased("scene tree cleanup");
+#endif
+
+	this->PublishTree();
 }
 
 QStandardItem *StvItemModel::GetParentOrRoot(const QModelIndex &index)
@@ -375,8 +1136,65 @@ void StvItemModel::SetFolderIconVisibility(bool enable_visibility)
 
 void StvItemModel::UpdateSceneSize()
 {
-	this->_scene_size.cx = config_get_int(obs_frontend_get_profile_config(), "Video", "BaseCX");
-	this->_scene_size.cy = config_get_int(obs_frontend_get_profile_config(), "Video", "BaseCY");
+	this->_scene_canvases.SetSceneSize({(uint32_t)config_get_int(obs_frontend_get_profile_config(), "Video", "BaseCX"),
+	                                    (uint32_t)config_get_int(obs_frontend_get_profile_config(), "Video", "BaseCY")});
+}
+
+StvItemModel::SCENE_SIZE_T StvItemModel::GetSceneSize() const
+{
+	return this->_scene_canvases.GetSceneSize();
+}
+
+void StvItemModel::SetCanvas(SCENE_SIZE_T canvas)
+{
+	this->_scene_canvases.SetCanvas(canvas);
+}
+
+StvItemModel::SCENE_SIZE_T StvItemModel::GetCanvas() const
+{
+	return this->_scene_canvases.GetCanvas();
+}
+
+uint64_t StvItemModel::GetCanvasesVersion() const
+{
+	return this->_scene_canvases.GetVersion();
+}
+
+std::vector<StvItemModel::SCENE_SIZE_T> StvItemModel::GetCanvases() const
+{
+	return this->_scene_canvases.GetCanvases();
+}
+
+std::vector<QStandardItem*> StvItemModel::HighlightSceneDependencies(QStandardItem *scene_item, DEPENDENCY_DIRECTION direction)
+{
+	assert(scene_item->type() == SCENE);
+
+	this->_highlight_scene = scene_item->index();
+	this->_highlight_direction = direction;
+
+	return this->UpdateHighlight();
+}
+
+void StvItemModel::ClearHighlight()
+{
+	this->_highlight_scene = QPersistentModelIndex();
+	this->UpdateHighlight();
+}
+
+bool StvItemModel::HasHighlight() const
+{
+	return this->_highlight_scene.isValid();
+}
+
+void StvItemModel::UpdateActiveScenes()
+{
+	this->_active_scenes_update_queued = false;
+
+	OBSSourceAutoRelease program_scene = obs_frontend_get_current_scene();
+	OBSSourceAutoRelease preview_scene = obs_frontend_preview_program_mode_active() ? obs_frontend_get_current_preview_scene() : nullptr;
+
+	this->MarkAncestors(this->GetSceneItem(program_scene), FOLDER_LIVE, this->_live_folders);
+	this->MarkAncestors(this->GetSceneItem(preview_scene), FOLDER_PREVIEW, this->_preview_folders);
 }
 
 bool StvItemModel::IsManagedScene(obs_scene_t *scene) const
@@ -386,109 +1204,446 @@ bool StvItemModel::IsManagedScene(obs_scene_t *scene) const
 }
 
 bool StvItemModel::IsManagedScene(obs_source_t *scene_source) const
+{
+	return this->GetSceneCanvas(scene_source) == this->_scene_canvases.GetCanvas();
+}
+
+void StvItemModel::IndexSceneCanvases(obs_frontend_source_list &scene_list)
+{
+	std::vector<QString> scene_uuids;
+	scene_uuids.reserve(scene_list.sources.num);
+	for(size_t i = 0; i < scene_list.sources.num; i++)
+		scene_uuids.push_back(QString::fromUtf8(obs_source_get_uuid(scene_list.sources.array[i])));
+
+	this->_scene_canvases.Index(scene_uuids, [this, &scene_list](size_t scene) {
+		return this->ClassifyScene(scene_list.sources.array[scene]);
+	});
+}
+
+StvItemModel::SCENE_SIZE_T StvItemModel::ClassifyScene(obs_source_t *scene_source) const
 {
 	OBSDataAutoRelease settings = obs_source_get_settings(scene_source);
-	return	obs_data_get_bool(settings, "custom_size") == false /*&&
-			obs_data_get_bool(settings, "cx") == this->_scene_size.cx &&
-					obs_data_get_bool(settings, "cy") == this->_scene_size.cy*/;
+	return this->_scene_canvases.Classify(settings);
+}
+
+StvItemModel::SCENE_SIZE_T StvItemModel::GetSceneCanvas(obs_source_t *scene_source) const
+{
+	const SCENE_SIZE_T *canvas = this->_scene_canvases.Find(QString::fromUtf8(obs_source_get_uuid(scene_source)));
+	return canvas ? *canvas : this->ClassifyScene(scene_source);
+}
+
+void StvItemModel::UpdateSceneCanvas(const OBSWeakSource &weak_source)
+{
+	OBSSourceAutoRelease source = obs_weak_source_get_source(weak_source);
+	if(!source)
+		return;
+
+	OBSDataAutoRelease settings = obs_source_get_settings(source);
+	if(this->_scene_canvases.Update(QString::fromUtf8(obs_source_get_uuid(source)), settings))
+		emit this->SceneCanvasChanged();
+}
+
+void StvItemModel::obs_source_update_cb(void *private_data, calldata_t *data)
+{
+	obs_source_t *source = (obs_source_t*)calldata_ptr(data, "source");
+	if(!obs_scene_from_source(source))
+		return;
+
+	// Deferred updates are signaled from the graphics thread
+	StvItemModel *model = (StvItemModel*)private_data;
+	QMetaObject::invokeMethod(model, [model, weak_source = OBSGetWeakRef(source)]() {
+		model->UpdateSceneCanvas(weak_source);
+	}, Qt::QueuedConnection);
 }
 
-void StvItemModel::MoveSceneItem(obs_weak_source_t *source, int row, QStandardItem *parent_item)
+int StvItemModel::GetSortedRow(QStandardItem *folder, QStandardItem *item)
 {
-	if(const auto scene_it = this->_scenes_in_tree.find(source); scene_it != this->_scenes_in_tree.end())
+	// item may already be part of folder, e.g. after a rename. Skip its row during the search
+	const int row_count = folder->rowCount();
+	const bool in_folder = item->index().isValid() && this->GetParentOrRoot(item->index()) == folder;
+	const int skip_row = in_folder ? item->row() : row_count;
+
+	int begin = 0;
+	int end = in_folder ? row_count-1 : row_count;
+	while(begin < end)
 	{
-		assert(scene_it->second->type() == SCENE);
+		const int mid = (begin + end) / 2;
+		if(this->IsSortedBefore(item, folder->child(mid < skip_row ? mid : mid+1)))
+			end = mid;
+		else
+			begin = mid+1;
+	}
 
-		blog(LOG_INFO, "[%s] Moving %s", obs_module_name(), scene_it->second->text().toStdString().c_str());
+	return begin;
+}
 
-		StvSceneItem *pItem = new StvSceneItem(scene_it->second->text(), scene_it->first);
-		parent_item->insertRow(row, pItem);
+bool StvItemModel::IsSortedBefore(const QStandardItem *item, const QStandardItem *other) const
+{
+	// Folders are listed before scenes
+	if(item->type() != other->type())
+		return item->type() == FOLDER;
 
-		// Old item removed when returning true
+	return this->GetSortKey(item).compare(this->GetSortKey(other)) < 0;
+}
+
+const QCollatorSortKey &StvItemModel::GetSortKey(const QStandardItem *item) const
+{
+	assert(item->type() == FOLDER || item->type() == SCENE);
+	return item->type() == FOLDER ? static_cast<const StvFolderItem*>(item)->GetSortKey(this->_collator) :
+	                                static_cast<const StvSceneItem*>(item)->GetSortKey(this->_collator);
+}
 
-		scene_it->second = pItem;
+void StvItemModel::EmitTreeEdit(const StvTreeOp &op)
+{
+	if(this->_suppress_tree_edits == 0)
+	{
+		this->PublishTreeEdit(op);
+		emit this->TreeEdited(op);
 	}
+}
+
+void StvItemModel::EmitTreeEdits(const std::vector<StvTreeOp> &ops)
+{
+	if(ops.size() == 1)
+		return this->EmitTreeEdit(ops.front());
+
+	if(this->_suppress_tree_edits > 0)
+		return;
+
+	// A single snapshot is cheaper than copying the edited folder once per op
+	this->PublishTree();
+
+	for(const auto &op : ops)
+		emit this->TreeEdited(op);
+}
+
+void StvItemModel::RegisterFolder(StvFolderItem *folder)
+{
+	this->_folders.insert(folder->GetId(), folder);
+}
+
+void StvItemModel::UnregisterFolders(QStandardItem *item)
+{
+	if(item->type() != FOLDER)
+		return;
+
+	this->_folders.remove(static_cast<StvFolderItem*>(item)->GetId());
+	for(int i=0; i < item->rowCount(); ++i)
+		this->UnregisterFolders(item->child(i));
+}
+
+void StvItemModel::RecordUndo(StvUndoStack::DELTA delta)
+{
+	// Loaded trees and edits made by undo itself aren't recorded
+	if(this->_suppress_tree_edits > 0 || this->_applying_undo > 0)
+		return;
+
+	// Edits made in the same event loop iteration, e.g. moving multiple dropped items, are undone together
+	const bool new_step = !this->_undo_step_open;
+	if(new_step)
+	{
+		this->_undo_step_open = true;
+		QMetaObject::invokeMethod(this, [this]() {
+			this->_undo_step_open = false;
+		}, Qt::QueuedConnection);
+	}
+
+	this->_undo_stack.Push(std::move(delta), new_step);
+}
+
+StvUndoStack::ITEM_HANDLE StvItemModel::GetHandle(QStandardItem *item)
+{
+	StvUndoStack::ITEM_HANDLE handle;
+	if(!item || item == this->invisibleRootItem())
+		return handle;
+
+	assert(item->type() == FOLDER || item->type() == SCENE);
+	if(item->type() == FOLDER)
+		handle.FolderId = static_cast<StvFolderItem*>(item)->GetId();
 	else
-		blog(LOG_WARNING, "[%s] Couldn't find item to move in Scene Tree View", obs_module_name());
+		handle.Scene = item->data(QDATA_ROLE::OBS_SCENE).value<obs_weak_source_ptr>().ptr;
+
+	return handle;
 }
 
-void StvItemModel::MoveSceneFolder(QStandardItem *item, int row, QStandardItem *parent_item)
+QStandardItem *StvItemModel::ResolveHandle(const StvUndoStack::ITEM_HANDLE &handle)
 {
-	assert(item->type() == FOLDER);
-	blog(LOG_INFO, "[%s] Moving %s", obs_module_name(), item->text().toStdString().c_str());
+	if(handle.IsRoot())
+		return this->invisibleRootItem();
 
-	// Check that name is unique
-	QString new_name = this->CreateUniqueFolderName(item, parent_item);
+	if(handle.FolderId != 0)
+		return this->_folders.value(handle.FolderId, nullptr);
 
-	StvFolderItem *new_item = new StvFolderItem(new_name);
-	parent_item->insertRow(row, new_item);
+	OBSSourceAutoRelease source = OBSGetStrongRef(handle.Scene);
+	return this->GetSceneItem(source);
+}
+
+bool StvItemModel::ApplyUndoDelta(const StvUndoStack::DELTA &delta, bool revert)
+{
+	QStandardItem *item = this->ResolveHandle(delta.Item);
 
-	for(int sub_row = 0; sub_row < item->rowCount(); ++sub_row)
+	switch(delta.Type)
 	{
-		QStandardItem *sub_item = item->child(sub_row);
+		case StvUndoStack::DELTA::CREATE_FOLDER:
+		case StvUndoStack::DELTA::REMOVE_FOLDER:
+		{
+			// Reverting a creation removes the folder again, reverting a removal restores it
+			if((delta.Type == StvUndoStack::DELTA::CREATE_FOLDER) == revert)
+			{
+				if(!item || item->type() != FOLDER || item->rowCount() > 0)
+					return false;
 
-		assert(sub_item->type() == FOLDER || sub_item->type() == SCENE);
+				this->RemoveItem(item);
+				return true;
+			}
 
-		if(sub_item->type() == FOLDER)
-			this->MoveSceneFolder(sub_item, sub_row, new_item);
-		else
+			QStandardItem *parent = this->ResolveHandle(delta.Parent);
+			if(item || !parent || parent->type() == SCENE || !this->CheckFolderNameUniqueness(delta.Name, parent))
+				return false;
+
+			StvFolderItem *folder = this->AddFolder(delta.Name, parent, std::clamp(delta.Row, 0, parent->rowCount()));
+
+			// Other deltas refer to the folder by its previous id
+			this->_folders.remove(folder->GetId());
+			folder->SetId(delta.Item.FolderId);
+			this->RegisterFolder(folder);
+
+			this->SetFolderExpanded(folder->index(), delta.IsExpanded);
+			return true;
+		}
+
+		case StvUndoStack::DELTA::RENAME:
 		{
-			obs_weak_source_t *weak = sub_item->data(OBS_SCENE).value<obs_weak_source_ptr>().ptr;
-			this->MoveSceneItem(weak, sub_row, new_item);
+			const QString &name = revert ? delta.Name : delta.NewName;
+			if(!item || item->type() != FOLDER ||
+			        !this->CheckFolderNameUniqueness(name, this->GetParentOrRoot(item->index()), item))
+				return false;
+
+			this->RenameItem(item, name);
+			return true;
+		}
+
+		case StvUndoStack::DELTA::MOVE:
+		{
+			// Only the moved item is re-parented, its children stay attached
+			QStandardItem *parent = this->ResolveHandle(revert ? delta.Parent : delta.NewParent);
+			if(!item || !parent || parent->type() == SCENE)
+				return false;
+
+			// MoveItem() counts rows before the item is taken out
+			int row = std::clamp(revert ? delta.Row : delta.NewRow, 0, parent->rowCount());
+			if(this->GetParentOrRoot(item->index()) == parent && item->row() < row)
+				++row;
+
+			return this->MoveItem(item, row, parent);
 		}
+
+		case StvUndoStack::DELTA::EXPAND:
+			if(!item || item->type() != FOLDER)
+				return false;
+
+			this->SetFolderExpanded(item->index(), revert ? !delta.IsExpanded : delta.IsExpanded);
+			return true;
+
+		case StvUndoStack::DELTA::SORT:
+			if(!item || item->type() != FOLDER)
+				return false;
+
+			this->SetFolderSorted(item, revert ? !delta.IsSorted : delta.IsSorted);
+			return true;
 	}
+
+	return false;
+}
+
+void StvItemModel::PublishTree()
+{
+	this->_published_tree = this->CreateSnapshot();
+	StvTreePublisher::Get().Publish(this->_published_tree);
 }
 
-obs_data_array_t *StvItemModel::CreateFolderArray(QStandardItem &folder, QTreeView *view)
+void StvItemModel::PublishTreeEdit(const StvTreeOp &op)
 {
-	obs_data_array_t *folder_data = obs_data_array_create();
+	if(this->_republish_queued)
+		return;
 
-	for(int i=0; i < folder.rowCount(); ++i)
+	// Only nodes along the edited path are copied, all others are shared with the previous snapshot
+	StvTreeNodePtr tree = this->_published_tree ? StvTreeSnapshot::Apply(this->_published_tree, op) : nullptr;
+	if(tree)
 	{
-		QStandardItem *item = folder.child(i);
-		assert(item->type() == FOLDER || item->type() == SCENE);
+		this->_published_tree = std::move(tree);
+		StvTreePublisher::Get().Publish(this->_published_tree);
+		return;
+	}
+
+	// Changes made while tree edits were suppressed aren't published, so the op doesn't fit the published tree.
+	// Take a full snapshot once the current edit is done instead
+	blog(LOG_DEBUG, "[%s] Published tree doesn't match edit, republishing", obs_module_name());
+
+	this->_republish_queued = true;
+	QMetaObject::invokeMethod(this, [this]() {
+		this->_republish_queued = false;
+		this->PublishTree();
+	}, Qt::QueuedConnection);
+}
+
+void StvItemModel::ScheduleActiveScenesUpdate()
+{
+	if(this->_active_scenes_update_queued)
+		return;
+
+	this->_active_scenes_update_queued = true;
+	QMetaObject::invokeMethod(this, [this]() {
+		if(this->_active_scenes_update_queued)
+			this->UpdateActiveScenes();
+	}, Qt::QueuedConnection);
+}
+
+void StvItemModel::MarkAncestors(QStandardItem *scene_item, QDATA_ROLE role, std::vector<uint64_t> &marked_folders)
+{
+	std::vector<uint64_t> folders;
+	for(QStandardItem *folder = scene_item ? scene_item->parent() : nullptr; folder; folder = folder->parent())
+		folders.push_back(static_cast<StvFolderItem*>(folder)->GetId());
+
+	// Each chain is only as long as the tree is deep. Unchanged folders are skipped, so their rows aren't repainted.
+	// Removed folders are no longer registered
+	for(const uint64_t folder_id : marked_folders)
+	{
+		if(std::find(folders.begin(), folders.end(), folder_id) != folders.end())
+			continue;
+
+		if(StvFolderItem *folder = this->_folders.value(folder_id, nullptr))
+			folder->setData(QVariant(), role);
+	}
+
+	for(const uint64_t folder_id : folders)
+	{
+		if(std::find(marked_folders.begin(), marked_folders.end(), folder_id) == marked_folders.end())
+			this->_folders.value(folder_id)->setData(true, role);
+	}
+
+	marked_folders = std::move(folders);
+}
+
+void StvItemModel::OnSceneDependenciesChanged()
+{
+	// Signals may arrive from any thread. Coalesce them into a single update on the UI thread
+	if(this->_scene_dependencies_changed.exchange(true))
+		return;
+
+	QMetaObject::invokeMethod(this, [this]() {
+		this->_scene_dependencies_changed = false;
+		if(this->HasHighlight())
+			this->UpdateHighlight();
+	}, Qt::QueuedConnection);
+}
+
+std::vector<QStandardItem*> StvItemModel::UpdateHighlight()
+{
+	for(const auto &index : this->_highlighted_items)
+	{
+		if(index.isValid())
+			this->setData(index, QVariant(), Qt::BackgroundRole);
+	}
+
+	this->_highlighted_items.clear();
+
+	std::vector<QStandardItem*> highlighted_items;
+	QStandardItem *scene_item = this->itemFromIndex(this->_highlight_scene);
+	if(!scene_item)
+		return highlighted_items;
 
-		OBSDataAutoRelease item_data = obs_data_create();
-		if(item->type() == FOLDER)
+	QColor color = QApplication::palette().color(QPalette::Highlight);
+	color.setAlpha(HIGHLIGHT_ALPHA);
+	const QBrush highlight(color);
+
+	// Breadth first walk over the dependency index, starting at the queried scene
+	obs_weak_source_t *scene = scene_item->data(QDATA_ROLE::OBS_SCENE).value<obs_weak_source_ptr>().ptr;
+	std::unordered_set<obs_weak_source_t*> visited_scenes{scene};
+	std::deque<OBSWeakSource> pending_scenes{OBSWeakSource(scene)};
+	while(!pending_scenes.empty())
+	{
+		const std::vector<OBSWeakSource> next_scenes = this->_highlight_direction == PARENT_SCENES ?
+		            this->_scene_dependencies.GetParents(pending_scenes.front()) :
+		            this->_scene_dependencies.GetChildren(pending_scenes.front());
+
+		pending_scenes.pop_front();
+
+		for(const auto &next_scene : next_scenes)
 		{
-			OBSDataArrayAutoRelease sub_folder_data = this->CreateFolderArray(*item, view);
-			obs_data_set_array(item_data, SCENE_TREE_CONFIG_FOLDER_DATA.data(), sub_folder_data);
-			obs_data_set_bool(item_data, SCENE_TREE_CONFIG_FOLDER_EXPANDED.data(), view->isExpanded(item->index()));
-			obs_data_set_string(item_data, SCENE_TREE_CONFIG_ITEM_NAME_DATA.data(), item->text().toStdString().c_str());
+			if(!visited_scenes.insert(next_scene.Get()).second)
+				continue;
+
+			pending_scenes.push_back(next_scene);
+
+			if(const auto scene_it = this->_scenes_in_tree.find(next_scene.Get()); scene_it != this->_scenes_in_tree.end())
+			{
+				scene_it->second->setData(highlight, Qt::BackgroundRole);
+				this->_highlighted_items.emplace_back(scene_it->second->index());
+				highlighted_items.push_back(scene_it->second);
+			}
 		}
-		else
+	}
+
+	return highlighted_items;
+}
+
+StvTreeNodePtr StvItemModel::CreateSnapshotNode(QStandardItem &item)
+{
+	auto node = std::make_shared<StvTreeNode>();
+	node->Name = item.text();
+	node->IsFolder = item.type() != SCENE;
+
+	if(node->IsFolder)
+	{
+		node->IsExpanded = item.data(QDATA_ROLE::FOLDER_EXPANDED).toBool();
+		node->IsSorted = item.data(QDATA_ROLE::FOLDER_SORTED).toBool();
+
+		const int row_count = item.rowCount();
+		node->Children.reserve(row_count);
+		for(int i=0; i < row_count; ++i)
 		{
-			obs_weak_source_t *weak = item->data(QDATA_ROLE::OBS_SCENE).value<obs_weak_source_ptr>().ptr;
-			OBSSourceAutoRelease source = OBSGetStrongRef(weak);
-			obs_data_set_string(item_data, SCENE_TREE_CONFIG_ITEM_NAME_DATA.data(), obs_source_get_name(source));
-		}
+			QStandardItem *child = item.child(i);
+			assert(child->type() == FOLDER || child->type() == SCENE);
 
-		obs_data_array_push_back(folder_data, item_data);
+			node->Children.push_back(this->CreateSnapshotNode(*child));
+		}
 	}
+	else
+		node->Uuid = static_cast<StvSceneItem&>(item).GetUuid();
 
-	return folder_data;
+	return node;
 }
 
-void StvItemModel::LoadFolderArray(obs_data_array_t *folder_data, QStandardItem &folder, std::list<StvFolderItem*> &expandable_folders)
+QStandardItem *StvItemModel::GetItem(const std::vector<int> &path)
 {
-	const size_t item_count = obs_data_array_count(folder_data);
-	for(size_t i=0; i < item_count; ++i)
-	{
-		OBSDataAutoRelease item_data = obs_data_array_item(folder_data, i);
+	QStandardItem *item = this->invisibleRootItem();
+	for(const int row : path)
+		item = item->child(row);
 
-		const char *item_name = obs_data_get_string(item_data, SCENE_TREE_CONFIG_ITEM_NAME_DATA.data());
-		OBSDataArrayAutoRelease folder_data = obs_data_get_array(item_data, SCENE_TREE_CONFIG_FOLDER_DATA.data());
+	return item;
+}
 
-		// Check if this is folder or scene item (only folders have folder_data)
-		if(!folder_data)
+void StvItemModel::LoadFolderNode(const StvTreeNode &folder_node, QStandardItem &folder, const SCENE_INDEX &scene_index)
+{
+	for(const auto &item_node : folder_node.Children)
+	{
+		// Check if this is folder or scene item
+		if(!item_node->IsFolder)
 		{
-			// Add scene to folder, skip if scene doesn't exist anymore
-			OBSSceneAutoRelease scene = obs_get_scene_by_name(item_name);
-			if(!scene || !this->IsManagedScene(scene))
+			// Add scene to folder, skip if scene doesn't exist anymore. Matching by UUID finds renamed scenes and
+			// keeps a different scene of the same name from taking their place. Older trees only store names, and
+			// scenes recreated or imported from another collection get a new UUID, so fall back to the name
+			obs_source_t *source = !item_node->Uuid.isEmpty() ? scene_index.ByUuid.value(item_node->Uuid, nullptr) : nullptr;
+			if(!source)
+				source = scene_index.ByName.value(item_node->Name, nullptr);
+			if(!source || !this->IsManagedScene(source))
+			{
+				++this->_skipped_scene_count;
 				continue;
+			}
 
 			{
-				OBSSource source = obs_scene_get_source(scene);
 				OBSWeakSource weak = obs_source_get_weak_source(source);
 
 				// Skip if scene already in treeview
@@ -496,26 +1651,32 @@ void StvItemModel::LoadFolderArray(obs_data_array_t *folder_data, QStandardItem
 				if(this->_scenes_in_tree.find(weak) != this->_scenes_in_tree.end())
 				{
 					obs_weak_source_release(weak);
+					++this->_skipped_scene_count;
 					continue;
 				}
 
-				StvSceneItem *new_scene_item = new StvSceneItem(item_name, weak);
+				const QString scene_name = QString::fromUtf8(obs_source_get_name(source));
+				const QString scene_uuid = QString::fromUtf8(obs_source_get_uuid(source));
+				if(scene_uuid != item_node->Uuid || scene_name != item_node->Name)
+					++this->_outdated_scene_count;
+
+				StvSceneItem *new_scene_item = new StvSceneItem(scene_name, weak, obs_source_get_uuid(source));
 				folder.appendRow(new_scene_item);
 
 				this->_scenes_in_tree.emplace(weak, new_scene_item);
+				STV_ACCOUNT(WEAK_SOURCE_REFS, 1);
+				this->_scene_dependencies.AddScene(weak);
 			}
 		}
 		else
 		{
-			StvFolderItem *new_folder_item = new StvFolderItem(item_name);
-			this->LoadFolderArray(folder_data, *new_folder_item, expandable_folders);
+			StvFolderItem *new_folder_item = new StvFolderItem(item_node->Name);
+			new_folder_item->setData(item_node->IsExpanded, QDATA_ROLE::FOLDER_EXPANDED);
+			new_folder_item->setData(item_node->IsSorted, QDATA_ROLE::FOLDER_SORTED);
+			this->RegisterFolder(new_folder_item);
+			this->LoadFolderNode(*item_node, *new_folder_item, scene_index);
 
 			folder.appendRow(new_folder_item);
-
-			// Check if folder should be expanded.
-			// The folders are expanded after the tree is completely created to prevent new inserts from closing the folders again
-			if(obs_data_get_bool(item_data, SCENE_TREE_CONFIG_FOLDER_EXPANDED.data()))
-				expandable_folders.push_back(new_folder_item);
 		}
 	}
 }
@@ -5,11 +5,21 @@
 #include <obs-module.h>
 #include <obs-frontend-api.h>
 
+#include <QCollator>
+#include <QHash>
 #include <QStandardItemModel>
 #include <QTreeView>
 #include <QtWidgets/QMainWindow>
 
+#include <atomic>
+#include <optional>
 #include <string_view>
+#include <vector>
+
+#include "obs_scene_tree_view/stv_scene_canvases.h"
+#include "obs_scene_tree_view/stv_scene_dependencies.h"
+#include "obs_scene_tree_view/stv_tree_snapshot.h"
+#include "obs_scene_tree_view/stv_undo_stack.h"
 
 
 struct obs_weak_source_ptr
@@ -24,17 +34,49 @@ class StvFolderItem
 {
 	public:
 		StvFolderItem(const QString &text);
-		virtual ~StvFolderItem() override = default;
+		virtual ~StvFolderItem() override;
 		int type() const override;
+		void setData(const QVariant &value, int role = Qt::UserRole + 1) override;
+
+		/*!
+		 * \brief Id that stays the same while the folder is moved or renamed. Never 0
+		 */
+		uint64_t GetId() const;
+		void SetId(uint64_t id);
+
+		/*!
+		 * \brief Collation key of the folder name. Created on first use and reset when the name changes
+		 */
+		const QCollatorSortKey &GetSortKey(const QCollator &collator) const;
+
+		bool operator<(const QStandardItem &other) const override;
+
+	private:
+		uint64_t _id;
+		mutable std::optional<QCollatorSortKey> _sort_key;
 };
 
 class StvSceneItem
         : public QStandardItem
 {
 	public:
-		StvSceneItem(const QString &text, obs_weak_source_t *weak);
-		virtual ~StvSceneItem() override = default;
+		StvSceneItem(const QString &text, obs_weak_source_t *weak, const char *uuid);
+		virtual ~StvSceneItem() override;
 		int type() const override;
+		void setData(const QVariant &value, int role = Qt::UserRole + 1) override;
+
+		const QCollatorSortKey &GetSortKey(const QCollator &collator) const;
+
+		/*!
+		 * \brief UUID of the scene. Unlike the name it never changes, so snapshots can store it without a source lookup
+		 */
+		const QString &GetUuid() const;
+
+		bool operator<(const QStandardItem &other) const override;
+
+	private:
+		QString _uuid;
+		mutable std::optional<QCollatorSortKey> _sort_key;
 };
 
 
@@ -43,23 +85,25 @@ class StvItemModel
 {
 		Q_OBJECT
 
-		struct SCENE_SIZE_T
-		{
-			uint32_t cx, cy;
-		};
-
 		static constexpr std::string_view MIME_TYPE = "application/x-stvindexlist";
-		static constexpr std::string_view SCENE_TREE_CONFIG_FOLDER_DATA = "folder";
-		static constexpr std::string_view SCENE_TREE_CONFIG_FOLDER_EXPANDED = "is_expanded";
-		static constexpr std::string_view SCENE_TREE_CONFIG_ITEM_NAME_DATA = "name";
 
 	public:
+		using SCENE_SIZE_T = StvSceneCanvases::SCENE_SIZE_T;
+
+		// Canvas of scenes without custom size, or with the base resolution of the profile
+		static constexpr SCENE_SIZE_T BASE_CANVAS = StvSceneCanvases::BASE_CANVAS;
+
 		enum QDATA_ROLE
-		{	OBS_SCENE = Qt::UserRole	};
+		{	OBS_SCENE = Qt::UserRole, FOLDER_EXPANDED, FOLDER_SORTED, FOLDER_LIVE, FOLDER_PREVIEW	};
 
 		enum QITEM_TYPE
 		{	FOLDER = QStandardItem::UserType+1, SCENE	};
 
+		enum DEPENDENCY_DIRECTION
+		{	PARENT_SCENES, NESTED_SCENES	};
+
+		static constexpr int HIGHLIGHT_ALPHA = 96;
+
 		StvItemModel();
 		virtual ~StvItemModel() override;
 
@@ -73,10 +117,103 @@ class StvItemModel
 
 		void SetSelectedScene(QStandardItem *item, bool set_preview_scene, bool force_set_scene = false);
 		QStandardItem *GetCurrentSceneItem();
+		QStandardItem *GetSceneItem(obs_source_t *scene_source);
 		OBSSourceAutoRelease GetCurrentScene();
 
-		void SaveSceneTree(obs_data_t *root_folder_data, const char *scene_collection, QTreeView *view);
-		void LoadSceneTree(obs_data_t *root_folder_data, const char *scene_collection, QTreeView *view);
+		void SetFolderExpanded(const QModelIndex &index, bool expanded);
+
+		/*!
+		 * \brief Set FOLDER_LIVE on all folders containing the program scene and FOLDER_PREVIEW on those containing
+		 * the preview scene in studio mode, so views can show a scene inside a collapsed folder. Only folders
+		 * whose mark changed are updated, so only their rows are repainted
+		 */
+		void UpdateActiveScenes();
+
+		/*!
+		 * \brief Keep the items of folder in natural order, case-insensitive and by the current locale. Folders are
+		 * listed before scenes. Enabling it sorts the folder once. Afterwards added, moved and renamed items are
+		 * placed by binary search, so the folder is never sorted again. Disabling it keeps the current order
+		 */
+		void SetFolderSorted(QStandardItem *folder, bool sorted);
+		bool IsFolderSorted(QStandardItem *folder) const;
+
+		/*!
+		 * \brief Collator of sorted folders. Edits resolved outside the model must place items with it
+		 */
+		const QCollator &GetCollator() const;
+
+		/*!
+		 * \brief Order used by QStandardItem::sortChildren(). Only children of the folder SetFolderSorted() sorts
+		 * are compared, all other items keep their order
+		 */
+		bool LessThan(const QStandardItem &item, const QStandardItem &other) const;
+
+		StvFolderItem *AddFolder(const QString &name, QStandardItem *parent, int row);
+		void RenameItem(QStandardItem *item, const QString &name);
+		void RemoveItem(QStandardItem *item);
+
+		/*!
+		 * \brief Re-parent item. Its children are moved along with it
+		 * \param row Row in parent_item, counted before item is removed from its current position
+		 * \return Returns false if item can't be moved to the given position
+		 */
+		bool MoveItem(QStandardItem *item, int row, QStandardItem *parent_item);
+
+		/*!
+		 * \brief Get row path of item, starting at the root item
+		 */
+		std::vector<int> GetItemPath(QStandardItem *item);
+
+		/*!
+		 * \brief Get names of folder and all its ancestors, starting at the top level
+		 */
+		std::vector<QString> GetFolderPath(QStandardItem *folder);
+		QStandardItem *FindFolder(const std::vector<QString> &folder_path);
+
+		/*!
+		 * \brief Find a folder by StvFolderItem::GetId(), wherever it was moved to
+		 */
+		StvFolderItem *GetFolderItem(uint64_t folder_id) const;
+
+		/*!
+		 * \brief Create an immutable copy of the tree. Only copies names and expansion state,
+		 * so it is cheap enough to run on the UI thread before serializing elsewhere
+		 */
+		StvTreeNodePtr CreateSnapshot();
+
+		/*!
+		 * \brief Get the current tree. Shares the snapshot given to StvTreePublisher if it is up to date
+		 */
+		StvTreeNodePtr GetTree();
+
+		/*!
+		 * \brief Apply a batch of folder edits. ops must have been validated against GetTree(), e.g. by
+		 * StvTreeCommands::Resolve(), including the rows of sorted folders. Scenes are only moved, never added or
+		 * removed, and ops never contain StvTreeOp::REMOVE. Rows are inserted and moved with their regular signals,
+		 * so views keep the state of all other items. The batch is recorded as one undo step
+		 * \param tree Tree after all ops were applied
+		 */
+		void ApplyTreeOps(const std::vector<StvTreeOp> &ops, StvTreeNodePtr tree);
+
+		/*!
+		 * \brief Revert the last step of folder edits. All edits made during one event loop iteration form a step.
+		 * Edits of items that no longer exist are skipped
+		 * \return Returns false if there was nothing to undo
+		 */
+		bool Undo();
+		bool Redo();
+		bool CanUndo() const;
+		bool CanRedo() const;
+		void SetUndoMemoryLimit(size_t memory_limit);
+
+		void LoadSceneTree(const StvTreeNodePtr &tree);
+
+		/*!
+		 * \brief Check whether the loaded tree already contains exactly the managed scenes of scene_list.
+		 * Every loaded scene was looked up by UUID or name, so if none was skipped, comparing counts is enough.
+		 * Only valid directly after LoadSceneTree()
+		 */
+		bool IsLoadedTreeComplete(obs_frontend_source_list &scene_list) const;
 		void CleanupSceneTree();
 
 		QStandardItem *GetParentOrRoot(const QModelIndex &index);
@@ -87,10 +224,59 @@ class StvItemModel
 		void SetSceneIconVisibility(bool enable_visibility);
 		void SetFolderIconVisibility(bool enable_visibility);
 
+		/*!
+		 * \brief Highlight all scenes that contain scene_item, or all scenes nested in it, directly or indirectly.
+		 * The highlight is kept up to date until ClearHighlight() is called
+		 * \return Highlighted items
+		 */
+		std::vector<QStandardItem*> HighlightSceneDependencies(QStandardItem *scene_item, DEPENDENCY_DIRECTION direction);
+		void ClearHighlight();
+		bool HasHighlight() const;
+
 		void UpdateSceneSize();
+		SCENE_SIZE_T GetSceneSize() const;
+
+		/*!
+		 * \brief Scenes are partitioned by canvas, the tree only holds scenes of one canvas. Scenes without custom
+		 * size, or with the base resolution, belong to BASE_CANVAS, each other resolution forms its own canvas.
+		 * Takes effect with the next LoadSceneTree() or UpdateTree()
+		 */
+		void SetCanvas(SCENE_SIZE_T canvas);
+		SCENE_SIZE_T GetCanvas() const;
+
+		/*!
+		 * \brief Get all canvases with scenes sorted by resolution, BASE_CANVAS first. BASE_CANVAS and the current
+		 * canvas are included even without scenes. Uses the canvas index, so no scene settings are read
+		 */
+		std::vector<SCENE_SIZE_T> GetCanvases() const;
+
+		/*!
+		 * \brief Changes whenever the result of GetCanvases(), GetCanvas() or GetSceneSize() may have changed
+		 */
+		uint64_t GetCanvasesVersion() const;
+
+		/*!
+		 * \brief Whether scene belongs to the current canvas
+		 */
 		bool IsManagedScene(obs_scene_t *scene) const;
 		bool IsManagedScene(obs_source_t *scene_source) const;
 
+	signals:
+		/*!
+		 * \brief Emitted after each structural edit of the tree. Not emitted while a tree is loaded
+		 */
+		void TreeEdited(const StvTreeOp &op);
+
+		/*!
+		 * \brief Emitted by SetSelectedScene() right before the program scene is switched
+		 */
+		void SceneSwitching(obs_source_t *scene_source);
+
+		/*!
+		 * \brief Emitted when a scene was resized into or out of the current canvas. The tree has to be updated
+		 */
+		void SceneCanvasChanged();
+
 	private:
 		struct mime_item_data_t
 		{
@@ -107,13 +293,105 @@ class StvItemModel
 
 		source_map_t _scenes_in_tree;
 
-		SCENE_SIZE_T _scene_size;
+		StvSceneDependencies _scene_dependencies;
+		std::atomic_bool _scene_dependencies_changed = false;
+
+		QPersistentModelIndex _highlight_scene;
+		DEPENDENCY_DIRECTION _highlight_direction = PARENT_SCENES;
+		std::vector<QPersistentModelIndex> _highlighted_items;
 
-		void MoveSceneItem(obs_weak_source_t *source, int row, QStandardItem *parent_item);
-		void MoveSceneFolder(QStandardItem *item, int row, QStandardItem *parent_item);
+		// Canvas of each scene. Built from the scene list, kept up to date by source_update signals
+		StvSceneCanvases _scene_canvases;
+
+		int _suppress_tree_edits = 0;
+
+		// Set by LoadSceneTree() if no stored scene had to be skipped or updated
+		bool _loaded_tree_complete = false;
+		size_t _skipped_scene_count = 0;
+
+		// Stored scenes that were renamed since or have no stored UUID
+		size_t _outdated_scene_count = 0;
+
+		// Last snapshot given to StvTreePublisher. Updated with each edit
+		StvTreeNodePtr _published_tree;
+		bool _republish_queued = false;
+
+		// Folders by id, so undo deltas can find them wherever they were moved to
+		QHash<uint64_t, StvFolderItem*> _folders;
+
+		StvUndoStack _undo_stack;
+		int _applying_undo = 0;
+		bool _undo_step_open = false;
+
+		QCollator _collator;
+
+		// Folder whose children QStandardItem::sortChildren() orders. Its subfolders keep their order
+		const QStandardItem *_sorting_folder = nullptr;
+
+		// Ids of the folders marked by UpdateActiveScenes(), starting at the scene's parent. Ids stay valid while
+		// folders are moved or removed, persistent indexes of taken rows don't
+		std::vector<uint64_t> _live_folders;
+		std::vector<uint64_t> _preview_folders;
+		bool _active_scenes_update_queued = false;
+
+		/*!
+		 * \brief Row of item in the sorted folder, counted without item itself
+		 */
+		int GetSortedRow(QStandardItem *folder, QStandardItem *item);
+		bool IsSortedBefore(const QStandardItem *item, const QStandardItem *other) const;
+		const QCollatorSortKey &GetSortKey(const QStandardItem *item) const;
+
+		void EmitTreeEdit(const StvTreeOp &op);
+		void EmitTreeEdits(const std::vector<StvTreeOp> &ops);
+
+		void RegisterFolder(StvFolderItem *folder);
+		void UnregisterFolders(QStandardItem *item);
+
+		void RecordUndo(StvUndoStack::DELTA delta);
+		StvUndoStack::ITEM_HANDLE GetHandle(QStandardItem *item);
+		QStandardItem *ResolveHandle(const StvUndoStack::ITEM_HANDLE &handle);
+
+		/*!
+		 * \param revert Revert delta if true, re-apply it otherwise
+		 * \return Returns false if the delta no longer applies to the tree
+		 */
+		bool ApplyUndoDelta(const StvUndoStack::DELTA &delta, bool revert);
+
+		void PublishTree();
+		void PublishTreeEdit(const StvTreeOp &op);
+
+		/*!
+		 * \brief Update the marks of active scenes once control returns to the event loop. Structural edits
+		 * may have moved the scenes to other folders
+		 */
+		void ScheduleActiveScenesUpdate();
+		void MarkAncestors(QStandardItem *scene_item, QDATA_ROLE role, std::vector<uint64_t> &marked_folders);
+
+		void OnSceneDependenciesChanged();
+		std::vector<QStandardItem*> UpdateHighlight();
+
+		/*!
+		 * \brief Rebuild the canvas index for scene_list. Only scenes that weren't indexed yet are classified
+		 */
+		void IndexSceneCanvases(obs_frontend_source_list &scene_list);
+		SCENE_SIZE_T ClassifyScene(obs_source_t *scene_source) const;
+		SCENE_SIZE_T GetSceneCanvas(obs_source_t *scene_source) const;
+		void UpdateSceneCanvas(const OBSWeakSource &weak_source);
+
+		static void obs_source_update_cb(void *private_data, calldata_t *data);
+
+		StvTreeNodePtr CreateSnapshotNode(QStandardItem &item);
+		QStandardItem *GetItem(const std::vector<int> &path);
+		/*!
+		 * \brief Scenes of the scene list by UUID, and by name for trees stored without UUIDs
+		 */
+		struct SCENE_INDEX
+		{
+			QHash<QString, obs_source_t*> ByUuid;
+			QHash<QString, obs_source_t*> ByName;
+		};
 
-		obs_data_array_t *CreateFolderArray(QStandardItem &folder, QTreeView *view);
-		void LoadFolderArray(obs_data_array_t *folder_data, QStandardItem &folder, std::list<StvFolderItem *> &expandable_folders);
+		void LoadFolderNode(const StvTreeNode &folder_node, QStandardItem &folder, const SCENE_INDEX &scene_index);
 
 		void SetIcon(const QIcon &icon, QITEM_TYPE item_type, QStandardItem *item);
 };
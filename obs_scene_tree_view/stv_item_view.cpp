@@ -1,16 +1,166 @@
 #include "obs_scene_tree_view/stv_item_view.h"
 
+#include "obs_scene_tree_view/stv_stats.h"
+
+#include <QCursor>
+#include <QDrag>
+#include <QElapsedTimer>
 #include <QMouseEvent>
+#include <QScrollBar>
 #include <util/config-file.h>
 
+#include <algorithm>
+#include <utility>
+
 
 StvItemView::StvItemView(QWidget *parent)
-    : QTreeView(parent)
-{}
+    : QTreeView(parent),
+      _delegate(new StvItemDelegate(this))
+{
+	this->setItemDelegate(this->_delegate);
+}
 
-void StvItemView::SetItemModel(StvItemModel *model)
+void StvItemView::SetItemModel(StvItemModel *model, bool persist_expansion)
 {
 	this->_model = model;
+	this->_persist_expansion = persist_expansion;
+	this->setModel(model);
+
+	// Connect after setModel(), so the view has laid out inserted rows before they are expanded
+	QObject::connect(this->_model, &QAbstractItemModel::rowsInserted, this, [this](const QModelIndex &parent, int first, int last) {
+		for(int row = first; row <= last; ++row)
+			this->RestoreExpansion(this->_model->index(row, 0, parent));
+	});
+
+	// Other views keep their own expansion state by folder id, so moved folders stay expanded
+	if(!persist_expansion)
+	{
+		QObject::connect(this, &QTreeView::expanded, this, [this](const QModelIndex &index) {
+			if(const uint64_t folder_id = this->GetFolderId(index))
+				this->_expanded_folder_ids.insert(folder_id);
+
+			if(!this->_restoring_expansion)
+				emit this->ExpandedFoldersChanged();
+		});
+		QObject::connect(this, &QTreeView::collapsed, this, [this](const QModelIndex &index) {
+			this->_expanded_folder_ids.remove(this->GetFolderId(index));
+
+			if(!this->_restoring_expansion)
+				emit this->ExpandedFoldersChanged();
+		});
+		return;
+	}
+
+	// Batched edits only report a layout change
+	QObject::connect(this->_model, &QAbstractItemModel::layoutChanged, this, [this]() {
+		QStandardItem *root_item = this->_model->invisibleRootItem();
+		for(int row = 0; row < root_item->rowCount(); ++row)
+			this->RestoreExpansion(root_item->child(row)->index());
+	});
+
+	// Expansion state changed by the model itself, e.g. by undo
+	QObject::connect(this->_model, &QAbstractItemModel::dataChanged, this,
+	                 [this](const QModelIndex &top_left, const QModelIndex &, const QList<int> &roles) {
+		if(!roles.contains(StvItemModel::FOLDER_EXPANDED))
+			return;
+
+		const bool expanded = top_left.data(StvItemModel::FOLDER_EXPANDED).toBool();
+		if(this->isExpanded(top_left) != expanded)
+			this->setExpanded(top_left, expanded);
+	});
+
+	// Let the model track expansion state, so saving doesn't need to query the view
+	QObject::connect(this, &QTreeView::expanded, this->_model, [this](const QModelIndex &index) {
+		this->_model->SetFolderExpanded(index, true);
+	});
+	QObject::connect(this, &QTreeView::collapsed, this->_model, [this](const QModelIndex &index) {
+		this->_model->SetFolderExpanded(index, false);
+	});
+}
+
+QSet<uint64_t> StvItemView::GetExpandedFolders() const
+{
+	return this->_expanded_folder_ids;
+}
+
+void StvItemView::SetExpandedFolders(const QSet<uint64_t> &folder_ids)
+{
+	assert(!this->_persist_expansion);
+	this->_expanded_folder_ids = folder_ids;
+
+	QStandardItem *root_item = this->_model->invisibleRootItem();
+	for(int row = 0; row < root_item->rowCount(); ++row)
+		this->RestoreExpansion(root_item->child(row)->index());
+}
+
+void StvItemView::SetCompactMode(bool compact)
+{
+	this->_delegate->SetCompact(compact);
+	this->setUniformRowHeights(compact);
+
+	// Row heights were computed by the previous delegate mode
+	this->doItemsLayout();
+	this->viewport()->update();
+}
+
+bool StvItemView::IsCompactMode() const
+{
+	return this->_delegate->IsCompact();
+}
+
+void StvItemView::startDrag(Qt::DropActions supported_actions)
+{
+	QModelIndexList indexes = this->selectedIndexes();
+	indexes.erase(std::remove_if(indexes.begin(), indexes.end(), [this](const QModelIndex &index) {
+		              return !(this->_model->flags(index) & Qt::ItemIsDragEnabled);
+	              }),
+	              indexes.end());
+	if(indexes.isEmpty())
+		return;
+
+	QMimeData *data = this->_model->mimeData(indexes);
+	if(!data)
+		return;
+
+	const QRect item_rect = this->visualRect(indexes.front());
+
+	QDrag *drag = new QDrag(this);
+	drag->setMimeData(data);
+	drag->setPixmap(this->viewport()->grab(item_rect));
+	drag->setHotSpot(this->viewport()->mapFromGlobal(QCursor::pos()) - item_rect.topLeft());
+
+	const Qt::DropAction default_action = (supported_actions & this->defaultDropAction()) ? this->defaultDropAction() : Qt::IgnoreAction;
+	drag->exec(supported_actions, default_action);
+}
+
+void StvItemView::paintEvent(QPaintEvent *event)
+{
+	if(this->_scroll_time_ns < 0)
+		return this->QTreeView::paintEvent(event);
+
+	QElapsedTimer timer;
+	timer.start();
+
+	this->QTreeView::paintEvent(event);
+
+	// Scroll position is counted in rows unless the view scrolls per pixel
+	const QScrollBar *scroll_bar = this->verticalScrollBar();
+	int row_count = scroll_bar->maximum() + scroll_bar->pageStep();
+	if(this->verticalScrollMode() == QAbstractItemView::ScrollPerPixel)
+		row_count /= std::max(this->sizeHintForRow(0), 1);
+
+	StvStats::Get().RecordScrollFrame(this->_scroll_time_ns + timer.nsecsElapsed(), row_count);
+	this->_scroll_time_ns = -1;
+}
+
+void StvItemView::scrollContentsBy(int dx, int dy)
+{
+	QElapsedTimer timer;
+	timer.start();
+
+	this->QTreeView::scrollContentsBy(dx, dy);
+
+	this->_scroll_time_ns = std::max<int64_t>(this->_scroll_time_ns, 0) + timer.nsecsElapsed();
 }
 
 void StvItemView::selectionChanged(const QItemSelection &selected, const QItemSelection &deselected)
@@ -53,3 +203,27 @@ void StvItemView::mouseDoubleClickEvent(QMouseEvent *event)
 	// If TransitionOnDoubleClick is disabled or a folder is selected, perform a normal edit on double click
 	return QTreeView::mouseDoubleClickEvent(event);
 }
+
+uint64_t StvItemView::GetFolderId(const QModelIndex &index) const
+{
+	QStandardItem *item = this->_model->itemFromIndex(index);
+	return item && item->type() == StvItemModel::FOLDER ? static_cast<StvFolderItem*>(item)->GetId() : 0;
+}
+
+void StvItemView::RestoreExpansion(const QModelIndex &index)
+{
+	QStandardItem *item = this->_model->itemFromIndex(index);
+	if(!item || item->type() != StvItemModel::FOLDER)
+		return;
+
+	const bool expanded = this->_persist_expansion ? item->data(StvItemModel::FOLDER_EXPANDED).toBool()
+	                                               : this->_expanded_folder_ids.contains(static_cast<StvFolderItem*>(item)->GetId());
+	const bool was_restoring = std::exchange(this->_restoring_expansion, true);
+	if(this->isExpanded(index) != expanded)
+		this->setExpanded(index, expanded);
+
+	for(int i=0; i < item->rowCount(); ++i)
+		this->RestoreExpansion(item->child(i)->index());
+
+	this->_restoring_expansion = was_restoring;
+}
@@ -1,8 +1,10 @@
 #ifndef STV_ITEM_VIEW_H
 #define STV_ITEM_VIEW_H
 
+#include <QSet>
 #include <QtWidgets/QTreeView>
 
+#include "obs_scene_tree_view/stv_item_delegate.h"
 #include "obs_scene_tree_view/stv_item_model.h"
 
 class StvItemView
@@ -14,7 +16,43 @@ class StvItemView
 		StvItemView(QWidget *parent = nullptr);
 		~StvItemView() override = default;
 
-		void SetItemModel(StvItemModel *model);
+		/*!
+		 * \brief Set model. Folders are expanded according to the view's expansion state when inserted
+		 * \param persist_expansion Store expansion changes in the model. Otherwise the view keeps its own expansion
+		 * state and ignores the model's
+		 */
+		void SetItemModel(StvItemModel *model, bool persist_expansion = true);
+
+		/*!
+		 * \brief Ids of the expanded folders of a view that doesn't persist its expansion state in the model.
+		 * Folder ids change whenever a tree is loaded, so the owner sets them again afterwards
+		 */
+		QSet<uint64_t> GetExpandedFolders() const;
+		void SetExpandedFolders(const QSet<uint64_t> &folder_ids);
+
+		/*!
+		 * \brief Compact mode uses uniform row heights and paints rows with the lightweight delegate path.
+		 * Meant for very large trees
+		 */
+		void SetCompactMode(bool compact);
+		bool IsCompactMode() const;
+
+	signals:
+		/*!
+		 * \brief Emitted when a folder was expanded or collapsed in a view that doesn't persist its expansion state.
+		 * Not emitted while the view restores its expansion state
+		 */
+		void ExpandedFoldersChanged();
+
+	protected:
+		/*!
+		 * \brief Like QAbstractItemView::startDrag(), but never removes the source rows. The model re-parents
+		 * dropped items itself in dropMimeData()
+		 */
+		void startDrag(Qt::DropActions supported_actions) override;
+
+		void paintEvent(QPaintEvent *event) override;
+		void scrollContentsBy(int dx, int dy) override;
 
 	protected slots:
 		void selectionChanged(const QItemSelection &selected, const QItemSelection &deselected) override;
@@ -26,6 +64,19 @@ class StvItemView
 
 	private:
 		StvItemModel *_model = nullptr;
+		StvItemDelegate *_delegate = nullptr;
+
+		bool _persist_expansion = true;
+
+		// Expanded folders of views that don't persist their expansion state in the model
+		QSet<uint64_t> _expanded_folder_ids;
+		bool _restoring_expansion = false;
+
+		// Time spent scrolling since the last paint. Negative if the view wasn't scrolled
+		int64_t _scroll_time_ns = -1;
+
+		uint64_t GetFolderId(const QModelIndex &index) const;
+		void RestoreExpansion(const QModelIndex &index);
 };
 
 #endif //STV_ITEM_VIEW_H
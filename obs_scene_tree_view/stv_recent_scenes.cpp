@@ -0,0 +1,173 @@
+#include "obs_scene_tree_view/stv_recent_scenes.h"
+
+#include <obs.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+
+bool StvRecentScenes::Activate(const std::string &scene_name, int64_t now)
+{
+	if(!this->_entries.empty() && this->_entries.front().Name == scene_name)
+		return false;
+
+	if(const auto entry_it = this->_entry_index.find(scene_name); entry_it != this->_entry_index.end())
+	{
+		ENTRY &entry = *entry_it->second;
+		entry.Score = StvRecentScenes::DecayedScore(entry, now) + 1.0;
+		entry.LastUsed = now;
+
+		this->_entries.splice(this->_entries.begin(), this->_entries, entry_it->second);
+		return true;
+	}
+
+	if(this->_entries.size() >= CAPACITY)
+	{
+		this->_entry_index.erase(this->_entries.back().Name);
+		this->_entries.pop_back();
+	}
+
+	this->_entries.push_front(ENTRY{scene_name, 1.0, now});
+	this->_entry_index.emplace(scene_name, this->_entries.begin());
+
+	return true;
+}
+
+void StvRecentScenes::Rename(const std::string &old_scene_name, const std::string &new_scene_name)
+{
+	auto node = this->_entry_index.extract(old_scene_name);
+	if(node.empty())
+		return;
+
+	// Name of a scene that was removed earlier. Keep the newer entry
+	if(this->_entry_index.count(new_scene_name) > 0)
+	{
+		this->_entries.erase(node.mapped());
+		return;
+	}
+
+	node.key() = new_scene_name;
+	node.mapped()->Name = new_scene_name;
+	this->_entry_index.insert(std::move(node));
+}
+
+void StvRecentScenes::Clear()
+{
+	this->_entries.clear();
+	this->_entry_index.clear();
+}
+
+std::vector<std::string> StvRecentScenes::GetRecent(size_t count) const
+{
+	std::vector<std::string> scene_names;
+	for(auto entry_it = this->_entries.begin(); entry_it != this->_entries.end() && scene_names.size() < count; ++entry_it)
+		scene_names.push_back(entry_it->Name);
+
+	return scene_names;
+}
+
+std::vector<std::string> StvRecentScenes::GetMostUsed(size_t count, int64_t now, size_t skip_recent) const
+{
+	std::vector<std::pair<double, const ENTRY*>> candidates;
+	candidates.reserve(this->_entries.size());
+
+	size_t i = 0;
+	for(const auto &entry : this->_entries)
+	{
+		if(i++ >= skip_recent)
+			candidates.emplace_back(StvRecentScenes::DecayedScore(entry, now), &entry);
+	}
+
+	count = std::min(count, candidates.size());
+	std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(),
+	                  [](const auto &x, const auto &y) { return x.first > y.first; });
+
+	std::vector<std::string> scene_names;
+	scene_names.reserve(count);
+	for(size_t j = 0; j < count; ++j)
+		scene_names.push_back(candidates[j].second->Name);
+
+	return scene_names;
+}
+
+void StvRecentScenes::Save(obs_data_t *save_data) const
+{
+	OBSDataArrayAutoRelease entries_data = obs_data_array_create();
+	for(const auto &entry : this->_entries)
+	{
+		OBSDataAutoRelease entry_data = obs_data_create();
+		obs_data_set_string(entry_data, RECENT_SCENE_NAME_DATA.data(), entry.Name.c_str());
+		obs_data_set_double(entry_data, RECENT_SCENE_SCORE_DATA.data(), entry.Score);
+		obs_data_set_int(entry_data, RECENT_SCENE_LAST_USED_DATA.data(), entry.LastUsed);
+
+		obs_data_array_push_back(entries_data, entry_data);
+	}
+
+	obs_data_set_array(save_data, RECENT_SCENES_DATA.data(), entries_data);
+}
+
+void StvRecentScenes::Load(obs_data_t *save_data)
+{
+	this->Clear();
+
+	OBSDataArrayAutoRelease entries_data = obs_data_get_array(save_data, RECENT_SCENES_DATA.data());
+	const size_t entry_count = std::min(obs_data_array_count(entries_data), CAPACITY);
+	for(size_t i=0; i < entry_count; ++i)
+	{
+		OBSDataAutoRelease entry_data = obs_data_array_item(entries_data, i);
+
+		ENTRY entry;
+		entry.Name = obs_data_get_string(entry_data, RECENT_SCENE_NAME_DATA.data());
+		entry.Score = obs_data_get_double(entry_data, RECENT_SCENE_SCORE_DATA.data());
+		entry.LastUsed = obs_data_get_int(entry_data, RECENT_SCENE_LAST_USED_DATA.data());
+
+		if(entry.Name.empty() || this->_entry_index.count(entry.Name) > 0)
+			continue;
+
+		// Saved in most recently used order
+		this->_entries.push_back(std::move(entry));
+		this->_entry_index.emplace(this->_entries.back().Name, std::prev(this->_entries.end()));
+	}
+}
+
+double StvRecentScenes::DecayedScore(const ENTRY &entry, int64_t now)
+{
+	const double elapsed = (double)std::max<int64_t>(now - entry.LastUsed, 0);
+	return entry.Score * std::exp2(-elapsed / FREQUENCY_HALF_LIFE_S);
+}
+
+
+StvRecentModel::StvRecentModel(QObject *parent)
+    : QAbstractListModel(parent)
+{}
+
+void StvRecentModel::SetScenes(std::vector<QString> scene_names)
+{
+	if(scene_names == this->_scene_names)
+		return;
+
+	this->beginResetModel();
+	this->_scene_names = std::move(scene_names);
+	this->endResetModel();
+}
+
+const QString &StvRecentModel::GetSceneName(int row) const
+{
+	return this->_scene_names[row];
+}
+
+int StvRecentModel::rowCount(const QModelIndex &parent) const
+{
+	return parent.isValid() ? 0 : (int)this->_scene_names.size();
+}
+
+QVariant StvRecentModel::data(const QModelIndex &index, int role) const
+{
+	if(!index.isValid() || index.row() >= (int)this->_scene_names.size())
+		return QVariant();
+
+	if(role == Qt::DisplayRole || role == Qt::ToolTipRole)
+		return this->_scene_names[index.row()];
+
+	return QVariant();
+}
@@ -0,0 +1,98 @@
+#ifndef STV_RECENT_SCENES_H
+#define STV_RECENT_SCENES_H
+
+#include <obs-data.h>
+
+#include <QAbstractListModel>
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+/*!
+ * \brief Tracks scene activations of a scene collection. Entries are kept in least recently used order,
+ * each with an exponentially decayed activation count. Activating, renaming and evicting an entry is O(1)
+ */
+class StvRecentScenes
+{
+	public:
+		static constexpr size_t CAPACITY = 64;
+
+		// An activation counts half as much after this time
+		static constexpr double FREQUENCY_HALF_LIFE_S = 60*60;
+
+		static constexpr std::string_view RECENT_SCENES_DATA = "scene_tree_view_recent_scenes";
+		static constexpr std::string_view RECENT_SCENE_NAME_DATA = "name";
+		static constexpr std::string_view RECENT_SCENE_SCORE_DATA = "score";
+		static constexpr std::string_view RECENT_SCENE_LAST_USED_DATA = "last_used";
+
+		/*!
+		 * \brief Record an activation of scene_name at time now (in seconds)
+		 * \return Returns false if scene_name already was the most recently activated scene. Its count isn't changed then,
+		 * so a scene that is activated in preview and program isn't counted twice
+		 */
+		bool Activate(const std::string &scene_name, int64_t now);
+
+		void Rename(const std::string &old_scene_name, const std::string &new_scene_name);
+		void Clear();
+
+		/*!
+		 * \brief Get up to count scene names, most recently activated first
+		 */
+		std::vector<std::string> GetRecent(size_t count) const;
+
+		/*!
+		 * \brief Get up to count scene names with the highest decayed activation count at time now,
+		 * skipping the first skip_recent most recently activated scenes
+		 */
+		std::vector<std::string> GetMostUsed(size_t count, int64_t now, size_t skip_recent = 0) const;
+
+		void Save(obs_data_t *save_data) const;
+		void Load(obs_data_t *save_data);
+
+	private:
+		struct ENTRY
+		{
+			std::string Name;
+			double Score;
+			int64_t LastUsed;
+		};
+
+		using entry_list_t = std::list<ENTRY>;
+
+		// Most recently activated first
+		entry_list_t _entries;
+		std::unordered_map<std::string, entry_list_t::iterator> _entry_index;
+
+		static double DecayedScore(const ENTRY &entry, int64_t now);
+};
+
+
+/*!
+ * \brief Scene names shown in the recent scenes folder. Rows only refer to scenes by name,
+ * the scene items themselves stay in StvItemModel
+ */
+class StvRecentModel
+        : public QAbstractListModel
+{
+		Q_OBJECT
+
+	public:
+		StvRecentModel(QObject *parent = nullptr);
+		~StvRecentModel() override = default;
+
+		void SetScenes(std::vector<QString> scene_names);
+		const QString &GetSceneName(int row) const;
+
+		int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+		QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+	private:
+		std::vector<QString> _scene_names;
+};
+
+#endif // STV_RECENT_SCENES_H
@@ -0,0 +1,108 @@
+#include "obs_scene_tree_view/stv_scene_canvases.h"
+
+#include <algorithm>
+
+
+void StvSceneCanvases::SetSceneSize(SCENE_SIZE_T scene_size)
+{
+	if(scene_size != this->_scene_size)
+	{
+		this->_scene_canvases.clear();
+		++this->_version;
+	}
+
+	this->_scene_size = scene_size;
+}
+
+StvSceneCanvases::SCENE_SIZE_T StvSceneCanvases::GetSceneSize() const
+{
+	return this->_scene_size;
+}
+
+void StvSceneCanvases::SetCanvas(SCENE_SIZE_T canvas)
+{
+	if(canvas != this->_canvas)
+		++this->_version;
+
+	this->_canvas = canvas;
+}
+
+StvSceneCanvases::SCENE_SIZE_T StvSceneCanvases::GetCanvas() const
+{
+	return this->_canvas;
+}
+
+std::vector<StvSceneCanvases::SCENE_SIZE_T> StvSceneCanvases::GetCanvases() const
+{
+	// Collections rarely use more than a few canvases
+	std::vector<SCENE_SIZE_T> canvases;
+	for(const SCENE_SIZE_T &canvas : this->_scene_canvases)
+	{
+		if(std::find(canvases.begin(), canvases.end(), canvas) == canvases.end())
+			canvases.push_back(canvas);
+	}
+
+	for(const SCENE_SIZE_T &canvas : {this->_canvas, BASE_CANVAS})
+	{
+		if(std::find(canvases.begin(), canvases.end(), canvas) == canvases.end())
+			canvases.push_back(canvas);
+	}
+
+	// BASE_CANVAS is 0x0 and sorted first
+	std::sort(canvases.begin(), canvases.end(), [](const SCENE_SIZE_T &x, const SCENE_SIZE_T &y) {
+		return x.cx != y.cx ? x.cx < y.cx : x.cy < y.cy;
+	});
+
+	return canvases;
+}
+
+uint64_t StvSceneCanvases::GetVersion() const
+{
+	return this->_version;
+}
+
+StvSceneCanvases::SCENE_SIZE_T StvSceneCanvases::Classify(obs_data_t *scene_settings) const
+{
+	if(!obs_data_get_bool(scene_settings, "custom_size"))
+		return BASE_CANVAS;
+
+	const SCENE_SIZE_T scene_size = {(uint32_t)obs_data_get_int(scene_settings, "cx"), (uint32_t)obs_data_get_int(scene_settings, "cy")};
+	return scene_size == this->_scene_size ? BASE_CANVAS : scene_size;
+}
+
+void StvSceneCanvases::Index(const std::vector<QString> &scene_uuids, const classify_fn_t &classify)
+{
+	QHash<QString, SCENE_SIZE_T> scene_canvases;
+	scene_canvases.reserve((qsizetype)scene_uuids.size());
+	for(size_t i = 0; i < scene_uuids.size(); i++)
+	{
+		const auto canvas_it = this->_scene_canvases.constFind(scene_uuids[i]);
+		scene_canvases.insert(scene_uuids[i], canvas_it != this->_scene_canvases.cend() ? *canvas_it : classify(i));
+	}
+
+	this->_scene_canvases = std::move(scene_canvases);
+	++this->_version;
+}
+
+const StvSceneCanvases::SCENE_SIZE_T *StvSceneCanvases::Find(const QString &scene_uuid) const
+{
+	const auto canvas_it = this->_scene_canvases.constFind(scene_uuid);
+	return canvas_it != this->_scene_canvases.cend() ? &*canvas_it : nullptr;
+}
+
+bool StvSceneCanvases::Update(const QString &scene_uuid, obs_data_t *scene_settings)
+{
+	const auto canvas_it = this->_scene_canvases.find(scene_uuid);
+	if(canvas_it == this->_scene_canvases.end())
+		return false;
+
+	const SCENE_SIZE_T canvas = this->Classify(scene_settings);
+	if(*canvas_it == canvas)
+		return false;
+
+	const bool was_current = *canvas_it == this->_canvas;
+	*canvas_it = canvas;
+	++this->_version;
+
+	return was_current || canvas == this->_canvas;
+}
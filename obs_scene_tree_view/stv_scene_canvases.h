@@ -0,0 +1,89 @@
+#ifndef STV_SCENE_CANVASES_H
+#define STV_SCENE_CANVASES_H
+
+#include <obs-data.h>
+
+#include <QHash>
+#include <QString>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+
+/*!
+ * \brief Partitions scenes by canvas. Scenes without custom size, or with the base resolution, belong to BASE_CANVAS,
+ * each other resolution forms its own canvas. The canvas of each scene is indexed by UUID, so listing canvases and
+ * checking scenes doesn't read scene settings
+ */
+class StvSceneCanvases
+{
+	public:
+		struct SCENE_SIZE_T
+		{
+			uint32_t cx = 0, cy = 0;
+
+			bool operator==(const SCENE_SIZE_T &other) const
+			{	return this->cx == other.cx && this->cy == other.cy;	}
+		};
+
+		// Canvas of scenes without custom size, or with the base resolution of the profile
+		static constexpr SCENE_SIZE_T BASE_CANVAS = {0, 0};
+
+		using classify_fn_t = std::function<SCENE_SIZE_T(size_t scene)>;
+
+		/*!
+		 * \brief Set the base resolution of the profile. The index is dropped if it changed, as custom size scenes
+		 * may have moved to or from the base canvas
+		 */
+		void SetSceneSize(SCENE_SIZE_T scene_size);
+		SCENE_SIZE_T GetSceneSize() const;
+
+		void SetCanvas(SCENE_SIZE_T canvas);
+		SCENE_SIZE_T GetCanvas() const;
+
+		/*!
+		 * \brief Get all indexed canvases sorted by resolution, BASE_CANVAS first. BASE_CANVAS and the current canvas
+		 * are included even without scenes
+		 */
+		std::vector<SCENE_SIZE_T> GetCanvases() const;
+
+		/*!
+		 * \brief Changes whenever the result of GetCanvases(), GetCanvas() or GetSceneSize() may have changed
+		 */
+		uint64_t GetVersion() const;
+
+		/*!
+		 * \brief Get the canvas of a scene with the given settings
+		 */
+		SCENE_SIZE_T Classify(obs_data_t *scene_settings) const;
+
+		/*!
+		 * \brief Rebuild the index for the scenes with the given UUIDs. Removed scenes drop out, the others keep
+		 * their indexed canvas. classify(i) is only called for scenes that weren't indexed yet, with i the position
+		 * of their UUID
+		 */
+		void Index(const std::vector<QString> &scene_uuids, const classify_fn_t &classify);
+
+		/*!
+		 * \return Canvas of the scene with scene_uuid, or nullptr if it isn't indexed
+		 */
+		const SCENE_SIZE_T *Find(const QString &scene_uuid) const;
+
+		/*!
+		 * \brief Reclassify an indexed scene after its settings changed. Scenes that aren't indexed are skipped,
+		 * they are classified with the next Index()
+		 * \return Returns true if the scene moved into or out of the current canvas
+		 */
+		bool Update(const QString &scene_uuid, obs_data_t *scene_settings);
+
+	private:
+		SCENE_SIZE_T _scene_size;
+		SCENE_SIZE_T _canvas = BASE_CANVAS;
+
+		// Canvas of each scene by UUID
+		QHash<QString, SCENE_SIZE_T> _scene_canvases;
+		uint64_t _version = 0;
+};
+
+#endif // STV_SCENE_CANVASES_H
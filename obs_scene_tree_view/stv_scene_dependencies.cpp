@@ -0,0 +1,239 @@
+#include "obs_scene_tree_view/stv_scene_dependencies.h"
+
+#include "obs_scene_tree_view/stv_stats.h"
+
+
+namespace
+{
+	// Weak reference of the scene source of item, or nullptr if item isn't a scene
+	obs_weak_source_t *get_nested_scene(obs_sceneitem_t *item)
+	{
+		obs_source_t *source = obs_sceneitem_get_source(item);
+		if(!source || !obs_scene_from_source(source))
+			return nullptr;
+
+		return obs_source_get_weak_source(source);
+	}
+}
+
+
+StvSceneDependencies::StvSceneDependencies(changed_cb_t changed_cb)
+    : _changed_cb(std::move(changed_cb))
+{}
+
+StvSceneDependencies::~StvSceneDependencies()
+{
+	this->Clear();
+}
+
+void StvSceneDependencies::AddScene(obs_weak_source_t *scene)
+{
+	{
+		std::lock_guard lock(this->_lock);
+		if(!this->_children.try_emplace(scene).second)
+			return;
+
+		obs_weak_source_addref(scene);
+		STV_ACCOUNT(WEAK_SOURCE_REFS, 1);
+	}
+
+	// Connect first, so no item added in between is missed
+	this->ConnectSignals(scene, true);
+
+	OBSSourceAutoRelease source = obs_weak_source_get_source(scene);
+	obs_scene_t *obs_scene = obs_scene_from_source(source);
+	if(!obs_scene)
+		return;
+
+	std::vector<obs_weak_source_t*> nested_scenes;
+	obs_scene_enum_items(obs_scene, [](obs_scene_t*, obs_sceneitem_t *item, void *param) {
+		if(obs_weak_source_t *nested_scene = get_nested_scene(item))
+			static_cast<std::vector<obs_weak_source_t*>*>(param)->push_back(nested_scene);
+
+		return true;
+	}, &nested_scenes);
+
+	{
+		std::lock_guard lock(this->_lock);
+		for(obs_weak_source_t *nested_scene : nested_scenes)
+			this->AddEdge(scene, nested_scene);
+	}
+
+	for(obs_weak_source_t *nested_scene : nested_scenes)
+		obs_weak_source_release(nested_scene);
+
+	if(!nested_scenes.empty())
+		this->_changed_cb();
+}
+
+void StvSceneDependencies::RemoveScene(obs_weak_source_t *scene)
+{
+	this->ConnectSignals(scene, false);
+
+	{
+		std::lock_guard lock(this->_lock);
+
+		const auto children_it = this->_children.find(scene);
+		if(children_it == this->_children.end())
+			return;
+
+		const edge_map_t children = std::move(children_it->second);
+		this->_children.erase(children_it);
+
+		for(const auto &child : children)
+		{
+			const auto parents_it = this->_parents.find(child.first);
+			parents_it->second.erase(scene);
+			if(parents_it->second.empty())
+			{
+				this->_parents.erase(parents_it);
+				obs_weak_source_release(child.first);
+				STV_ACCOUNT(WEAK_SOURCE_REFS, -1);
+			}
+		}
+	}
+
+	this->_changed_cb();
+	obs_weak_source_release(scene);
+	STV_ACCOUNT(WEAK_SOURCE_REFS, -1);
+}
+
+void StvSceneDependencies::Clear()
+{
+	std::vector<obs_weak_source_t*> scenes;
+	{
+		std::lock_guard lock(this->_lock);
+		for(const auto &scene : this->_children)
+			scenes.push_back(scene.first);
+	}
+
+	for(obs_weak_source_t *scene : scenes)
+		this->RemoveScene(scene);
+}
+
+std::vector<OBSWeakSource> StvSceneDependencies::GetParents(obs_weak_source_t *scene) const
+{
+	std::lock_guard lock(this->_lock);
+
+	std::vector<OBSWeakSource> parents;
+	if(const auto parents_it = this->_parents.find(scene); parents_it != this->_parents.end())
+	{
+		for(const auto &parent : parents_it->second)
+			parents.emplace_back(parent.first);
+	}
+
+	return parents;
+}
+
+std::vector<OBSWeakSource> StvSceneDependencies::GetChildren(obs_weak_source_t *scene) const
+{
+	std::lock_guard lock(this->_lock);
+
+	std::vector<OBSWeakSource> children;
+	if(const auto children_it = this->_children.find(scene); children_it != this->_children.end())
+	{
+		for(const auto &child : children_it->second)
+			children.emplace_back(child.first);
+	}
+
+	return children;
+}
+
+void StvSceneDependencies::AddEdge(obs_weak_source_t *parent, obs_weak_source_t *child)
+{
+	const auto children_it = this->_children.find(parent);
+	if(children_it == this->_children.end())
+		return;
+
+	children_it->second[child] += 1;
+
+	auto [parents_it, inserted] = this->_parents.try_emplace(child);
+	if(inserted)
+	{
+		obs_weak_source_addref(child);
+		STV_ACCOUNT(WEAK_SOURCE_REFS, 1);
+	}
+
+	parents_it->second[parent] += 1;
+}
+
+void StvSceneDependencies::RemoveEdge(obs_weak_source_t *parent, obs_weak_source_t *child)
+{
+	const auto children_it = this->_children.find(parent);
+	if(children_it == this->_children.end())
+		return;
+
+	const auto child_it = children_it->second.find(child);
+	if(child_it == children_it->second.end())
+		return;
+
+	if(--child_it->second == 0)
+		children_it->second.erase(child_it);
+
+	const auto parents_it = this->_parents.find(child);
+	const auto parent_it = parents_it->second.find(parent);
+	if(--parent_it->second == 0)
+	{
+		parents_it->second.erase(parent_it);
+		if(parents_it->second.empty())
+		{
+			this->_parents.erase(parents_it);
+			obs_weak_source_release(child);
+			STV_ACCOUNT(WEAK_SOURCE_REFS, -1);
+		}
+	}
+}
+
+void StvSceneDependencies::ConnectSignals(obs_weak_source_t *scene, bool connect)
+{
+	// The signal handler is destroyed together with the source
+	OBSSourceAutoRelease source = obs_weak_source_get_source(scene);
+	if(!source)
+		return;
+
+	signal_handler_t *signal_handler = obs_source_get_signal_handler(source);
+	if(connect)
+	{
+		signal_handler_connect(signal_handler, "item_add", &StvSceneDependencies::obs_item_add_cb, this);
+		signal_handler_connect(signal_handler, "item_remove", &StvSceneDependencies::obs_item_remove_cb, this);
+	}
+	else
+	{
+		signal_handler_disconnect(signal_handler, "item_add", &StvSceneDependencies::obs_item_add_cb, this);
+		signal_handler_disconnect(signal_handler, "item_remove", &StvSceneDependencies::obs_item_remove_cb, this);
+	}
+}
+
+void StvSceneDependencies::OnItemChanged(calldata_t *data, bool added)
+{
+	obs_scene_t *scene = (obs_scene_t*)calldata_ptr(data, "scene");
+	obs_sceneitem_t *item = (obs_sceneitem_t*)calldata_ptr(data, "item");
+	if(!scene || !item)
+		return;
+
+	OBSWeakSourceAutoRelease nested_scene = get_nested_scene(item);
+	if(!nested_scene)
+		return;
+
+	OBSWeakSourceAutoRelease parent = obs_source_get_weak_source(obs_scene_get_source(scene));
+
+	{
+		std::lock_guard lock(this->_lock);
+		if(added)
+			this->AddEdge(parent, nested_scene);
+		else
+			this->RemoveEdge(parent, nested_scene);
+	}
+
+	this->_changed_cb();
+}
+
+void StvSceneDependencies::obs_item_add_cb(void *private_data, calldata_t *data)
+{
+	static_cast<StvSceneDependencies*>(private_data)->OnItemChanged(data, true);
+}
+
+void StvSceneDependencies::obs_item_remove_cb(void *private_data, calldata_t *data)
+{
+	static_cast<StvSceneDependencies*>(private_data)->OnItemChanged(data, false);
+}
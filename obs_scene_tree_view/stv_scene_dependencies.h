@@ -0,0 +1,74 @@
+#ifndef STV_SCENE_DEPENDENCIES_H
+#define STV_SCENE_DEPENDENCIES_H
+
+#include <obs.hpp>
+
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+
+/*!
+ * \brief Index of scenes nested in other scenes, in both directions. Scenes are identified by their weak reference,
+ * which is unique per source. The index is updated from the item_add and item_remove signals of all added scenes,
+ * which may be emitted from any thread. Groups are not descended into
+ */
+class StvSceneDependencies
+{
+	public:
+		using changed_cb_t = std::function<void()>;
+
+		/*!
+		 * \param changed_cb Called whenever a nesting changed. May be called from any thread
+		 */
+		StvSceneDependencies(changed_cb_t changed_cb);
+		~StvSceneDependencies();
+
+		StvSceneDependencies(const StvSceneDependencies&) = delete;
+		StvSceneDependencies &operator=(const StvSceneDependencies&) = delete;
+
+		/*!
+		 * \brief Start tracking the items of scene
+		 */
+		void AddScene(obs_weak_source_t *scene);
+		void RemoveScene(obs_weak_source_t *scene);
+		void Clear();
+
+		/*!
+		 * \brief Get all tracked scenes that directly contain scene
+		 */
+		std::vector<OBSWeakSource> GetParents(obs_weak_source_t *scene) const;
+
+		/*!
+		 * \brief Get all scenes directly nested in scene
+		 */
+		std::vector<OBSWeakSource> GetChildren(obs_weak_source_t *scene) const;
+
+	private:
+		// Scene -> number of items referencing it
+		using edge_map_t = std::unordered_map<obs_weak_source_t*, int>;
+
+		mutable std::mutex _lock;
+
+		// Tracked scene -> nested scenes. Holds a reference of each tracked scene
+		std::unordered_map<obs_weak_source_t*, edge_map_t> _children;
+
+		// Nested scene -> tracked scenes containing it. Holds a reference of each nested scene
+		std::unordered_map<obs_weak_source_t*, edge_map_t> _parents;
+
+		changed_cb_t _changed_cb;
+
+		// Must be called while holding _lock
+		void AddEdge(obs_weak_source_t *parent, obs_weak_source_t *child);
+		void RemoveEdge(obs_weak_source_t *parent, obs_weak_source_t *child);
+
+		void ConnectSignals(obs_weak_source_t *scene, bool connect);
+
+		void OnItemChanged(calldata_t *data, bool added);
+
+		static void obs_item_add_cb(void *private_data, calldata_t *data);
+		static void obs_item_remove_cb(void *private_data, calldata_t *data);
+};
+
+#endif // STV_SCENE_DEPENDENCIES_H
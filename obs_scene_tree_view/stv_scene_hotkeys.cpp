@@ -0,0 +1,314 @@
+#include "obs_scene_tree_view/stv_scene_hotkeys.h"
+
+#include "obs_scene_tree_view/stv_item_model.h"
+
+#include <obs-frontend-api.h>
+#include <obs-module.h>
+
+
+StvSceneHotkeys::StvSceneHotkeys(StvItemModel &model)
+    : _model(model)
+{
+	// Hotkey name and description of each action before FIRST_FOLDER
+	static constexpr const char *action_names[FIRST_FOLDER][2] = {
+	    {"SceneTreeView.NextScene", "SceneTreeView.Hotkey.NextScene"},
+	    {"SceneTreeView.PrevScene", "SceneTreeView.Hotkey.PrevScene"},
+	    {"SceneTreeView.NextFolder", "SceneTreeView.Hotkey.NextFolder"},
+	    {"SceneTreeView.PrevFolder", "SceneTreeView.Hotkey.PrevFolder"},
+	};
+
+	const QString folder_format{obs_module_text("SceneTreeView.Hotkey.FirstFolderScene")};
+
+	for(size_t action = 0; action < HOTKEY_COUNT; ++action)
+	{
+		HOTKEY &hotkey = this->_hotkeys[action];
+		hotkey.Hotkeys = this;
+		hotkey.Action = action;
+
+		QString description;
+		if(action < FIRST_FOLDER)
+		{
+			hotkey.Name = action_names[action][0];
+			description = obs_module_text(action_names[action][1]);
+		}
+		else
+		{
+			const size_t folder_number = action - FIRST_FOLDER + 1;
+			hotkey.Name = "SceneTreeView.Folder" + std::to_string(folder_number);
+			description = folder_format.arg(QString::number(folder_number));
+		}
+
+		hotkey.Id = obs_hotkey_register_frontend(hotkey.Name.c_str(), description.toUtf8().constData(),
+		                                         &StvSceneHotkeys::obs_hotkey_cb, &hotkey);
+	}
+
+	// Renames and expansion don't change the traversal order
+	QObject::connect(&this->_model, &QAbstractItemModel::rowsInserted, this, &StvSceneHotkeys::OnRowsInserted);
+	QObject::connect(&this->_model, &QAbstractItemModel::rowsAboutToBeRemoved, this, &StvSceneHotkeys::OnRowsAboutToBeRemoved);
+	QObject::connect(&this->_model, &QAbstractItemModel::rowsRemoved, this, [this](const QModelIndex &parent) {
+		this->OnRowsRemoved(parent);
+	});
+	QObject::connect(&this->_model, &QAbstractItemModel::rowsMoved, this, &StvSceneHotkeys::ScheduleRebuild);
+	QObject::connect(&this->_model, &QAbstractItemModel::layoutChanged, this, &StvSceneHotkeys::ScheduleRebuild);
+	QObject::connect(&this->_model, &QAbstractItemModel::modelReset, this, &StvSceneHotkeys::ScheduleRebuild);
+}
+
+StvSceneHotkeys::~StvSceneHotkeys()
+{
+	// Unregistering waits for running callbacks. Queued triggers are dropped together with this object
+	for(const HOTKEY &hotkey : this->_hotkeys)
+		obs_hotkey_unregister(hotkey.Id);
+}
+
+void StvSceneHotkeys::Save(obs_data_t *save_data) const
+{
+	OBSDataAutoRelease hotkeys_data = obs_data_create();
+	for(const HOTKEY &hotkey : this->_hotkeys)
+	{
+		OBSDataArrayAutoRelease bindings = obs_hotkey_save(hotkey.Id);
+		obs_data_set_array(hotkeys_data, hotkey.Name.c_str(), bindings);
+	}
+
+	obs_data_set_obj(save_data, SCENE_HOTKEYS_DATA.data(), hotkeys_data);
+}
+
+void StvSceneHotkeys::Load(obs_data_t *save_data)
+{
+	// Hotkeys without stored bindings are cleared, so bindings of the previous scene collection don't carry over
+	OBSDataAutoRelease hotkeys_data = obs_data_get_obj(save_data, SCENE_HOTKEYS_DATA.data());
+	for(const HOTKEY &hotkey : this->_hotkeys)
+	{
+		OBSDataArrayAutoRelease bindings = obs_data_get_array(hotkeys_data, hotkey.Name.c_str());
+		if(!bindings)
+			bindings = obs_data_array_create();
+
+		obs_hotkey_load(hotkey.Id, bindings);
+	}
+}
+
+void StvSceneHotkeys::ScheduleRebuild()
+{
+	if(this->_rebuild_pending)
+		return;
+
+	this->_rebuild_pending = true;
+	QMetaObject::invokeMethod(this, [this]() {
+		if(this->_rebuild_pending)
+			this->BuildTraversalOrder();
+	}, Qt::QueuedConnection);
+}
+
+void StvSceneHotkeys::BuildTraversalOrder()
+{
+	this->_rebuild_pending = false;
+
+	this->_folders.clear();
+	this->_top_level_folders.clear();
+	this->_scene_positions.clear();
+	this->_folder_indexes.clear();
+
+	this->AddFolder(this->_model.invisibleRootItem());
+
+	// Link the folders that can be switched to, in traversal order
+	std::vector<size_t> scene_folders;
+	for(size_t folder = 0; folder < this->_folders.size(); ++folder)
+	{
+		if(!this->_folders[folder].Scenes.empty())
+			scene_folders.push_back(folder);
+	}
+
+	for(size_t i = 0; i < scene_folders.size(); ++i)
+	{
+		FOLDER &folder = this->_folders[scene_folders[i]];
+		folder.NextFolder = scene_folders[(i+1) % scene_folders.size()];
+		folder.PrevFolder = scene_folders[(i+scene_folders.size()-1) % scene_folders.size()];
+	}
+}
+
+size_t StvSceneHotkeys::AddFolder(QStandardItem *folder)
+{
+	// _folders grows while subfolders are added, so the entry is only accessed by index
+	const size_t folder_index = this->_folders.size();
+	this->_folders.emplace_back();
+	this->_folder_indexes.emplace(folder, folder_index);
+
+	const bool is_top_level = folder == this->_model.invisibleRootItem();
+
+	for(int row = 0; row < folder->rowCount(); ++row)
+	{
+		QStandardItem *item = folder->child(row);
+		if(item->type() == StvItemModel::SCENE)
+		{
+			obs_weak_source_t *weak = item->data(StvItemModel::OBS_SCENE).value<obs_weak_source_ptr>().ptr;
+			this->_scene_positions[weak] = SCENE_POSITION{folder_index, this->_folders[folder_index].Scenes.size()};
+			this->_folders[folder_index].Scenes.emplace_back(weak);
+
+			if(!this->_folders[folder_index].FirstScene)
+				this->_folders[folder_index].FirstScene = OBSWeakSource(weak);
+		}
+		else if(item->type() == StvItemModel::FOLDER)
+		{
+			const size_t subfolder_index = this->AddFolder(item);
+			if(is_top_level)
+				this->_top_level_folders.push_back(subfolder_index);
+
+			if(!this->_folders[folder_index].FirstScene)
+				this->_folders[folder_index].FirstScene = this->_folders[subfolder_index].FirstScene;
+		}
+	}
+
+	return folder_index;
+}
+
+void StvSceneHotkeys::OnRowsInserted(const QModelIndex &parent, int first, int last)
+{
+	QStandardItem *folder = parent.isValid() ? this->_model.itemFromIndex(parent) : this->_model.invisibleRootItem();
+	for(int row = first; row <= last; ++row)
+	{
+		if(folder->child(row)->type() != StvItemModel::SCENE)
+			return this->ScheduleRebuild();
+	}
+
+	this->UpdateFolder(folder);
+}
+
+void StvSceneHotkeys::OnRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last)
+{
+	QStandardItem *folder = parent.isValid() ? this->_model.itemFromIndex(parent) : this->_model.invisibleRootItem();
+	for(int row = first; row <= last; ++row)
+	{
+		if(folder->child(row)->type() != StvItemModel::SCENE)
+			return this->ScheduleRebuild();
+	}
+}
+
+void StvSceneHotkeys::OnRowsRemoved(const QModelIndex &parent)
+{
+	this->UpdateFolder(parent.isValid() ? this->_model.itemFromIndex(parent) : this->_model.invisibleRootItem());
+}
+
+void StvSceneHotkeys::UpdateFolder(QStandardItem *folder)
+{
+	// A pending rebuild covers this edit. Folders added since the last rebuild aren't indexed yet
+	const auto index_it = this->_folder_indexes.find(folder);
+	if(this->_rebuild_pending || index_it == this->_folder_indexes.end())
+		return this->ScheduleRebuild();
+
+	const size_t folder_index = index_it->second;
+	FOLDER &folder_order = this->_folders[folder_index];
+	const bool had_scenes = !folder_order.Scenes.empty();
+
+	// The folder holds references of its previous scenes, so their keys are still valid
+	for(const OBSWeakSource &weak : folder_order.Scenes)
+		this->_scene_positions.erase(weak.Get());
+
+	folder_order.Scenes.clear();
+	for(int row = 0; row < folder->rowCount(); ++row)
+	{
+		QStandardItem *item = folder->child(row);
+		if(item->type() != StvItemModel::SCENE)
+			continue;
+
+		obs_weak_source_t *weak = item->data(StvItemModel::OBS_SCENE).value<obs_weak_source_ptr>().ptr;
+		this->_scene_positions[weak] = SCENE_POSITION{folder_index, folder_order.Scenes.size()};
+		folder_order.Scenes.emplace_back(weak);
+	}
+
+	// Folders are only linked while they contain scenes
+	if(had_scenes != !folder_order.Scenes.empty())
+		return this->ScheduleRebuild();
+
+	QStandardItem *root_item = this->_model.invisibleRootItem();
+	for(QStandardItem *ancestor = folder; ; ancestor = ancestor->parent() ? ancestor->parent() : root_item)
+	{
+		this->UpdateFirstScene(this->_folder_indexes.at(ancestor), ancestor);
+
+		// Top-level items have no parent
+		if(ancestor == root_item)
+			break;
+	}
+}
+
+void StvSceneHotkeys::UpdateFirstScene(size_t folder_index, QStandardItem *folder)
+{
+	OBSWeakSource first_scene;
+	for(int row = 0; row < folder->rowCount() && !first_scene; ++row)
+	{
+		QStandardItem *item = folder->child(row);
+		if(item->type() == StvItemModel::SCENE)
+			first_scene = OBSWeakSource(item->data(StvItemModel::OBS_SCENE).value<obs_weak_source_ptr>().ptr);
+		else if(item->type() == StvItemModel::FOLDER)
+			first_scene = this->_folders[this->_folder_indexes.at(item)].FirstScene;
+	}
+
+	this->_folders[folder_index].FirstScene = first_scene;
+}
+
+void StvSceneHotkeys::Trigger(size_t action)
+{
+	// A key pressed right after an edit arrives before the scheduled rebuild. Queue it again, behind the rebuild
+	if(this->_rebuild_pending)
+	{
+		QMetaObject::invokeMethod(this, [this, action]() {
+			this->Trigger(action);
+		}, Qt::QueuedConnection);
+		return;
+	}
+
+	OBSSourceAutoRelease source = OBSGetStrongRef(this->GetTarget(action));
+
+	// Same as selecting the scene in the dock, in studio mode only the preview is changed
+	if(QStandardItem *scene_item = this->_model.GetSceneItem(source))
+		this->_model.SetSelectedScene(scene_item, obs_frontend_preview_program_mode_active());
+}
+
+OBSWeakSource StvSceneHotkeys::GetTarget(size_t action) const
+{
+	if(action >= FIRST_FOLDER)
+	{
+		const size_t folder_number = action - FIRST_FOLDER;
+		return folder_number < this->_top_level_folders.size() ? this->_folders[this->_top_level_folders[folder_number]].FirstScene :
+		                                                         OBSWeakSource();
+	}
+
+	if(this->_folders.empty())
+		return OBSWeakSource();
+
+	OBSSourceAutoRelease current_scene = this->_model.GetCurrentScene();
+	OBSWeakSourceAutoRelease current_weak = obs_source_get_weak_source(current_scene);
+
+	// Start at the first scene if the current one isn't part of the tree
+	const auto position_it = this->_scene_positions.find(current_weak.Get());
+	if(position_it == this->_scene_positions.end())
+		return this->_folders.front().FirstScene;
+
+	const SCENE_POSITION &position = position_it->second;
+	const FOLDER &folder = this->_folders[position.Folder];
+	switch(action)
+	{
+		case NEXT_SCENE:
+			return folder.Scenes[(position.Row+1) % folder.Scenes.size()];
+		case PREV_SCENE:
+			return folder.Scenes[(position.Row+folder.Scenes.size()-1) % folder.Scenes.size()];
+		case NEXT_FOLDER:
+			return this->_folders[folder.NextFolder].Scenes.front();
+		case PREV_FOLDER:
+			return this->_folders[folder.PrevFolder].Scenes.front();
+		default:
+			return OBSWeakSource();
+	}
+}
+
+void StvSceneHotkeys::obs_hotkey_cb(void *data, obs_hotkey_id, obs_hotkey_t*, bool pressed)
+{
+	if(!pressed)
+		return;
+
+	// Called on the hotkey thread, the model may only be accessed on the UI thread
+	const HOTKEY *hotkey = (const HOTKEY*)data;
+	StvSceneHotkeys *hotkeys = hotkey->Hotkeys;
+	const size_t action = hotkey->Action;
+	QMetaObject::invokeMethod(hotkeys, [hotkeys, action]() {
+		hotkeys->Trigger(action);
+	}, Qt::QueuedConnection);
+}
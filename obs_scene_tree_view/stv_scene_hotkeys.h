@@ -0,0 +1,114 @@
+#ifndef STV_SCENE_HOTKEYS_H
+#define STV_SCENE_HOTKEYS_H
+
+#include <obs.hpp>
+
+#include <QObject>
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+class QStandardItem;
+class StvItemModel;
+
+/*!
+ * \brief Frontend hotkeys that switch scenes along the tree: Next/previous scene in the current folder,
+ * next/previous folder and the first scene of the Nth top-level folder.
+ *
+ * The traversal order is flattened into arrays, so a key press only does a few lookups before switching the scene.
+ * Scenes added to or removed from a folder only update that folder and its ancestors. Folder changes rebuild the
+ * arrays once control returns to the event loop. Bindings are stored with the scene collection
+ */
+class StvSceneHotkeys
+        : public QObject
+{
+		Q_OBJECT
+
+	public:
+		static constexpr size_t FOLDER_HOTKEY_COUNT = 10;
+
+		static constexpr std::string_view SCENE_HOTKEYS_DATA = "scene_tree_view_hotkeys";
+
+		StvSceneHotkeys(StvItemModel &model);
+		virtual ~StvSceneHotkeys() override;
+
+		void Save(obs_data_t *save_data) const;
+		void Load(obs_data_t *save_data);
+
+	private:
+		enum ACTION
+		{	NEXT_SCENE, PREV_SCENE, NEXT_FOLDER, PREV_FOLDER, FIRST_FOLDER	};
+
+		static constexpr size_t HOTKEY_COUNT = FIRST_FOLDER + FOLDER_HOTKEY_COUNT;
+
+		struct HOTKEY
+		{
+			StvSceneHotkeys *Hotkeys = nullptr;
+			size_t Action = 0;
+			std::string Name;
+			obs_hotkey_id Id = OBS_INVALID_HOTKEY_ID;
+		};
+
+		/*!
+		 * \brief Scenes directly contained in a folder. Index 0 is the top level
+		 */
+		struct FOLDER
+		{
+			std::vector<OBSWeakSource> Scenes;
+
+			// First scene of the folder or its subfolders
+			OBSWeakSource FirstScene;
+
+			// Adjacent folders that directly contain scenes, wrapping around at the ends
+			size_t NextFolder = 0;
+			size_t PrevFolder = 0;
+		};
+
+		struct SCENE_POSITION
+		{
+			size_t Folder;
+			size_t Row;
+		};
+
+		StvItemModel &_model;
+
+		std::array<HOTKEY, HOTKEY_COUNT> _hotkeys;
+
+		std::vector<FOLDER> _folders;
+		std::vector<size_t> _top_level_folders;
+		std::unordered_map<obs_weak_source_t*, SCENE_POSITION> _scene_positions;
+
+		// Index in _folders by folder item. Only valid while no rebuild is pending
+		std::unordered_map<const QStandardItem*, size_t> _folder_indexes;
+
+		bool _rebuild_pending = false;
+
+		/*!
+		 * \brief Rebuild the traversal order once control returns to the event loop, so a batch of edits
+		 * only causes a single rebuild
+		 */
+		void ScheduleRebuild();
+		void BuildTraversalOrder();
+		size_t AddFolder(QStandardItem *folder);
+
+		void OnRowsInserted(const QModelIndex &parent, int first, int last);
+		void OnRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last);
+		void OnRowsRemoved(const QModelIndex &parent);
+
+		/*!
+		 * \brief Re-read the scenes directly contained in folder, and the first scene of it and its ancestors
+		 */
+		void UpdateFolder(QStandardItem *folder);
+		void UpdateFirstScene(size_t folder_index, QStandardItem *folder);
+
+		void Trigger(size_t action);
+		OBSWeakSource GetTarget(size_t action) const;
+
+		static void obs_hotkey_cb(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed);
+};
+
+#endif // STV_SCENE_HOTKEYS_H
@@ -0,0 +1,130 @@
+#include "obs_scene_tree_view/stv_scene_order_sync.h"
+
+#include "obs_scene_tree_view/stv_item_model.h"
+
+#include <obs-frontend-api.h>
+#include <obs-module.h>
+#include <util/config-file.h>
+
+#include <QHash>
+#include <QSignalBlocker>
+#include <QtWidgets/QListWidget>
+#include <QtWidgets/QMainWindow>
+
+
+StvSceneOrderSync::StvSceneOrderSync(StvItemModel &model, QMainWindow *main_window)
+    : _model(model),
+      _main_window(main_window)
+{
+	config_t *const global_config = obs_frontend_get_global_config();
+	config_set_default_bool(global_config, "SceneTreeView", SYNC_SCENE_ORDER_CONFIG.data(), false);
+	this->_enabled = config_get_bool(global_config, "SceneTreeView", SYNC_SCENE_ORDER_CONFIG.data());
+
+	// Every committed edit is reported, including scenes added by UpdateTree()
+	QObject::connect(&this->_model, &StvItemModel::TreeEdited, this, &StvSceneOrderSync::ScheduleSync);
+}
+
+StvSceneOrderSync::~StvSceneOrderSync() = default;
+
+void StvSceneOrderSync::SetEnabled(bool enabled)
+{
+	this->_enabled = enabled;
+	config_set_bool(obs_frontend_get_global_config(), "SceneTreeView", SYNC_SCENE_ORDER_CONFIG.data(), enabled);
+
+	this->ScheduleSync();
+}
+
+bool StvSceneOrderSync::IsEnabled() const
+{
+	return this->_enabled;
+}
+
+void StvSceneOrderSync::ScheduleSync()
+{
+	if(!this->_enabled || this->_sync_queued)
+		return;
+
+	this->_sync_queued = true;
+	QMetaObject::invokeMethod(this, &StvSceneOrderSync::Sync, Qt::QueuedConnection);
+}
+
+bool StvSceneOrderSync::IsSyncing() const
+{
+	return this->_syncing;
+}
+
+void StvSceneOrderSync::Sync()
+{
+	this->_sync_queued = false;
+
+	// Trees of other canvases only hold part of the scenes. Showing one mustn't reorder the scene list of OBS
+	if(!this->_enabled || this->_model.GetCanvas() != StvItemModel::BASE_CANVAS)
+		return;
+
+	// Workaround, the frontend API can't reorder scenes
+	QListWidget *scene_list = this->_main_window->findChild<QListWidget*>("scenes");
+	if(!scene_list)
+	{
+		blog(LOG_WARNING, "[%s] Couldn't find the scene list of OBS, can't sync the scene order", obs_module_name());
+		return;
+	}
+
+	std::vector<QString> scene_names;
+	scene_names.reserve(scene_list->count());
+	this->AddSceneNames(this->_model.invisibleRootItem(), scene_names);
+
+	// Views only lay out the list once afterwards, and OBS isn't notified of each single move
+	int move_count = 0;
+	{
+		QAbstractItemModel *list_model = scene_list->model();
+		const QSignalBlocker blocker(list_model);
+
+		// Row of each scene, kept up to date while rows are moved. Items are named after their scene
+		QHash<QString, int> scene_rows;
+		scene_rows.reserve(scene_list->count());
+		for(int row = 0; row < scene_list->count(); ++row)
+			scene_rows.insert(scene_list->item(row)->text(), row);
+
+		int target_row = 0;
+		for(const QString &scene_name : scene_names)
+		{
+			// Rows before target_row are already in tree order
+			const int row = scene_rows.value(scene_name, -1);
+			if(row < target_row)
+				continue;
+
+			if(row != target_row && list_model->moveRow(QModelIndex(), row, QModelIndex(), target_row))
+			{
+				++move_count;
+
+				// Only the rows in between moved, each down by one
+				for(int moved_row = target_row + 1; moved_row <= row; ++moved_row)
+					scene_rows[scene_list->item(moved_row)->text()] = moved_row;
+			}
+
+			++target_row;
+		}
+	}
+
+	if(move_count == 0)
+		return;
+
+	scene_list->doItemsLayout();
+
+	// Same slot OBS calls after its own reorders. Updates multiview and emits SCENE_LIST_CHANGED once
+	this->_syncing = true;
+	QMetaObject::invokeMethod(this->_main_window, "ScenesReordered");
+	this->_syncing = false;
+}
+
+void StvSceneOrderSync::AddSceneNames(QStandardItem *folder, std::vector<QString> &scene_names) const
+{
+	for(int row = 0; row < folder->rowCount(); ++row)
+	{
+		QStandardItem *item = folder->child(row);
+		if(item->type() == StvItemModel::FOLDER)
+			this->AddSceneNames(item, scene_names);
+		else
+			scene_names.push_back(item->text());
+	}
+}
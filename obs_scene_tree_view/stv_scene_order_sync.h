@@ -0,0 +1,61 @@
+#ifndef STV_SCENE_ORDER_SYNC_H
+#define STV_SCENE_ORDER_SYNC_H
+
+#include <QObject>
+#include <QString>
+
+#include <string_view>
+#include <vector>
+
+
+class QMainWindow;
+class QStandardItem;
+class StvItemModel;
+
+/*!
+ * \brief Applies the tree order to the scene list of OBS, which still orders the multiview, the scene hotkeys of OBS
+ * and the scene list of obs-websocket. Enabled in the global config. Only the tree of the base canvas is synced,
+ * scenes of other canvases follow the synced ones in their previous order.
+ *
+ * All edits of an event loop iteration are synced together. The scene list of the main window is reordered with
+ * its model's signals blocked and OBS is notified once afterwards, so the whole reorder causes a single
+ * SCENE_LIST_CHANGED event
+ */
+class StvSceneOrderSync
+        : public QObject
+{
+		Q_OBJECT
+
+	public:
+		static constexpr std::string_view SYNC_SCENE_ORDER_CONFIG = "SyncSceneOrder";
+
+		StvSceneOrderSync(StvItemModel &model, QMainWindow *main_window);
+		virtual ~StvSceneOrderSync() override;
+
+		void SetEnabled(bool enabled);
+		bool IsEnabled() const;
+
+		/*!
+		 * \brief Sync once control returns to the event loop. Does nothing while disabled
+		 */
+		void ScheduleSync();
+
+		/*!
+		 * \brief Whether OBS is being notified of a reorder. The resulting SCENE_LIST_CHANGED event must not update
+		 * the tree
+		 */
+		bool IsSyncing() const;
+
+	private:
+		StvItemModel &_model;
+		QMainWindow *_main_window;
+
+		bool _enabled = false;
+		bool _sync_queued = false;
+		bool _syncing = false;
+
+		void Sync();
+		void AddSceneNames(QStandardItem *folder, std::vector<QString> &scene_names) const;
+};
+
+#endif // STV_SCENE_ORDER_SYNC_H
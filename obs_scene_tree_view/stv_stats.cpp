@@ -0,0 +1,158 @@
+#include "obs_scene_tree_view/stv_stats.h"
+
+#include <obs-module.h>
+
+#include <algorithm>
+#include <cstdio>
+
+
+StvStats &StvStats::Get()
+{
+	static StvStats stats;
+	return stats;
+}
+
+void StvStats::RecordScrollFrame(int64_t frame_time_ns, int row_count)
+{
+	const size_t bucket = std::min<size_t>(std::max<int64_t>(frame_time_ns, 0) / FRAME_BUCKET_NS, FRAME_BUCKET_COUNT-1);
+
+	std::lock_guard lock(this->_lock);
+
+	this->_scroll_frames.Count += 1;
+	this->_scroll_frames.TotalNs += frame_time_ns;
+	this->_scroll_frames.MaxNs = std::max(this->_scroll_frames.MaxNs, frame_time_ns);
+	this->_scroll_frame_buckets[bucket] += 1;
+	this->_max_scroll_rows = std::max(this->_max_scroll_rows, row_count);
+}
+
+StvStats::FRAME_STATS StvStats::GetScrollFrameStats() const
+{
+	std::lock_guard lock(this->_lock);
+
+	FRAME_STATS stats = this->_scroll_frames;
+
+	// Upper bound of the bucket containing the 95th percentile
+	const uint64_t p95_count = (stats.Count * 95 + 99) / 100;
+	uint64_t count = 0;
+	for(size_t i=0; i < FRAME_BUCKET_COUNT && stats.Count > 0; ++i)
+	{
+		count += this->_scroll_frame_buckets[i];
+		if(count >= p95_count)
+		{
+			stats.P95Ns = std::min<int64_t>((i+1) * FRAME_BUCKET_NS, stats.MaxNs);
+			break;
+		}
+	}
+
+	return stats;
+}
+
+void StvStats::RecordModuleLoad(int64_t load_time_ns)
+{
+	std::lock_guard lock(this->_lock);
+	this->_startup.ModuleLoadNs = load_time_ns;
+}
+
+void StvStats::RecordTreeLoad(int64_t load_time_ns, int64_t reconcile_time_ns, bool reconcile_skipped)
+{
+	std::lock_guard lock(this->_lock);
+	this->_startup.TreeLoadNs = load_time_ns;
+	this->_startup.ReconcileNs = reconcile_time_ns;
+	this->_startup.ReconcileSkipped = reconcile_skipped;
+}
+
+StvStats::STARTUP_STATS StvStats::GetStartupStats() const
+{
+	std::lock_guard lock(this->_lock);
+	return this->_startup;
+}
+
+void StvStats::LogStartup() const
+{
+	const STARTUP_STATS startup = this->GetStartupStats();
+	blog(LOG_INFO, "[%s] startup: %.2f ms (module load %.2f ms, tree load %.2f ms, reconcile %.2f ms%s)", obs_module_name(),
+	     (startup.ModuleLoadNs + startup.TreeLoadNs + startup.ReconcileNs) / 1e6, startup.ModuleLoadNs / 1e6,
+	     startup.TreeLoadNs / 1e6, startup.ReconcileNs / 1e6, startup.ReconcileSkipped ? ", tree unchanged" : "");
+}
+
+void StvStats::Account(ACCOUNT account, int64_t delta)
+{
+	this->_accounts[account].fetch_add(delta, std::memory_order_relaxed);
+}
+
+int64_t StvStats::GetAccount(ACCOUNT account) const
+{
+	return this->_accounts[account].load(std::memory_order_relaxed);
+}
+
+bool StvStats::CheckAccountsReleased(const char *context) const
+{
+	bool released = true;
+	for(size_t i=0; i < ACCOUNT_COUNT; ++i)
+	{
+		if(const int64_t outstanding = this->GetAccount((ACCOUNT)i); outstanding != 0)
+		{
+			blog(LOG_ERROR, "[%s] %lld %s outstanding after %s", obs_module_name(), (long long)outstanding,
+			     StvStats::GetAccountName((ACCOUNT)i), context);
+			released = false;
+		}
+	}
+
+	return released;
+}
+
+std::string StvStats::Format() const
+{
+	const FRAME_STATS scroll_frames = this->GetScrollFrameStats();
+
+	int max_scroll_rows;
+	{
+		std::lock_guard lock(this->_lock);
+		max_scroll_rows = this->_max_scroll_rows;
+	}
+
+	const double avg_ms = scroll_frames.Count > 0 ? scroll_frames.TotalNs / 1e6 / scroll_frames.Count : 0.0;
+
+	char line[256];
+	snprintf(line, sizeof(line), "scroll frames: %llu, avg %.2f ms, p95 %.2f ms, max %.2f ms, rows %d",
+	         (unsigned long long)scroll_frames.Count, avg_ms, scroll_frames.P95Ns / 1e6, scroll_frames.MaxNs / 1e6,
+	         max_scroll_rows);
+
+	std::string text = line;
+
+#ifdef STV_ACCOUNTING
+	for(size_t i=0; i < ACCOUNT_COUNT; ++i)
+	{
+		snprintf(line, sizeof(line), ", %s %lld", StvStats::GetAccountName((ACCOUNT)i), (long long)this->GetAccount((ACCOUNT)i));
+		text += line;
+	}
+#endif
+
+	return text;
+}
+
+void StvStats::Log() const
+{
+	blog(LOG_INFO, "[%s] %s", obs_module_name(), this->Format().c_str());
+}
+
+const char *StvStats::GetAccountName(ACCOUNT account)
+{
+	switch(account)
+	{
+		case WEAK_SOURCE_REFS:
+			return "weak source refs";
+		case SCENE_ITEMS:
+			return "scene items";
+		case FOLDER_ITEMS:
+			return "folder items";
+		case NAME_BYTES:
+			return "name bytes";
+		case ICON_REFS:
+			return "icon refs";
+		case ACCOUNT_COUNT:
+			break;
+	}
+
+	return "";
+}
@@ -0,0 +1,107 @@
+#ifndef STV_STATS_H
+#define STV_STATS_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+
+/*!
+ * \brief Adjust an outstanding resource count. Compiled out unless built with ENABLE_STV_ACCOUNTING
+ */
+#ifdef STV_ACCOUNTING
+#define STV_ACCOUNT(account, delta) StvStats::Get().Account(StvStats::account, (delta))
+#else
+#define STV_ACCOUNT(account, delta) ((void)0)
+#endif
+
+/*!
+ * \brief Runtime statistics of the scene tree view. Values are collected for the lifetime of the module
+ * and written to the OBS log on request or on unload
+ */
+class StvStats
+{
+	public:
+		struct FRAME_STATS
+		{
+			uint64_t Count = 0;
+			int64_t TotalNs = 0;
+			int64_t MaxNs = 0;
+			int64_t P95Ns = 0;
+		};
+
+		struct STARTUP_STATS
+		{
+			int64_t ModuleLoadNs = 0;
+			int64_t TreeLoadNs = 0;
+			int64_t ReconcileNs = 0;
+
+			// Set if the stored tree matched the scene list, so nothing was reconciled or written
+			bool ReconcileSkipped = false;
+		};
+
+		// Resources held by the scene tree. Only counted if built with ENABLE_STV_ACCOUNTING
+		enum ACCOUNT
+		{	WEAK_SOURCE_REFS, SCENE_ITEMS, FOLDER_ITEMS, NAME_BYTES, ICON_REFS, ACCOUNT_COUNT	};
+
+		static StvStats &Get();
+
+		StvStats(const StvStats&) = delete;
+		StvStats &operator=(const StvStats&) = delete;
+
+		/*!
+		 * \brief Record the time the view spent scrolling and repainting for a single frame
+		 * \param row_count Number of rows the view can scroll through
+		 */
+		void RecordScrollFrame(int64_t frame_time_ns, int row_count);
+
+		FRAME_STATS GetScrollFrameStats() const;
+
+		/*!
+		 * \brief Record the time spent in obs_module_load()
+		 */
+		void RecordModuleLoad(int64_t load_time_ns);
+
+		/*!
+		 * \brief Record the time spent loading the first scene tree once OBS finished loading
+		 */
+		void RecordTreeLoad(int64_t load_time_ns, int64_t reconcile_time_ns, bool reconcile_skipped);
+
+		STARTUP_STATS GetStartupStats() const;
+		void LogStartup() const;
+
+		void Account(ACCOUNT account, int64_t delta);
+		int64_t GetAccount(ACCOUNT account) const;
+
+		/*!
+		 * \brief Log an error for each account that is still outstanding
+		 * \return Returns false if anything is outstanding
+		 */
+		bool CheckAccountsReleased(const char *context) const;
+
+		std::string Format() const;
+		void Log() const;
+
+	private:
+		// Frame times are collected in buckets of FRAME_BUCKET_NS. Longer frames share the last bucket
+		static constexpr int64_t FRAME_BUCKET_NS = 250*1000;
+		static constexpr size_t FRAME_BUCKET_COUNT = 256;
+
+		mutable std::mutex _lock;
+
+		FRAME_STATS _scroll_frames;
+		std::array<uint32_t, FRAME_BUCKET_COUNT> _scroll_frame_buckets = {};
+		int _max_scroll_rows = 0;
+
+		STARTUP_STATS _startup;
+
+		std::array<std::atomic<int64_t>, ACCOUNT_COUNT> _accounts = {};
+
+		static const char *GetAccountName(ACCOUNT account);
+
+		StvStats() = default;
+};
+
+#endif // STV_STATS_H
@@ -0,0 +1,302 @@
+#include "obs_scene_tree_view/stv_transition_overrides.h"
+
+#include "obs_scene_tree_view/stv_item_model.h"
+
+#include <obs-frontend-api.h>
+#include <obs-module.h>
+
+
+StvTransitionOverrides::StvTransitionOverrides(StvItemModel &model)
+    : _model(model)
+{
+	// Renames and expansion don't change the folder a scene inherits from
+	QObject::connect(&this->_model, &QAbstractItemModel::rowsInserted, this, &StvTransitionOverrides::Invalidate);
+	QObject::connect(&this->_model, &QAbstractItemModel::rowsRemoved, this, &StvTransitionOverrides::Invalidate);
+	QObject::connect(&this->_model, &QAbstractItemModel::rowsMoved, this, &StvTransitionOverrides::Invalidate);
+	QObject::connect(&this->_model, &QAbstractItemModel::layoutChanged, this, &StvTransitionOverrides::Invalidate);
+	QObject::connect(&this->_model, &QAbstractItemModel::modelReset, this, &StvTransitionOverrides::Invalidate);
+}
+
+StvTransitionOverrides::~StvTransitionOverrides() = default;
+
+StvTransitionOverrides::OVERRIDE StvTransitionOverrides::GetFolderOverride(QStandardItem *folder) const
+{
+	if(!folder || folder->type() != StvItemModel::FOLDER)
+		return OVERRIDE();
+
+	const auto override_it = this->_overrides.find(static_cast<StvFolderItem*>(folder)->GetId());
+	return override_it != this->_overrides.end() ? override_it->second : OVERRIDE();
+}
+
+void StvTransitionOverrides::SetFolderOverride(QStandardItem *folder, const OVERRIDE &folder_override)
+{
+	if(!folder || folder->type() != StvItemModel::FOLDER)
+		return;
+
+	this->_overrides[static_cast<StvFolderItem*>(folder)->GetId()] = folder_override;
+	this->Invalidate();
+}
+
+void StvTransitionOverrides::ApplyOverride(obs_source_t *scene_source)
+{
+	if(!scene_source)
+		return;
+
+	// OBS applies the scene's own override. Scenes without any override use the transition selected by the user
+	OBSDataAutoRelease data = obs_source_get_private_settings(scene_source);
+	const char *scene_transition = obs_data_get_string(data, "transition");
+	const uint64_t folder_id = scene_transition && *scene_transition ? 0 : this->ResolveFolder(scene_source);
+	if(folder_id == 0)
+		return;
+
+	const OVERRIDE &folder_override = this->_overrides.at(folder_id);
+	if(!OBSSourceAutoRelease(this->GetTransition(folder_override.Transition)))
+		return;
+
+	// OBS switches synchronously when called on the UI thread. It swaps in the override and restores the selected
+	// transition once it stopped, also if another switch starts in between
+	SCENE_OVERRIDE scene_override;
+	scene_override.Scene = OBSGetWeakRef(scene_source);
+	scene_override.HasTransition = obs_data_has_user_value(data, "transition");
+	scene_override.HasDuration = obs_data_has_user_value(data, "transition_duration");
+	scene_override.DurationMs = (int)obs_data_get_int(data, "transition_duration");
+
+	obs_data_set_string(data, "transition", folder_override.Transition.toUtf8().constData());
+	obs_data_set_int(data, "transition_duration", folder_override.DurationMs);
+
+	if(this->_scene_overrides.empty())
+		QMetaObject::invokeMethod(this, &StvTransitionOverrides::ClearSceneOverrides, Qt::QueuedConnection);
+
+	this->_scene_overrides.push_back(std::move(scene_override));
+}
+
+void StvTransitionOverrides::ApplyPreviewOverride(obs_source_t *scene_source)
+{
+	if(!scene_source)
+		return;
+
+	OBSDataAutoRelease data = obs_source_get_private_settings(scene_source);
+	const char *scene_transition = obs_data_get_string(data, "transition");
+	const uint64_t folder_id = scene_transition && *scene_transition ? 0 : this->ResolveFolder(scene_source);
+
+	OBSSourceAutoRelease transition = folder_id ? this->GetTransition(this->_overrides.at(folder_id).Transition) : nullptr;
+	if(!transition)
+	{
+		this->RestoreTransition();
+		return;
+	}
+
+	// Keep the transition from before the first override, unless the user selected another one since
+	if(!this->_restore_transition || !this->IsPreviewOverrideCurrent())
+	{
+		OBSSourceAutoRelease current_transition = obs_frontend_get_current_transition();
+		this->_restore_transition = OBSGetWeakRef(current_transition);
+		this->_restore_duration_ms = obs_frontend_get_transition_duration();
+	}
+
+	// Setting the same transition again still updates the transition list of the main window
+	const int duration_ms = this->_overrides.at(folder_id).DurationMs;
+	if(OBSSourceAutoRelease(obs_frontend_get_current_transition()).Get() != transition.Get())
+		obs_frontend_set_current_transition(transition);
+	if(obs_frontend_get_transition_duration() != duration_ms)
+		obs_frontend_set_transition_duration(duration_ms);
+
+	this->_applied_transition = OBSGetWeakRef(transition);
+	this->_applied_duration_ms = duration_ms;
+}
+
+int StvTransitionOverrides::GetTransitionDuration(obs_source_t *scene_source)
+{
+	OBSDataAutoRelease data = obs_source_get_private_settings(scene_source);
+	obs_data_set_default_int(data, "transition_duration", DEFAULT_DURATION_MS);
+
+	const char *scene_transition = obs_data_get_string(data, "transition");
+	if(scene_transition && *scene_transition)
+		return (int)obs_data_get_int(data, "transition_duration");
+
+	if(const uint64_t folder_id = this->ResolveFolder(scene_source); folder_id != 0)
+		return this->_overrides.at(folder_id).DurationMs;
+
+	// While a preview override is applied, the current duration is that of the override
+	return this->_restore_transition && this->IsPreviewOverrideCurrent() ? this->_restore_duration_ms : obs_frontend_get_transition_duration();
+}
+
+void StvTransitionOverrides::RestoreTransition()
+{
+	if(!this->_restore_transition)
+		return;
+
+	const bool is_current = this->IsPreviewOverrideCurrent();
+	OBSSourceAutoRelease transition = OBSGetStrongRef(this->_restore_transition);
+	this->_restore_transition = nullptr;
+	this->_applied_transition = nullptr;
+
+	// Keep a transition or duration the user selected while the override was applied
+	if(!is_current)
+		return;
+
+	if(transition)
+		obs_frontend_set_current_transition(transition);
+
+	obs_frontend_set_transition_duration(this->_restore_duration_ms);
+}
+
+void StvTransitionOverrides::ResetTransitions()
+{
+	this->_transitions.clear();
+}
+
+void StvTransitionOverrides::Save(obs_data_t *save_data) const
+{
+	OBSDataArrayAutoRelease overrides_data = obs_data_array_create();
+	for(const auto &[folder_id, folder_override] : this->_overrides)
+	{
+		StvFolderItem *folder = this->_model.GetFolderItem(folder_id);
+		if(!folder)
+			continue;
+
+		OBSDataArrayAutoRelease path_array = obs_data_array_create();
+		for(const QString &folder_name : this->_model.GetFolderPath(folder))
+		{
+			OBSDataAutoRelease folder_data = obs_data_create();
+			obs_data_set_string(folder_data, StvTreeSnapshot::SCENE_TREE_CONFIG_ITEM_NAME_DATA.data(), folder_name.toUtf8().constData());
+			obs_data_array_push_back(path_array, folder_data);
+		}
+
+		OBSDataAutoRelease override_data = obs_data_create();
+		obs_data_set_array(override_data, FOLDER_PATH_DATA.data(), path_array);
+		obs_data_set_string(override_data, FOLDER_TRANSITION_DATA.data(), folder_override.Transition.toUtf8().constData());
+		obs_data_set_int(override_data, FOLDER_DURATION_DATA.data(), folder_override.DurationMs);
+
+		obs_data_array_push_back(overrides_data, override_data);
+	}
+
+	obs_data_set_array(save_data, FOLDER_TRANSITIONS_DATA.data(), overrides_data);
+}
+
+void StvTransitionOverrides::Load(obs_data_t *save_data)
+{
+	// Folders of the previous scene collection are gone
+	this->RestoreTransition();
+	this->_overrides.clear();
+	this->Invalidate();
+
+	this->_loaded_overrides = obs_data_get_array(save_data, FOLDER_TRANSITIONS_DATA.data());
+}
+
+void StvTransitionOverrides::ApplyLoadedOverrides()
+{
+	const size_t override_count = obs_data_array_count(this->_loaded_overrides);
+	for(size_t i=0; i < override_count; ++i)
+	{
+		OBSDataAutoRelease override_data = obs_data_array_item(this->_loaded_overrides, i);
+		OBSDataArrayAutoRelease path_array = obs_data_get_array(override_data, FOLDER_PATH_DATA.data());
+
+		std::vector<QString> folder_path;
+		const size_t folder_count = obs_data_array_count(path_array);
+		for(size_t j=0; j < folder_count; ++j)
+		{
+			OBSDataAutoRelease folder_data = obs_data_array_item(path_array, j);
+			folder_path.push_back(QString::fromUtf8(obs_data_get_string(folder_data, StvTreeSnapshot::SCENE_TREE_CONFIG_ITEM_NAME_DATA.data())));
+		}
+
+		QStandardItem *folder = this->_model.FindFolder(folder_path);
+		if(!folder || folder->type() != StvItemModel::FOLDER)
+			continue;
+
+		obs_data_set_default_int(override_data, FOLDER_DURATION_DATA.data(), DEFAULT_DURATION_MS);
+
+		OVERRIDE folder_override;
+		folder_override.Transition = QString::fromUtf8(obs_data_get_string(override_data, FOLDER_TRANSITION_DATA.data()));
+		folder_override.DurationMs = (int)obs_data_get_int(override_data, FOLDER_DURATION_DATA.data());
+
+		this->_overrides[static_cast<StvFolderItem*>(folder)->GetId()] = folder_override;
+	}
+
+	this->_loaded_overrides = nullptr;
+	this->Invalidate();
+}
+
+void StvTransitionOverrides::Invalidate()
+{
+	this->_scene_folders.clear();
+}
+
+void StvTransitionOverrides::ClearSceneOverrides()
+{
+	// Restore in reverse, a scene switched to twice gets the settings from before the first switch
+	for(auto scene_override_it = this->_scene_overrides.rbegin(); scene_override_it != this->_scene_overrides.rend(); ++scene_override_it)
+	{
+		OBSSourceAutoRelease scene_source = OBSGetStrongRef(scene_override_it->Scene);
+		if(!scene_source)
+			continue;
+
+		OBSDataAutoRelease data = obs_source_get_private_settings(scene_source);
+		if(scene_override_it->HasTransition)
+			obs_data_set_string(data, "transition", "");
+		else
+			obs_data_erase(data, "transition");
+
+		if(scene_override_it->HasDuration)
+			obs_data_set_int(data, "transition_duration", scene_override_it->DurationMs);
+		else
+			obs_data_erase(data, "transition_duration");
+	}
+
+	this->_scene_overrides.clear();
+}
+
+bool StvTransitionOverrides::IsPreviewOverrideCurrent() const
+{
+	OBSSourceAutoRelease applied_transition = OBSGetStrongRef(this->_applied_transition);
+	OBSSourceAutoRelease current_transition = obs_frontend_get_current_transition();
+	return applied_transition && applied_transition.Get() == current_transition.Get() &&
+	       obs_frontend_get_transition_duration() == this->_applied_duration_ms;
+}
+
+uint64_t StvTransitionOverrides::ResolveFolder(obs_source_t *scene_source)
+{
+	OBSWeakSourceAutoRelease weak = obs_source_get_weak_source(scene_source);
+	if(const auto folder_it = this->_scene_folders.find(weak.Get()); folder_it != this->_scene_folders.end())
+		return folder_it->second;
+
+	uint64_t folder_id = 0;
+	if(QStandardItem *scene_item = this->_model.GetSceneItem(scene_source))
+	{
+		// Top-level items have no parent
+		for(QStandardItem *folder = scene_item->parent(); folder; folder = folder->parent())
+		{
+			const uint64_t id = static_cast<StvFolderItem*>(folder)->GetId();
+			const auto override_it = this->_overrides.find(id);
+			if(override_it != this->_overrides.end() && !override_it->second.Transition.isEmpty())
+			{
+				folder_id = id;
+				break;
+			}
+		}
+	}
+
+	// The tree holds a weak reference of each scene, so the key stays valid until the scene is removed from it
+	this->_scene_folders.emplace(weak.Get(), folder_id);
+	return folder_id;
+}
+
+OBSSourceAutoRelease StvTransitionOverrides::GetTransition(const QString &name)
+{
+	if(this->_transitions.isEmpty())
+	{
+		obs_frontend_source_list transition_list = {};
+		obs_frontend_get_transitions(&transition_list);
+
+		for(size_t i = 0; i < transition_list.sources.num; ++i)
+		{
+			obs_source_t *transition = transition_list.sources.array[i];
+			this->_transitions.insert(QString::fromUtf8(obs_source_get_name(transition)), OBSGetWeakRef(transition));
+		}
+
+		obs_frontend_source_list_free(&transition_list);
+	}
+
+	const auto transition_it = this->_transitions.find(name);
+	return transition_it != this->_transitions.end() ? OBSGetStrongRef(transition_it.value()) : nullptr;
+}
@@ -0,0 +1,134 @@
+#ifndef STV_TRANSITION_OVERRIDES_H
+#define STV_TRANSITION_OVERRIDES_H
+
+#include <obs.hpp>
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+class QStandardItem;
+class StvItemModel;
+
+/*!
+ * \brief Transition overrides of folders. Scenes without an override of their own use the one of the closest
+ * ancestor folder that has one.
+ *
+ * OBS only reads the override from the private settings of the scene it switches to. For switches requested by the
+ * tree, the folder override is written there for the duration of the switch, so OBS swaps in the transition and
+ * restores the selected one itself, without touching the transition selected by the user. The transition button of
+ * studio mode switches later, so there the override of the preview scene is made current while it is previewed.
+ * The folder a scene inherits from is cached until the tree or an override changes, so a switch only does a hash
+ * lookup
+ */
+class StvTransitionOverrides
+        : public QObject
+{
+		Q_OBJECT
+
+	public:
+		// Same default as the per-scene override of OBS
+		static constexpr int DEFAULT_DURATION_MS = 300;
+
+		static constexpr std::string_view FOLDER_TRANSITIONS_DATA = "scene_tree_view_folder_transitions";
+		static constexpr std::string_view FOLDER_PATH_DATA = "path";
+		static constexpr std::string_view FOLDER_TRANSITION_DATA = "transition";
+		static constexpr std::string_view FOLDER_DURATION_DATA = "transition_duration";
+
+		struct OVERRIDE
+		{
+			// Name of the transition. Empty if the folder inherits the override of its parent
+			QString Transition;
+			int DurationMs = DEFAULT_DURATION_MS;
+		};
+
+		StvTransitionOverrides(StvItemModel &model);
+		virtual ~StvTransitionOverrides() override;
+
+		OVERRIDE GetFolderOverride(QStandardItem *folder) const;
+		void SetFolderOverride(QStandardItem *folder, const OVERRIDE &folder_override);
+
+		/*!
+		 * \brief Let OBS use the inherited transition of scene_source for the next switch, if the scene has no
+		 * override of its own. Call right before switching to the scene, the override is removed from the scene
+		 * again once control returns to the event loop
+		 */
+		void ApplyOverride(obs_source_t *scene_source);
+
+		/*!
+		 * \brief Make the inherited transition of the studio mode preview scene current, if it has no override of its
+		 * own. Otherwise the previous transition is restored
+		 */
+		void ApplyPreviewOverride(obs_source_t *scene_source);
+
+		/*!
+		 * \brief Duration of the transition to scene_source: That of its own override, the inherited one or the
+		 * duration set by the user
+		 */
+		int GetTransitionDuration(obs_source_t *scene_source);
+
+		/*!
+		 * \brief Restore the transition that was current before ApplyPreviewOverride(), unless the user selected
+		 * another one in the meantime
+		 */
+		void RestoreTransition();
+
+		/*!
+		 * \brief Forget cached transitions after the transition list changed
+		 */
+		void ResetTransitions();
+
+		void Save(obs_data_t *save_data) const;
+
+		/*!
+		 * \brief Read folder overrides of a scene collection. They are matched to folders by ApplyLoadedOverrides(),
+		 * once the tree of the collection is loaded
+		 */
+		void Load(obs_data_t *save_data);
+		void ApplyLoadedOverrides();
+
+	private:
+		StvItemModel &_model;
+
+		// Overrides by folder id
+		std::unordered_map<uint64_t, OVERRIDE> _overrides;
+		OBSDataArrayAutoRelease _loaded_overrides;
+
+		// Folder each scene inherits its override from, 0 if none. Cleared whenever that may have changed
+		std::unordered_map<obs_weak_source_t*, uint64_t> _scene_folders;
+
+		QHash<QString, OBSWeakSource> _transitions;
+
+		// Private settings of a scene before ApplyOverride() wrote the folder override into them
+		struct SCENE_OVERRIDE
+		{
+			OBSWeakSource Scene;
+			bool HasTransition = false;
+			bool HasDuration = false;
+			int DurationMs = 0;
+		};
+
+		std::vector<SCENE_OVERRIDE> _scene_overrides;
+
+		// Transition and duration to restore, set while a preview override is applied
+		OBSWeakSource _restore_transition;
+		int _restore_duration_ms = 0;
+
+		// Preview override that was made current. If the current transition differs, the user changed it
+		OBSWeakSource _applied_transition;
+		int _applied_duration_ms = 0;
+
+		void Invalidate();
+		void ClearSceneOverrides();
+		bool IsPreviewOverrideCurrent() const;
+		uint64_t ResolveFolder(obs_source_t *scene_source);
+		OBSSourceAutoRelease GetTransition(const QString &name);
+};
+
+#endif // STV_TRANSITION_OVERRIDES_H
@@ -0,0 +1,669 @@
+#include "obs_scene_tree_view/stv_tree_store.h"
+
+#include <obs-module.h>
+#include <util/base.h>
+#include <util/platform.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <unordered_set>
+
+
+/*!
+ * \brief Offline tool for scene tree files. Uses the same StvTreeStore as the plugin,
+ * so journals are replayed exactly as on load. Each file is processed on its own worker thread
+ */
+namespace
+{
+	// Must match StvTreeService::SCENE_TREE_JOURNAL_DIR
+	constexpr std::string_view SCENE_TREE_JOURNAL_DIR = "scene_tree_journal";
+
+	constexpr std::string_view OBS_COLLECTION_NAME_DATA = "name";
+	constexpr std::string_view OBS_COLLECTION_SOURCES_DATA = "sources";
+	constexpr std::string_view OBS_SOURCE_ID_DATA = "id";
+	constexpr std::string_view OBS_SCENE_SOURCE_ID = "scene";
+
+	constexpr int64_t SECONDS_PER_DAY = 24*60*60;
+
+	enum EXIT_CODE
+	{	EXIT_OK = 0, EXIT_INVALID = 1, EXIT_USAGE = 2	};
+
+	enum class COMMAND
+	{	VALIDATE, COMPACT, CONVERT	};
+
+	enum class FORMAT
+	{	CURRENT, LEGACY	};
+
+	struct SCENE_LIST
+	{
+		// Empty if the list applies to all collections
+		std::string Collection;
+		std::unordered_set<std::string> Scenes;
+	};
+
+	struct OPTIONS
+	{
+		COMMAND Command = COMMAND::VALIDATE;
+		std::vector<std::string> Files;
+
+		// validate
+		std::vector<SCENE_LIST> SceneLists;
+		std::string Collection;
+		bool Fix = false;
+
+		// compact
+		std::vector<std::string> LiveCollections;
+		bool HasLiveCollections = false;
+		int64_t GracePeriodS = StvTreeStore::ORPHAN_GRACE_PERIOD_S;
+
+		// convert
+		FORMAT Format = FORMAT::CURRENT;
+		bool Pretty = false;
+		std::string OutputDir;
+
+		std::string JournalDir;
+		unsigned int Jobs = 0;
+		bool Verbose = false;
+	};
+
+	struct FILE_RESULT
+	{
+		std::string Report;
+		int Errors = 0;
+		int Warnings = 0;
+
+		uint64_t ParseNs = 0;
+		uint64_t ProcessNs = 0;
+		uint64_t WriteNs = 0;
+	};
+
+	struct VALIDATION
+	{
+		const std::unordered_set<std::string> *Scenes = nullptr;
+		std::unordered_set<std::string> SeenScenes;
+		std::string Prefix;
+		bool Fix = false;
+		FILE_RESULT *Result = nullptr;
+	};
+
+	bool verbose_log = false;
+
+	void print_usage()
+	{
+		fprintf(stderr,
+		        "Usage: %s <command> [options] <scene_tree.json>...\n"
+		        "\n"
+		        "Commands:\n"
+		        "  validate   Check trees for duplicate, unnamed and unknown scenes\n"
+		        "  compact    Mark trees of deleted collections as orphaned and drop expired ones\n"
+		        "  convert    Write trees with their journals folded in to --output-dir\n"
+		        "\n"
+		        "Options:\n"
+		        "  --scenes <file>        validate: Scene names to check against. Either an OBS scene collection\n"
+		        "                         (.json), or a text file with one name per line. May be repeated\n"
+		        "  --collection <name>    validate: Only check this collection. Text scene lists apply to it\n"
+		        "  --fix                  validate: Drop duplicate, unnamed and unknown scenes and save the result\n"
+		        "  --collections <path>   compact: Live collection names. Either the OBS scene collection\n"
+		        "                         directory, or a text file with one name per line\n"
+		        "  --grace-days <days>    compact: Keep orphaned trees this long (default: %d)\n"
+		        "  --format <format>      convert: 'current' (default) or 'legacy' (without schema version)\n"
+		        "  --pretty               convert: Write indented JSON\n"
+		        "  --output-dir <dir>     convert: Directory to write converted files to\n"
+		        "  --journal-dir <dir>    Journal directory (default: '%s' next to each file)\n"
+		        "  -j, --jobs <count>     Number of files processed in parallel (default: number of cores)\n"
+		        "  -v, --verbose          Print notes, per file timings and plugin log messages\n",
+		        obs_module_name(), (int)(StvTreeStore::ORPHAN_GRACE_PERIOD_S/SECONDS_PER_DAY), SCENE_TREE_JOURNAL_DIR.data());
+	}
+
+	void log_handler(int lvl, const char *msg, va_list args, void*)
+	{
+		if(!verbose_log && lvl > LOG_WARNING)
+			return;
+
+		vfprintf(stderr, msg, args);
+		fputc('\n', stderr);
+	}
+
+	double to_ms(uint64_t ns)
+	{
+		return (double)ns/1000000.0;
+	}
+
+	void append_line(std::string &report, const char *format, ...)
+	{
+		va_list args;
+		va_start(args, format);
+
+		char buffer[1024];
+		vsnprintf(buffer, sizeof(buffer), format, args);
+		va_end(args);
+
+		report += buffer;
+		report += '\n';
+	}
+
+	std::string get_file_name(const std::string &file_path)
+	{
+		const size_t separator = file_path.find_last_of("/\\");
+		return separator == std::string::npos ? file_path : file_path.substr(separator + 1);
+	}
+
+	std::string get_journal_dir(const OPTIONS &options, const std::string &file_path)
+	{
+		if(!options.JournalDir.empty())
+			return options.JournalDir;
+
+		const size_t separator = file_path.find_last_of("/\\");
+		const std::string dir = separator == std::string::npos ? std::string(".") : file_path.substr(0, separator);
+		return dir + "/" + SCENE_TREE_JOURNAL_DIR.data();
+	}
+
+	bool read_lines(const char *file_path, std::vector<std::string> &lines)
+	{
+		std::ifstream file(file_path);
+		if(!file)
+			return false;
+
+		std::string line;
+		while(std::getline(file, line))
+		{
+			if(!line.empty() && line.back() == '\r')
+				line.pop_back();
+
+			if(!line.empty())
+				lines.push_back(std::move(line));
+		}
+
+		return true;
+	}
+
+	bool read_obs_collection(const char *file_path, SCENE_LIST &scene_list)
+	{
+		OBSDataAutoRelease collection_data = obs_data_create_from_json_file(file_path);
+		if(!collection_data)
+			return false;
+
+		scene_list.Collection = obs_data_get_string(collection_data, OBS_COLLECTION_NAME_DATA.data());
+
+		OBSDataArrayAutoRelease sources_data = obs_data_get_array(collection_data, OBS_COLLECTION_SOURCES_DATA.data());
+		const size_t source_count = obs_data_array_count(sources_data);
+		for(size_t i=0; i < source_count; ++i)
+		{
+			OBSDataAutoRelease source_data = obs_data_array_item(sources_data, i);
+			if(OBS_SCENE_SOURCE_ID == obs_data_get_string(source_data, OBS_SOURCE_ID_DATA.data()))
+				scene_list.Scenes.emplace(obs_data_get_string(source_data, OBS_COLLECTION_NAME_DATA.data()));
+		}
+
+		return !scene_list.Collection.empty();
+	}
+
+	bool read_scene_list(const char *file_path, const std::string &collection, SCENE_LIST &scene_list)
+	{
+		const size_t length = strlen(file_path);
+		if(length > 5 && strcmp(file_path + length - 5, ".json") == 0)
+			return read_obs_collection(file_path, scene_list);
+
+		std::vector<std::string> scene_names;
+		if(!read_lines(file_path, scene_names))
+			return false;
+
+		scene_list.Collection = collection;
+		scene_list.Scenes.insert(scene_names.begin(), scene_names.end());
+		return true;
+	}
+
+	bool read_live_collections(const char *path, std::vector<std::string> &collections)
+	{
+		os_dir_t *dir = os_opendir(path);
+		if(!dir)
+			return read_lines(path, collections);
+
+		// OBS stores one file per collection, named after the sanitized collection name
+		while(struct os_dirent *entry = os_readdir(dir))
+		{
+			const size_t length = strlen(entry->d_name);
+			if(entry->directory || length <= 5 || strcmp(entry->d_name + length - 5, ".json") != 0)
+				continue;
+
+			SCENE_LIST scene_list;
+			const std::string file_path = std::string(path) + "/" + entry->d_name;
+			if(read_obs_collection(file_path.c_str(), scene_list))
+				collections.push_back(std::move(scene_list.Collection));
+		}
+
+		os_closedir(dir);
+		return true;
+	}
+
+	const SCENE_LIST *find_scene_list(const OPTIONS &options, const std::string &collection)
+	{
+		const SCENE_LIST *fallback = nullptr;
+		for(const auto &scene_list : options.SceneLists)
+		{
+			if(scene_list.Collection == collection)
+				return &scene_list;
+			else if(scene_list.Collection.empty())
+				fallback = &scene_list;
+		}
+
+		return fallback;
+	}
+
+	/*!
+	 * \brief Check the children of folder, recursively
+	 * \return folder with all issues removed if validation.Fix is set and anything was fixed, otherwise folder
+	 */
+	StvTreeNodePtr validate_folder(const StvTreeNodePtr &folder, const std::string &path, VALIDATION &validation)
+	{
+		FILE_RESULT &result = *validation.Result;
+
+		std::unordered_set<std::string> folder_names;
+		std::vector<StvTreeNodePtr> children;
+		children.reserve(folder->Children.size());
+		bool changed = false;
+
+		for(const StvTreeNodePtr &item : folder->Children)
+		{
+			const std::string name = item->Name.toStdString();
+			const std::string item_path = path.empty() ? name : path + "/" + name;
+
+			if(item->IsFolder)
+			{
+				if(name.empty())
+				{
+					append_line(result.Report, "%s: warning: unnamed folder in '%s'", validation.Prefix.c_str(), path.c_str());
+					++result.Warnings;
+				}
+				else if(!folder_names.insert(name).second)
+				{
+					append_line(result.Report, "%s: warning: folder name '%s' used more than once", validation.Prefix.c_str(), item_path.c_str());
+					++result.Warnings;
+				}
+
+				StvTreeNodePtr new_item = validate_folder(item, item_path, validation);
+				changed |= new_item != item;
+				children.push_back(std::move(new_item));
+				continue;
+			}
+
+			bool drop = false;
+			if(name.empty())
+			{
+				append_line(result.Report, "%s: error: unnamed scene in '%s'", validation.Prefix.c_str(), path.c_str());
+				++result.Errors;
+				drop = true;
+			}
+			else if(!validation.SeenScenes.insert(name).second)
+			{
+				// Would be skipped on load (see issue https://github.com/DigitOtter/obs_scene_tree_view/issues/19)
+				append_line(result.Report, "%s: error: duplicate scene '%s'", validation.Prefix.c_str(), item_path.c_str());
+				++result.Errors;
+				drop = true;
+			}
+			else if(validation.Scenes && validation.Scenes->count(name) == 0)
+			{
+				append_line(result.Report, "%s: warning: unknown scene '%s'", validation.Prefix.c_str(), item_path.c_str());
+				++result.Warnings;
+				drop = true;
+			}
+
+			if(drop && validation.Fix)
+				changed = true;
+			else
+				children.push_back(item);
+		}
+
+		if(!changed)
+			return folder;
+
+		auto new_folder = std::make_shared<StvTreeNode>(*folder);
+		new_folder->Children = std::move(children);
+		return new_folder;
+	}
+
+	FILE_RESULT validate_file(const OPTIONS &options, const std::string &file_path, StvTreeStore &store)
+	{
+		FILE_RESULT result;
+
+		uint64_t start = os_gettime_ns();
+		std::vector<std::string> collections = store.GetSceneCollections();
+		if(!options.Collection.empty())
+		{
+			if(std::find(collections.begin(), collections.end(), options.Collection) == collections.end())
+			{
+				append_line(result.Report, "%s: error: no tree for collection '%s'", file_path.c_str(), options.Collection.c_str());
+				++result.Errors;
+			}
+
+			collections = {options.Collection};
+		}
+
+		for(const auto &collection : collections)
+		{
+			start = os_gettime_ns();
+			StvTreeNodePtr tree = store.Read(collection.c_str());
+			result.ParseNs += os_gettime_ns() - start;
+
+			if(!tree)
+				continue;
+
+			start = os_gettime_ns();
+
+			const SCENE_LIST *scene_list = find_scene_list(options, collection);
+
+			VALIDATION validation;
+			validation.Scenes = scene_list ? &scene_list->Scenes : nullptr;
+			validation.Prefix = file_path + ": '" + collection + "'";
+			validation.Fix = options.Fix;
+			validation.Result = &result;
+
+			StvTreeNodePtr fixed_tree = validate_folder(tree, std::string(), validation);
+
+			// Missing scenes are appended by the plugin on load, so they're no issue
+			if(options.Verbose && validation.Scenes)
+			{
+				for(const auto &scene_name : *validation.Scenes)
+				{
+					if(validation.SeenScenes.count(scene_name) == 0)
+						append_line(result.Report, "%s: note: scene '%s' not in tree", validation.Prefix.c_str(), scene_name.c_str());
+				}
+			}
+
+			result.ProcessNs += os_gettime_ns() - start;
+
+			if(fixed_tree != tree)
+			{
+				start = os_gettime_ns();
+				store.Save(collection.c_str(), std::move(fixed_tree));
+				store.Flush();
+				result.WriteNs += os_gettime_ns() - start;
+
+				append_line(result.Report, "%s: fixed", validation.Prefix.c_str());
+			}
+		}
+
+		return result;
+	}
+
+	FILE_RESULT compact_file(const OPTIONS &options, const std::string &file_path, StvTreeStore &store)
+	{
+		FILE_RESULT result;
+
+		const size_t collection_count = store.GetSceneCollections().size();
+
+		const uint64_t start = os_gettime_ns();
+		store.Compact(options.LiveCollections, options.GracePeriodS);
+		store.Flush();
+		result.WriteNs += os_gettime_ns() - start;
+
+		const size_t new_collection_count = store.GetSceneCollections().size();
+		if(new_collection_count != collection_count || options.Verbose)
+		{
+			append_line(result.Report, "%s: %zu of %zu trees kept", file_path.c_str(),
+			            new_collection_count, collection_count);
+		}
+
+		return result;
+	}
+
+	FILE_RESULT convert_file(const OPTIONS &options, const std::string &file_path, StvTreeStore &store)
+	{
+		FILE_RESULT result;
+
+		const std::string output_path = options.OutputDir + "/" + get_file_name(file_path);
+		if(output_path == file_path)
+		{
+			append_line(result.Report, "%s: error: output file is the input file", file_path.c_str());
+			++result.Errors;
+			return result;
+		}
+
+		uint64_t start = os_gettime_ns();
+		OBSDataAutoRelease root = obs_data_create();
+		for(const auto &collection : store.GetSceneCollections())
+		{
+			StvTreeNodePtr tree = store.Read(collection.c_str());
+			if(!tree)
+				continue;
+
+			OBSDataArrayAutoRelease folder_data = StvTreeSnapshot::Serialize(*tree);
+			obs_data_set_array(root, collection.c_str(), folder_data);
+		}
+
+		// Without journals, all checkpoints of the new file start at generation 0
+		if(options.Format == FORMAT::CURRENT)
+			obs_data_set_int(root, StvTreeStore::SCHEMA_VERSION_KEY.data(), StvTreeStore::SCHEMA_VERSION);
+
+		result.ProcessNs += os_gettime_ns() - start;
+
+		start = os_gettime_ns();
+		const bool saved = options.Pretty ?
+		                       obs_data_save_json_pretty_safe(root, output_path.c_str(), "tmp", "bak") :
+		                       obs_data_save_json_safe(root, output_path.c_str(), "tmp", "bak");
+		result.WriteNs += os_gettime_ns() - start;
+
+		if(!saved)
+		{
+			append_line(result.Report, "%s: error: failed to write '%s'", file_path.c_str(), output_path.c_str());
+			++result.Errors;
+		}
+
+		return result;
+	}
+
+	FILE_RESULT process_file(const OPTIONS &options, const std::string &file_path)
+	{
+		const uint64_t start = os_gettime_ns();
+
+		StvTreeStore store(file_path.c_str(), get_journal_dir(options, file_path).c_str());
+		if(!store.Open())
+		{
+			FILE_RESULT result;
+			append_line(result.Report, "%s: error: failed to parse file", file_path.c_str());
+			++result.Errors;
+			return result;
+		}
+
+		const int schema_version = store.GetSchemaVersion();
+		if(schema_version > StvTreeStore::SCHEMA_VERSION)
+		{
+			FILE_RESULT result;
+			append_line(result.Report, "%s: error: schema version %d is newer than supported version %d",
+			            file_path.c_str(), schema_version, StvTreeStore::SCHEMA_VERSION);
+			++result.Errors;
+			return result;
+		}
+
+		const uint64_t parse_ns = os_gettime_ns() - start;
+
+		FILE_RESULT result;
+		switch(options.Command)
+		{
+			case COMMAND::VALIDATE:
+				result = validate_file(options, file_path, store);
+				break;
+			case COMMAND::COMPACT:
+				result = compact_file(options, file_path, store);
+				break;
+			case COMMAND::CONVERT:
+				result = convert_file(options, file_path, store);
+				break;
+		}
+
+		result.ParseNs += parse_ns;
+
+		if(options.Verbose)
+		{
+			append_line(result.Report, "%s: parse %.2f ms, process %.2f ms, write %.2f ms", file_path.c_str(),
+			            to_ms(result.ParseNs), to_ms(result.ProcessNs), to_ms(result.WriteNs));
+		}
+
+		return result;
+	}
+
+	bool parse_options(int argc, char **argv, OPTIONS &options)
+	{
+		if(argc < 2)
+			return false;
+
+		if(strcmp(argv[1], "validate") == 0)
+			options.Command = COMMAND::VALIDATE;
+		else if(strcmp(argv[1], "compact") == 0)
+			options.Command = COMMAND::COMPACT;
+		else if(strcmp(argv[1], "convert") == 0)
+			options.Command = COMMAND::CONVERT;
+		else
+			return false;
+
+		std::vector<const char*> scene_list_files;
+		for(int i = 2; i < argc; ++i)
+		{
+			const char *arg = argv[i];
+			const bool has_value = i + 1 < argc;
+
+			if(strcmp(arg, "--scenes") == 0 && has_value)
+				scene_list_files.push_back(argv[++i]);
+			else if(strcmp(arg, "--collection") == 0 && has_value)
+				options.Collection = argv[++i];
+			else if(strcmp(arg, "--fix") == 0)
+				options.Fix = true;
+			else if(strcmp(arg, "--collections") == 0 && has_value)
+			{
+				const char *path = argv[++i];
+				if(!read_live_collections(path, options.LiveCollections))
+				{
+					fprintf(stderr, "Failed to read collections from '%s'\n", path);
+					return false;
+				}
+
+				options.HasLiveCollections = true;
+			}
+			else if(strcmp(arg, "--grace-days") == 0 && has_value)
+				options.GracePeriodS = strtoll(argv[++i], nullptr, 10)*SECONDS_PER_DAY;
+			else if(strcmp(arg, "--format") == 0 && has_value)
+			{
+				const char *format = argv[++i];
+				if(strcmp(format, "current") == 0)
+					options.Format = FORMAT::CURRENT;
+				else if(strcmp(format, "legacy") == 0)
+					options.Format = FORMAT::LEGACY;
+				else
+					return false;
+			}
+			else if(strcmp(arg, "--pretty") == 0)
+				options.Pretty = true;
+			else if(strcmp(arg, "--output-dir") == 0 && has_value)
+				options.OutputDir = argv[++i];
+			else if(strcmp(arg, "--journal-dir") == 0 && has_value)
+				options.JournalDir = argv[++i];
+			else if((strcmp(arg, "-j") == 0 || strcmp(arg, "--jobs") == 0) && has_value)
+				options.Jobs = (unsigned int)strtoul(argv[++i], nullptr, 10);
+			else if(strcmp(arg, "-v") == 0 || strcmp(arg, "--verbose") == 0)
+				options.Verbose = true;
+			else if(arg[0] == '-')
+				return false;
+			else
+				options.Files.emplace_back(arg);
+		}
+
+		// Text scene lists refer to --collection, so read them once all options are known
+		for(const char *scene_list_file : scene_list_files)
+		{
+			SCENE_LIST scene_list;
+			if(!read_scene_list(scene_list_file, options.Collection, scene_list))
+			{
+				fprintf(stderr, "Failed to read scene list '%s'\n", scene_list_file);
+				return false;
+			}
+
+			options.SceneLists.push_back(std::move(scene_list));
+		}
+
+		if(options.Command == COMMAND::COMPACT && !options.HasLiveCollections)
+		{
+			fprintf(stderr, "compact requires --collections\n");
+			return false;
+		}
+
+		if(options.Command == COMMAND::CONVERT && options.OutputDir.empty())
+		{
+			fprintf(stderr, "convert requires --output-dir\n");
+			return false;
+		}
+
+		if(options.Jobs == 0)
+			options.Jobs = std::max(std::thread::hardware_concurrency(), 1u);
+
+		return !options.Files.empty();
+	}
+}
+
+
+extern "C" const char *obs_module_name(void)
+{
+	return "obs_scene_tree_view";
+}
+
+int main(int argc, char **argv)
+{
+	OPTIONS options;
+	if(!parse_options(argc, argv, options))
+	{
+		print_usage();
+		return EXIT_USAGE;
+	}
+
+	verbose_log = options.Verbose;
+	base_set_log_handler(&log_handler, nullptr);
+
+	if(options.Command == COMMAND::CONVERT && os_mkdirs(options.OutputDir.c_str()) == MKDIR_ERROR)
+	{
+		fprintf(stderr, "Failed to create output dir '%s'\n", options.OutputDir.c_str());
+		return EXIT_USAGE;
+	}
+
+	const uint64_t start = os_gettime_ns();
+
+	// Workers pick the next unprocessed file. Results are printed in input order afterwards
+	std::vector<FILE_RESULT> results(options.Files.size());
+	std::atomic<size_t> next_file = 0;
+	const auto process_files = [&]() {
+		for(size_t i = next_file++; i < options.Files.size(); i = next_file++)
+			results[i] = process_file(options, options.Files[i]);
+	};
+
+	const unsigned int job_count = (unsigned int)std::min<size_t>(options.Jobs, options.Files.size());
+	std::vector<std::thread> workers;
+	for(unsigned int i = 1; i < job_count; ++i)
+		workers.emplace_back(process_files);
+
+	process_files();
+
+	for(auto &worker : workers)
+		worker.join();
+
+	const uint64_t wall_ns = os_gettime_ns() - start;
+
+	int errors = 0;
+	int warnings = 0;
+	uint64_t file_ns = 0;
+	for(const auto &result : results)
+	{
+		fputs(result.Report.c_str(), stdout);
+
+		errors += result.Errors;
+		warnings += result.Warnings;
+		file_ns += result.ParseNs + result.ProcessNs + result.WriteNs;
+	}
+
+	printf("%zu files, %d errors, %d warnings in %.2f ms (%.2f ms summed over %u jobs)\n",
+	       options.Files.size(), errors, warnings, to_ms(wall_ns), to_ms(file_ns), job_count);
+
+	return errors > 0 ? EXIT_INVALID : EXIT_OK;
+}
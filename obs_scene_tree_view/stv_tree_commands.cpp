@@ -0,0 +1,507 @@
+#include "obs_scene_tree_view/stv_tree_commands.h"
+
+#include "obs_scene_tree_view/stv_item_model.h"
+#include "obs_scene_tree_view/stv_tree_publisher.h"
+
+#include <QCollator>
+#include <QCoreApplication>
+#include <QHash>
+#include <QThread>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+
+namespace
+{
+	// Mutable copy of a tree node. Commands are resolved on these, so a rejected batch leaves no trace
+	struct WORK_NODE
+	{
+		QString Name;
+		QString Uuid;
+		bool IsFolder = false;
+		bool IsExpanded = false;
+		bool IsSorted = false;
+		WORK_NODE *Parent = nullptr;
+		std::vector<std::unique_ptr<WORK_NODE>> Children;
+	};
+
+	using scene_index_t = QHash<QString, WORK_NODE*>;
+
+	// Batch handed from a proc caller to the UI thread
+	struct PENDING_APPLY
+	{
+		std::mutex Lock;
+		std::condition_variable Changed;
+
+		bool Started = false;
+		bool Finished = false;
+		bool Cancelled = false;
+
+		bool Success = false;
+		std::string Error;
+	};
+
+	std::unique_ptr<WORK_NODE> create_work_node(const StvTreeNode &node, WORK_NODE *parent, scene_index_t &scenes)
+	{
+		auto work_node = std::make_unique<WORK_NODE>();
+		work_node->Name = node.Name;
+		work_node->Uuid = node.Uuid;
+		work_node->IsFolder = node.IsFolder;
+		work_node->IsExpanded = node.IsExpanded;
+		work_node->IsSorted = node.IsSorted;
+		work_node->Parent = parent;
+
+		if(!node.IsFolder)
+			scenes.insert(node.Name, work_node.get());
+
+		work_node->Children.reserve(node.Children.size());
+		for(const StvTreeNodePtr &child : node.Children)
+			work_node->Children.push_back(create_work_node(*child, work_node.get(), scenes));
+
+		return work_node;
+	}
+
+	StvTreeNodePtr create_snapshot_node(const WORK_NODE &work_node)
+	{
+		auto node = std::make_shared<StvTreeNode>();
+		node->Name = work_node.Name;
+		node->Uuid = work_node.Uuid;
+		node->IsFolder = work_node.IsFolder;
+		node->IsExpanded = work_node.IsExpanded;
+		node->IsSorted = work_node.IsSorted;
+
+		node->Children.reserve(work_node.Children.size());
+		for(const auto &child : work_node.Children)
+			node->Children.push_back(create_snapshot_node(*child));
+
+		return node;
+	}
+
+	int get_row(const WORK_NODE &node)
+	{
+		const auto &siblings = node.Parent->Children;
+		const auto node_it = std::find_if(siblings.begin(), siblings.end(), [&node](const auto &sibling) {
+			return sibling.get() == &node;
+		});
+
+		return (int)(node_it - siblings.begin());
+	}
+
+	std::vector<int> get_path(const WORK_NODE &node)
+	{
+		std::vector<int> path;
+		for(const WORK_NODE *item = &node; item->Parent; item = item->Parent)
+			path.push_back(get_row(*item));
+
+		std::reverse(path.begin(), path.end());
+		return path;
+	}
+
+	bool is_folder_name_used(const WORK_NODE &parent, const QString &name, const WORK_NODE *item_to_skip = nullptr)
+	{
+		return std::any_of(parent.Children.begin(), parent.Children.end(), [&](const auto &child) {
+			return child.get() != item_to_skip && child->IsFolder && child->Name == name;
+		});
+	}
+
+	/*!
+	 * \brief Find the folder at the path stored in command_data under key. A missing path refers to the top level
+	 */
+	WORK_NODE *find_folder(WORK_NODE &root, obs_data_t *command_data, std::string_view key, std::string &error)
+	{
+		OBSDataArrayAutoRelease path_data = obs_data_get_array(command_data, key.data());
+
+		WORK_NODE *folder = &root;
+		const size_t folder_count = obs_data_array_count(path_data);
+		for(size_t i=0; i < folder_count; ++i)
+		{
+			OBSDataAutoRelease folder_data = obs_data_array_item(path_data, i);
+			const QString folder_name = QString::fromUtf8(obs_data_get_string(folder_data, StvTreeCommands::COMMAND_NAME_DATA.data()));
+
+			const auto child_it = std::find_if(folder->Children.begin(), folder->Children.end(), [&folder_name](const auto &child) {
+				return child->IsFolder && child->Name == folder_name;
+			});
+
+			if(child_it == folder->Children.end())
+			{
+				error = "folder '" + folder_name.toStdString() + "' not found";
+				return nullptr;
+			}
+
+			folder = child_it->get();
+		}
+
+		return folder;
+	}
+
+	// Same order as StvItemModel::IsSortedBefore(). Folders are listed before scenes
+	bool is_sorted_before(const WORK_NODE &node, const WORK_NODE &other, const QCollator &collator)
+	{
+		if(node.IsFolder != other.IsFolder)
+			return node.IsFolder;
+
+		return collator.compare(node.Name, other.Name) < 0;
+	}
+
+	/*!
+	 * \brief Row of node in parent, which must not contain node. Sorted folders ignore the requested row,
+	 * same as StvItemModel::GetSortedRow()
+	 */
+	int get_target_row(obs_data_t *command_data, const WORK_NODE &parent, const WORK_NODE &node, const QCollator &collator)
+	{
+		if(parent.IsSorted)
+		{
+			const auto row_it = std::upper_bound(parent.Children.begin(), parent.Children.end(), node, [&collator](const WORK_NODE &node, const auto &child) {
+				return is_sorted_before(node, *child, collator);
+			});
+
+			return (int)(row_it - parent.Children.begin());
+		}
+
+		const int child_count = (int)parent.Children.size();
+		if(!obs_data_has_user_value(command_data, StvTreeCommands::COMMAND_ROW_DATA.data()))
+			return child_count;
+
+		return std::clamp((int)obs_data_get_int(command_data, StvTreeCommands::COMMAND_ROW_DATA.data()), 0, child_count);
+	}
+
+	bool create_folder(WORK_NODE &root, obs_data_t *command_data, const QCollator &collator, std::vector<StvTreeOp> &ops, std::string &error)
+	{
+		WORK_NODE *parent = find_folder(root, command_data, StvTreeCommands::COMMAND_PARENT_DATA, error);
+		if(!parent)
+			return false;
+
+		const QString name = QString::fromUtf8(obs_data_get_string(command_data, StvTreeCommands::COMMAND_NAME_DATA.data()));
+		if(name.isEmpty())
+		{
+			error = "folder name is empty";
+			return false;
+		}
+
+		if(is_folder_name_used(*parent, name))
+		{
+			error = "folder '" + name.toStdString() + "' already exists";
+			return false;
+		}
+
+		auto folder = std::make_unique<WORK_NODE>();
+		folder->Name = name;
+		folder->IsFolder = true;
+		folder->IsExpanded = obs_data_get_bool(command_data, StvTreeCommands::COMMAND_EXPANDED_DATA.data());
+		folder->Parent = parent;
+
+		StvTreeOp op;
+		op.Type = StvTreeOp::INSERT;
+		op.Path = get_path(*parent);
+		op.Row = get_target_row(command_data, *parent, *folder, collator);
+		op.IsFolder = true;
+		op.IsExpanded = folder->IsExpanded;
+		op.Name = name;
+
+		parent->Children.insert(parent->Children.begin() + op.Row, std::move(folder));
+		ops.push_back(std::move(op));
+
+		return true;
+	}
+
+	bool move_item(WORK_NODE &root, const scene_index_t &scenes, obs_data_t *command_data, const QCollator &collator, std::vector<StvTreeOp> &ops, std::string &error)
+	{
+		WORK_NODE *item = nullptr;
+		if(const char *scene_name = obs_data_get_string(command_data, StvTreeCommands::COMMAND_SCENE_DATA.data()); *scene_name)
+		{
+			item = scenes.value(QString::fromUtf8(scene_name), nullptr);
+			if(!item)
+			{
+				error = std::string("scene '") + scene_name + "' not found";
+				return false;
+			}
+		}
+		else
+		{
+			item = find_folder(root, command_data, StvTreeCommands::COMMAND_FOLDER_DATA, error);
+			if(!item)
+				return false;
+			else if(item == &root)
+			{
+				error = "no scene or folder to move given";
+				return false;
+			}
+		}
+
+		WORK_NODE *target = find_folder(root, command_data, StvTreeCommands::COMMAND_TARGET_DATA, error);
+		if(!target)
+			return false;
+
+		// Folders can't be moved into themselves
+		for(const WORK_NODE *ancestor = target; ancestor; ancestor = ancestor->Parent)
+		{
+			if(ancestor == item)
+			{
+				error = "folder '" + item->Name.toStdString() + "' can't be moved into itself";
+				return false;
+			}
+		}
+
+		if(item->IsFolder && is_folder_name_used(*target, item->Name, item))
+		{
+			error = "folder '" + item->Name.toStdString() + "' already exists in target";
+			return false;
+		}
+
+		StvTreeOp op;
+		op.Type = StvTreeOp::MOVE;
+		op.Path = get_path(*item);
+
+		// Target path and row are resolved after the item was taken out, same as for StvTreeSnapshot::Apply()
+		auto &siblings = item->Parent->Children;
+		const auto item_it = siblings.begin() + op.Path.back();
+		std::unique_ptr<WORK_NODE> taken_item = std::move(*item_it);
+		siblings.erase(item_it);
+
+		op.TargetPath = get_path(*target);
+		op.Row = get_target_row(command_data, *target, *taken_item, collator);
+
+		taken_item->Parent = target;
+		target->Children.insert(target->Children.begin() + op.Row, std::move(taken_item));
+		ops.push_back(std::move(op));
+
+		return true;
+	}
+
+	bool rename_folder(WORK_NODE &root, obs_data_t *command_data, const QCollator &collator, std::vector<StvTreeOp> &ops, std::string &error)
+	{
+		WORK_NODE *folder = find_folder(root, command_data, StvTreeCommands::COMMAND_FOLDER_DATA, error);
+		if(!folder)
+			return false;
+		else if(folder == &root)
+		{
+			error = "no folder to rename given";
+			return false;
+		}
+
+		const QString name = QString::fromUtf8(obs_data_get_string(command_data, StvTreeCommands::COMMAND_NAME_DATA.data()));
+		if(name.isEmpty())
+		{
+			error = "folder name is empty";
+			return false;
+		}
+
+		if(is_folder_name_used(*folder->Parent, name, folder))
+		{
+			error = "folder '" + name.toStdString() + "' already exists";
+			return false;
+		}
+
+		folder->Name = name;
+
+		StvTreeOp op;
+		op.Type = StvTreeOp::RENAME;
+		op.Path = get_path(*folder);
+		op.Name = name;
+		ops.push_back(op);
+
+		// Renamed items move to their new row in a sorted folder, same as StvItemModel::RenameItem()
+		WORK_NODE &parent = *folder->Parent;
+		if(parent.IsSorted)
+		{
+			const auto folder_it = parent.Children.begin() + op.Path.back();
+			std::unique_ptr<WORK_NODE> taken_folder = std::move(*folder_it);
+			parent.Children.erase(folder_it);
+
+			const int row = get_target_row(command_data, parent, *taken_folder, collator);
+			parent.Children.insert(parent.Children.begin() + row, std::move(taken_folder));
+
+			if(row != op.Path.back())
+			{
+				StvTreeOp move_op;
+				move_op.Type = StvTreeOp::MOVE;
+				move_op.Path = op.Path;
+				move_op.TargetPath = get_path(parent);
+				move_op.Row = row;
+				ops.push_back(std::move(move_op));
+			}
+		}
+
+		return true;
+	}
+
+	bool set_expanded(WORK_NODE &root, obs_data_t *command_data, std::vector<StvTreeOp> &ops, std::string &error)
+	{
+		WORK_NODE *folder = find_folder(root, command_data, StvTreeCommands::COMMAND_FOLDER_DATA, error);
+		if(!folder)
+			return false;
+		else if(folder == &root)
+		{
+			error = "no folder to expand given";
+			return false;
+		}
+
+		folder->IsExpanded = obs_data_get_bool(command_data, StvTreeCommands::COMMAND_EXPANDED_DATA.data());
+
+		StvTreeOp op;
+		op.Type = StvTreeOp::EXPAND;
+		op.Path = get_path(*folder);
+		op.IsExpanded = folder->IsExpanded;
+		ops.push_back(std::move(op));
+
+		return true;
+	}
+}
+
+
+StvTreeCommands &StvTreeCommands::Get()
+{
+	static StvTreeCommands commands;
+	return commands;
+}
+
+void StvTreeCommands::SetModel(StvItemModel *model)
+{
+	this->_model = model;
+}
+
+void StvTreeCommands::RegisterProcs(proc_handler_t *proc_handler)
+{
+	proc_handler_add(proc_handler, APPLY_COMMANDS_PROC.data(), &StvTreeCommands::proc_apply_commands, this);
+}
+
+bool StvTreeCommands::Resolve(const StvTreeNode &tree, obs_data_array_t *commands, const QCollator &collator, std::vector<StvTreeOp> &ops, StvTreeNodePtr &result, std::string &error)
+{
+	scene_index_t scenes;
+	std::unique_ptr<WORK_NODE> root = create_work_node(tree, nullptr, scenes);
+
+	const size_t command_count = obs_data_array_count(commands);
+	ops.clear();
+	ops.reserve(command_count);
+
+	for(size_t i=0; i < command_count; ++i)
+	{
+		OBSDataAutoRelease command_data = obs_data_array_item(commands, i);
+		const std::string_view type = obs_data_get_string(command_data, COMMAND_TYPE_DATA.data());
+
+		bool valid = false;
+		std::string command_error;
+		if(type == CREATE_FOLDER_COMMAND)
+			valid = create_folder(*root, command_data, collator, ops, command_error);
+		else if(type == MOVE_COMMAND)
+			valid = move_item(*root, scenes, command_data, collator, ops, command_error);
+		else if(type == RENAME_FOLDER_COMMAND)
+			valid = rename_folder(*root, command_data, collator, ops, command_error);
+		else if(type == SET_EXPANDED_COMMAND)
+			valid = set_expanded(*root, command_data, ops, command_error);
+		else if(type == REMOVE_COMMAND)
+			command_error = "items can't be removed by commands";
+		else
+			command_error = "unknown command type '" + std::string(type) + "'";
+
+		if(!valid)
+		{
+			error = "command " + std::to_string(i) + ": " + command_error;
+			return false;
+		}
+	}
+
+	result = create_snapshot_node(*root);
+	return true;
+}
+
+bool StvTreeCommands::Apply(const char *commands_json, std::string &error)
+{
+	if(!this->_model)
+	{
+		error = "no scene tree loaded";
+		return false;
+	}
+
+	OBSDataAutoRelease commands_data = obs_data_create_from_json(commands_json);
+	if(!commands_data)
+	{
+		error = "commands aren't valid JSON";
+		return false;
+	}
+
+	OBSDataArrayAutoRelease commands = obs_data_get_array(commands_data, COMMANDS_DATA.data());
+
+	std::vector<StvTreeOp> ops;
+	StvTreeNodePtr result;
+	if(!StvTreeCommands::Resolve(*this->_model->GetTree(), commands, this->_model->GetCollator(), ops, result, error))
+		return false;
+
+	if(!ops.empty())
+		this->_model->ApplyTreeOps(ops, std::move(result));
+
+	return true;
+}
+
+void StvTreeCommands::proc_apply_commands(void *private_data, calldata_t *data)
+{
+	StvTreeCommands *commands = static_cast<StvTreeCommands*>(private_data);
+	const char *commands_json = calldata_string(data, "commands");
+
+	bool success = false;
+	std::string error;
+
+	// The model may only be changed on the UI thread
+	QCoreApplication *app = QCoreApplication::instance();
+	if(!app)
+		error = "OBS is shutting down";
+	else if(QThread::currentThread() == app->thread())
+	{
+		// Queuing the batch would wait for this very thread, so apply it without waiting
+		success = commands->Apply(commands_json ? commands_json : "", error);
+	}
+	else
+	{
+		// Never block without limit, the UI thread may be waiting for this thread, e.g. during shutdown
+		auto pending = std::make_shared<PENDING_APPLY>();
+		QMetaObject::invokeMethod(app, [commands, pending, commands_json = std::string(commands_json ? commands_json : "")]() {
+			{
+				std::lock_guard lock(pending->Lock);
+				if(pending->Cancelled)
+					return;
+
+				pending->Started = true;
+			}
+			pending->Changed.notify_all();
+
+			std::string apply_error;
+			const bool apply_success = commands->Apply(commands_json.c_str(), apply_error);
+
+			{
+				std::lock_guard lock(pending->Lock);
+				pending->Success = apply_success;
+				pending->Error = std::move(apply_error);
+				pending->Finished = true;
+			}
+			pending->Changed.notify_all();
+		}, Qt::QueuedConnection);
+
+		std::unique_lock lock(pending->Lock);
+		if(!pending->Changed.wait_for(lock, std::chrono::milliseconds(APPLY_TIMEOUT_MS), [&pending]() { return pending->Started; }))
+		{
+			pending->Cancelled = true;
+			error = "UI thread didn't respond, commands weren't applied";
+		}
+		else
+		{
+			// A started batch doesn't wait for other threads, so it always finishes
+			pending->Changed.wait(lock, [&pending]() { return pending->Finished; });
+			success = pending->Success;
+			error = pending->Error;
+		}
+	}
+
+	if(!success)
+		blog(LOG_INFO, "[%s] Rejected tree commands: %s", obs_module_name(), error.c_str());
+
+	uint64_t version;
+	StvTreePublisher::Get().GetTree(&version);
+
+	calldata_set_bool(data, "success", success);
+	calldata_set_string(data, "error", error.c_str());
+	calldata_set_int(data, "version", (long long)version);
+}
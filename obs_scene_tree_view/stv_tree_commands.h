@@ -0,0 +1,100 @@
+#ifndef STV_TREE_COMMANDS_H
+#define STV_TREE_COMMANDS_H
+
+#include <obs.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "obs_scene_tree_view/stv_tree_snapshot.h"
+
+
+class QCollator;
+class StvItemModel;
+
+/*!
+ * \brief Structural tree edits requested by other modules through the global proc handler.
+ * A batch of commands is resolved against a working copy of the tree first. Only if all commands are valid,
+ * the resulting ops are applied to the model as a single layout change and written to the journal together.
+ *
+ * Commands are passed as JSON: {"commands": [{"type": ..., ...}, ...]}. Folders are addressed by their path,
+ * an array of {"name": ...} objects from the top level down, as returned by stv_get_scene_folder:
+ * - create_folder: "name", optional "parent" path, "row" and "expanded"
+ * - move: Either "scene" name or "folder" path, optional "target" folder path and "row"
+ * - rename_folder: "folder" path and new "name"
+ * - set_expanded: "folder" path and "expanded"
+ *
+ * Items can't be removed, "remove" commands are rejected. Scenes are removed by removing their source in OBS, folders
+ * through the dock, which removes the scenes they contain through OBS as well.
+ *
+ * Rows refer to the position in the parent folder after the command was applied. Without a row, items are appended.
+ * Sorted folders place items by name instead
+ */
+class StvTreeCommands
+{
+	public:
+		/*!
+		 * \brief The batch is applied on the UI thread, the call returns once it was applied or rejected.
+		 * Called from the UI thread, the batch is applied directly and the call never waits.
+		 * Called from any other thread, the call blocks: first for up to APPLY_TIMEOUT_MS until the UI thread picks
+		 * the batch up, then for as long as applying it takes. If the UI thread doesn't pick it up in time, the call
+		 * fails and the batch is never applied. Callers that must not block, e.g. the video or audio thread, should
+		 * call this from a worker thread
+		 */
+		static constexpr std::string_view APPLY_COMMANDS_PROC = "void stv_apply_commands(in string commands, out bool success, out string error, out int version)";
+
+		static constexpr int APPLY_TIMEOUT_MS = 2000;
+
+		static constexpr std::string_view COMMANDS_DATA = "commands";
+		static constexpr std::string_view COMMAND_TYPE_DATA = "type";
+		static constexpr std::string_view COMMAND_NAME_DATA = "name";
+		static constexpr std::string_view COMMAND_SCENE_DATA = "scene";
+		static constexpr std::string_view COMMAND_FOLDER_DATA = "folder";
+		static constexpr std::string_view COMMAND_PARENT_DATA = "parent";
+		static constexpr std::string_view COMMAND_TARGET_DATA = "target";
+		static constexpr std::string_view COMMAND_ROW_DATA = "row";
+		static constexpr std::string_view COMMAND_EXPANDED_DATA = "expanded";
+
+		static constexpr std::string_view CREATE_FOLDER_COMMAND = "create_folder";
+		static constexpr std::string_view MOVE_COMMAND = "move";
+		static constexpr std::string_view RENAME_FOLDER_COMMAND = "rename_folder";
+		static constexpr std::string_view SET_EXPANDED_COMMAND = "set_expanded";
+		static constexpr std::string_view REMOVE_COMMAND = "remove";
+
+		static StvTreeCommands &Get();
+
+		StvTreeCommands(const StvTreeCommands&) = delete;
+		StvTreeCommands &operator=(const StvTreeCommands&) = delete;
+
+		/*!
+		 * \brief Set the model commands are applied to. Must be called from the UI thread
+		 */
+		void SetModel(StvItemModel *model);
+
+		/*!
+		 * \brief Add the procs to proc_handler. Procs can't be removed again, so this must only be called once
+		 */
+		void RegisterProcs(proc_handler_t *proc_handler);
+
+		/*!
+		 * \brief Resolve commands against tree without changing it. Items added to, moved into or renamed in a
+		 * sorted folder are placed by collator, requested rows are ignored there
+		 * \param ops Ops that transform tree into result, in the order they must be applied. Never contains
+		 * StvTreeOp::REMOVE
+		 * \return Returns false and sets error if any command is invalid
+		 */
+		static bool Resolve(const StvTreeNode &tree, obs_data_array_t *commands, const QCollator &collator, std::vector<StvTreeOp> &ops, StvTreeNodePtr &result, std::string &error);
+
+	private:
+		// Only accessed from the UI thread
+		StvItemModel *_model = nullptr;
+
+		StvTreeCommands() = default;
+
+		bool Apply(const char *commands_json, std::string &error);
+
+		static void proc_apply_commands(void *private_data, calldata_t *data);
+};
+
+#endif // STV_TREE_COMMANDS_H
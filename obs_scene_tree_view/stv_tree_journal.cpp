@@ -0,0 +1,266 @@
+#include "obs_scene_tree_view/stv_tree_journal.h"
+
+#include <obs-module.h>
+#include <util/crc32.h>
+#include <util/platform.h>
+
+#include <cstdio>
+#include <cstring>
+
+
+namespace
+{
+	template<class T>
+	void write_value(std::string &buffer, T value)
+	{
+		buffer.append((const char*)&value, sizeof(T));
+	}
+
+	template<class T>
+	bool read_value(const char *&data, const char *end, T &value)
+	{
+		if((size_t)(end - data) < sizeof(T))
+			return false;
+
+		memcpy(&value, data, sizeof(T));
+		data += sizeof(T);
+		return true;
+	}
+
+	void write_path(std::string &buffer, const std::vector<int> &path)
+	{
+		write_value<uint16_t>(buffer, (uint16_t)path.size());
+		for(const int row : path)
+			write_value<int32_t>(buffer, row);
+	}
+
+	bool read_path(const char *&data, const char *end, std::vector<int> &path)
+	{
+		uint16_t depth;
+		if(!read_value(data, end, depth))
+			return false;
+
+		path.resize(depth);
+		for(auto &row : path)
+		{
+			int32_t value;
+			if(!read_value(data, end, value))
+				return false;
+
+			row = value;
+		}
+
+		return true;
+	}
+
+	// Collection names may contain characters that aren't valid in file names
+	std::string journal_file_name(const char *scene_collection)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for(const char *c = scene_collection; *c; ++c)
+		{
+			hash ^= (uint8_t)*c;
+			hash *= 1099511628211ull;
+		}
+
+		char name[17];
+		snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash);
+		return name;
+	}
+}
+
+
+StvTreeJournal::StvTreeJournal(const std::string &journal_dir, const char *scene_collection)
+    : _file_path(journal_dir + "/" + journal_file_name(scene_collection) + JOURNAL_FILE_EXTENSION.data())
+{}
+
+const std::string &StvTreeJournal::FilePath() const
+{
+	return this->_file_path;
+}
+
+size_t StvTreeJournal::Size() const
+{
+	return this->_size;
+}
+
+bool StvTreeJournal::Read(uint64_t generation, std::vector<StvTreeOp> &ops)
+{
+	this->_size = 0;
+
+	FILE *file = os_fopen(this->_file_path.c_str(), "rb");
+	if(!file)
+		return false;
+
+	std::string content;
+	char chunk[4096];
+	size_t chunk_size;
+	while((chunk_size = fread(chunk, 1, sizeof(chunk), file)) > 0)
+		content.append(chunk, chunk_size);
+
+	fclose(file);
+
+	const char *data = content.data();
+	const char *end = data + content.size();
+
+	uint64_t file_generation;
+	if((size_t)(end - data) < HEADER_SIZE)
+		return false;
+
+	// Version 1 records are a subset of version 2, but new records must not be appended to the old header
+	const bool is_v1 = memcmp(data, MAGIC_V1, sizeof(MAGIC_V1)) == 0;
+	if(!is_v1 && memcmp(data, MAGIC, sizeof(MAGIC)) != 0)
+		return false;
+
+	// Journals of an older checkpoint were already folded into the current one
+	data += sizeof(MAGIC);
+	read_value(data, end, file_generation);
+	if(file_generation != generation)
+		return false;
+
+	while(data < end)
+	{
+		uint32_t payload_size, crc;
+		const char *record = data;
+		if(!read_value(data, end, payload_size) || !read_value(data, end, crc) ||
+		        (size_t)(end - data) < payload_size)
+			break;
+
+		StvTreeOp op;
+		if(calc_crc32(0, data, payload_size) != crc || !StvTreeJournal::Decode(data, payload_size, op))
+		{
+			data = record;
+			break;
+		}
+
+		ops.push_back(std::move(op));
+		data += payload_size;
+	}
+
+	this->_size = data - content.data();
+	return data == end && !is_v1;
+}
+
+bool StvTreeJournal::Append(const std::vector<StvTreeOp> &ops)
+{
+	// Encode all records first, so they are written with a single call
+	std::string buffer;
+	std::string payload;
+	for(const auto &op : ops)
+	{
+		payload.clear();
+		StvTreeJournal::Encode(op, payload);
+
+		write_value<uint32_t>(buffer, (uint32_t)payload.size());
+		write_value<uint32_t>(buffer, calc_crc32(0, payload.data(), payload.size()));
+		buffer.append(payload);
+	}
+
+	FILE *file = os_fopen(this->_file_path.c_str(), "ab");
+	if(!file)
+	{
+		blog(LOG_WARNING, "[%s] Failed to open scene tree journal '%s'", obs_module_name(), this->_file_path.c_str());
+		return false;
+	}
+
+	const bool success = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+	fflush(file);
+	fclose(file);
+
+	if(success)
+		this->_size += buffer.size();
+	else
+		blog(LOG_WARNING, "[%s] Failed to write scene tree journal '%s'", obs_module_name(), this->_file_path.c_str());
+
+	return success;
+}
+
+bool StvTreeJournal::Reset(uint64_t generation)
+{
+	FILE *file = os_fopen(this->_file_path.c_str(), "wb");
+	if(!file)
+	{
+		blog(LOG_WARNING, "[%s] Failed to create scene tree journal '%s'", obs_module_name(), this->_file_path.c_str());
+		this->_size = 0;
+		return false;
+	}
+
+	std::string header(MAGIC, sizeof(MAGIC));
+	write_value<uint64_t>(header, generation);
+
+	const bool success = fwrite(header.data(), 1, header.size(), file) == header.size();
+	fflush(file);
+	fclose(file);
+
+	this->_size = header.size();
+	return success;
+}
+
+void StvTreeJournal::Remove()
+{
+	if(os_file_exists(this->_file_path.c_str()))
+		os_unlink(this->_file_path.c_str());
+
+	this->_size = 0;
+}
+
+void StvTreeJournal::Encode(const StvTreeOp &op, std::string &buffer)
+{
+	const QByteArray name = op.Name.toUtf8();
+	const QByteArray uuid = op.Uuid.toUtf8();
+
+	// The UUID is optional, so records written before it was added still decode
+	const uint8_t flags = (op.IsFolder ? 1 : 0) | (op.IsExpanded ? 2 : 0) | (op.IsSorted ? 4 : 0) | (!uuid.isEmpty() ? 8 : 0);
+
+	write_value<uint8_t>(buffer, op.Type);
+	write_value<uint8_t>(buffer, flags);
+	write_value<int32_t>(buffer, op.Row);
+	write_path(buffer, op.Path);
+	write_path(buffer, op.TargetPath);
+	if(!uuid.isEmpty())
+	{
+		write_value<uint32_t>(buffer, (uint32_t)uuid.size());
+		buffer.append(uuid.constData(), uuid.size());
+	}
+
+	write_value<uint32_t>(buffer, (uint32_t)name.size());
+	buffer.append(name.constData(), name.size());
+}
+
+bool StvTreeJournal::Decode(const char *data, size_t size, StvTreeOp &op)
+{
+	const char *end = data + size;
+
+	uint8_t type, flags;
+	int32_t row;
+	uint32_t name_size;
+	if(!read_value(data, end, type) || !read_value(data, end, flags) || !read_value(data, end, row) ||
+	        !read_path(data, end, op.Path) || !read_path(data, end, op.TargetPath))
+		return false;
+
+	op.Uuid.clear();
+	if(flags & 8)
+	{
+		uint32_t uuid_size;
+		if(!read_value(data, end, uuid_size) || (size_t)(end - data) < uuid_size)
+			return false;
+
+		op.Uuid = QString::fromUtf8(data, uuid_size);
+		data += uuid_size;
+	}
+
+	if(!read_value(data, end, name_size) || (size_t)(end - data) != name_size)
+		return false;
+
+	if(type < StvTreeOp::INSERT || type > StvTreeOp::SORT)
+		return false;
+
+	op.Type = (StvTreeOp::TYPE)type;
+	op.Row = row;
+	op.IsFolder = flags & 1;
+	op.IsExpanded = flags & 2;
+	op.IsSorted = flags & 4;
+	op.Name = QString::fromUtf8(data, name_size);
+
+	return true;
+}
@@ -0,0 +1,66 @@
+#ifndef STV_TREE_JOURNAL_H
+#define STV_TREE_JOURNAL_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "obs_scene_tree_view/stv_tree_snapshot.h"
+
+
+/*!
+ * \brief Append-only log of tree edits for a single scene collection.
+ * The file starts with a header containing MAGIC and the generation of the checkpoint it belongs to,
+ * followed by records of the form [payload size][crc32 of payload][payload]
+ *
+ * Payloads hold type, flags, row, path, target path and name. Version 2 ("STVJRNL2") adds an optional scene UUID
+ * before the name, marked by flag 8. Version 1 ("STVJRNL1") journals are still replayed, but are never appended to.
+ * They are replaced by a version 2 journal with the next checkpoint
+ */
+class StvTreeJournal
+{
+	public:
+		static constexpr std::string_view JOURNAL_FILE_EXTENSION = ".stvj";
+		// Version 2 records may carry a scene UUID (flag 8), which version 1 readers would misread
+		static constexpr char MAGIC[8] = {'S', 'T', 'V', 'J', 'R', 'N', 'L', '2'};
+
+		// Journals smaller than this are never folded into a new checkpoint
+		static constexpr size_t COMPACTION_THRESHOLD = 64*1024;
+
+		StvTreeJournal() = default;
+		StvTreeJournal(const std::string &journal_dir, const char *scene_collection);
+
+		const std::string &FilePath() const;
+		size_t Size() const;
+
+		/*!
+		 * \brief Read all records that belong to the checkpoint with the given generation.
+		 * Reading stops at the first incomplete or corrupt record
+		 * Version 1 journals are read as well, their records never carry a UUID
+		 * \return Returns false if the file contains stale or unreadable data, or was written by version 1, and must
+		 * be reset before appending
+		 */
+		bool Read(uint64_t generation, std::vector<StvTreeOp> &ops);
+
+		bool Append(const std::vector<StvTreeOp> &ops);
+
+		/*!
+		 * \brief Start a new, empty journal for the checkpoint with the given generation
+		 */
+		bool Reset(uint64_t generation);
+
+		void Remove();
+
+		static void Encode(const StvTreeOp &op, std::string &buffer);
+		static bool Decode(const char *data, size_t size, StvTreeOp &op);
+
+	private:
+		static constexpr char MAGIC_V1[8] = {'S', 'T', 'V', 'J', 'R', 'N', 'L', '1'};
+		static constexpr size_t HEADER_SIZE = sizeof(MAGIC) + sizeof(uint64_t);
+
+		std::string _file_path;
+		size_t _size = 0;
+};
+
+#endif // STV_TREE_JOURNAL_H
@@ -0,0 +1,165 @@
+#include "obs_scene_tree_view/stv_tree_publisher.h"
+
+#include <obs.hpp>
+
+#include <algorithm>
+
+
+StvTreePublisher &StvTreePublisher::Get()
+{
+	static StvTreePublisher publisher;
+	return publisher;
+}
+
+StvTreePublisher::StvTreePublisher()
+    : _tree(StvTreeSnapshot::Deserialize(nullptr))
+{}
+
+void StvTreePublisher::Publish(StvTreeNodePtr tree)
+{
+	{
+		std::lock_guard lock(this->_lock);
+		this->_tree.swap(tree);
+		++this->_version;
+	}
+
+	// tree now holds the previous snapshot. Release it outside the lock
+}
+
+StvTreeNodePtr StvTreePublisher::GetTree(uint64_t *version) const
+{
+	std::lock_guard lock(this->_lock);
+	if(version)
+		*version = this->_version;
+
+	return this->_tree;
+}
+
+void StvTreePublisher::RegisterProcs(proc_handler_t *proc_handler)
+{
+	proc_handler_add(proc_handler, GET_TREE_PROC.data(), &StvTreePublisher::proc_get_tree, this);
+	proc_handler_add(proc_handler, GET_FOLDER_PROC.data(), &StvTreePublisher::proc_get_folder, this);
+	proc_handler_add(proc_handler, GET_SCENE_FOLDER_PROC.data(), &StvTreePublisher::proc_get_scene_folder, this);
+}
+
+StvTreeNodePtr StvTreePublisher::FindFolder(const StvTreeNodePtr &root, const std::vector<QString> &folder_path)
+{
+	StvTreeNodePtr folder = root;
+	for(const QString &folder_name : folder_path)
+	{
+		// Folder names are unique within their parent
+		const auto child_it = std::find_if(folder->Children.begin(), folder->Children.end(), [&folder_name](const StvTreeNodePtr &child) {
+			return child->IsFolder && child->Name == folder_name;
+		});
+
+		if(child_it == folder->Children.end())
+			return nullptr;
+
+		folder = *child_it;
+	}
+
+	return folder;
+}
+
+bool StvTreePublisher::FindSceneFolder(const StvTreeNode &folder, const QString &scene_name, std::vector<QString> &folder_path)
+{
+	for(const StvTreeNodePtr &child : folder.Children)
+	{
+		if(!child->IsFolder)
+		{
+			if(child->Name == scene_name)
+				return true;
+
+			continue;
+		}
+
+		folder_path.push_back(child->Name);
+		if(StvTreePublisher::FindSceneFolder(*child, scene_name, folder_path))
+			return true;
+
+		folder_path.pop_back();
+	}
+
+	return false;
+}
+
+void StvTreePublisher::proc_get_tree(void *private_data, calldata_t *data)
+{
+	uint64_t version;
+	const StvTreeNodePtr tree = static_cast<StvTreePublisher*>(private_data)->GetTree(&version);
+
+	OBSDataAutoRelease tree_data = obs_data_create();
+	OBSDataArrayAutoRelease folder_data = StvTreeSnapshot::SerializeFolder(*tree);
+	obs_data_set_array(tree_data, TREE_DATA.data(), folder_data);
+
+	calldata_set_string(data, "tree", obs_data_get_json(tree_data));
+	calldata_set_int(data, "version", (long long)version);
+}
+
+void StvTreePublisher::proc_get_folder(void *private_data, calldata_t *data)
+{
+	uint64_t version;
+	const StvTreeNodePtr tree = static_cast<StvTreePublisher*>(private_data)->GetTree(&version);
+	calldata_set_int(data, "version", (long long)version);
+
+	std::vector<QString> folder_path;
+	if(const char *path_json = calldata_string(data, "path"); path_json && *path_json)
+	{
+		OBSDataAutoRelease path_data = obs_data_create_from_json(path_json);
+		OBSDataArrayAutoRelease path_array = obs_data_get_array(path_data, PATH_DATA.data());
+
+		const size_t folder_count = obs_data_array_count(path_array);
+		for(size_t i=0; i < folder_count; ++i)
+		{
+			OBSDataAutoRelease folder_data = obs_data_array_item(path_array, i);
+			folder_path.push_back(QString::fromUtf8(obs_data_get_string(folder_data, StvTreeSnapshot::SCENE_TREE_CONFIG_ITEM_NAME_DATA.data())));
+		}
+	}
+
+	const StvTreeNodePtr folder = StvTreePublisher::FindFolder(tree, folder_path);
+	calldata_set_bool(data, "found", folder != nullptr);
+	if(!folder)
+		return;
+
+	OBSDataArrayAutoRelease children_array = obs_data_array_create();
+	for(const StvTreeNodePtr &child : folder->Children)
+	{
+		OBSDataAutoRelease child_data = obs_data_create();
+		obs_data_set_string(child_data, StvTreeSnapshot::SCENE_TREE_CONFIG_ITEM_NAME_DATA.data(), child->Name.toUtf8().constData());
+		obs_data_set_bool(child_data, IS_FOLDER_DATA.data(), child->IsFolder);
+
+		obs_data_array_push_back(children_array, child_data);
+	}
+
+	OBSDataAutoRelease children_data = obs_data_create();
+	obs_data_set_array(children_data, CHILDREN_DATA.data(), children_array);
+	calldata_set_string(data, "children", obs_data_get_json(children_data));
+}
+
+void StvTreePublisher::proc_get_scene_folder(void *private_data, calldata_t *data)
+{
+	uint64_t version;
+	const StvTreeNodePtr tree = static_cast<StvTreePublisher*>(private_data)->GetTree(&version);
+	calldata_set_int(data, "version", (long long)version);
+
+	const char *scene_name = calldata_string(data, "scene");
+
+	std::vector<QString> folder_path;
+	const bool found = scene_name && StvTreePublisher::FindSceneFolder(*tree, QString::fromUtf8(scene_name), folder_path);
+	calldata_set_bool(data, "found", found);
+	if(!found)
+		return;
+
+	OBSDataArrayAutoRelease path_array = obs_data_array_create();
+	for(const QString &folder_name : folder_path)
+	{
+		OBSDataAutoRelease folder_data = obs_data_create();
+		obs_data_set_string(folder_data, StvTreeSnapshot::SCENE_TREE_CONFIG_ITEM_NAME_DATA.data(), folder_name.toUtf8().constData());
+
+		obs_data_array_push_back(path_array, folder_data);
+	}
+
+	OBSDataAutoRelease path_data = obs_data_create();
+	obs_data_set_array(path_data, PATH_DATA.data(), path_array);
+	calldata_set_string(data, "path", obs_data_get_json(path_data));
+}
@@ -0,0 +1,89 @@
+#ifndef STV_TREE_PUBLISHER_H
+#define STV_TREE_PUBLISHER_H
+
+#include <obs.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include "obs_scene_tree_view/stv_tree_snapshot.h"
+
+
+/*!
+ * \brief Makes the current scene tree readable from any thread. The UI thread publishes a new immutable snapshot
+ * after each committed edit, readers keep using the snapshot they loaded for as long as they hold it.
+ * Since snapshots share all unchanged nodes, publishing an edit only copies the edited path.
+ *
+ * The snapshot is exposed to other modules through the global proc handler. All tree data is passed as JSON in
+ * the format of the scene tree file, folder paths are arrays of {"name": ...} objects
+ */
+class StvTreePublisher
+{
+	public:
+		/*!
+		 * \brief tree: {"tree": [...]}, version: Incremented with every published snapshot
+		 */
+		static constexpr std::string_view GET_TREE_PROC = "void stv_get_tree(out string tree, out int version)";
+
+		/*!
+		 * \brief path: {"path": [...]} as returned by stv_get_scene_folder, or empty for the top level.
+		 * children: {"children": [{"name": ..., "is_folder": ...}, ...]}
+		 */
+		static constexpr std::string_view GET_FOLDER_PROC = "void stv_get_folder(in string path, out string children, out bool found, out int version)";
+
+		/*!
+		 * \brief path: {"path": [...]} of the folder containing scene, empty if scene is at the top level
+		 */
+		static constexpr std::string_view GET_SCENE_FOLDER_PROC = "void stv_get_scene_folder(in string scene, out string path, out bool found, out int version)";
+
+		static constexpr std::string_view TREE_DATA = "tree";
+		static constexpr std::string_view CHILDREN_DATA = "children";
+		static constexpr std::string_view PATH_DATA = "path";
+		static constexpr std::string_view IS_FOLDER_DATA = "is_folder";
+
+		static StvTreePublisher &Get();
+
+		StvTreePublisher(const StvTreePublisher&) = delete;
+		StvTreePublisher &operator=(const StvTreePublisher&) = delete;
+
+		/*!
+		 * \brief Replace the current snapshot. Readers that already loaded the previous snapshot are unaffected
+		 */
+		void Publish(StvTreeNodePtr tree);
+
+		/*!
+		 * \brief Get the current snapshot and its version. Never blocks on the UI thread
+		 */
+		StvTreeNodePtr GetTree(uint64_t *version = nullptr) const;
+
+		/*!
+		 * \brief Add the procs to proc_handler. Procs can't be removed again, so this must only be called once
+		 */
+		void RegisterProcs(proc_handler_t *proc_handler);
+
+		static StvTreeNodePtr FindFolder(const StvTreeNodePtr &root, const std::vector<QString> &folder_path);
+
+		/*!
+		 * \brief Find the folder containing the scene named scene_name
+		 * \param folder_path Names of all folders from the top level down to the containing folder
+		 */
+		static bool FindSceneFolder(const StvTreeNode &folder, const QString &scene_name, std::vector<QString> &folder_path);
+
+	private:
+		// Tree and version are swapped together, so readers always see a matching pair. Only held while
+		// copying the pointer, never while a tree is built or released
+		mutable std::mutex _lock;
+		StvTreeNodePtr _tree;
+		uint64_t _version = 0;
+
+		StvTreePublisher();
+
+		static void proc_get_tree(void *private_data, calldata_t *data);
+		static void proc_get_folder(void *private_data, calldata_t *data);
+		static void proc_get_scene_folder(void *private_data, calldata_t *data);
+};
+
+#endif // STV_TREE_PUBLISHER_H
@@ -0,0 +1,551 @@
+#include "obs_scene_tree_view/stv_tree_service.h"
+
+#include "obs_scene_tree_view/obs_scene_tree_view.h"
+#include "obs_scene_tree_view/stv_stats.h"
+#include "obs_scene_tree_view/stv_tree_commands.h"
+
+#include <obs-module.h>
+#include <util/config-file.h>
+
+#include <QElapsedTimer>
+#include <QStringList>
+
+#include <algorithm>
+#include <ctime>
+
+
+namespace
+{
+	// Name of canvas in the tree store and in the settings of other canvases
+	std::string get_canvas_name(const StvItemModel::SCENE_SIZE_T &canvas)
+	{
+		return std::to_string(canvas.cx) + "x" + std::to_string(canvas.cy);
+	}
+}
+
+
+StvTreeService *StvTreeService::_service = nullptr;
+
+StvTreeService &StvTreeService::Create(QMainWindow *main_window)
+{
+	assert(!StvTreeService::_service);
+	StvTreeService::_service = new StvTreeService(main_window);
+	return *StvTreeService::_service;
+}
+
+StvTreeService &StvTreeService::Get()
+{
+	assert(StvTreeService::_service);
+	return *StvTreeService::_service;
+}
+
+StvTreeService::StvTreeService(QMainWindow *main_window)
+    : QObject(main_window),
+      _main_window(main_window),
+      _scene_hotkeys(_scene_tree_items),
+      _transition_overrides(_scene_tree_items),
+      _folder_playlist(_scene_tree_items, _transition_overrides),
+      _tree_stream(_scene_tree_items),
+      _scene_order_sync(_scene_tree_items, main_window),
+      _tree_store(BPtr<char>(obs_module_config_path(SCENE_TREE_CONFIG_FILE.data())),
+                  BPtr<char>(obs_module_config_path(SCENE_TREE_JOURNAL_DIR.data())))
+{
+	config_t *const global_config = obs_frontend_get_global_config();
+	config_set_default_int(global_config, "SceneTreeView", "UndoMemoryLimitKB", StvUndoStack::DEFAULT_MEMORY_LIMIT/1024);
+	config_set_default_string(global_config, "SceneTreeView", "ExtraDocks", "");
+	config_set_default_string(global_config, "SceneTreeView", StvTreeStream::SOCKET_NAME_CONFIG.data(), "");
+
+	this->_scene_tree_items.SetUndoMemoryLimit((size_t)config_get_int(global_config, "SceneTreeView", "UndoMemoryLimitKB")*1024);
+
+	// Add callback to obs scene list change event
+	obs_frontend_add_event_callback(&StvTreeService::obs_frontend_event_cb, this);
+	obs_frontend_add_save_callback(&StvTreeService::obs_frontend_save_cb, this);
+
+	signal_handler_connect(obs_get_signal_handler(), "source_rename", &StvTreeService::obs_source_rename_cb, this);
+
+	QObject::connect(&this->_scene_tree_items, &StvItemModel::TreeEdited, this, &StvTreeService::OnTreeEdited);
+	QObject::connect(&this->_scene_tree_items, &StvItemModel::SceneCanvasChanged, this, [this]() {
+		this->UpdateTree();
+		this->UpdateRecentScenes();
+	});
+	QObject::connect(&this->_scene_tree_items, &StvItemModel::SceneSwitching,
+	                 &this->_transition_overrides, &StvTransitionOverrides::ApplyOverride);
+
+	QObject::connect(&this->_scene_tree_items, &StvItemModel::TreeEdited, &this->_tree_stream, &StvTreeStream::SendTreeEdit);
+	QObject::connect(this, &StvTreeService::TreeLoaded, &this->_tree_stream, &StvTreeStream::SendSnapshots);
+	QObject::connect(this, &StvTreeService::TreeLoaded, &this->_scene_order_sync, &StvSceneOrderSync::ScheduleSync);
+
+	StvTreeCommands::Get().SetModel(&this->_scene_tree_items);
+}
+
+StvTreeService::~StvTreeService()
+{
+	StvTreeCommands::Get().SetModel(nullptr);
+
+	signal_handler_disconnect(obs_get_signal_handler(), "source_rename", &StvTreeService::obs_source_rename_cb, this);
+
+	// Remove frontend cb
+	obs_frontend_remove_save_callback(&StvTreeService::obs_frontend_save_cb, this);
+	obs_frontend_remove_event_callback(&StvTreeService::obs_frontend_event_cb, this);
+
+	StvTreeService::_service = nullptr;
+}
+
+StvItemModel &StvTreeService::GetModel()
+{
+	return this->_scene_tree_items;
+}
+
+StvRecentModel &StvTreeService::GetRecentModel()
+{
+	return this->_recent_scenes_model;
+}
+
+StvFolderPlaylist &StvTreeService::GetFolderPlaylist()
+{
+	return this->_folder_playlist;
+}
+
+StvTransitionOverrides &StvTreeService::GetTransitionOverrides()
+{
+	return this->_transition_overrides;
+}
+
+StvSceneOrderSync &StvTreeService::GetSceneOrderSync()
+{
+	return this->_scene_order_sync;
+}
+
+bool StvTreeService::IsLoaded() const
+{
+	return this->_loaded;
+}
+
+void StvTreeService::SetInsertIndex(const QModelIndex &index)
+{
+	this->_insert_index = index;
+}
+
+void StvTreeService::CreateDocks()
+{
+	this->AddDock(PRIMARY_DOCK_ID);
+
+	const QStringList dock_ids = QString::fromUtf8(config_get_string(obs_frontend_get_global_config(), "SceneTreeView", "ExtraDocks"))
+	                                 .split(' ', Qt::SkipEmptyParts);
+	for(const QString &dock_id : dock_ids)
+	{
+		bool valid;
+		const int id = dock_id.toInt(&valid);
+		if(!valid || id == PRIMARY_DOCK_ID ||
+		        std::find(this->_extra_dock_ids.begin(), this->_extra_dock_ids.end(), id) != this->_extra_dock_ids.end())
+			continue;
+
+		this->_extra_dock_ids.push_back(id);
+		this->AddDock(id);
+	}
+}
+
+void StvTreeService::AddDock()
+{
+	const int dock_id = this->_extra_dock_ids.empty() ? PRIMARY_DOCK_ID+1 :
+	                                                    *std::max_element(this->_extra_dock_ids.begin(), this->_extra_dock_ids.end())+1;
+
+	this->_extra_dock_ids.push_back(dock_id);
+	this->SaveDockIds();
+
+	this->AddDock(dock_id);
+}
+
+void StvTreeService::RemoveDock(ObsSceneTreeView *dock)
+{
+	const auto id_it = std::find(this->_extra_dock_ids.begin(), this->_extra_dock_ids.end(), dock->GetDockId());
+	if(id_it == this->_extra_dock_ids.end())
+		return;
+
+	this->_extra_dock_ids.erase(id_it);
+	this->SaveDockIds();
+
+	// A dock added later can reuse the id, it shouldn't inherit the root folder or expanded folders
+	const QString root_config_name = QString(ObsSceneTreeView::ROOT_FOLDER_CONFIG.data()).arg(dock->GetDockId());
+	config_remove_value(obs_frontend_get_global_config(), "SceneTreeView", root_config_name.toUtf8().constData());
+
+	const QString expanded_config_name = QString(ObsSceneTreeView::EXPANDED_FOLDERS_CONFIG.data()).arg(dock->GetDockId());
+	config_remove_value(obs_frontend_get_global_config(), "SceneTreeView", expanded_config_name.toUtf8().constData());
+
+	// Deleting the dock also removes its toggle action from the docks menu
+	dock->hide();
+	dock->deleteLater();
+}
+
+void StvTreeService::UpdateRecentScenes()
+{
+	std::vector<QString> scene_names;
+	if(config_get_bool(obs_frontend_get_global_config(), "SceneTreeView", "ShowRecentScenes"))
+	{
+		auto add_scenes = [this, &scene_names](const std::vector<std::string> &names) {
+			for(const auto &name : names)
+			{
+				// Skip scenes that were removed or aren't part of the tree
+				OBSSourceAutoRelease source = obs_get_source_by_name(name.c_str());
+				if(this->_scene_tree_items.GetSceneItem(source))
+					scene_names.push_back(QString::fromUtf8(name.c_str()));
+			}
+		};
+
+		add_scenes(this->_recent_scenes.GetRecent(RECENT_SCENE_COUNT));
+		add_scenes(this->_recent_scenes.GetMostUsed(MOST_USED_SCENE_COUNT, time(nullptr), RECENT_SCENE_COUNT));
+	}
+
+	this->_recent_scenes_model.SetScenes(std::move(scene_names));
+
+	emit this->RecentScenesChanged();
+}
+
+void StvTreeService::AddDock(int dock_id)
+{
+	obs_frontend_push_ui_translation(obs_module_get_string);
+	ObsSceneTreeView *dock = new ObsSceneTreeView(this->_main_window, dock_id);
+	obs_frontend_add_dock(dock);
+	obs_frontend_pop_ui_translation();
+
+	if(dock_id != PRIMARY_DOCK_ID && this->_loaded)
+		dock->show();
+}
+
+void StvTreeService::SaveDockIds()
+{
+	QStringList dock_ids;
+	for(const int dock_id : this->_extra_dock_ids)
+		dock_ids.push_back(QString::number(dock_id));
+
+	config_set_string(obs_frontend_get_global_config(), "SceneTreeView", "ExtraDocks", dock_ids.join(' ').toUtf8().constData());
+}
+
+void StvTreeService::SetCanvas(StvItemModel::SCENE_SIZE_T canvas)
+{
+	const StvItemModel::SCENE_SIZE_T prev_canvas = this->_scene_tree_items.GetCanvas();
+	if(canvas == prev_canvas || !this->_scene_collection_name)
+		return;
+
+	// Edits made so far belong to the tree of the previous canvas
+	this->FlushTreeEdits();
+
+	// Its folders are gone, keep their settings for switching back. A running playlist keeps switching its scenes
+	if(this->_folder_playlist.Detach())
+		this->_playlist_canvas = prev_canvas;
+
+	this->_transition_overrides.RestoreTransition();
+
+	OBSDataAutoRelease prev_settings = obs_data_create();
+	this->_folder_playlist.Save(prev_settings);
+	this->_transition_overrides.Save(prev_settings);
+	obs_data_set_obj(this->_canvas_settings, get_canvas_name(prev_canvas).c_str(), prev_settings);
+
+	this->_scene_tree_items.SetCanvas(canvas);
+	this->LoadSceneTree(this->_scene_collection_name);
+	this->ReconcileSceneTree();
+
+	OBSDataAutoRelease settings = obs_data_get_obj(this->_canvas_settings, get_canvas_name(canvas).c_str());
+	obs_data_erase(this->_canvas_settings, get_canvas_name(canvas).c_str());
+
+	this->_folder_playlist.Load(settings);
+	this->_transition_overrides.Load(settings);
+	this->_folder_playlist.ApplyLoadedSettings();
+	this->_transition_overrides.ApplyLoadedOverrides();
+
+	if(this->_folder_playlist.IsDetached() && canvas == this->_playlist_canvas)
+		this->_folder_playlist.Attach();
+
+	emit this->TreeLoaded();
+
+	this->UpdateRecentScenes();
+
+	blog(LOG_INFO, "[%s] Showing scene tree of canvas %s", obs_module_name(), get_canvas_name(canvas).c_str());
+}
+
+std::string StvTreeService::GetTreeName(const char *scene_collection) const
+{
+	const StvItemModel::SCENE_SIZE_T canvas = this->_scene_tree_items.GetCanvas();
+	return StvTreeStore::GetCanvasTreeName(scene_collection,
+	                                       canvas == StvItemModel::BASE_CANVAS ? std::string() : get_canvas_name(canvas));
+}
+
+void StvTreeService::SaveSceneTree(const char *scene_collection)
+{
+	if(!scene_collection)
+		return;
+
+	// Pending edits are part of the snapshot
+	this->_pending_tree_edits.clear();
+
+	// Only the snapshot is taken on the UI thread. Serialization and file I/O run in the background
+	this->_tree_store.Save(this->GetTreeName(scene_collection).c_str(), this->_scene_tree_items.CreateSnapshot());
+}
+
+void StvTreeService::LoadSceneTree(const char *scene_collection)
+{
+	assert(scene_collection);
+
+	this->_scene_tree_items.LoadSceneTree(this->_tree_store.Load(this->GetTreeName(scene_collection).c_str()));
+}
+
+bool StvTreeService::ReconcileSceneTree()
+{
+	obs_frontend_source_list scene_list = {};
+	obs_frontend_get_scenes(&scene_list);
+
+	// Usually the stored tree matches the scene list. Skip the full comparison and the write then
+	const bool reconcile = !this->_scene_tree_items.IsLoadedTreeComplete(scene_list);
+	if(reconcile)
+	{
+		// Add any missing items that weren't saved
+		this->_scene_tree_items.UpdateTree(scene_list, this->_insert_index);
+
+		// Start a new checkpoint, so following edits are journaled relative to the reconciled tree
+		this->SaveSceneTree(this->_scene_collection_name);
+	}
+
+	obs_frontend_source_list_free(&scene_list);
+
+	return reconcile;
+}
+
+void StvTreeService::CompactTreeStore()
+{
+	std::vector<std::string> scene_collections;
+
+	char **names = obs_frontend_get_scene_collections();
+	for(char **name = names; name && *name; ++name)
+		scene_collections.emplace_back(*name);
+
+	bfree(names);
+
+	this->_tree_store.Compact(std::move(scene_collections));
+}
+
+void StvTreeService::FlushTreeEdits()
+{
+	if(this->_pending_tree_edits.empty())
+		return;
+
+	if(this->_scene_collection_name)
+		this->_tree_store.Append(this->GetTreeName(this->_scene_collection_name).c_str(), std::move(this->_pending_tree_edits));
+
+	this->_pending_tree_edits.clear();
+}
+
+void StvTreeService::UpdateTree()
+{
+	obs_frontend_source_list scene_list = {};
+	obs_frontend_get_scenes(&scene_list);
+
+	this->_scene_tree_items.UpdateTree(scene_list, this->_insert_index);
+
+	obs_frontend_source_list_free(&scene_list);
+}
+
+void StvTreeService::RecordSceneActivation(obs_source_t *scene_source)
+{
+	if(!scene_source || !this->_scene_tree_items.GetSceneItem(scene_source))
+		return;
+
+	if(this->_recent_scenes.Activate(obs_source_get_name(scene_source), time(nullptr)))
+		this->UpdateRecentScenes();
+}
+
+void StvTreeService::OnTreeEdited(const StvTreeOp &op)
+{
+	// Collect all edits of this event loop iteration and write them together
+	if(this->_pending_tree_edits.empty())
+		QMetaObject::invokeMethod(this, &StvTreeService::FlushTreeEdits, Qt::QueuedConnection);
+
+	this->_pending_tree_edits.push_back(op);
+}
+
+void StvTreeService::obs_source_rename_cb(void *private_data, calldata_t *data)
+{
+	StvTreeService *service = (StvTreeService*)private_data;
+	std::string old_name = calldata_string(data, "prev_name");
+	std::string new_name = calldata_string(data, "new_name");
+
+	QMetaObject::invokeMethod(service, [service, old_name = std::move(old_name), new_name = std::move(new_name)]() {
+		service->_recent_scenes.Rename(old_name, new_name);
+		service->UpdateRecentScenes();
+	}, Qt::QueuedConnection);
+}
+
+void StvTreeService::ObsFrontendEvent(enum obs_frontend_event event)
+{
+	// Update the tree when scene list was changed
+	if(event == OBS_FRONTEND_EVENT_FINISHED_LOADING)
+	{
+		this->_scene_collection_name = obs_frontend_get_current_scene_collection();
+
+		QElapsedTimer timer;
+		timer.start();
+
+		this->LoadSceneTree(this->_scene_collection_name);
+		const int64_t load_time_ns = timer.nsecsElapsed();
+
+		const bool reconcile_skipped = !this->ReconcileSceneTree();
+		StvStats::Get().RecordTreeLoad(load_time_ns, timer.nsecsElapsed() - load_time_ns, reconcile_skipped);
+		StvStats::Get().LogStartup();
+
+		this->_loaded = true;
+
+		this->_folder_playlist.ApplyLoadedSettings();
+		this->_transition_overrides.ApplyLoadedOverrides();
+		emit this->TreeLoaded();
+		emit this->FinishedLoading();
+
+		this->_tree_stream.Start();
+
+		this->UpdateRecentScenes();
+
+		// Drop trees of deleted collections in the background. Only writes the file if a collection was deleted,
+		// reappeared or its grace period passed, or if the file is from an older version
+		this->CompactTreeStore();
+	}
+	else if(event == OBS_FRONTEND_EVENT_SCENE_LIST_CHANGED)
+	{
+		// Reordering OBS' scene list to the tree order doesn't change the tree
+		if(this->_scene_order_sync.IsSyncing())
+			return;
+
+		this->UpdateTree();
+		this->UpdateRecentScenes();
+	}
+	else if(event == OBS_FRONTEND_EVENT_SCENE_CHANGED || event == OBS_FRONTEND_EVENT_PREVIEW_SCENE_CHANGED)
+	{
+		this->_scene_tree_items.UpdateActiveScenes();
+		this->_tree_stream.SendActiveScenes();
+		emit this->CurrentSceneChanged();
+
+		const bool is_preview = event == OBS_FRONTEND_EVENT_PREVIEW_SCENE_CHANGED;
+		if(!is_preview || obs_frontend_preview_program_mode_active())
+		{
+			OBSSourceAutoRelease scene = is_preview ? obs_frontend_get_current_preview_scene() : obs_frontend_get_current_scene();
+			this->RecordSceneActivation(scene);
+
+			// In studio mode OBS switches to the preview scene, however it was selected
+			if(is_preview)
+				this->_transition_overrides.ApplyPreviewOverride(scene);
+		}
+	}
+	else if(event == OBS_FRONTEND_EVENT_SCENE_COLLECTION_CLEANUP)
+	{
+		this->FlushTreeEdits();
+		this->_folder_playlist.Stop();
+		this->_transition_overrides.RestoreTransition();
+
+		this->_recent_scenes.Clear();
+		this->_recent_scenes_model.SetScenes({});
+		emit this->RecentScenesChanged();
+
+		this->_scene_tree_items.CleanupSceneTree();
+		this->_scene_collection_name = nullptr;
+
+		// The next collection starts with its base canvas
+		this->_scene_tree_items.SetCanvas(StvItemModel::BASE_CANVAS);
+	}
+	else if(event == OBS_FRONTEND_EVENT_SCENE_COLLECTION_CHANGING)
+		this->FlushTreeEdits();
+	else if(event == OBS_FRONTEND_EVENT_SCENE_COLLECTION_CHANGED)
+	{
+		this->_scene_collection_name = obs_frontend_get_current_scene_collection();
+		this->LoadSceneTree(this->_scene_collection_name);
+		this->ReconcileSceneTree();
+
+		this->_folder_playlist.ApplyLoadedSettings();
+		this->_transition_overrides.ApplyLoadedOverrides();
+		emit this->TreeLoaded();
+
+		this->UpdateRecentScenes();
+	}
+	else if(event == OBS_FRONTEND_EVENT_SCENE_COLLECTION_RENAMED)
+	{
+		// Edits made before the rename belong to the old name
+		this->FlushTreeEdits();
+
+		BPtr<char> old_scene_collection_name = std::move(this->_scene_collection_name);
+		this->_scene_collection_name = obs_frontend_get_current_scene_collection();
+
+		if(old_scene_collection_name)
+			this->_tree_store.Rename(old_scene_collection_name, this->_scene_collection_name);
+		else
+			this->SaveSceneTree(this->_scene_collection_name);
+
+		this->UpdateTree();
+	}
+	else if(event == OBS_FRONTEND_EVENT_TRANSITION_LIST_CHANGED)
+	{
+		this->_transition_overrides.ResetTransitions();
+		emit this->TransitionListChanged();
+	}
+	else if(event == OBS_FRONTEND_EVENT_TRANSITION_STOPPED)
+	{
+		// The transition button switches to the preview, which may have changed with the transition. Its override
+		// is applied in place, so the transition list doesn't switch back and forth
+		if(obs_frontend_preview_program_mode_active())
+		{
+			OBSSourceAutoRelease preview_scene = obs_frontend_get_current_preview_scene();
+			this->_transition_overrides.ApplyPreviewOverride(preview_scene);
+		}
+	}
+	else if(event == OBS_FRONTEND_EVENT_STUDIO_MODE_ENABLED)
+	{
+		this->_scene_tree_items.UpdateActiveScenes();
+		this->_tree_stream.SendActiveScenes();
+	}
+	else if(event == OBS_FRONTEND_EVENT_STUDIO_MODE_DISABLED)
+	{
+		this->_transition_overrides.RestoreTransition();
+		this->_scene_tree_items.UpdateActiveScenes();
+		this->_tree_stream.SendActiveScenes();
+	}
+	else if(event == OBS_FRONTEND_EVENT_THEME_CHANGED)
+		emit this->ThemeChanged();
+}
+
+void StvTreeService::ObsFrontendSave(obs_data_t *save_data, bool saving)
+{
+	// Edits are journaled, no need to rewrite the whole tree
+	if(saving)
+	{
+		this->FlushTreeEdits();
+
+		// Recent scenes, hotkey bindings, playlist settings and folder transitions are stored with the scene collection
+		this->_recent_scenes.Save(save_data);
+		this->_scene_hotkeys.Save(save_data);
+
+		// Playlist settings and folder transitions refer to the folders of one canvas
+		OBSDataAutoRelease canvas_settings = obs_data_create();
+		obs_data_apply(canvas_settings, this->_canvas_settings);
+
+		OBSDataAutoRelease settings = obs_data_create();
+		this->_folder_playlist.Save(settings);
+		this->_transition_overrides.Save(settings);
+		obs_data_set_obj(canvas_settings, get_canvas_name(this->_scene_tree_items.GetCanvas()).c_str(), settings);
+
+		// Those of the base canvas are stored where they were before trees were partitioned by canvas
+		const std::string base_canvas_name = get_canvas_name(StvItemModel::BASE_CANVAS);
+		OBSDataAutoRelease base_settings = obs_data_get_obj(canvas_settings, base_canvas_name.c_str());
+		obs_data_erase(canvas_settings, base_canvas_name.c_str());
+
+		obs_data_apply(save_data, base_settings);
+		obs_data_set_obj(save_data, CANVAS_SETTINGS_DATA.data(), canvas_settings);
+	}
+	else
+	{
+		this->_recent_scenes.Load(save_data);
+		this->_scene_hotkeys.Load(save_data);
+
+		// Collections are loaded with their base canvas
+		this->_folder_playlist.Load(save_data);
+		this->_transition_overrides.Load(save_data);
+
+		this->_canvas_settings = obs_data_get_obj(save_data, CANVAS_SETTINGS_DATA.data());
+		if(!this->_canvas_settings)
+			this->_canvas_settings = obs_data_create();
+	}
+}
@@ -0,0 +1,190 @@
+#ifndef STV_TREE_SERVICE_H
+#define STV_TREE_SERVICE_H
+
+#include <obs.hpp>
+#include <obs-frontend-api.h>
+#include <util/util.hpp>
+
+#include <QObject>
+#include <QPersistentModelIndex>
+#include <QtWidgets/QMainWindow>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "obs_scene_tree_view/stv_folder_playlist.h"
+#include "obs_scene_tree_view/stv_item_model.h"
+#include "obs_scene_tree_view/stv_recent_scenes.h"
+#include "obs_scene_tree_view/stv_scene_hotkeys.h"
+#include "obs_scene_tree_view/stv_scene_order_sync.h"
+#include "obs_scene_tree_view/stv_transition_overrides.h"
+#include "obs_scene_tree_view/stv_tree_store.h"
+#include "obs_scene_tree_view/stv_tree_stream.h"
+
+
+class ObsSceneTreeView;
+
+/*!
+ * \brief Scene tree state shared by all scene tree docks of an OBS instance. Holds the only model, scene index
+ * and tree store, and is the only receiver of frontend events. Docks only add views, so each additional dock
+ * costs its widgets, selection and expansion state.
+ *
+ * Created once by obs_module_load() and deleted together with the main window
+ */
+class StvTreeService
+        : public QObject
+{
+		Q_OBJECT
+
+	public:
+		static constexpr std::string_view SCENE_TREE_CONFIG_FILE = "scene_tree.json";
+		static constexpr std::string_view SCENE_TREE_JOURNAL_DIR = "scene_tree_journal";
+
+		// Playlist settings and folder transitions of canvases other than the base canvas, by canvas
+		static constexpr std::string_view CANVAS_SETTINGS_DATA = "scene_tree_view_canvas_settings";
+
+		// Number of scenes shown in the recent scenes folder, by recency and by decayed activation count
+		static constexpr size_t RECENT_SCENE_COUNT = 5;
+		static constexpr size_t MOST_USED_SCENE_COUNT = 5;
+
+		// Dock id of the dock that always exists. Its expansion state is stored with the tree
+		static constexpr int PRIMARY_DOCK_ID = 0;
+
+		static StvTreeService &Create(QMainWindow *main_window);
+		static StvTreeService &Get();
+
+		StvTreeService(const StvTreeService&) = delete;
+		StvTreeService &operator=(const StvTreeService&) = delete;
+
+		virtual ~StvTreeService() override;
+
+		StvItemModel &GetModel();
+		StvRecentModel &GetRecentModel();
+		StvFolderPlaylist &GetFolderPlaylist();
+		StvTransitionOverrides &GetTransitionOverrides();
+		StvSceneOrderSync &GetSceneOrderSync();
+
+		/*!
+		 * \brief Whether OBS finished loading and the tree of the current scene collection is loaded
+		 */
+		bool IsLoaded() const;
+
+		/*!
+		 * \brief Set the item new scenes are added next to. Follows the current item of the last used dock
+		 */
+		void SetInsertIndex(const QModelIndex &index);
+
+		/*!
+		 * \brief Add the primary dock and all additional docks stored in the global config
+		 */
+		void CreateDocks();
+
+		/*!
+		 * \brief Add and show a new dock
+		 */
+		void AddDock();
+
+		/*!
+		 * \brief Delete an additional dock. The primary dock can't be removed
+		 */
+		void RemoveDock(ObsSceneTreeView *dock);
+
+		void UpdateRecentScenes();
+
+		/*!
+		 * \brief Show the tree of another canvas in all docks. Each canvas has its own stored tree, playlist
+		 * settings and folder transitions. Scenes are classified by the model's canvas index, and trees shown
+		 * before are cached by the store, so switching back reads no files. A running playlist keeps playing
+		 */
+		void SetCanvas(StvItemModel::SCENE_SIZE_T canvas);
+
+	signals:
+		/*!
+		 * \brief Emitted once OBS finished loading, after the tree was loaded. Theme icons are available from then on
+		 */
+		void FinishedLoading();
+
+		/*!
+		 * \brief Emitted after the tree of a scene collection was loaded and reconciled with the scene list
+		 */
+		void TreeLoaded();
+
+		void CurrentSceneChanged();
+		void RecentScenesChanged();
+
+		void TransitionListChanged();
+		void ThemeChanged();
+
+	private:
+		QMainWindow *_main_window;
+
+		StvItemModel _scene_tree_items;
+		StvSceneHotkeys _scene_hotkeys;
+		StvTransitionOverrides _transition_overrides;
+		StvFolderPlaylist _folder_playlist;
+		StvTreeStream _tree_stream;
+		StvSceneOrderSync _scene_order_sync;
+		BPtr<char> _scene_collection_name = nullptr;
+		bool _loaded = false;
+
+		QPersistentModelIndex _insert_index;
+
+		StvTreeStore _tree_store;
+		std::vector<StvTreeOp> _pending_tree_edits;
+
+		// Settings of all canvases except the shown one, by canvas name
+		OBSDataAutoRelease _canvas_settings = obs_data_create();
+
+		// Canvas of the playlist that keeps playing while another canvas is shown
+		StvItemModel::SCENE_SIZE_T _playlist_canvas = StvItemModel::BASE_CANVAS;
+
+		StvRecentScenes _recent_scenes;
+		StvRecentModel _recent_scenes_model;
+
+		std::vector<int> _extra_dock_ids;
+
+		static StvTreeService *_service;
+
+		StvTreeService(QMainWindow *main_window);
+
+		void AddDock(int dock_id);
+		void SaveDockIds();
+
+		/*!
+		 * \brief Get the name the tree of the current canvas of scene_collection is stored under
+		 */
+		std::string GetTreeName(const char *scene_collection) const;
+
+		void SaveSceneTree(const char *scene_collection);
+		void LoadSceneTree(const char *scene_collection);
+
+		/*!
+		 * \brief Add scenes missing from the loaded tree and remove deleted ones. Together with
+		 * StvTreeStore::Load(), which only writes a checkpoint if the journal can't be appended to, loading a
+		 * current tree doesn't write anything
+		 * \return Returns false if the loaded tree already matched the scene list and nothing was written
+		 */
+		bool ReconcileSceneTree();
+
+		void CompactTreeStore();
+		void FlushTreeEdits();
+		void UpdateTree();
+
+		void RecordSceneActivation(obs_source_t *scene_source);
+
+		void OnTreeEdited(const StvTreeOp &op);
+
+		inline static void obs_frontend_event_cb(enum obs_frontend_event event, void *private_data)
+		{	((StvTreeService*)private_data)->ObsFrontendEvent(event);	}
+
+		inline static void obs_frontend_save_cb(obs_data_t *save_data, bool saving, void *private_data)
+		{	((StvTreeService*)private_data)->ObsFrontendSave(save_data, saving);	}
+
+		static void obs_source_rename_cb(void *private_data, calldata_t *data);
+
+		void ObsFrontendEvent(enum obs_frontend_event event);
+		void ObsFrontendSave(obs_data_t *save_data, bool saving);
+};
+
+#endif // STV_TREE_SERVICE_H
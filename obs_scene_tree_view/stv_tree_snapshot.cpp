@@ -0,0 +1,251 @@
+#include "obs_scene_tree_view/stv_tree_snapshot.h"
+
+#include <obs.hpp>
+
+#include <QThreadPool>
+
+#include <algorithm>
+#include <future>
+
+
+obs_data_array_t *StvTreeSnapshot::Serialize(const StvTreeNode &root)
+{
+	const size_t item_count = root.Children.size();
+
+	// Serialize all top-level items into separate data objects. Each worker writes into its own range
+	std::vector<obs_data_t*> items(item_count, nullptr);
+	auto serialize_range = [&root, &items](size_t begin, size_t end) {
+		for(size_t i = begin; i < end; ++i)
+			items[i] = StvTreeSnapshot::SerializeItem(*root.Children[i]);
+	};
+
+	QThreadPool *pool = QThreadPool::globalInstance();
+	const size_t chunk_count = std::min<size_t>(std::max(pool->maxThreadCount(), 1), item_count);
+
+	std::vector<std::future<void>> pending_chunks;
+	pending_chunks.reserve(chunk_count);
+
+	// The first chunk is serialized on the calling thread, so a saturated pool can't stall the save
+	for(size_t chunk = 1; chunk < chunk_count; ++chunk)
+	{
+		const size_t begin = item_count * chunk / chunk_count;
+		const size_t end = item_count * (chunk+1) / chunk_count;
+
+		auto task = std::make_shared<std::packaged_task<void()>>(std::bind(serialize_range, begin, end));
+		pending_chunks.push_back(task->get_future());
+		pool->start([task]() { (*task)(); });
+	}
+
+	if(chunk_count > 0)
+		serialize_range(0, item_count / chunk_count);
+
+	for(auto &chunk : pending_chunks)
+		chunk.wait();
+
+	// Concatenate in tree order
+	obs_data_array_t *folder_data = obs_data_array_create();
+	for(obs_data_t *item_data : items)
+	{
+		obs_data_array_push_back(folder_data, item_data);
+		obs_data_release(item_data);
+	}
+
+	return folder_data;
+}
+
+obs_data_array_t *StvTreeSnapshot::SerializeFolder(const StvTreeNode &folder)
+{
+	obs_data_array_t *folder_data = obs_data_array_create();
+
+	for(const auto &item : folder.Children)
+	{
+		OBSDataAutoRelease item_data = StvTreeSnapshot::SerializeItem(*item);
+		obs_data_array_push_back(folder_data, item_data);
+	}
+
+	return folder_data;
+}
+
+obs_data_t *StvTreeSnapshot::SerializeItem(const StvTreeNode &item)
+{
+	obs_data_t *item_data = obs_data_create();
+	if(item.IsFolder)
+	{
+		OBSDataArrayAutoRelease sub_folder_data = StvTreeSnapshot::SerializeFolder(item);
+		obs_data_set_array(item_data, SCENE_TREE_CONFIG_FOLDER_DATA.data(), sub_folder_data);
+		obs_data_set_bool(item_data, SCENE_TREE_CONFIG_FOLDER_EXPANDED.data(), item.IsExpanded);
+		obs_data_set_bool(item_data, SCENE_TREE_CONFIG_FOLDER_SORTED.data(), item.IsSorted);
+	}
+	else if(!item.Uuid.isEmpty())
+		obs_data_set_string(item_data, SCENE_TREE_CONFIG_SCENE_UUID_DATA.data(), item.Uuid.toUtf8().constData());
+
+	obs_data_set_string(item_data, SCENE_TREE_CONFIG_ITEM_NAME_DATA.data(), item.Name.toUtf8().constData());
+
+	return item_data;
+}
+
+StvTreeNodePtr StvTreeSnapshot::Deserialize(obs_data_array_t *folder_data)
+{
+	auto root = std::make_shared<StvTreeNode>();
+	root->IsFolder = true;
+	root->IsExpanded = true;
+
+	if(folder_data)
+		StvTreeSnapshot::DeserializeFolder(folder_data, *root);
+
+	return root;
+}
+
+StvTreeNodePtr StvTreeSnapshot::Apply(const StvTreeNodePtr &root, const StvTreeOp &op)
+{
+	switch(op.Type)
+	{
+		case StvTreeOp::INSERT:
+		{
+			auto item = std::make_shared<StvTreeNode>();
+			item->Name = op.Name;
+			item->IsFolder = op.IsFolder;
+			item->IsExpanded = op.IsFolder && op.IsExpanded;
+			if(!op.IsFolder)
+				item->Uuid = op.Uuid;
+
+			return StvTreeSnapshot::InsertAt(root, op.Path, op.Row, std::move(item));
+		}
+
+		case StvTreeOp::MOVE:
+		{
+			StvTreeNodePtr item = StvTreeSnapshot::Find(root, op.Path);
+			if(!item || op.Path.empty())
+				return nullptr;
+
+			StvTreeNodePtr new_root = StvTreeSnapshot::RemoveAt(root, op.Path);
+			if(!new_root)
+				return nullptr;
+
+			return StvTreeSnapshot::InsertAt(new_root, op.TargetPath, op.Row, std::move(item));
+		}
+
+		case StvTreeOp::RENAME:
+			return StvTreeSnapshot::ModifyAt(root, op.Path, 0, [&op](const StvTreeNode &item) {
+				auto new_item = std::make_shared<StvTreeNode>(item);
+				new_item->Name = op.Name;
+				return StvTreeNodePtr(std::move(new_item));
+			});
+
+		case StvTreeOp::REMOVE:
+			return StvTreeSnapshot::RemoveAt(root, op.Path);
+
+		case StvTreeOp::EXPAND:
+			return StvTreeSnapshot::ModifyAt(root, op.Path, 0, [&op](const StvTreeNode &item) -> StvTreeNodePtr {
+				if(!item.IsFolder)
+					return nullptr;
+
+				auto new_item = std::make_shared<StvTreeNode>(item);
+				new_item->IsExpanded = op.IsExpanded;
+				return new_item;
+			});
+
+		case StvTreeOp::SORT:
+			return StvTreeSnapshot::ModifyAt(root, op.Path, 0, [&op](const StvTreeNode &item) -> StvTreeNodePtr {
+				if(!item.IsFolder)
+					return nullptr;
+
+				auto new_item = std::make_shared<StvTreeNode>(item);
+				new_item->IsSorted = op.IsSorted;
+				return new_item;
+			});
+	}
+
+	return nullptr;
+}
+
+StvTreeNodePtr StvTreeSnapshot::Find(const StvTreeNodePtr &root, const std::vector<int> &path)
+{
+	StvTreeNodePtr node = root;
+	for(const int row : path)
+	{
+		if(row < 0 || row >= (int)node->Children.size())
+			return nullptr;
+
+		node = node->Children[row];
+	}
+
+	return node;
+}
+
+void StvTreeSnapshot::DeserializeFolder(obs_data_array_t *folder_data, StvTreeNode &folder)
+{
+	const size_t item_count = obs_data_array_count(folder_data);
+	folder.Children.reserve(item_count);
+
+	for(size_t i=0; i < item_count; ++i)
+	{
+		OBSDataAutoRelease item_data = obs_data_array_item(folder_data, i);
+		OBSDataArrayAutoRelease sub_folder_data = obs_data_get_array(item_data, SCENE_TREE_CONFIG_FOLDER_DATA.data());
+
+		auto item = std::make_shared<StvTreeNode>();
+		item->Name = QString::fromUtf8(obs_data_get_string(item_data, SCENE_TREE_CONFIG_ITEM_NAME_DATA.data()));
+
+		// Only folders have folder data
+		if(sub_folder_data)
+		{
+			item->IsFolder = true;
+			item->IsExpanded = obs_data_get_bool(item_data, SCENE_TREE_CONFIG_FOLDER_EXPANDED.data());
+			item->IsSorted = obs_data_get_bool(item_data, SCENE_TREE_CONFIG_FOLDER_SORTED.data());
+			StvTreeSnapshot::DeserializeFolder(sub_folder_data, *item);
+		}
+		else
+			item->Uuid = QString::fromUtf8(obs_data_get_string(item_data, SCENE_TREE_CONFIG_SCENE_UUID_DATA.data()));
+
+		folder.Children.push_back(std::move(item));
+	}
+}
+
+StvTreeNodePtr StvTreeSnapshot::ModifyAt(const StvTreeNodePtr &node, const std::vector<int> &path, size_t depth, const modify_fn_t &modify)
+{
+	if(depth == path.size())
+		return modify(*node);
+
+	const int row = path[depth];
+	if(row < 0 || row >= (int)node->Children.size())
+		return nullptr;
+
+	StvTreeNodePtr child = StvTreeSnapshot::ModifyAt(node->Children[row], path, depth+1, modify);
+	if(!child)
+		return nullptr;
+
+	auto new_node = std::make_shared<StvTreeNode>(*node);
+	new_node->Children[row] = std::move(child);
+
+	return new_node;
+}
+
+StvTreeNodePtr StvTreeSnapshot::InsertAt(const StvTreeNodePtr &root, const std::vector<int> &path, int row, StvTreeNodePtr item)
+{
+	return StvTreeSnapshot::ModifyAt(root, path, 0, [row, &item](const StvTreeNode &folder) -> StvTreeNodePtr {
+		if(!folder.IsFolder || row < 0 || row > (int)folder.Children.size())
+			return nullptr;
+
+		auto new_folder = std::make_shared<StvTreeNode>(folder);
+		new_folder->Children.insert(new_folder->Children.begin() + row, std::move(item));
+		return new_folder;
+	});
+}
+
+StvTreeNodePtr StvTreeSnapshot::RemoveAt(const StvTreeNodePtr &root, const std::vector<int> &path)
+{
+	if(path.empty())
+		return nullptr;
+
+	const int row = path.back();
+	const std::vector<int> parent_path(path.begin(), path.end()-1);
+
+	return StvTreeSnapshot::ModifyAt(root, parent_path, 0, [row](const StvTreeNode &folder) -> StvTreeNodePtr {
+		if(row < 0 || row >= (int)folder.Children.size())
+			return nullptr;
+
+		auto new_folder = std::make_shared<StvTreeNode>(folder);
+		new_folder->Children.erase(new_folder->Children.begin() + row);
+		return new_folder;
+	});
+}
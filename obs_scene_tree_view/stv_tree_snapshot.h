@@ -0,0 +1,113 @@
+#ifndef STV_TREE_SNAPSHOT_H
+#define STV_TREE_SNAPSHOT_H
+
+#include <obs-data.h>
+
+#include <QString>
+
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+
+struct StvTreeNode;
+using StvTreeNodePtr = std::shared_ptr<const StvTreeNode>;
+
+/*!
+ * \brief Immutable copy of a tree node. Created on the UI thread, can be read from any thread.
+ * Names are stored as QString, so copying them only increments a reference count
+ */
+struct StvTreeNode
+{
+	QString Name;
+
+	// Scenes only. Empty for scenes stored before UUIDs were recorded
+	QString Uuid;
+
+	bool IsFolder = false;
+	bool IsExpanded = false;
+
+	// Folder keeps its items in natural order
+	bool IsSorted = false;
+
+	std::vector<StvTreeNodePtr> Children;
+};
+
+/*!
+ * \brief A single structural tree edit. Items are addressed by their row path from the root
+ */
+struct StvTreeOp
+{
+	enum TYPE : uint8_t
+	{	INSERT = 1, MOVE, RENAME, REMOVE, EXPAND, SORT	};
+
+	TYPE Type = INSERT;
+
+	// INSERT: Path of parent folder. Other types: Path of edited item
+	std::vector<int> Path;
+
+	// MOVE: Path of new parent folder, resolved after the item was removed from its old position
+	std::vector<int> TargetPath;
+
+	// INSERT, MOVE: Row in the parent folder
+	int Row = 0;
+
+	bool IsFolder = false;
+	bool IsExpanded = false;
+
+	// SORT: New sort mode of the folder. Reordering is recorded as separate MOVE ops
+	bool IsSorted = false;
+
+	// INSERT, RENAME: Item name
+	QString Name;
+
+	// INSERT: Scene UUID
+	QString Uuid;
+};
+
+class StvTreeSnapshot
+{
+	public:
+		static constexpr std::string_view SCENE_TREE_CONFIG_FOLDER_DATA = "folder";
+		static constexpr std::string_view SCENE_TREE_CONFIG_FOLDER_EXPANDED = "is_expanded";
+		static constexpr std::string_view SCENE_TREE_CONFIG_FOLDER_SORTED = "is_sorted";
+		static constexpr std::string_view SCENE_TREE_CONFIG_ITEM_NAME_DATA = "name";
+		static constexpr std::string_view SCENE_TREE_CONFIG_SCENE_UUID_DATA = "uuid";
+
+		/*!
+		 * \brief Serialize the children of root. Top-level entries are split into chunks that are serialized
+		 * in parallel on the global thread pool and concatenated in order afterwards
+		 */
+		static obs_data_array_t *Serialize(const StvTreeNode &root);
+
+		/*!
+		 * \brief Serialize the children of folder on the calling thread
+		 */
+		static obs_data_array_t *SerializeFolder(const StvTreeNode &folder);
+
+		/*!
+		 * \brief Create a snapshot root from serialized tree data
+		 */
+		static StvTreeNodePtr Deserialize(obs_data_array_t *folder_data);
+
+		/*!
+		 * \brief Apply op to root. Only nodes along the edited paths are copied, all others are shared
+		 * \return New root, or nullptr if op doesn't match the tree
+		 */
+		static StvTreeNodePtr Apply(const StvTreeNodePtr &root, const StvTreeOp &op);
+
+		static StvTreeNodePtr Find(const StvTreeNodePtr &root, const std::vector<int> &path);
+
+	private:
+		using modify_fn_t = std::function<StvTreeNodePtr(const StvTreeNode&)>;
+
+		static obs_data_t *SerializeItem(const StvTreeNode &item);
+		static void DeserializeFolder(obs_data_array_t *folder_data, StvTreeNode &folder);
+
+		static StvTreeNodePtr ModifyAt(const StvTreeNodePtr &node, const std::vector<int> &path, size_t depth, const modify_fn_t &modify);
+		static StvTreeNodePtr InsertAt(const StvTreeNodePtr &root, const std::vector<int> &path, int row, StvTreeNodePtr item);
+		static StvTreeNodePtr RemoveAt(const StvTreeNodePtr &root, const std::vector<int> &path);
+};
+
+#endif // STV_TREE_SNAPSHOT_H
@@ -0,0 +1,522 @@
+#include "obs_scene_tree_view/stv_tree_store.h"
+
+#include <obs-module.h>
+#include <util/platform.h>
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+
+
+StvTreeStore::StvTreeStore(const char *file_path, const char *journal_dir)
+    : _file_path(file_path),
+      _journal_dir(journal_dir),
+      _worker(&StvTreeStore::ProcessTasks, this)
+{}
+
+StvTreeStore::~StvTreeStore()
+{
+	{
+		std::lock_guard lock(this->_lock);
+		this->_stop = true;
+	}
+
+	this->_tasks_changed.notify_all();
+	this->_worker.join();
+}
+
+std::string StvTreeStore::GetCanvasTreeName(const char *scene_collection, const std::string &canvas)
+{
+	if(canvas.empty())
+		return scene_collection;
+
+	return std::string(scene_collection).append(CANVAS_SEPARATOR).append(canvas);
+}
+
+std::string_view StvTreeStore::GetSceneCollection(std::string_view tree_name)
+{
+	return tree_name.substr(0, tree_name.find(CANVAS_SEPARATOR));
+}
+
+bool StvTreeStore::Open()
+{
+	this->Flush();
+
+	std::lock_guard lock(this->_data_lock);
+
+	this->GetRoot();
+	return !this->_parse_failed;
+}
+
+int StvTreeStore::GetSchemaVersion()
+{
+	this->Flush();
+
+	std::lock_guard lock(this->_data_lock);
+
+	return (int)obs_data_get_int(this->GetRoot(), SCHEMA_VERSION_KEY.data());
+}
+
+StvTreeNodePtr StvTreeStore::Load(const char *scene_collection)
+{
+	{
+		std::lock_guard trees_lock(this->_trees_lock);
+
+		// Canvases of other collections aren't switched to
+		const std::string_view collection = GetSceneCollection(scene_collection);
+		for(auto tree_it = this->_trees.begin(); tree_it != this->_trees.end();)
+		{
+			if(GetSceneCollection(tree_it->first) != collection)
+				tree_it = this->_trees.erase(tree_it);
+			else
+				++tree_it;
+		}
+
+		if(const auto tree_it = this->_trees.find(scene_collection); tree_it != this->_trees.end())
+			return tree_it->second;
+	}
+
+	this->Flush();
+
+	std::lock_guard lock(this->_data_lock);
+
+	StvTreeJournal journal(this->_journal_dir, scene_collection);
+	bool needs_checkpoint;
+	StvTreeNodePtr tree = this->ReadTree(scene_collection, journal, needs_checkpoint);
+
+	this->_journals.insert_or_assign(scene_collection, std::move(journal));
+
+	{
+		std::lock_guard trees_lock(this->_trees_lock);
+		this->_trees.insert_or_assign(scene_collection, tree);
+	}
+
+	// Fold the journal into a new checkpoint if it can't be appended to. Written by the worker, so loading never
+	// blocks on disk writes. Appends queued afterwards are applied on top of this checkpoint
+	if(needs_checkpoint)
+	{
+		this->Enqueue([this, tree = tree ? tree : StvTreeSnapshot::Deserialize(nullptr), scene_collection = std::string(scene_collection)]() {
+			this->WriteCheckpoint(scene_collection, *tree);
+		});
+	}
+
+	return tree;
+}
+
+StvTreeNodePtr StvTreeStore::Read(const char *scene_collection)
+{
+	{
+		std::lock_guard trees_lock(this->_trees_lock);
+		if(const auto tree_it = this->_trees.find(scene_collection); tree_it != this->_trees.end())
+			return tree_it->second;
+	}
+
+	this->Flush();
+
+	std::lock_guard lock(this->_data_lock);
+
+	StvTreeJournal journal(this->_journal_dir, scene_collection);
+	bool needs_checkpoint;
+	return this->ReadTree(scene_collection, journal, needs_checkpoint);
+}
+
+std::vector<std::string> StvTreeStore::GetSceneCollections()
+{
+	this->Flush();
+
+	std::lock_guard lock(this->_data_lock);
+
+	std::vector<std::string> scene_collections;
+	for(obs_data_item_t *item = obs_data_first(this->GetRoot()); item; obs_data_item_next(&item))
+	{
+		if(obs_data_item_gettype(item) == OBS_DATA_ARRAY)
+			scene_collections.push_back(obs_data_item_get_name(item));
+	}
+
+	return scene_collections;
+}
+
+void StvTreeStore::Save(const char *scene_collection, StvTreeNodePtr snapshot)
+{
+	{
+		std::lock_guard trees_lock(this->_trees_lock);
+		if(const auto tree_it = this->_trees.find(scene_collection); tree_it != this->_trees.end())
+			tree_it->second = snapshot;
+	}
+
+	this->Enqueue([this, snapshot = std::move(snapshot), scene_collection = std::string(scene_collection)]() {
+		this->WriteCheckpoint(scene_collection, *snapshot);
+	});
+}
+
+void StvTreeStore::Append(const char *scene_collection, std::vector<StvTreeOp> ops)
+{
+	StvTreeNodePtr tree;
+	std::vector<StvTreeOp> applied_ops;
+	applied_ops.reserve(ops.size());
+	{
+		std::lock_guard trees_lock(this->_trees_lock);
+		const auto tree_it = this->_trees.find(scene_collection);
+		if(tree_it == this->_trees.end())
+		{
+			blog(LOG_WARNING, "[%s] Dropping edits of '%s', collection isn't loaded", obs_module_name(), scene_collection);
+			return;
+		}
+
+		tree = tree_it->second ? tree_it->second : StvTreeSnapshot::Deserialize(nullptr);
+		for(auto &op : ops)
+		{
+			StvTreeNodePtr new_tree = StvTreeSnapshot::Apply(tree, op);
+			if(!new_tree)
+			{
+				blog(LOG_WARNING, "[%s] Scene tree edit doesn't match stored tree", obs_module_name());
+				continue;
+			}
+
+			tree = std::move(new_tree);
+			applied_ops.push_back(std::move(op));
+		}
+
+		tree_it->second = tree;
+	}
+
+	// Replaying stops at the first op that doesn't match, so rejected ops must not reach the journal
+	if(applied_ops.empty())
+		return;
+
+	// The tree including these ops becomes the checkpoint once the journal is full
+	this->Enqueue([this, ops = std::move(applied_ops), tree = std::move(tree), scene_collection = std::string(scene_collection)]() {
+		StvTreeJournal &journal = this->_journals.try_emplace(scene_collection, this->_journal_dir, scene_collection.c_str()).first->second;
+		if(!journal.Append(ops) || this->IsJournalFull(journal))
+			this->WriteCheckpoint(scene_collection, *tree);
+	});
+}
+
+void StvTreeStore::Rename(const char *old_scene_collection, const char *new_scene_collection)
+{
+	if(strcmp(old_scene_collection, new_scene_collection) == 0)
+		return;
+
+	// Loaded trees include edits that may still be queued, move them along
+	std::unordered_map<std::string, StvTreeNodePtr> loaded_trees;
+	{
+		std::lock_guard trees_lock(this->_trees_lock);
+		for(auto tree_it = this->_trees.begin(); tree_it != this->_trees.end();)
+		{
+			if(GetSceneCollection(tree_it->first) == old_scene_collection)
+			{
+				loaded_trees.emplace(tree_it->first, tree_it->second);
+				tree_it = this->_trees.erase(tree_it);
+			}
+			else
+				++tree_it;
+		}
+
+		const size_t old_size = strlen(old_scene_collection);
+		for(const auto &[tree_name, tree] : loaded_trees)
+			this->_trees.insert_or_assign(new_scene_collection + tree_name.substr(old_size), tree);
+	}
+
+	this->Enqueue([this, old_name = std::string(old_scene_collection), new_name = std::string(new_scene_collection),
+	               loaded_trees = std::move(loaded_trees)]() {
+		// Collect first, items can't be erased while iterating
+		std::vector<std::string> tree_names;
+		for(obs_data_item_t *item = obs_data_first(this->GetRoot()); item; obs_data_item_next(&item))
+		{
+			const char *tree_name = obs_data_item_get_name(item);
+			if(obs_data_item_gettype(item) == OBS_DATA_ARRAY && GetSceneCollection(tree_name) == old_name)
+				tree_names.push_back(tree_name);
+		}
+
+		// Loaded trees may not have a checkpoint yet
+		for(const auto &[tree_name, tree] : loaded_trees)
+		{
+			if(tree && std::find(tree_names.begin(), tree_names.end(), tree_name) == tree_names.end())
+				tree_names.push_back(tree_name);
+		}
+
+		for(const std::string &tree_name : tree_names)
+		{
+			const auto loaded_it = loaded_trees.find(tree_name);
+			this->RenameTree(tree_name, new_name + tree_name.substr(old_name.size()),
+			                 loaded_it != loaded_trees.end() ? loaded_it->second : nullptr);
+		}
+	});
+}
+
+void StvTreeStore::Compact(std::vector<std::string> live_scene_collections, int64_t grace_period_s)
+{
+	// Trees of missing collections may be dropped, read them from the file if loaded again
+	{
+		std::lock_guard trees_lock(this->_trees_lock);
+		for(auto tree_it = this->_trees.begin(); tree_it != this->_trees.end();)
+		{
+			if(std::find(live_scene_collections.begin(), live_scene_collections.end(), GetSceneCollection(tree_it->first)) == live_scene_collections.end())
+				tree_it = this->_trees.erase(tree_it);
+			else
+				++tree_it;
+		}
+	}
+
+	this->Enqueue([this, live_scene_collections = std::move(live_scene_collections), grace_period_s]() {
+		if(this->CompactRoot(live_scene_collections, grace_period_s))
+			this->WriteFile();
+	});
+}
+
+void StvTreeStore::Flush()
+{
+	std::unique_lock lock(this->_lock);
+	this->_tasks_changed.wait(lock, [this]() { return this->_tasks.empty() && !this->_task_running; });
+}
+
+void StvTreeStore::Enqueue(std::function<void()> task)
+{
+	{
+		std::lock_guard lock(this->_lock);
+		this->_tasks.push_back(std::move(task));
+	}
+
+	this->_tasks_changed.notify_all();
+}
+
+void StvTreeStore::ProcessTasks()
+{
+	std::unique_lock lock(this->_lock);
+	while(true)
+	{
+		this->_tasks_changed.wait(lock, [this]() { return this->_stop || !this->_tasks.empty(); });
+
+		// Finish all queued writes before stopping
+		if(this->_tasks.empty())
+			break;
+
+		std::function<void()> task = std::move(this->_tasks.front());
+		this->_tasks.pop_front();
+		this->_task_running = true;
+
+		// Don't block Enqueue() while executing
+		lock.unlock();
+		{
+			std::lock_guard data_lock(this->_data_lock);
+			task();
+		}
+		lock.lock();
+
+		this->_task_running = false;
+		this->_tasks_changed.notify_all();
+	}
+}
+
+obs_data_t *StvTreeStore::GetRoot()
+{
+	if(!this->_root)
+	{
+		this->_root = obs_data_create_from_json_file(this->_file_path.c_str());
+		if(!this->_root)
+		{
+			this->_parse_failed = os_file_exists(this->_file_path.c_str());
+			this->_root = obs_data_create();
+		}
+		else
+			this->_file_size = (size_t)std::max<int64_t>(os_get_file_size(this->_file_path.c_str()), 0);
+	}
+
+	return this->_root;
+}
+
+uint64_t StvTreeStore::GetGeneration(const char *scene_collection)
+{
+	OBSDataAutoRelease generations = obs_data_get_obj(this->GetRoot(), GENERATION_KEY.data());
+	return generations ? (uint64_t)obs_data_get_int(generations, scene_collection) : 0;
+}
+
+bool StvTreeStore::IsJournalFull(const StvTreeJournal &journal) const
+{
+	// Replaying a journal is cheap compared to rewriting the file, which holds the trees of all collections
+	return journal.Size() > std::max(StvTreeJournal::COMPACTION_THRESHOLD, this->_file_size / 2);
+}
+
+StvTreeNodePtr StvTreeStore::ReadTree(const char *scene_collection, StvTreeJournal &journal, bool &needs_checkpoint)
+{
+	OBSDataArrayAutoRelease folder_data = obs_data_get_array(this->GetRoot(), scene_collection);
+	StvTreeNodePtr tree = StvTreeSnapshot::Deserialize(folder_data);
+
+	// Replay edits made since the last checkpoint
+	std::vector<StvTreeOp> ops;
+	const bool journal_valid = journal.Read(this->GetGeneration(scene_collection), ops);
+
+	size_t replayed = 0;
+	for(const auto &op : ops)
+	{
+		StvTreeNodePtr new_tree = StvTreeSnapshot::Apply(tree, op);
+		if(!new_tree)
+		{
+			blog(LOG_WARNING, "[%s] Scene tree journal '%s' doesn't match checkpoint, skipping remaining edits",
+			     obs_module_name(), journal.FilePath().c_str());
+			break;
+		}
+
+		tree = std::move(new_tree);
+		++replayed;
+	}
+
+	needs_checkpoint = !journal_valid || replayed != ops.size();
+
+	return folder_data || replayed > 0 ? tree : nullptr;
+}
+
+void StvTreeStore::WriteCheckpoint(const std::string &scene_collection, const StvTreeNode &tree)
+{
+	obs_data_t *root = this->GetRoot();
+
+	OBSDataArrayAutoRelease folder_data = StvTreeSnapshot::Serialize(tree);
+	obs_data_set_array(root, scene_collection.c_str(), folder_data);
+
+	OBSDataAutoRelease generations = obs_data_get_obj(root, GENERATION_KEY.data());
+	if(!generations)
+	{
+		generations = obs_data_create();
+		obs_data_set_obj(root, GENERATION_KEY.data(), generations);
+	}
+
+	// Journal records are only replayed on the checkpoint they were written for. If writing stops between
+	// the checkpoint and the journal reset, the old journal is discarded on the next load
+	const uint64_t generation = (uint64_t)obs_data_get_int(generations, scene_collection.c_str()) + 1;
+	obs_data_set_int(generations, scene_collection.c_str(), (long long)generation);
+
+	this->WriteFile();
+
+	if(!this->_journal_dir_created)
+	{
+		if(os_mkdirs(this->_journal_dir.c_str()) == MKDIR_ERROR)
+			blog(LOG_WARNING, "[%s] failed to create journal dir '%s'", obs_module_name(), this->_journal_dir.c_str());
+
+		this->_journal_dir_created = true;
+	}
+
+	StvTreeJournal journal(this->_journal_dir, scene_collection.c_str());
+	journal.Reset(generation);
+
+	this->_journals.insert_or_assign(scene_collection, std::move(journal));
+}
+
+void StvTreeStore::RenameTree(const std::string &old_name, const std::string &new_name, StvTreeNodePtr tree)
+{
+	obs_data_t *root = this->GetRoot();
+
+	// Edits in the old journal are included in loaded trees. Replay them for all others, including version 1
+	// journals, before the journal is removed
+	if(!tree)
+	{
+		StvTreeJournal journal(this->_journal_dir, old_name.c_str());
+		bool needs_checkpoint;
+		tree = this->ReadTree(old_name.c_str(), journal, needs_checkpoint);
+		if(!tree)
+			return;
+	}
+
+	StvTreeJournal(this->_journal_dir, old_name.c_str()).Remove();
+	obs_data_erase(root, old_name.c_str());
+
+	OBSDataAutoRelease generations = obs_data_get_obj(root, GENERATION_KEY.data());
+	if(generations)
+		obs_data_erase(generations, old_name.c_str());
+
+	OBSDataAutoRelease orphaned = obs_data_get_obj(root, ORPHANED_KEY.data());
+	if(orphaned)
+		obs_data_erase(orphaned, new_name.c_str());
+
+	this->_journals.erase(old_name);
+
+	blog(LOG_INFO, "[%s] Moved scene tree '%s' to '%s'", obs_module_name(), old_name.c_str(), new_name.c_str());
+
+	this->WriteCheckpoint(new_name, *tree);
+}
+
+void StvTreeStore::WriteFile()
+{
+	obs_data_t *root = this->GetRoot();
+	obs_data_set_int(root, SCHEMA_VERSION_KEY.data(), SCHEMA_VERSION);
+
+	if(!obs_data_save_json(root, this->_file_path.c_str()))
+		blog(LOG_WARNING, "[%s] Failed to save scene tree in '%s'", obs_module_name(), this->_file_path.c_str());
+	else
+		this->_file_size = (size_t)std::max<int64_t>(os_get_file_size(this->_file_path.c_str()), 0);
+}
+
+bool StvTreeStore::CompactRoot(const std::vector<std::string> &live_scene_collections, int64_t grace_period_s)
+{
+	obs_data_t *root = this->GetRoot();
+
+	OBSDataAutoRelease orphaned = obs_data_get_obj(root, ORPHANED_KEY.data());
+	if(!orphaned)
+	{
+		orphaned = obs_data_create();
+		obs_data_set_obj(root, ORPHANED_KEY.data(), orphaned);
+	}
+
+	// Trees of other canvases live as long as their collection
+	auto is_live = [&live_scene_collections](const char *name) {
+		return std::find(live_scene_collections.begin(), live_scene_collections.end(), GetSceneCollection(name)) != live_scene_collections.end();
+	};
+
+	// Collect first, items can't be erased while iterating
+	std::vector<std::string> stored_trees;
+	for(obs_data_item_t *item = obs_data_first(root); item; obs_data_item_next(&item))
+	{
+		if(obs_data_item_gettype(item) == OBS_DATA_ARRAY)
+			stored_trees.push_back(obs_data_item_get_name(item));
+	}
+
+	// Files of older versions are rewritten with the current schema. A store without trees isn't created
+	bool modified = !stored_trees.empty() && obs_data_get_int(root, SCHEMA_VERSION_KEY.data()) != SCHEMA_VERSION;
+
+	std::vector<std::string> orphan_entries;
+	for(obs_data_item_t *item = obs_data_first(orphaned); item; obs_data_item_next(&item))
+	{
+		orphan_entries.push_back(obs_data_item_get_name(item));
+	}
+
+	// Collections that reappeared (e.g. re-imported) are no longer orphaned
+	for(const auto &name : orphan_entries)
+	{
+		if(is_live(name.c_str()) || std::find(stored_trees.begin(), stored_trees.end(), name) == stored_trees.end())
+		{
+			obs_data_erase(orphaned, name.c_str());
+			modified = true;
+		}
+	}
+
+	const int64_t now = (int64_t)time(nullptr);
+	size_t dropped = 0;
+	for(const auto &name : stored_trees)
+	{
+		if(is_live(name.c_str()))
+			continue;
+
+		if(!obs_data_has_user_value(orphaned, name.c_str()))
+		{
+			obs_data_set_int(orphaned, name.c_str(), now);
+			modified = true;
+		}
+		else if(now - obs_data_get_int(orphaned, name.c_str()) > grace_period_s)
+		{
+			obs_data_erase(root, name.c_str());
+			obs_data_erase(orphaned, name.c_str());
+
+			OBSDataAutoRelease generations = obs_data_get_obj(root, GENERATION_KEY.data());
+			if(generations)
+				obs_data_erase(generations, name.c_str());
+
+			StvTreeJournal(this->_journal_dir, name.c_str()).Remove();
+			modified = true;
+			++dropped;
+		}
+	}
+
+	if(dropped > 0)
+		blog(LOG_INFO, "[%s] Dropped %zu stale scene trees", obs_module_name(), dropped);
+
+	return modified;
+}
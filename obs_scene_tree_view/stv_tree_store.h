@@ -0,0 +1,181 @@
+#ifndef STV_TREE_STORE_H
+#define STV_TREE_STORE_H
+
+#include <obs.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "obs_scene_tree_view/stv_tree_journal.h"
+#include "obs_scene_tree_view/stv_tree_snapshot.h"
+
+
+/*!
+ * \brief Owns the scene tree file. The file is parsed once and kept in memory. All writes are queued
+ * and executed in order on a background thread, so the UI thread never waits for file I/O.
+ *
+ * The tree file holds one checkpoint per collection. Edits of loaded trees are appended to their journal and
+ * folded into a new checkpoint once the journal exceeds StvTreeJournal::COMPACTION_THRESHOLD and half the size of
+ * the tree file. A checkpoint rewrites the whole file, so files with many collections are rewritten less often.
+ *
+ * Loaded trees of the current collection, e.g. those of several canvases, are cached with all queued edits
+ * applied, so loading one of them again neither waits for the worker nor reads any file
+ */
+class StvTreeStore
+{
+	public:
+		static constexpr int SCHEMA_VERSION = 1;
+
+		static constexpr std::string_view SCHEMA_VERSION_KEY = "__stv_schema_version";
+		static constexpr std::string_view ORPHANED_KEY = "__stv_orphaned";
+		static constexpr std::string_view GENERATION_KEY = "__stv_checkpoint_generation";
+
+		// Trees of canvases other than the base canvas are stored as "<collection><CANVAS_SEPARATOR><canvas>"
+		static constexpr std::string_view CANVAS_SEPARATOR = "\x1f";
+
+		// Trees of collections that no longer exist are kept this long before being dropped
+		static constexpr int64_t ORPHAN_GRACE_PERIOD_S = 30*24*60*60;
+
+		StvTreeStore(const char *file_path, const char *journal_dir);
+		~StvTreeStore();
+
+		StvTreeStore(const StvTreeStore&) = delete;
+		StvTreeStore &operator=(const StvTreeStore&) = delete;
+
+		/*!
+		 * \brief Get the name the tree of canvas is stored under. An empty canvas is the base canvas, whose tree
+		 * is stored under the collection name
+		 */
+		static std::string GetCanvasTreeName(const char *scene_collection, const std::string &canvas);
+
+		/*!
+		 * \brief Get the collection a stored tree belongs to
+		 */
+		static std::string_view GetSceneCollection(std::string_view tree_name);
+
+		/*!
+		 * \brief Parse the tree file. Waits for all queued writes to finish first
+		 * \return Returns false if the file exists but couldn't be parsed. An empty tree is used then
+		 */
+		bool Open();
+
+		/*!
+		 * \brief Get the schema version the tree file was written with. Files written before the schema
+		 * was versioned return 0
+		 */
+		int GetSchemaVersion();
+
+		/*!
+		 * \brief Get the stored tree of scene_collection with its journal replayed on top. Trees loaded before are
+		 * returned from the cache. Otherwise all queued writes are waited for first, and a missing or invalid journal
+		 * is replaced by a checkpoint on the worker thread. Cached trees of other collections are dropped
+		 * \return Root node of the stored tree, or nullptr if none exists
+		 */
+		StvTreeNodePtr Load(const char *scene_collection);
+
+		/*!
+		 * \brief Like Load(), but doesn't cache the tree and never writes
+		 */
+		StvTreeNodePtr Read(const char *scene_collection);
+
+		/*!
+		 * \brief Get names of all collections with a stored tree. Waits for all queued writes to finish first
+		 */
+		std::vector<std::string> GetSceneCollections();
+
+		/*!
+		 * \brief Write snapshot as new checkpoint of scene_collection and clear its journal
+		 */
+		void Save(const char *scene_collection, StvTreeNodePtr snapshot);
+
+		/*!
+		 * \brief Append ops to the journal of scene_collection, which must have been loaded with Load().
+		 * Ops that don't match the loaded tree are skipped and not journaled
+		 */
+		void Append(const char *scene_collection, std::vector<StvTreeOp> ops);
+
+		/*!
+		 * \brief Move the trees of all canvases of old_scene_collection to new_scene_collection
+		 */
+		void Rename(const char *old_scene_collection, const char *new_scene_collection);
+
+		/*!
+		 * \brief Reconcile stored trees with live_scene_collections. Trees of missing collections are marked
+		 * as orphaned and dropped once grace_period_s has passed. The file is only written if a tree was marked,
+		 * unmarked or dropped, or if it was written by an older version. Journals aren't folded in
+		 */
+		void Compact(std::vector<std::string> live_scene_collections, int64_t grace_period_s = ORPHAN_GRACE_PERIOD_S);
+
+		/*!
+		 * \brief Wait until all queued writes were executed
+		 */
+		void Flush();
+
+	private:
+		std::string _file_path;
+		std::string _journal_dir;
+		bool _journal_dir_created = false;
+		OBSDataAutoRelease _root = nullptr;
+		bool _parse_failed = false;
+
+		// Size of the tree file when it was last read or written
+		size_t _file_size = 0;
+
+		// Trees returned by Load() with all queued edits applied, by tree name. Updated when a write is queued.
+		// nullptr if no tree was stored
+		std::unordered_map<std::string, StvTreeNodePtr> _trees;
+		std::mutex _trees_lock;
+
+		// Journals of loaded trees. Only accessed while holding _data_lock
+		std::unordered_map<std::string, StvTreeJournal> _journals;
+
+		// Guards _root. Held while a task executes
+		std::mutex _data_lock;
+
+		// Guards the task queue
+		std::mutex _lock;
+		std::condition_variable _tasks_changed;
+		std::deque<std::function<void()>> _tasks;
+		bool _task_running = false;
+		bool _stop = false;
+
+		std::thread _worker;
+
+		void Enqueue(std::function<void()> task);
+		void ProcessTasks();
+
+		// Must only be called from a task
+		obs_data_t *GetRoot();
+		void WriteFile();
+
+		uint64_t GetGeneration(const char *scene_collection);
+
+		/*!
+		 * \brief Check whether journal grew large enough to be folded into a new checkpoint
+		 */
+		bool IsJournalFull(const StvTreeJournal &journal) const;
+
+		/*!
+		 * \brief Read the checkpoint of scene_collection and replay its journal
+		 * \param needs_checkpoint Set to true if the journal can't be appended to
+		 * \return Root node, or nullptr if neither checkpoint nor journal edits exist
+		 */
+		StvTreeNodePtr ReadTree(const char *scene_collection, StvTreeJournal &journal, bool &needs_checkpoint);
+		void WriteCheckpoint(const std::string &scene_collection, const StvTreeNode &tree);
+
+		/*!
+		 * \param tree Tree stored under old_name including its journal. Read from the checkpoint and journal if nullptr
+		 */
+		void RenameTree(const std::string &old_name, const std::string &new_name, StvTreeNodePtr tree);
+
+		bool CompactRoot(const std::vector<std::string> &live_scene_collections, int64_t grace_period_s);
+};
+
+#endif // STV_TREE_STORE_H
@@ -0,0 +1,279 @@
+#include "obs_scene_tree_view/stv_tree_stream.h"
+
+#include "obs_scene_tree_view/stv_item_model.h"
+
+#include <obs-frontend-api.h>
+#include <obs-module.h>
+#include <util/config-file.h>
+
+#include <QJsonDocument>
+#include <QLocalServer>
+#include <QLocalSocket>
+
+#include <algorithm>
+
+
+namespace
+{
+	inline QString ToKey(std::string_view key)
+	{
+		return QString::fromLatin1(key.data(), (qsizetype)key.size());
+	}
+
+	// Compact JSON never contains raw newlines, so clients can split messages at them
+	inline QByteArray ToLine(const QJsonObject &message)
+	{
+		return QJsonDocument(message).toJson(QJsonDocument::Compact) + '\n';
+	}
+
+	inline QJsonValue GetSceneName(obs_source_t *scene_source)
+	{
+		return scene_source ? QJsonValue(QString::fromUtf8(obs_source_get_name(scene_source))) : QJsonValue();
+	}
+}
+
+
+StvTreeStream::StvTreeStream(StvItemModel &model)
+    : _model(model)
+{}
+
+StvTreeStream::~StvTreeStream()
+{
+	this->Stop();
+}
+
+void StvTreeStream::Start()
+{
+	if(this->_server)
+		return;
+
+	const char *socket_name = config_get_string(obs_frontend_get_global_config(), "SceneTreeView", SOCKET_NAME_CONFIG.data());
+	if(!socket_name || !*socket_name)
+		return;
+
+	// A socket file left behind by a crashed instance would make listen() fail
+	QLocalServer::removeServer(QString::fromUtf8(socket_name));
+
+	this->_server = std::make_unique<QLocalServer>();
+	this->_server->setSocketOptions(QLocalServer::UserAccessOption);
+	QObject::connect(this->_server.get(), &QLocalServer::newConnection, this, &StvTreeStream::OnNewConnection);
+
+	if(!this->_server->listen(QString::fromUtf8(socket_name)))
+	{
+		blog(LOG_WARNING, "[%s] Couldn't listen on tree stream socket '%s': %s", obs_module_name(), socket_name,
+		     this->_server->errorString().toStdString().c_str());
+
+		this->_server.reset();
+		return;
+	}
+
+	blog(LOG_INFO, "[%s] Serving tree stream on '%s'", obs_module_name(),
+	     this->_server->fullServerName().toStdString().c_str());
+}
+
+void StvTreeStream::Stop()
+{
+	// Sockets are children of the server and deleted with it
+	this->_clients.clear();
+	this->_server.reset();
+}
+
+void StvTreeStream::SendSnapshots()
+{
+	for(CLIENT &client : this->_clients)
+		this->SendSnapshot(client);
+}
+
+void StvTreeStream::SendTreeEdit(const StvTreeOp &op)
+{
+	if(this->_clients.empty())
+		return;
+
+	QJsonObject message;
+	message.insert(ToKey(MESSAGE_PATH_DATA), SerializePath(op.Path));
+
+	switch(op.Type)
+	{
+		case StvTreeOp::INSERT:
+			message.insert(ToKey(MESSAGE_TYPE_DATA), ToKey(INSERT_MESSAGE));
+			message.insert(ToKey(MESSAGE_ROW_DATA), op.Row);
+			message.insert(ToKey(StvTreeSnapshot::SCENE_TREE_CONFIG_ITEM_NAME_DATA), op.Name);
+			if(op.IsFolder)
+			{
+				// Folders are inserted empty, their items follow as separate inserts
+				message.insert(ToKey(StvTreeSnapshot::SCENE_TREE_CONFIG_FOLDER_DATA), QJsonArray());
+				message.insert(ToKey(StvTreeSnapshot::SCENE_TREE_CONFIG_FOLDER_EXPANDED), op.IsExpanded);
+				message.insert(ToKey(StvTreeSnapshot::SCENE_TREE_CONFIG_FOLDER_SORTED), op.IsSorted);
+			}
+			else if(!op.Uuid.isEmpty())
+				message.insert(ToKey(StvTreeSnapshot::SCENE_TREE_CONFIG_SCENE_UUID_DATA), op.Uuid);
+			break;
+
+		case StvTreeOp::MOVE:
+			message.insert(ToKey(MESSAGE_TYPE_DATA), ToKey(MOVE_MESSAGE));
+			message.insert(ToKey(MESSAGE_TARGET_DATA), SerializePath(op.TargetPath));
+			message.insert(ToKey(MESSAGE_ROW_DATA), op.Row);
+			break;
+
+		case StvTreeOp::RENAME:
+			message.insert(ToKey(MESSAGE_TYPE_DATA), ToKey(RENAME_MESSAGE));
+			message.insert(ToKey(StvTreeSnapshot::SCENE_TREE_CONFIG_ITEM_NAME_DATA), op.Name);
+			break;
+
+		case StvTreeOp::REMOVE:
+			message.insert(ToKey(MESSAGE_TYPE_DATA), ToKey(REMOVE_MESSAGE));
+			break;
+
+		case StvTreeOp::EXPAND:
+			message.insert(ToKey(MESSAGE_TYPE_DATA), ToKey(EXPAND_MESSAGE));
+			message.insert(ToKey(StvTreeSnapshot::SCENE_TREE_CONFIG_FOLDER_EXPANDED), op.IsExpanded);
+			break;
+
+		case StvTreeOp::SORT:
+			message.insert(ToKey(MESSAGE_TYPE_DATA), ToKey(SORT_MESSAGE));
+			message.insert(ToKey(StvTreeSnapshot::SCENE_TREE_CONFIG_FOLDER_SORTED), op.IsSorted);
+			break;
+	}
+
+	this->Broadcast(std::move(message));
+}
+
+void StvTreeStream::SendActiveScenes()
+{
+	if(!this->_clients.empty())
+		this->Broadcast(this->CreateActiveScenesMessage());
+}
+
+void StvTreeStream::OnNewConnection()
+{
+	while(QLocalSocket *socket = this->_server->nextPendingConnection())
+	{
+		QObject::connect(socket, &QLocalSocket::bytesWritten, this, [this, socket]() {
+			this->OnBytesWritten(socket);
+		});
+		// Queued, writes may detect the disconnect while Broadcast() iterates the clients
+		QObject::connect(socket, &QLocalSocket::disconnected, this, [this, socket]() {
+			this->OnDisconnected(socket);
+		}, Qt::QueuedConnection);
+
+		// The stream is one-way, drop anything clients send
+		QObject::connect(socket, &QLocalSocket::readyRead, socket, [socket]() {
+			socket->readAll();
+		});
+
+		this->_clients.push_back(CLIENT{socket});
+		this->SendSnapshot(this->_clients.back());
+	}
+}
+
+void StvTreeStream::OnBytesWritten(QLocalSocket *socket)
+{
+	const auto client_it = std::find_if(this->_clients.begin(), this->_clients.end(), [socket](const CLIENT &client) {
+		return client.Socket == socket;
+	});
+
+	// The snapshot replaces all deltas the client missed
+	if(client_it != this->_clients.end() && client_it->NeedsSnapshot && socket->bytesToWrite() == 0)
+		this->SendSnapshot(*client_it);
+}
+
+void StvTreeStream::OnDisconnected(QLocalSocket *socket)
+{
+	const auto client_it = std::find_if(this->_clients.begin(), this->_clients.end(), [socket](const CLIENT &client) {
+		return client.Socket == socket;
+	});
+
+	if(client_it == this->_clients.end())
+		return;
+
+	this->_clients.erase(client_it);
+	socket->deleteLater();
+}
+
+void StvTreeStream::SendSnapshot(CLIENT &client)
+{
+	client.NeedsSnapshot = false;
+	this->Write(client, this->CreateSnapshotMessage());
+}
+
+void StvTreeStream::Broadcast(QJsonObject message)
+{
+	message.insert(ToKey(MESSAGE_SEQUENCE_DATA), (qint64)++this->_sequence);
+	const QByteArray line = ToLine(message);
+
+	for(CLIENT &client : this->_clients)
+	{
+		if(client.NeedsSnapshot)
+			continue;
+
+		if(client.Socket->bytesToWrite() > MAX_PENDING_BYTES)
+		{
+			blog(LOG_INFO, "[%s] Tree stream client fell behind, resyncing once it caught up", obs_module_name());
+			client.NeedsSnapshot = true;
+			continue;
+		}
+
+		client.Socket->write(line);
+	}
+}
+
+void StvTreeStream::Write(CLIENT &client, const QJsonObject &message)
+{
+	client.Socket->write(ToLine(message));
+}
+
+QJsonObject StvTreeStream::CreateSnapshotMessage()
+{
+	// Deltas following the snapshot start at the next sequence number
+	QJsonObject message = this->CreateActiveScenesMessage();
+	message.insert(ToKey(MESSAGE_TYPE_DATA), ToKey(SNAPSHOT_MESSAGE));
+	message.insert(ToKey(MESSAGE_SEQUENCE_DATA), (qint64)this->_sequence);
+	message.insert(ToKey(MESSAGE_TREE_DATA), SerializeFolder(*this->_model.GetTree()));
+
+	return message;
+}
+
+QJsonObject StvTreeStream::CreateActiveScenesMessage() const
+{
+	OBSSourceAutoRelease program_scene = obs_frontend_get_current_scene();
+	OBSSourceAutoRelease preview_scene = obs_frontend_preview_program_mode_active() ? obs_frontend_get_current_preview_scene() : nullptr;
+
+	QJsonObject message;
+	message.insert(ToKey(MESSAGE_TYPE_DATA), ToKey(ACTIVE_SCENES_MESSAGE));
+	message.insert(ToKey(MESSAGE_PROGRAM_DATA), GetSceneName(program_scene));
+	message.insert(ToKey(MESSAGE_PREVIEW_DATA), GetSceneName(preview_scene));
+
+	return message;
+}
+
+QJsonArray StvTreeStream::SerializeFolder(const StvTreeNode &folder)
+{
+	// Same keys as StvTreeSnapshot::SerializeFolder()
+	QJsonArray items;
+	for(const StvTreeNodePtr &child : folder.Children)
+	{
+		QJsonObject item;
+		item.insert(ToKey(StvTreeSnapshot::SCENE_TREE_CONFIG_ITEM_NAME_DATA), child->Name);
+		if(child->IsFolder)
+		{
+			item.insert(ToKey(StvTreeSnapshot::SCENE_TREE_CONFIG_FOLDER_DATA), SerializeFolder(*child));
+			item.insert(ToKey(StvTreeSnapshot::SCENE_TREE_CONFIG_FOLDER_EXPANDED), child->IsExpanded);
+			item.insert(ToKey(StvTreeSnapshot::SCENE_TREE_CONFIG_FOLDER_SORTED), child->IsSorted);
+		}
+		else if(!child->Uuid.isEmpty())
+			item.insert(ToKey(StvTreeSnapshot::SCENE_TREE_CONFIG_SCENE_UUID_DATA), child->Uuid);
+
+		items.append(item);
+	}
+
+	return items;
+}
+
+QJsonArray StvTreeStream::SerializePath(const std::vector<int> &path)
+{
+	QJsonArray rows;
+	for(const int row : path)
+		rows.append(row);
+
+	return rows;
+}
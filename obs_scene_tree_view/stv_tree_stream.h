@@ -0,0 +1,107 @@
+#ifndef STV_TREE_STREAM_H
+#define STV_TREE_STREAM_H
+
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QObject>
+#include <QString>
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "obs_scene_tree_view/stv_tree_snapshot.h"
+
+
+class QLocalServer;
+class QLocalSocket;
+class StvItemModel;
+
+/*!
+ * \brief Serves the scene tree to local clients, e.g. control surfaces, on a local socket (a Unix domain socket on
+ * Linux and macOS, a named pipe on Windows). Disabled unless a socket name is set in the global config.
+ *
+ * Messages are JSON objects, one per line. A client first receives a snapshot of the whole tree in the format of
+ * the scene tree file, followed by every structural edit as a delta of row paths, and the program and preview
+ * scene whenever they change. Sockets are written without blocking. A client that doesn't keep up stops receiving
+ * deltas and gets a fresh snapshot once it has read everything that was queued for it
+ */
+class StvTreeStream
+        : public QObject
+{
+		Q_OBJECT
+
+	public:
+		static constexpr std::string_view SOCKET_NAME_CONFIG = "DeltaStreamSocket";
+
+		// Clients with more unread data stop receiving deltas until they caught up
+		static constexpr int64_t MAX_PENDING_BYTES = 1024*1024;
+
+		static constexpr std::string_view MESSAGE_TYPE_DATA = "type";
+		static constexpr std::string_view MESSAGE_SEQUENCE_DATA = "seq";
+		static constexpr std::string_view MESSAGE_TREE_DATA = "tree";
+		static constexpr std::string_view MESSAGE_PATH_DATA = "path";
+		static constexpr std::string_view MESSAGE_TARGET_DATA = "target";
+		static constexpr std::string_view MESSAGE_ROW_DATA = "row";
+		static constexpr std::string_view MESSAGE_PROGRAM_DATA = "program";
+		static constexpr std::string_view MESSAGE_PREVIEW_DATA = "preview";
+
+		static constexpr std::string_view SNAPSHOT_MESSAGE = "snapshot";
+		static constexpr std::string_view INSERT_MESSAGE = "insert";
+		static constexpr std::string_view MOVE_MESSAGE = "move";
+		static constexpr std::string_view RENAME_MESSAGE = "rename";
+		static constexpr std::string_view REMOVE_MESSAGE = "remove";
+		static constexpr std::string_view EXPAND_MESSAGE = "expand";
+		static constexpr std::string_view SORT_MESSAGE = "sort";
+		static constexpr std::string_view ACTIVE_SCENES_MESSAGE = "active";
+
+		StvTreeStream(StvItemModel &model);
+		virtual ~StvTreeStream() override;
+
+		/*!
+		 * \brief Listen on the socket set in the global config. Does nothing if none is set
+		 */
+		void Start();
+		void Stop();
+
+		/*!
+		 * \brief Send a fresh snapshot to all clients, e.g. after another tree was loaded
+		 */
+		void SendSnapshots();
+
+		void SendTreeEdit(const StvTreeOp &op);
+		void SendActiveScenes();
+
+	private:
+		struct CLIENT
+		{
+			QLocalSocket *Socket = nullptr;
+
+			// Set while the client doesn't receive deltas, until its queued data was written
+			bool NeedsSnapshot = false;
+		};
+
+		StvItemModel &_model;
+
+		std::unique_ptr<QLocalServer> _server;
+		std::vector<CLIENT> _clients;
+
+		uint64_t _sequence = 0;
+
+		void OnNewConnection();
+		void OnBytesWritten(QLocalSocket *socket);
+		void OnDisconnected(QLocalSocket *socket);
+
+		void SendSnapshot(CLIENT &client);
+		void Broadcast(QJsonObject message);
+		void Write(CLIENT &client, const QJsonObject &message);
+
+		QJsonObject CreateSnapshotMessage();
+		QJsonObject CreateActiveScenesMessage() const;
+
+		static QJsonArray SerializeFolder(const StvTreeNode &folder);
+		static QJsonArray SerializePath(const std::vector<int> &path);
+};
+
+#endif // STV_TREE_STREAM_H
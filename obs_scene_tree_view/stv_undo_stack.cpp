@@ -0,0 +1,142 @@
+#include "obs_scene_tree_view/stv_undo_stack.h"
+
+#include <iterator>
+
+
+void StvUndoStack::Push(DELTA delta, bool new_step)
+{
+	for(const auto &redo_delta : this->_redo)
+		this->_memory_usage -= StvUndoStack::GetDeltaSize(redo_delta);
+
+	this->_redo.clear();
+	this->_redo_steps = 0;
+
+	delta.StepStart = new_step || this->_undo.empty();
+	this->_undo_steps += delta.StepStart ? 1 : 0;
+	this->_memory_usage += StvUndoStack::GetDeltaSize(delta);
+	this->_undo.push_back(std::move(delta));
+
+	this->EnforceMemoryLimit();
+}
+
+bool StvUndoStack::CanUndo() const
+{
+	return !this->_undo.empty();
+}
+
+bool StvUndoStack::CanRedo() const
+{
+	return !this->_redo.empty();
+}
+
+StvUndoStack::step_t StvUndoStack::TakeUndoStep()
+{
+	return this->TakeStep(this->_undo, this->_undo_steps);
+}
+
+StvUndoStack::step_t StvUndoStack::TakeRedoStep()
+{
+	return this->TakeStep(this->_redo, this->_redo_steps);
+}
+
+void StvUndoStack::PushUndoStep(step_t step)
+{
+	this->PushStep(this->_undo, this->_undo_steps, std::move(step));
+}
+
+void StvUndoStack::PushRedoStep(step_t step)
+{
+	this->PushStep(this->_redo, this->_redo_steps, std::move(step));
+}
+
+void StvUndoStack::Clear()
+{
+	this->_undo.clear();
+	this->_redo.clear();
+	this->_undo_steps = 0;
+	this->_redo_steps = 0;
+	this->_memory_usage = 0;
+}
+
+void StvUndoStack::SetMemoryLimit(size_t memory_limit)
+{
+	this->_memory_limit = memory_limit;
+	this->EnforceMemoryLimit();
+}
+
+size_t StvUndoStack::GetMemoryUsage() const
+{
+	return this->_memory_usage;
+}
+
+size_t StvUndoStack::GetDeltaSize(const DELTA &delta)
+{
+	// Names are the only variable sized data, handles only hold a reference
+	return sizeof(DELTA) + (delta.Name.size() + delta.NewName.size())*sizeof(QChar);
+}
+
+StvUndoStack::step_t StvUndoStack::TakeStep(std::deque<DELTA> &deltas, size_t &step_count)
+{
+	step_t step;
+	if(deltas.empty())
+		return step;
+
+	--step_count;
+
+	auto step_it = std::prev(deltas.end());
+	while(!step_it->StepStart && step_it != deltas.begin())
+		--step_it;
+
+	step.reserve(std::distance(step_it, deltas.end()));
+	for(auto delta_it = step_it; delta_it != deltas.end(); ++delta_it)
+	{
+		this->_memory_usage -= StvUndoStack::GetDeltaSize(*delta_it);
+		step.push_back(std::move(*delta_it));
+	}
+
+	deltas.erase(step_it, deltas.end());
+
+	return step;
+}
+
+void StvUndoStack::PushStep(std::deque<DELTA> &deltas, size_t &step_count, step_t step)
+{
+	if(step.empty())
+		return;
+
+	++step_count;
+	step.front().StepStart = true;
+	for(auto &delta : step)
+	{
+		this->_memory_usage += StvUndoStack::GetDeltaSize(delta);
+		deltas.push_back(std::move(delta));
+	}
+
+	this->EnforceMemoryLimit();
+}
+
+void StvUndoStack::EnforceMemoryLimit()
+{
+	// Drop the oldest undo steps first, then the redo steps furthest ahead. The latest step is always kept,
+	// even if it alone exceeds the limit
+	while(this->_memory_usage > this->_memory_limit)
+	{
+		if(this->_undo_steps > 0 && (this->_redo_steps > 0 || this->_undo_steps > 1))
+			this->DropOldestStep(this->_undo, this->_undo_steps);
+		else if(this->_redo_steps > 1)
+			this->DropOldestStep(this->_redo, this->_redo_steps);
+		else
+			break;
+	}
+}
+
+void StvUndoStack::DropOldestStep(std::deque<DELTA> &deltas, size_t &step_count)
+{
+	--step_count;
+	do
+	{
+		this->_memory_usage -= StvUndoStack::GetDeltaSize(deltas.front());
+		deltas.pop_front();
+	}
+	while(!deltas.empty() && !deltas.front().StepStart);
+}
@@ -0,0 +1,123 @@
+#ifndef STV_UNDO_STACK_H
+#define STV_UNDO_STACK_H
+
+#include <obs.hpp>
+
+#include <QString>
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+
+/*!
+ * \brief Undo and redo history of structural tree edits.
+ * Edits are stored as deltas that address items by handle instead of by row path, so a delta stays valid
+ * while other edits shift rows around it, and undoing it never needs a copy of the tree.
+ * Moving a folder is a single delta, independent of the number of items it contains.
+ *
+ * Deltas are grouped into steps. The oldest steps are dropped once the stored deltas exceed the memory limit
+ */
+class StvUndoStack
+{
+	public:
+		static constexpr size_t DEFAULT_MEMORY_LIMIT = 256*1024;
+
+		/*!
+		 * \brief Identifies an item independent of its position. Folders by their id, scenes by their source.
+		 * If neither is set, the handle refers to the top level
+		 */
+		struct ITEM_HANDLE
+		{
+			uint64_t FolderId = 0;
+			OBSWeakSource Scene;
+
+			bool IsRoot() const
+			{	return this->FolderId == 0 && !this->Scene;	}
+		};
+
+		struct DELTA
+		{
+			enum TYPE : uint8_t
+			{	CREATE_FOLDER, REMOVE_FOLDER, RENAME, MOVE, EXPAND, SORT	};
+
+			TYPE Type = CREATE_FOLDER;
+
+			// First delta of an undo step
+			bool StepStart = false;
+
+			// CREATE_FOLDER, REMOVE_FOLDER: Expansion state of the folder. EXPAND: New expansion state
+			bool IsExpanded = false;
+
+			// SORT: New sort mode. Undoing it keeps the sorted order
+			bool IsSorted = false;
+
+			ITEM_HANDLE Item;
+
+			// CREATE_FOLDER, REMOVE_FOLDER: Parent of the folder. MOVE: Parent before the move
+			ITEM_HANDLE Parent;
+			int Row = 0;
+
+			// MOVE: Parent after the move
+			ITEM_HANDLE NewParent;
+			int NewRow = 0;
+
+			// CREATE_FOLDER, REMOVE_FOLDER: Folder name. RENAME: Name before the edit
+			QString Name;
+
+			// RENAME: Name after the edit
+			QString NewName;
+		};
+
+		using step_t = std::vector<DELTA>;
+
+		/*!
+		 * \brief Record a new edit. Discards all redo steps
+		 * \param new_step Start a new undo step instead of adding delta to the last one
+		 */
+		void Push(DELTA delta, bool new_step);
+
+		bool CanUndo() const;
+		bool CanRedo() const;
+
+		/*!
+		 * \brief Remove the last undo step. Its deltas must be reverted in reverse order
+		 */
+		step_t TakeUndoStep();
+		step_t TakeRedoStep();
+
+		/*!
+		 * \brief Store a step that was reverted or re-applied. Empty steps are dropped
+		 */
+		void PushUndoStep(step_t step);
+		void PushRedoStep(step_t step);
+
+		void Clear();
+
+		void SetMemoryLimit(size_t memory_limit);
+		size_t GetMemoryUsage() const;
+
+	private:
+		std::deque<DELTA> _undo;
+		std::deque<DELTA> _redo;
+
+		// Number of deltas with StepStart set, so enforcing the memory limit doesn't scan the deltas
+		size_t _undo_steps = 0;
+		size_t _redo_steps = 0;
+
+		size_t _memory_usage = 0;
+		size_t _memory_limit = DEFAULT_MEMORY_LIMIT;
+
+		static size_t GetDeltaSize(const DELTA &delta);
+
+		step_t TakeStep(std::deque<DELTA> &deltas, size_t &step_count);
+		void PushStep(std::deque<DELTA> &deltas, size_t &step_count, step_t step);
+
+		/*!
+		 * \brief Drop the oldest steps until the memory limit is met. Undo steps are dropped before redo steps
+		 */
+		void EnforceMemoryLimit();
+		void DropOldestStep(std::deque<DELTA> &deltas, size_t &step_count);
+};
+
+#endif // STV_UNDO_STACK_H
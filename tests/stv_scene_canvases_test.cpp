@@ -0,0 +1,167 @@
+#include "tests/stv_scene_canvases_test.h"
+
+#include <obs.hpp>
+
+#include <QTest>
+
+
+void StvSceneCanvasesTest::init()
+{
+	this->_canvases = StvSceneCanvases();
+	this->_canvases.SetSceneSize(SCENE_SIZE);
+
+	const std::vector<StvSceneCanvases::SCENE_SIZE_T> sizes = {StvSceneCanvases::BASE_CANVAS, VERTICAL, SQUARE};
+	this->_canvases.Index({"base", "vertical", "square"}, [&sizes](size_t scene) {
+		return sizes[scene];
+	});
+}
+
+void StvSceneCanvasesTest::Classify()
+{
+	OBSDataAutoRelease settings = obs_data_create();
+	QCOMPARE(this->_canvases.Classify(settings), StvSceneCanvases::BASE_CANVAS);
+
+	// The size is only used if custom_size is set
+	obs_data_set_int(settings, "cx", VERTICAL.cx);
+	obs_data_set_int(settings, "cy", VERTICAL.cy);
+	QCOMPARE(this->_canvases.Classify(settings), StvSceneCanvases::BASE_CANVAS);
+
+	obs_data_set_bool(settings, "custom_size", true);
+	QCOMPARE(this->_canvases.Classify(settings), VERTICAL);
+
+	// Custom sizes equal to the base resolution belong to the base canvas
+	OBSDataAutoRelease base_settings = StvSceneCanvasesTest::CreateSettings(SCENE_SIZE);
+	QCOMPARE(this->_canvases.Classify(base_settings), StvSceneCanvases::BASE_CANVAS);
+
+	this->_canvases.SetSceneSize(VERTICAL);
+	QCOMPARE(this->_canvases.Classify(settings), StvSceneCanvases::BASE_CANVAS);
+	QCOMPARE(this->_canvases.Classify(base_settings), SCENE_SIZE);
+}
+
+void StvSceneCanvasesTest::Index()
+{
+	QCOMPARE(*this->_canvases.Find("vertical"), VERTICAL);
+	QVERIFY(!this->_canvases.Find("new"));
+
+	// Only new scenes are classified, removed ones drop out
+	std::vector<size_t> classified;
+	const uint64_t version = this->_canvases.GetVersion();
+	this->_canvases.Index({"new", "vertical", "base"}, [&classified](size_t scene) {
+		classified.push_back(scene);
+		return SQUARE;
+	});
+
+	QCOMPARE(classified, std::vector<size_t>({0}));
+	QCOMPARE(*this->_canvases.Find("new"), SQUARE);
+	QCOMPARE(*this->_canvases.Find("vertical"), VERTICAL);
+	QCOMPARE(*this->_canvases.Find("base"), StvSceneCanvases::BASE_CANVAS);
+	QVERIFY(!this->_canvases.Find("square"));
+	QVERIFY(this->_canvases.GetVersion() != version);
+}
+
+void StvSceneCanvasesTest::IndexAfterSceneSizeChange()
+{
+	// Keeping the base resolution keeps the index
+	uint64_t version = this->_canvases.GetVersion();
+	this->_canvases.SetSceneSize(SCENE_SIZE);
+	QCOMPARE(this->_canvases.GetVersion(), version);
+	QVERIFY(this->_canvases.Find("vertical"));
+
+	// Scenes may have moved to or from the base canvas, all are classified again
+	this->_canvases.SetSceneSize(VERTICAL);
+	QVERIFY(this->_canvases.GetVersion() != version);
+	QVERIFY(!this->_canvases.Find("vertical"));
+
+	std::vector<size_t> classified;
+	this->_canvases.Index({"base", "vertical"}, [&classified](size_t scene) {
+		classified.push_back(scene);
+		return StvSceneCanvases::BASE_CANVAS;
+	});
+
+	QCOMPARE(classified, std::vector<size_t>({0, 1}));
+}
+
+void StvSceneCanvasesTest::UpdateIntoCanvas()
+{
+	this->_canvases.SetCanvas(VERTICAL);
+
+	const uint64_t version = this->_canvases.GetVersion();
+	OBSDataAutoRelease settings = StvSceneCanvasesTest::CreateSettings(VERTICAL);
+	QVERIFY(this->_canvases.Update("base", settings));
+	QCOMPARE(*this->_canvases.Find("base"), VERTICAL);
+	QVERIFY(this->_canvases.GetVersion() != version);
+}
+
+void StvSceneCanvasesTest::UpdateOutOfCanvas()
+{
+	this->_canvases.SetCanvas(VERTICAL);
+
+	OBSDataAutoRelease settings = StvSceneCanvasesTest::CreateSettings(StvSceneCanvases::BASE_CANVAS);
+	QVERIFY(this->_canvases.Update("vertical", settings));
+	QCOMPARE(*this->_canvases.Find("vertical"), StvSceneCanvases::BASE_CANVAS);
+
+	// The current canvas stays listed after its last scene left
+	QCOMPARE(this->_canvases.GetCanvases(), std::vector<StvSceneCanvases::SCENE_SIZE_T>({StvSceneCanvases::BASE_CANVAS, SQUARE, VERTICAL}));
+}
+
+void StvSceneCanvasesTest::UpdateOtherCanvas()
+{
+	// The shown tree isn't affected, but the list of canvases changed
+	const uint64_t version = this->_canvases.GetVersion();
+	OBSDataAutoRelease settings = StvSceneCanvasesTest::CreateSettings(VERTICAL);
+	QVERIFY(!this->_canvases.Update("square", settings));
+	QCOMPARE(*this->_canvases.Find("square"), VERTICAL);
+	QVERIFY(this->_canvases.GetVersion() != version);
+	QCOMPARE(this->_canvases.GetCanvases(), std::vector<StvSceneCanvases::SCENE_SIZE_T>({StvSceneCanvases::BASE_CANVAS, VERTICAL}));
+}
+
+void StvSceneCanvasesTest::UpdateUnchanged()
+{
+	// Settings updates that don't change the size, e.g. of the base resolution as custom size, change nothing
+	const uint64_t version = this->_canvases.GetVersion();
+	OBSDataAutoRelease settings = StvSceneCanvasesTest::CreateSettings(SCENE_SIZE);
+	QVERIFY(!this->_canvases.Update("base", settings));
+	QCOMPARE(this->_canvases.GetVersion(), version);
+}
+
+void StvSceneCanvasesTest::UpdateNotIndexed()
+{
+	// Scenes that aren't indexed yet are classified with the next Index()
+	const uint64_t version = this->_canvases.GetVersion();
+	OBSDataAutoRelease settings = StvSceneCanvasesTest::CreateSettings(StvSceneCanvases::BASE_CANVAS);
+	QVERIFY(!this->_canvases.Update("new", settings));
+	QVERIFY(!this->_canvases.Find("new"));
+	QCOMPARE(this->_canvases.GetVersion(), version);
+}
+
+void StvSceneCanvasesTest::GetCanvases()
+{
+	// Sorted by resolution, the base canvas is 0x0
+	using canvases_t = std::vector<StvSceneCanvases::SCENE_SIZE_T>;
+	QCOMPARE(this->_canvases.GetCanvases(), canvases_t({StvSceneCanvases::BASE_CANVAS, SQUARE, VERTICAL}));
+
+	// The current canvas is listed even without scenes, the base canvas always is
+	const StvSceneCanvases::SCENE_SIZE_T empty_canvas = {640, 480};
+	uint64_t version = this->_canvases.GetVersion();
+	this->_canvases.SetCanvas(empty_canvas);
+	QVERIFY(this->_canvases.GetVersion() != version);
+
+	this->_canvases.Index({"vertical"}, [](size_t) {
+		return StvSceneCanvases::BASE_CANVAS;
+	});
+	QCOMPARE(this->_canvases.GetCanvases(), canvases_t({StvSceneCanvases::BASE_CANVAS, empty_canvas, VERTICAL}));
+
+	version = this->_canvases.GetVersion();
+	this->_canvases.SetCanvas(empty_canvas);
+	QCOMPARE(this->_canvases.GetVersion(), version);
+}
+
+obs_data_t *StvSceneCanvasesTest::CreateSettings(StvSceneCanvases::SCENE_SIZE_T size)
+{
+	obs_data_t *settings = obs_data_create();
+	obs_data_set_bool(settings, "custom_size", size != StvSceneCanvases::BASE_CANVAS);
+	obs_data_set_int(settings, "cx", size.cx);
+	obs_data_set_int(settings, "cy", size.cy);
+
+	return settings;
+}
@@ -0,0 +1,46 @@
+#ifndef STV_SCENE_CANVASES_TEST_H
+#define STV_SCENE_CANVASES_TEST_H
+
+#include <QObject>
+
+#include <vector>
+
+#include "obs_scene_tree_view/stv_scene_canvases.h"
+
+
+class StvSceneCanvasesTest
+        : public QObject
+{
+		Q_OBJECT
+
+	private slots:
+		void init();
+
+		void Classify();
+
+		void Index();
+		void IndexAfterSceneSizeChange();
+
+		void UpdateIntoCanvas();
+		void UpdateOutOfCanvas();
+		void UpdateOtherCanvas();
+		void UpdateUnchanged();
+		void UpdateNotIndexed();
+
+		void GetCanvases();
+
+	private:
+		static constexpr StvSceneCanvases::SCENE_SIZE_T SCENE_SIZE = {1920, 1080};
+		static constexpr StvSceneCanvases::SCENE_SIZE_T VERTICAL = {1080, 1920};
+		static constexpr StvSceneCanvases::SCENE_SIZE_T SQUARE = {1080, 1080};
+
+		// Scenes "base", "vertical" and "square", indexed with SCENE_SIZE as base resolution
+		StvSceneCanvases _canvases;
+
+		/*!
+		 * \brief Settings of a scene with the given custom size. Scenes with a size of 0x0 don't use a custom size
+		 */
+		static obs_data_t *CreateSettings(StvSceneCanvases::SCENE_SIZE_T size);
+};
+
+#endif // STV_SCENE_CANVASES_TEST_H
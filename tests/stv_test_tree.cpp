@@ -0,0 +1,56 @@
+#include "tests/stv_test_tree.h"
+
+
+StvTreeNodePtr StvTestTree::Scene(const QString &name, const QString &uuid)
+{
+	auto scene = std::make_shared<StvTreeNode>();
+	scene->Name = name;
+	scene->Uuid = uuid;
+
+	return scene;
+}
+
+StvTreeNodePtr StvTestTree::Folder(const QString &name, std::vector<StvTreeNodePtr> children, bool is_expanded)
+{
+	auto folder = std::make_shared<StvTreeNode>();
+	folder->Name = name;
+	folder->IsFolder = true;
+	folder->IsExpanded = is_expanded;
+	folder->Children = std::move(children);
+
+	return folder;
+}
+
+StvTreeNodePtr StvTestTree::Root(std::vector<StvTreeNodePtr> children)
+{
+	auto root = std::make_shared<StvTreeNode>();
+	root->IsFolder = true;
+	root->IsExpanded = true;
+	root->Children = std::move(children);
+
+	return root;
+}
+
+QStringList StvTestTree::GetPaths(const StvTreeNodePtr &root)
+{
+	QStringList paths;
+	if(root)
+		StvTestTree::AddPaths(*root, QString(), paths);
+
+	return paths;
+}
+
+void StvTestTree::AddPaths(const StvTreeNode &folder, const QString &prefix, QStringList &paths)
+{
+	for(const auto &item : folder.Children)
+	{
+		const QString path = prefix + item->Name;
+		if(item->IsFolder)
+		{
+			paths.append(path + (item->IsExpanded ? "+" : "") + (item->IsSorted ? "~" : ""));
+			StvTestTree::AddPaths(*item, path + "/", paths);
+		}
+		else
+			paths.append(item->Uuid.isEmpty() ? path : path + "@" + item->Uuid);
+	}
+}
@@ -0,0 +1,35 @@
+#ifndef STV_TEST_TREE_H
+#define STV_TEST_TREE_H
+
+#include <QStringList>
+
+#include <vector>
+
+#include "obs_scene_tree_view/stv_tree_snapshot.h"
+
+
+/*!
+ * \brief Builds snapshot trees for tests and flattens them for comparison
+ */
+class StvTestTree
+{
+	public:
+		static StvTreeNodePtr Scene(const QString &name, const QString &uuid = QString());
+		static StvTreeNodePtr Folder(const QString &name, std::vector<StvTreeNodePtr> children, bool is_expanded = false);
+
+		/*!
+		 * \brief Root node as created by StvTreeSnapshot::Deserialize()
+		 */
+		static StvTreeNodePtr Root(std::vector<StvTreeNodePtr> children);
+
+		/*!
+		 * \brief Get the path of each item in tree order, e.g. "Folder/Scene". Expanded folders end with "+",
+		 * sorted ones with "~", scenes with a UUID with "@<uuid>"
+		 */
+		static QStringList GetPaths(const StvTreeNodePtr &root);
+
+	private:
+		static void AddPaths(const StvTreeNode &folder, const QString &prefix, QStringList &paths);
+};
+
+#endif // STV_TEST_TREE_H
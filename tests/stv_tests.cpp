@@ -0,0 +1,45 @@
+#include "tests/stv_scene_canvases_test.h"
+#include "tests/stv_tree_journal_test.h"
+#include "tests/stv_tree_snapshot_test.h"
+#include "tests/stv_tree_store_test.h"
+
+#include <obs-module.h>
+
+#include <QCoreApplication>
+#include <QTest>
+
+
+/*!
+ * \brief Runs the tests of the tree store, its file formats and the canvas index. They only use libobs' data and
+ * file functions and Qt Core, so neither OBS nor a display is needed
+ */
+extern "C" const char *obs_module_name(void)
+{
+	return "obs_scene_tree_view";
+}
+
+int main(int argc, char **argv)
+{
+	// Snapshots are serialized on the global thread pool
+	QCoreApplication app(argc, argv);
+
+	int status = 0;
+	{
+		StvSceneCanvasesTest canvases_test;
+		status |= QTest::qExec(&canvases_test, argc, argv);
+	}
+	{
+		StvTreeJournalTest journal_test;
+		status |= QTest::qExec(&journal_test, argc, argv);
+	}
+	{
+		StvTreeSnapshotTest snapshot_test;
+		status |= QTest::qExec(&snapshot_test, argc, argv);
+	}
+	{
+		StvTreeStoreTest store_test;
+		status |= QTest::qExec(&store_test, argc, argv);
+	}
+
+	return status;
+}
@@ -0,0 +1,227 @@
+#include "tests/stv_tree_journal_test.h"
+
+#include <QFile>
+#include <QTest>
+
+#include <cstring>
+
+
+void StvTreeJournalTest::EncodeDecode()
+{
+	for(const StvTreeOp &op : StvTreeJournalTest::CreateOps())
+	{
+		std::string buffer;
+		StvTreeJournal::Encode(op, buffer);
+
+		// Decoding must not depend on the previous content of op
+		StvTreeOp decoded_op;
+		decoded_op.Path = {7};
+		decoded_op.Uuid = "stale";
+		QVERIFY(StvTreeJournal::Decode(buffer.data(), buffer.size(), decoded_op));
+
+		StvTreeJournalTest::CompareOps({decoded_op}, {op});
+		if(QTest::currentTestFailed())
+			return;
+	}
+}
+
+void StvTreeJournalTest::DecodeInvalid()
+{
+	const StvTreeOp op = StvTreeJournalTest::CreateOps().front();
+
+	std::string buffer;
+	StvTreeJournal::Encode(op, buffer);
+
+	StvTreeOp decoded_op;
+	QVERIFY(!StvTreeJournal::Decode(buffer.data(), buffer.size()-1, decoded_op));
+
+	// The record size is stored separately, trailing bytes mean the record is corrupt
+	QVERIFY(!StvTreeJournal::Decode((buffer + '\0').data(), buffer.size()+1, decoded_op));
+
+	// The type is the first byte
+	for(const uint8_t type : {(uint8_t)0, (uint8_t)(StvTreeOp::SORT+1)})
+	{
+		std::string invalid_buffer = buffer;
+		invalid_buffer[0] = (char)type;
+		QVERIFY(!StvTreeJournal::Decode(invalid_buffer.data(), invalid_buffer.size(), decoded_op));
+	}
+}
+
+void StvTreeJournalTest::ReadAppended()
+{
+	const std::vector<StvTreeOp> ops = StvTreeJournalTest::CreateOps();
+	const std::vector<StvTreeOp> first_ops(ops.begin(), ops.begin()+2);
+	const std::vector<StvTreeOp> last_ops(ops.begin()+2, ops.end());
+
+	StvTreeJournal journal = this->CreateJournal("Read appended", 3, first_ops);
+	QVERIFY(journal.Append(last_ops));
+
+	StvTreeJournal read_journal(this->_dir.path().toStdString(), "Read appended");
+
+	std::vector<StvTreeOp> read_ops;
+	QVERIFY(read_journal.Read(3, read_ops));
+	StvTreeJournalTest::CompareOps(read_ops, ops);
+
+	QCOMPARE(read_journal.Size(), journal.Size());
+	QCOMPARE((qint64)read_journal.Size(), QFile(QString::fromStdString(journal.FilePath())).size());
+}
+
+void StvTreeJournalTest::ReadStaleGeneration()
+{
+	this->CreateJournal("Read stale", 3, StvTreeJournalTest::CreateOps());
+
+	StvTreeJournal journal(this->_dir.path().toStdString(), "Read stale");
+
+	std::vector<StvTreeOp> read_ops;
+	QVERIFY(!journal.Read(4, read_ops));
+	QVERIFY(read_ops.empty());
+	QCOMPARE(journal.Size(), (size_t)0);
+
+	// Missing journals can't be appended to either
+	StvTreeJournal missing_journal(this->_dir.path().toStdString(), "Read missing");
+	QVERIFY(!missing_journal.Read(0, read_ops));
+	QVERIFY(read_ops.empty());
+}
+
+void StvTreeJournalTest::ReadCorruptRecord()
+{
+	const std::vector<StvTreeOp> ops = StvTreeJournalTest::CreateOps();
+	const StvTreeJournal journal = this->CreateJournal("Read corrupt", 1, ops);
+
+	// The last byte belongs to the name of the last record, so only its CRC doesn't match
+	QFile file(QString::fromStdString(journal.FilePath()));
+	QVERIFY(file.open(QIODevice::ReadWrite));
+
+	QVERIFY(file.seek(file.size()-1));
+	char last_byte;
+	QVERIFY(file.getChar(&last_byte));
+	QVERIFY(file.seek(file.size()-1));
+	QVERIFY(file.putChar((char)(last_byte ^ 0x20)));
+	file.close();
+
+	StvTreeJournal read_journal(this->_dir.path().toStdString(), "Read corrupt");
+
+	std::vector<StvTreeOp> read_ops;
+	QVERIFY(!read_journal.Read(1, read_ops));
+	StvTreeJournalTest::CompareOps(read_ops, std::vector<StvTreeOp>(ops.begin(), ops.end()-1));
+	QVERIFY(read_journal.Size() < journal.Size());
+}
+
+void StvTreeJournalTest::ReadTruncatedRecord()
+{
+	const std::vector<StvTreeOp> ops = StvTreeJournalTest::CreateOps();
+	const StvTreeJournal journal = this->CreateJournal("Read truncated", 1, ops);
+
+	// Writing stopped in the middle of the last record
+	QVERIFY(QFile::resize(QString::fromStdString(journal.FilePath()), (qint64)journal.Size()-1));
+
+	StvTreeJournal read_journal(this->_dir.path().toStdString(), "Read truncated");
+
+	std::vector<StvTreeOp> read_ops;
+	QVERIFY(!read_journal.Read(1, read_ops));
+	StvTreeJournalTest::CompareOps(read_ops, std::vector<StvTreeOp>(ops.begin(), ops.end()-1));
+}
+
+void StvTreeJournalTest::ReadVersion1()
+{
+	// Version 1 records never carry a UUID
+	std::vector<StvTreeOp> ops = StvTreeJournalTest::CreateOps();
+	for(auto &op : ops)
+		op.Uuid.clear();
+
+	StvTreeJournal journal(this->_dir.path().toStdString(), "Read version 1");
+
+	const uint64_t generation = 2;
+	QFile file(QString::fromStdString(journal.FilePath()));
+	QVERIFY(file.open(QIODevice::WriteOnly));
+	QVERIFY(file.write("STVJRNL1", 8) == 8);
+	QVERIFY(file.write((const char*)&generation, sizeof(generation)) == sizeof(generation));
+	file.close();
+
+	QVERIFY(journal.Append(ops));
+
+	// Records are read, but the journal must be reset before new records are appended
+	std::vector<StvTreeOp> read_ops;
+	QVERIFY(!journal.Read(generation, read_ops));
+	StvTreeJournalTest::CompareOps(read_ops, ops);
+}
+
+std::vector<StvTreeOp> StvTreeJournalTest::CreateOps()
+{
+	std::vector<StvTreeOp> ops;
+
+	StvTreeOp insert_scene;
+	insert_scene.Type = StvTreeOp::INSERT;
+	insert_scene.Path = {0, 2};
+	insert_scene.Row = 1;
+	insert_scene.Name = "Scene ä";
+	insert_scene.Uuid = "0c4d7a52-3a3e-4c5b-8d0e-6f1a2b3c4d5e";
+	ops.push_back(insert_scene);
+
+	StvTreeOp insert_folder;
+	insert_folder.Type = StvTreeOp::INSERT;
+	insert_folder.Row = 0;
+	insert_folder.IsFolder = true;
+	insert_folder.IsExpanded = true;
+	insert_folder.Name = "Folder";
+	ops.push_back(insert_folder);
+
+	StvTreeOp move;
+	move.Type = StvTreeOp::MOVE;
+	move.Path = {1, 0};
+	move.TargetPath = {0};
+	move.Row = 3;
+	ops.push_back(move);
+
+	StvTreeOp remove;
+	remove.Type = StvTreeOp::REMOVE;
+	remove.Path = {4};
+	ops.push_back(remove);
+
+	StvTreeOp expand;
+	expand.Type = StvTreeOp::EXPAND;
+	expand.Path = {0};
+	expand.IsExpanded = true;
+	ops.push_back(expand);
+
+	StvTreeOp sort;
+	sort.Type = StvTreeOp::SORT;
+	sort.Path = {0};
+	sort.IsSorted = true;
+	ops.push_back(sort);
+
+	// Last, so the last byte of a journal is part of a name
+	StvTreeOp rename;
+	rename.Type = StvTreeOp::RENAME;
+	rename.Path = {0, 1};
+	rename.Name = "Renamed";
+	ops.push_back(rename);
+
+	return ops;
+}
+
+void StvTreeJournalTest::CompareOps(const std::vector<StvTreeOp> &ops, const std::vector<StvTreeOp> &expected_ops)
+{
+	QCOMPARE(ops.size(), expected_ops.size());
+	for(size_t i = 0; i < ops.size(); ++i)
+	{
+		QCOMPARE(ops[i].Type, expected_ops[i].Type);
+		QCOMPARE(ops[i].Path, expected_ops[i].Path);
+		QCOMPARE(ops[i].TargetPath, expected_ops[i].TargetPath);
+		QCOMPARE(ops[i].Row, expected_ops[i].Row);
+		QCOMPARE(ops[i].IsFolder, expected_ops[i].IsFolder);
+		QCOMPARE(ops[i].IsExpanded, expected_ops[i].IsExpanded);
+		QCOMPARE(ops[i].IsSorted, expected_ops[i].IsSorted);
+		QCOMPARE(ops[i].Name, expected_ops[i].Name);
+		QCOMPARE(ops[i].Uuid, expected_ops[i].Uuid);
+	}
+}
+
+StvTreeJournal StvTreeJournalTest::CreateJournal(const char *scene_collection, uint64_t generation, const std::vector<StvTreeOp> &ops)
+{
+	StvTreeJournal journal(this->_dir.path().toStdString(), scene_collection);
+	if(!journal.Reset(generation) || !journal.Append(ops))
+		QTest::qFail("Failed to write journal", __FILE__, __LINE__);
+
+	return journal;
+}
@@ -0,0 +1,39 @@
+#ifndef STV_TREE_JOURNAL_TEST_H
+#define STV_TREE_JOURNAL_TEST_H
+
+#include <QObject>
+#include <QTemporaryDir>
+
+#include <vector>
+
+#include "obs_scene_tree_view/stv_tree_journal.h"
+
+
+class StvTreeJournalTest
+        : public QObject
+{
+		Q_OBJECT
+
+	private slots:
+		void EncodeDecode();
+		void DecodeInvalid();
+
+		void ReadAppended();
+		void ReadStaleGeneration();
+		void ReadCorruptRecord();
+		void ReadTruncatedRecord();
+		void ReadVersion1();
+
+	private:
+		QTemporaryDir _dir;
+
+		/*!
+		 * \brief One op of each type, with all fields set that the type uses
+		 */
+		static std::vector<StvTreeOp> CreateOps();
+		static void CompareOps(const std::vector<StvTreeOp> &ops, const std::vector<StvTreeOp> &expected_ops);
+
+		StvTreeJournal CreateJournal(const char *scene_collection, uint64_t generation, const std::vector<StvTreeOp> &ops);
+};
+
+#endif // STV_TREE_JOURNAL_TEST_H
@@ -0,0 +1,226 @@
+#include "tests/stv_tree_snapshot_test.h"
+
+#include "tests/stv_test_tree.h"
+
+#include <obs.hpp>
+
+#include <QTest>
+
+
+void StvTreeSnapshotTest::init()
+{
+	this->_tree = StvTestTree::Root({
+		StvTestTree::Folder("A", {StvTestTree::Scene("1"), StvTestTree::Scene("2")}, true),
+		StvTestTree::Scene("3"),
+	});
+}
+
+void StvTreeSnapshotTest::ApplyInsert()
+{
+	StvTreeOp insert_scene = StvTreeSnapshotTest::CreateOp(StvTreeOp::INSERT, {0});
+	insert_scene.Row = 1;
+	insert_scene.Name = "4";
+
+	const StvTreeNodePtr tree = StvTreeSnapshot::Apply(this->_tree, insert_scene);
+	QVERIFY(tree);
+	QCOMPARE(StvTestTree::GetPaths(tree), QStringList({"A+", "A/1", "A/4", "A/2", "3"}));
+
+	// Snapshots are immutable, untouched items are shared
+	QCOMPARE(StvTestTree::GetPaths(this->_tree), QStringList({"A+", "A/1", "A/2", "3"}));
+	QVERIFY(tree->Children[1] == this->_tree->Children[1]);
+	QVERIFY(tree->Children[0]->Children[0] == this->_tree->Children[0]->Children[0]);
+
+	StvTreeOp insert_folder = StvTreeSnapshotTest::CreateOp(StvTreeOp::INSERT, {});
+	insert_folder.Row = 2;
+	insert_folder.Name = "B";
+	insert_folder.IsFolder = true;
+	insert_folder.IsExpanded = true;
+
+	const StvTreeNodePtr folder_tree = StvTreeSnapshot::Apply(tree, insert_folder);
+	QVERIFY(folder_tree);
+	QCOMPARE(StvTestTree::GetPaths(folder_tree), QStringList({"A+", "A/1", "A/4", "A/2", "3", "B+"}));
+}
+
+void StvTreeSnapshotTest::ApplyInsertUuid()
+{
+	StvTreeOp insert_scene = StvTreeSnapshotTest::CreateOp(StvTreeOp::INSERT, {0});
+	insert_scene.Row = 2;
+	insert_scene.Name = "4";
+	insert_scene.Uuid = "u4";
+
+	const StvTreeNodePtr tree = StvTreeSnapshot::Apply(this->_tree, insert_scene);
+	QVERIFY(tree);
+	QCOMPARE(StvTestTree::GetPaths(tree), QStringList({"A+", "A/1", "A/2", "A/4@u4", "3"}));
+
+	// Folders don't keep a UUID
+	StvTreeOp insert_folder = StvTreeSnapshotTest::CreateOp(StvTreeOp::INSERT, {});
+	insert_folder.Row = 0;
+	insert_folder.Name = "B";
+	insert_folder.Uuid = "u5";
+	insert_folder.IsFolder = true;
+
+	const StvTreeNodePtr folder_tree = StvTreeSnapshot::Apply(tree, insert_folder);
+	QVERIFY(folder_tree);
+	QCOMPARE(StvTestTree::GetPaths(folder_tree), QStringList({"B", "A+", "A/1", "A/2", "A/4@u4", "3"}));
+}
+
+void StvTreeSnapshotTest::ApplyInsertInvalid()
+{
+	StvTreeOp op = StvTreeSnapshotTest::CreateOp(StvTreeOp::INSERT, {0});
+	op.Name = "4";
+
+	op.Row = 3;
+	QVERIFY(!StvTreeSnapshot::Apply(this->_tree, op));
+
+	op.Row = -1;
+	QVERIFY(!StvTreeSnapshot::Apply(this->_tree, op));
+
+	// Scenes have no children
+	op.Row = 0;
+	op.Path = {1};
+	QVERIFY(!StvTreeSnapshot::Apply(this->_tree, op));
+
+	op.Path = {2};
+	QVERIFY(!StvTreeSnapshot::Apply(this->_tree, op));
+}
+
+void StvTreeSnapshotTest::ApplyMove()
+{
+	StvTreeOp move_out = StvTreeSnapshotTest::CreateOp(StvTreeOp::MOVE, {0, 0});
+	move_out.TargetPath = {};
+	move_out.Row = 2;
+
+	const StvTreeNodePtr tree = StvTreeSnapshot::Apply(this->_tree, move_out);
+	QVERIFY(tree);
+	QCOMPARE(StvTestTree::GetPaths(tree), QStringList({"A+", "A/2", "3", "1"}));
+
+	// Moved items aren't copied
+	QVERIFY(tree->Children[2] == this->_tree->Children[0]->Children[0]);
+
+	// The target path is resolved after the item was removed
+	StvTreeOp move_in = StvTreeSnapshotTest::CreateOp(StvTreeOp::MOVE, {1});
+	move_in.TargetPath = {0};
+	move_in.Row = 0;
+
+	const StvTreeNodePtr moved_in_tree = StvTreeSnapshot::Apply(tree, move_in);
+	QVERIFY(moved_in_tree);
+	QCOMPARE(StvTestTree::GetPaths(moved_in_tree), QStringList({"A+", "A/3", "A/2", "1"}));
+}
+
+void StvTreeSnapshotTest::ApplyMoveInvalid()
+{
+	StvTreeOp op = StvTreeSnapshotTest::CreateOp(StvTreeOp::MOVE, {});
+	QVERIFY(!StvTreeSnapshot::Apply(this->_tree, op));
+
+	op.Path = {2};
+	QVERIFY(!StvTreeSnapshot::Apply(this->_tree, op));
+
+	// Row is checked against the parent without the moved item
+	op.Path = {0, 0};
+	op.TargetPath = {0};
+	op.Row = 2;
+	QVERIFY(!StvTreeSnapshot::Apply(this->_tree, op));
+
+	// Scene 3 isn't at row 1 anymore once it was removed
+	op.Path = {1};
+	op.TargetPath = {1};
+	op.Row = 0;
+	QVERIFY(!StvTreeSnapshot::Apply(this->_tree, op));
+}
+
+void StvTreeSnapshotTest::ApplyRename()
+{
+	StvTreeOp op = StvTreeSnapshotTest::CreateOp(StvTreeOp::RENAME, {0});
+	op.Name = "B";
+
+	const StvTreeNodePtr tree = StvTreeSnapshot::Apply(this->_tree, op);
+	QVERIFY(tree);
+	QCOMPARE(StvTestTree::GetPaths(tree), QStringList({"B+", "B/1", "B/2", "3"}));
+	QVERIFY(tree->Children[0]->Children[0] == this->_tree->Children[0]->Children[0]);
+
+	op.Path = {0, 1};
+	op.Name = "5";
+	QCOMPARE(StvTestTree::GetPaths(StvTreeSnapshot::Apply(tree, op)), QStringList({"B+", "B/1", "B/5", "3"}));
+
+	op.Path = {0, 2};
+	QVERIFY(!StvTreeSnapshot::Apply(tree, op));
+}
+
+void StvTreeSnapshotTest::ApplyRemove()
+{
+	const StvTreeNodePtr tree = StvTreeSnapshot::Apply(this->_tree, StvTreeSnapshotTest::CreateOp(StvTreeOp::REMOVE, {0, 1}));
+	QVERIFY(tree);
+	QCOMPARE(StvTestTree::GetPaths(tree), QStringList({"A+", "A/1", "3"}));
+
+	// Folders are removed with their items
+	const StvTreeNodePtr folder_tree = StvTreeSnapshot::Apply(tree, StvTreeSnapshotTest::CreateOp(StvTreeOp::REMOVE, {0}));
+	QVERIFY(folder_tree);
+	QCOMPARE(StvTestTree::GetPaths(folder_tree), QStringList({"3"}));
+
+	// The root can't be removed
+	QVERIFY(!StvTreeSnapshot::Apply(this->_tree, StvTreeSnapshotTest::CreateOp(StvTreeOp::REMOVE, {})));
+	QVERIFY(!StvTreeSnapshot::Apply(this->_tree, StvTreeSnapshotTest::CreateOp(StvTreeOp::REMOVE, {0, 2})));
+}
+
+void StvTreeSnapshotTest::ApplyExpand()
+{
+	StvTreeOp collapse = StvTreeSnapshotTest::CreateOp(StvTreeOp::EXPAND, {0});
+	collapse.IsExpanded = false;
+
+	const StvTreeNodePtr tree = StvTreeSnapshot::Apply(this->_tree, collapse);
+	QVERIFY(tree);
+	QCOMPARE(StvTestTree::GetPaths(tree), QStringList({"A", "A/1", "A/2", "3"}));
+
+	// Only folders can be expanded
+	collapse.Path = {1};
+	QVERIFY(!StvTreeSnapshot::Apply(this->_tree, collapse));
+}
+
+void StvTreeSnapshotTest::ApplySort()
+{
+	StvTreeOp sort = StvTreeSnapshotTest::CreateOp(StvTreeOp::SORT, {0});
+	sort.IsSorted = true;
+
+	// Items keep their order, reordering is recorded as separate moves
+	const StvTreeNodePtr tree = StvTreeSnapshot::Apply(this->_tree, sort);
+	QVERIFY(tree);
+	QCOMPARE(StvTestTree::GetPaths(tree), QStringList({"A+~", "A/1", "A/2", "3"}));
+
+	sort.IsSorted = false;
+	QCOMPARE(StvTestTree::GetPaths(StvTreeSnapshot::Apply(tree, sort)), StvTestTree::GetPaths(this->_tree));
+
+	// Only folders can be sorted
+	sort.Path = {0, 0};
+	QVERIFY(!StvTreeSnapshot::Apply(this->_tree, sort));
+}
+
+void StvTreeSnapshotTest::SerializeRoundTrip()
+{
+	// Enough top-level items to be split into several chunks
+	std::vector<StvTreeNodePtr> items;
+	for(int i = 0; i < 64; ++i)
+		items.push_back(StvTestTree::Scene(QString::number(i), QString("u%1").arg(i)));
+
+	auto folder = std::make_shared<StvTreeNode>(*StvTestTree::Folder("Sorted", {StvTestTree::Scene("Without UUID")}));
+	folder->IsSorted = true;
+	items.insert(items.begin() + 10, std::move(folder));
+	items.push_back(StvTestTree::Folder("Empty", {}, true));
+
+	const StvTreeNodePtr tree = StvTestTree::Root(std::move(items));
+
+	OBSDataArrayAutoRelease folder_data = StvTreeSnapshot::Serialize(*tree);
+	QCOMPARE(obs_data_array_count(folder_data), tree->Children.size());
+	QCOMPARE(StvTestTree::GetPaths(StvTreeSnapshot::Deserialize(folder_data)), StvTestTree::GetPaths(tree));
+
+	OBSDataArrayAutoRelease sequential_folder_data = StvTreeSnapshot::SerializeFolder(*tree);
+	QCOMPARE(StvTestTree::GetPaths(StvTreeSnapshot::Deserialize(sequential_folder_data)), StvTestTree::GetPaths(tree));
+}
+
+StvTreeOp StvTreeSnapshotTest::CreateOp(StvTreeOp::TYPE type, std::vector<int> path)
+{
+	StvTreeOp op;
+	op.Type = type;
+	op.Path = std::move(path);
+
+	return op;
+}
@@ -0,0 +1,36 @@
+#ifndef STV_TREE_SNAPSHOT_TEST_H
+#define STV_TREE_SNAPSHOT_TEST_H
+
+#include <QObject>
+
+#include "obs_scene_tree_view/stv_tree_snapshot.h"
+
+
+class StvTreeSnapshotTest
+        : public QObject
+{
+		Q_OBJECT
+
+	private slots:
+		void init();
+
+		void ApplyInsert();
+		void ApplyInsertUuid();
+		void ApplyInsertInvalid();
+		void ApplyMove();
+		void ApplyMoveInvalid();
+		void ApplyRename();
+		void ApplyRemove();
+		void ApplyExpand();
+		void ApplySort();
+
+		void SerializeRoundTrip();
+
+	private:
+		// Folder A (expanded) with scenes 1 and 2, followed by scene 3
+		StvTreeNodePtr _tree;
+
+		static StvTreeOp CreateOp(StvTreeOp::TYPE type, std::vector<int> path);
+};
+
+#endif // STV_TREE_SNAPSHOT_TEST_H
@@ -0,0 +1,374 @@
+#include "tests/stv_tree_store_test.h"
+
+#include "tests/stv_test_tree.h"
+
+#include <QFile>
+#include <QTest>
+
+#include <algorithm>
+
+
+namespace
+{
+	const std::string CANVAS = "1280x720";
+
+	StvTreeNodePtr create_tree(const QString &scene_name)
+	{
+		return StvTestTree::Root({
+			StvTestTree::Folder("Folder", {StvTestTree::Scene(scene_name, "u-" + scene_name)}, true),
+		});
+	}
+
+	bool journal_exists(const std::string &journal_dir, const std::string &tree_name)
+	{
+		return QFile::exists(QString::fromStdString(StvTreeJournal(journal_dir, tree_name.c_str()).FilePath()));
+	}
+}
+
+
+void StvTreeStoreTest::init()
+{
+	this->_dir = std::make_unique<QTemporaryDir>();
+	QVERIFY(this->_dir->isValid());
+}
+
+void StvTreeStoreTest::cleanup()
+{
+	this->_dir.reset();
+}
+
+void StvTreeStoreTest::CanvasTreeNames()
+{
+	const std::string canvas_name = StvTreeStore::GetCanvasTreeName("Coll", CANVAS);
+	QCOMPARE(canvas_name, std::string("Coll\x1f" "1280x720"));
+	QCOMPARE(StvTreeStore::GetCanvasTreeName("Coll", std::string()), std::string("Coll"));
+
+	QCOMPARE(StvTreeStore::GetSceneCollection(canvas_name), std::string_view("Coll"));
+	QCOMPARE(StvTreeStore::GetSceneCollection("Coll"), std::string_view("Coll"));
+	QCOMPARE(StvTreeStore::GetSceneCollection("Coll 2"), std::string_view("Coll 2"));
+}
+
+void StvTreeStoreTest::Rename()
+{
+	const std::string canvas_name = StvTreeStore::GetCanvasTreeName("Coll", CANVAS);
+	const std::string other_name = "Coll 2";
+	const std::string other_canvas_name = StvTreeStore::GetCanvasTreeName(other_name.c_str(), CANVAS);
+
+	std::unique_ptr<StvTreeStore> store = this->CreateStore();
+	QVERIFY(store->Open());
+
+	store->Save("Coll", create_tree("Base"));
+	store->Save(canvas_name.c_str(), create_tree("Canvas"));
+	store->Save(other_name.c_str(), create_tree("Other"));
+	store->Save(other_canvas_name.c_str(), create_tree("Other canvas"));
+
+	// All canvases of the collection move, collections that only share a prefix stay
+	store->Rename("Coll", "New");
+	store->Flush();
+
+	QVERIFY(!journal_exists(this->GetJournalDir(), "Coll"));
+	QVERIFY(!journal_exists(this->GetJournalDir(), canvas_name));
+	QVERIFY(journal_exists(this->GetJournalDir(), "New"));
+	QVERIFY(journal_exists(this->GetJournalDir(), StvTreeStore::GetCanvasTreeName("New", CANVAS)));
+
+	store = this->CreateStore();
+
+	std::vector<std::string> expected_collections = {"New", StvTreeStore::GetCanvasTreeName("New", CANVAS), other_name, other_canvas_name};
+	std::sort(expected_collections.begin(), expected_collections.end());
+	QCOMPARE(StvTreeStoreTest::GetSortedCollections(*store), expected_collections);
+
+	QCOMPARE(StvTestTree::GetPaths(store->Read("New")), StvTestTree::GetPaths(create_tree("Base")));
+	QCOMPARE(StvTestTree::GetPaths(store->Read(StvTreeStore::GetCanvasTreeName("New", CANVAS).c_str())),
+	         StvTestTree::GetPaths(create_tree("Canvas")));
+	QCOMPARE(StvTestTree::GetPaths(store->Read(other_canvas_name.c_str())), StvTestTree::GetPaths(create_tree("Other canvas")));
+	QVERIFY(!store->Read("Coll"));
+	QVERIFY(!store->Read(canvas_name.c_str()));
+}
+
+void StvTreeStoreTest::RenameLoaded()
+{
+	const std::string canvas_name = StvTreeStore::GetCanvasTreeName("Coll", CANVAS);
+	const std::string new_canvas_name = StvTreeStore::GetCanvasTreeName("New", CANVAS);
+
+	std::unique_ptr<StvTreeStore> store = this->CreateStore();
+	store->Save(canvas_name.c_str(), create_tree("Canvas"));
+	QVERIFY(store->Load(canvas_name.c_str()));
+
+	StvTreeOp insert;
+	insert.Type = StvTreeOp::INSERT;
+	insert.Path = {0};
+	insert.Row = 1;
+	insert.Name = "Journaled";
+	insert.Uuid = "u-Journaled";
+
+	// The edit may still be queued while renaming, it must not stay behind in the old journal
+	store->Append(canvas_name.c_str(), {insert});
+	store->Rename("Coll", "New");
+
+	const QStringList expected_paths = {"Folder+", "Folder/Canvas@u-Canvas", "Folder/Journaled@u-Journaled"};
+	QCOMPARE(StvTestTree::GetPaths(store->Load(new_canvas_name.c_str())), expected_paths);
+
+	// The renamed tree stays loaded, following edits go to the new journal
+	StvTreeOp rename;
+	rename.Type = StvTreeOp::RENAME;
+	rename.Path = {0};
+	rename.Name = "Renamed";
+	store->Append(new_canvas_name.c_str(), {rename});
+
+	store = this->CreateStore();
+
+	QCOMPARE(StvTestTree::GetPaths(store->Read(new_canvas_name.c_str())),
+	         QStringList({"Renamed+", "Renamed/Canvas@u-Canvas", "Renamed/Journaled@u-Journaled"}));
+	QVERIFY(!store->Read(canvas_name.c_str()));
+}
+
+void StvTreeStoreTest::AppendMismatched()
+{
+	std::unique_ptr<StvTreeStore> store = this->CreateStore();
+	store->Save("Coll", create_tree("Coll"));
+	QVERIFY(store->Load("Coll"));
+
+	StvTreeOp insert;
+	insert.Type = StvTreeOp::INSERT;
+	insert.Path = {0};
+	insert.Row = 1;
+	insert.Name = "Inserted";
+
+	StvTreeOp mismatched_rename;
+	mismatched_rename.Type = StvTreeOp::RENAME;
+	mismatched_rename.Path = {3};
+	mismatched_rename.Name = "Missing";
+
+	StvTreeOp rename;
+	rename.Type = StvTreeOp::RENAME;
+	rename.Path = {0};
+	rename.Name = "Renamed";
+
+	// Edits following the mismatched one must survive replaying the journal
+	store->Append("Coll", {insert, mismatched_rename, rename});
+	store->Append("Coll", {mismatched_rename});
+
+	const QStringList expected_paths = {"Renamed+", "Renamed/Coll@u-Coll", "Renamed/Inserted"};
+	QCOMPARE(StvTestTree::GetPaths(store->Load("Coll")), expected_paths);
+
+	store = this->CreateStore();
+	QCOMPARE(StvTestTree::GetPaths(store->Read("Coll")), expected_paths);
+}
+
+void StvTreeStoreTest::LoadVersion1Journal()
+{
+	this->CreateVersion1Journal();
+	if(QTest::currentTestFailed())
+		return;
+
+	std::unique_ptr<StvTreeStore> store = this->CreateStore();
+	const QStringList expected_paths = {"Renamed+", "Renamed/Coll@u-Coll", "Renamed/Version 1"};
+	QCOMPARE(StvTestTree::GetPaths(store->Load("Coll")), expected_paths);
+
+	// The journal is replaced by a checkpoint, new edits are appended to a version 2 journal
+	StvTreeOp insert;
+	insert.Type = StvTreeOp::INSERT;
+	insert.Path = {0};
+	insert.Row = 0;
+	insert.Name = "Version 2";
+	insert.Uuid = "u-Version 2";
+	store->Append("Coll", {insert});
+
+	store = this->CreateStore();
+	QCOMPARE(StvTestTree::GetPaths(store->Read("Coll")),
+	         QStringList({"Renamed+", "Renamed/Version 2@u-Version 2", "Renamed/Coll@u-Coll", "Renamed/Version 1"}));
+}
+
+void StvTreeStoreTest::RenameVersion1Journal()
+{
+	this->CreateVersion1Journal();
+	if(QTest::currentTestFailed())
+		return;
+
+	// Edits of trees that weren't loaded only exist in the journal, which is removed by the rename
+	std::unique_ptr<StvTreeStore> store = this->CreateStore();
+	store->Rename("Coll", "New");
+	store->Flush();
+
+	QVERIFY(!journal_exists(this->GetJournalDir(), "Coll"));
+
+	store = this->CreateStore();
+	QCOMPARE(StvTestTree::GetPaths(store->Read("New")), QStringList({"Renamed+", "Renamed/Coll@u-Coll", "Renamed/Version 1"}));
+	QVERIFY(!store->Read("Coll"));
+}
+
+void StvTreeStoreTest::Compact()
+{
+	std::unique_ptr<StvTreeStore> store = this->CreateStore();
+	for(const char *tree_name : {"Coll", "Gone"})
+		store->Save(tree_name, create_tree(tree_name));
+
+	// Trees of missing collections are only marked at first
+	store->Compact({"Coll"}, -1);
+	QCOMPARE(StvTreeStoreTest::GetSortedCollections(*store), std::vector<std::string>({"Coll", "Gone"}));
+
+	{
+		OBSDataAutoRelease root = obs_data_create_from_json_file(this->GetFilePath().c_str());
+		OBSDataAutoRelease orphaned = obs_data_get_obj(root, StvTreeStore::ORPHANED_KEY.data());
+		QVERIFY(obs_data_has_user_value(orphaned, "Gone"));
+		QVERIFY(!obs_data_has_user_value(orphaned, "Coll"));
+	}
+
+	// Collections that reappear are no longer orphaned, and are only marked again when they disappear
+	store->Compact({"Coll", "Gone"}, -1);
+	store->Compact({"Coll"}, -1);
+	QCOMPARE(StvTreeStoreTest::GetSortedCollections(*store), std::vector<std::string>({"Coll", "Gone"}));
+
+	store->Compact({"Coll"}, -1);
+	QCOMPARE(StvTreeStoreTest::GetSortedCollections(*store), std::vector<std::string>({"Coll"}));
+	QVERIFY(!journal_exists(this->GetJournalDir(), "Gone"));
+	QVERIFY(journal_exists(this->GetJournalDir(), "Coll"));
+
+	store = this->CreateStore();
+	QCOMPARE(StvTreeStoreTest::GetSortedCollections(*store), std::vector<std::string>({"Coll"}));
+	QCOMPARE(StvTestTree::GetPaths(store->Read("Coll")), StvTestTree::GetPaths(create_tree("Coll")));
+}
+
+void StvTreeStoreTest::CompactUnchanged()
+{
+	const QString file_path = QString::fromStdString(this->GetFilePath());
+
+	// Compacting at startup doesn't create a store
+	std::unique_ptr<StvTreeStore> store = this->CreateStore();
+	store->Compact({"Coll"}, -1);
+	store->Flush();
+	QVERIFY(!QFile::exists(file_path));
+
+	store->Save("Coll", create_tree("Coll"));
+	store->Flush();
+	QVERIFY(QFile::exists(file_path));
+
+	// Nor does it rewrite the file if all collections exist. The store keeps the file's data, so removing the file
+	// shows whether it was written again
+	QVERIFY(QFile::remove(file_path));
+	store->Compact({"Coll"}, -1);
+	store->Flush();
+	QVERIFY(!QFile::exists(file_path));
+
+	store->Compact({}, -1);
+	store->Flush();
+	QVERIFY(QFile::exists(file_path));
+}
+
+void StvTreeStoreTest::CompactCanvasTrees()
+{
+	const std::string canvas_name = StvTreeStore::GetCanvasTreeName("Coll", CANVAS);
+	const std::string gone_canvas_name = StvTreeStore::GetCanvasTreeName("Gone", CANVAS);
+
+	std::unique_ptr<StvTreeStore> store = this->CreateStore();
+	for(const std::string &tree_name : {std::string("Coll"), canvas_name, gone_canvas_name})
+		store->Save(tree_name.c_str(), create_tree(QString::fromStdString(tree_name)));
+
+	// Canvas trees belong to their collection, even if it has no tree for the base canvas
+	store->Compact({"Coll"}, -1);
+	store->Compact({"Coll"}, -1);
+
+	std::vector<std::string> expected_trees = {"Coll", canvas_name};
+	std::sort(expected_trees.begin(), expected_trees.end());
+	QCOMPARE(StvTreeStoreTest::GetSortedCollections(*store), expected_trees);
+	QVERIFY(!journal_exists(this->GetJournalDir(), gone_canvas_name));
+	QVERIFY(journal_exists(this->GetJournalDir(), canvas_name));
+
+	store = this->CreateStore();
+	QCOMPARE(StvTestTree::GetPaths(store->Read(canvas_name.c_str())), StvTestTree::GetPaths(create_tree(QString::fromStdString(canvas_name))));
+}
+
+void StvTreeStoreTest::CheckpointLargeFile()
+{
+	std::vector<StvTreeNodePtr> scenes;
+	for(int i = 0; i < 4000; ++i)
+		scenes.push_back(StvTestTree::Scene(QString("Scene %1").arg(i), QString("0c4d7a52-3a3e-4c5b-8d0e-%1").arg(i)));
+
+	std::unique_ptr<StvTreeStore> store = this->CreateStore();
+	store->Save("Large", StvTestTree::Root(std::move(scenes)));
+	store->Save("Coll", create_tree("Coll"));
+	QVERIFY(store->Load("Coll"));
+
+	const qint64 file_size = QFile(QString::fromStdString(this->GetFilePath())).size();
+	QVERIFY(file_size > 2*(qint64)StvTreeJournal::COMPACTION_THRESHOLD);
+
+	const QString journal_path = QString::fromStdString(StvTreeJournal(this->GetJournalDir(), "Coll").FilePath());
+
+	// Rewriting the file for every few edits of a single collection costs more than replaying them
+	StvTreeOp rename;
+	rename.Type = StvTreeOp::RENAME;
+	rename.Path = {0};
+
+	qint64 journal_size = 0;
+	for(int i = 0; i < 10000; ++i)
+	{
+		rename.Name = QString("Folder %1 ").arg(i).append(QString(100, 'x'));
+		store->Append("Coll", {rename});
+		store->Flush();
+
+		const qint64 new_journal_size = QFile(journal_path).size();
+		if(new_journal_size < journal_size)
+			break;
+
+		journal_size = new_journal_size;
+	}
+
+	QVERIFY(journal_size > (qint64)StvTreeJournal::COMPACTION_THRESHOLD);
+	QVERIFY(journal_size > file_size/2 - 1024);
+	QVERIFY(journal_size <= file_size/2);
+
+	store = this->CreateStore();
+	QCOMPARE(StvTestTree::GetPaths(store->Read("Coll")).first(), rename.Name + "+");
+}
+
+std::string StvTreeStoreTest::GetFilePath() const
+{
+	return this->_dir->filePath("scene_tree.json").toStdString();
+}
+
+std::string StvTreeStoreTest::GetJournalDir() const
+{
+	return this->_dir->filePath("scene_tree_journal").toStdString();
+}
+
+std::unique_ptr<StvTreeStore> StvTreeStoreTest::CreateStore() const
+{
+	return std::make_unique<StvTreeStore>(this->GetFilePath().c_str(), this->GetJournalDir().c_str());
+}
+
+void StvTreeStoreTest::CreateVersion1Journal()
+{
+	{
+		std::unique_ptr<StvTreeStore> store = this->CreateStore();
+		store->Save("Coll", create_tree("Coll"));
+	}
+
+	StvTreeOp insert;
+	insert.Type = StvTreeOp::INSERT;
+	insert.Path = {0};
+	insert.Row = 1;
+	insert.Name = "Version 1";
+
+	StvTreeOp rename;
+	rename.Type = StvTreeOp::RENAME;
+	rename.Path = {0};
+	rename.Name = "Renamed";
+
+	// Version 2 records without UUID equal those of version 1, only the magic differs
+	StvTreeJournal journal(this->GetJournalDir(), "Coll");
+	QVERIFY(journal.Reset(1));
+	QVERIFY(journal.Append({insert, rename}));
+
+	QFile file(QString::fromStdString(journal.FilePath()));
+	QVERIFY(file.open(QIODevice::ReadWrite));
+	QVERIFY(file.seek(sizeof(StvTreeJournal::MAGIC)-1));
+	QVERIFY(file.putChar('1'));
+}
+
+std::vector<std::string> StvTreeStoreTest::GetSortedCollections(StvTreeStore &store)
+{
+	std::vector<std::string> scene_collections = store.GetSceneCollections();
+	std::sort(scene_collections.begin(), scene_collections.end());
+
+	return scene_collections;
+}
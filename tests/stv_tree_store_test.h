@@ -0,0 +1,57 @@
+#ifndef STV_TREE_STORE_TEST_H
+#define STV_TREE_STORE_TEST_H
+
+#include <QObject>
+#include <QTemporaryDir>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "obs_scene_tree_view/stv_tree_store.h"
+
+
+class StvTreeStoreTest
+        : public QObject
+{
+		Q_OBJECT
+
+	private slots:
+		void init();
+		void cleanup();
+
+		void CanvasTreeNames();
+
+		void Rename();
+		void RenameLoaded();
+
+		void AppendMismatched();
+
+		void LoadVersion1Journal();
+		void RenameVersion1Journal();
+
+		void Compact();
+		void CompactUnchanged();
+		void CompactCanvasTrees();
+		void CheckpointLargeFile();
+
+	private:
+		std::unique_ptr<QTemporaryDir> _dir;
+
+		std::string GetFilePath() const;
+		std::string GetJournalDir() const;
+
+		/*!
+		 * \brief Create a store that reads the files written by previous stores
+		 */
+		std::unique_ptr<StvTreeStore> CreateStore() const;
+
+		/*!
+		 * \brief Store a tree for "Coll" whose journal was written by version 1, i.e. without UUIDs
+		 */
+		void CreateVersion1Journal();
+
+		static std::vector<std::string> GetSortedCollections(StvTreeStore &store);
+};
+
+#endif // STV_TREE_STORE_TEST_H